@@ -40,30 +40,6 @@ static struct hashtable_t *host_hash = NULL;
 const char *bat_hosts_path[3] = {"/etc/bat-hosts", "~/bat-hosts", "bat-hosts"};
 
 
-static int compare_mac(void *data1, void *data2)
-{
-	return (memcmp(data1, data2, sizeof(struct ether_addr)) == 0 ? 1 : 0);
-}
-
-static int choose_mac(void *data, int32_t size)
-{
-	unsigned char *key= data;
-	uint32_t hash = 0, m_size = sizeof(struct ether_addr);
-	size_t i;
-
-	for (i = 0; i < m_size; i++) {
-		hash += key[i];
-		hash += (hash << 10);
-		hash ^= (hash >> 6);
-	}
-
-	hash += (hash << 3);
-	hash ^= (hash >> 11);
-	hash += (hash << 15);
-
-	return (hash % size);
-}
-
 static void parse_hosts_file(struct hashtable_t **hash, const char path[], int read_opt)
 {
 	FILE *fd;
@@ -58,21 +58,7 @@ static int compare_name(void *data1, void *data2)
 
 static int choose_name(void *data, int32_t size)
 {
-	unsigned char *key= data;
-	uint32_t hash = 0, m_size = NAME_LEN - 1;
-	size_t i;
-
-	for (i = 0; i < m_size; i++) {
-		hash += key[i];
-		hash += (hash << 10);
-		hash ^= (hash >> 6);
-	}
-
-	hash += (hash << 3);
-	hash ^= (hash >> 11);
-	hash += (hash << 15);
-
-	return (hash % size);
+	return (hash_bytes(data, NAME_LEN - 1) % size);
 }
 
 static struct bat_node *node_get(char *name)
@@ -0,0 +1,1016 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#include <errno.h>
+#include <linux/filter.h>
+#include <net/ethernet.h>
+#include <netinet/ether.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "bat-hosts.h"
+#include "batadv_packet.h"
+#include "bpf_filter.h"
+#include "functions.h"
+#include "main.h"
+
+#ifndef ETH_P_BATMAN
+#define ETH_P_BATMAN	0x4305
+#endif /* ETH_P_BATMAN */
+
+#define BPF_FILTER_MAX_NODES 64
+#define BPF_FILTER_MAX_INSNS 512
+#define BPF_FILTER_MAX_LABELS (2 * BPF_FILTER_MAX_NODES + 8)
+#define BPF_FILTER_MAX_TYPES 8
+
+/* bytes of an accepted frame which are passed on */
+#define BPF_FILTER_SNAPLEN 0x40000
+
+/* jump target which is the next instruction */
+#define BPF_LABEL_NEXT -1
+
+/* scratch memory slot for the ethertype after an optional VLAN header */
+#define BPF_MEM_ETHERTYPE 0
+
+enum bpf_op {
+	BPF_OP_EQ,
+	BPF_OP_NE,
+	BPF_OP_LT,
+	BPF_OP_LE,
+	BPF_OP_GT,
+	BPF_OP_GE,
+};
+
+enum bpf_prim {
+	BPF_PRIM_BATMAN,	/* any batman-adv packet */
+	BPF_PRIM_TYPE,		/* batman-adv packet types */
+	BPF_PRIM_FIELD,		/* field of the batman-adv header */
+	BPF_PRIM_ETHER_SRC,	/* ethernet source */
+	BPF_PRIM_ETHER_DST,	/* ethernet destination */
+	BPF_PRIM_VLAN,		/* VLAN tagged (with vid) */
+	BPF_PRIM_LEN,		/* frame length */
+};
+
+enum bpf_node_type {
+	BPF_NODE_AND,
+	BPF_NODE_OR,
+	BPF_NODE_NOT,
+	BPF_NODE_PRIM,
+};
+
+/* position of a field in the batman-adv header of a packet type */
+struct bpf_field_pos {
+	uint8_t type;
+	uint8_t offset;
+};
+
+struct bpf_field {
+	const char *name;
+	uint8_t size;
+	size_t num;
+	struct bpf_field_pos pos[BPF_FILTER_MAX_TYPES];
+};
+
+#define BPF_FIELD_POS(_type, _packet, _member) \
+	{ .type = (_type), .offset = offsetof(struct _packet, _member) }
+
+static const struct bpf_field bpf_fields[] = {
+	{
+		.name = "ttl",
+		.size = 1,
+		.num = 8,
+		.pos = {
+			BPF_FIELD_POS(BATADV_IV_OGM, batadv_ogm_packet, ttl),
+			BPF_FIELD_POS(BATADV_OGM2, batadv_ogm2_packet, ttl),
+			BPF_FIELD_POS(BATADV_BCAST, batadv_bcast_packet, ttl),
+			BPF_FIELD_POS(BATADV_ICMP, batadv_icmp_packet, ttl),
+			BPF_FIELD_POS(BATADV_UNICAST, batadv_unicast_packet,
+				      ttl),
+			BPF_FIELD_POS(BATADV_UNICAST_4ADDR,
+				      batadv_unicast_4addr_packet, u.ttl),
+			BPF_FIELD_POS(BATADV_UNICAST_FRAG, batadv_frag_packet,
+				      ttl),
+			BPF_FIELD_POS(BATADV_UNICAST_TVLV,
+				      batadv_unicast_tvlv_packet, ttl),
+		},
+	},
+	{
+		.name = "orig",
+		.size = ETH_ALEN,
+		.num = 8,
+		.pos = {
+			BPF_FIELD_POS(BATADV_IV_OGM, batadv_ogm_packet, orig),
+			BPF_FIELD_POS(BATADV_OGM2, batadv_ogm2_packet, orig),
+			BPF_FIELD_POS(BATADV_ELP, batadv_elp_packet, orig),
+			BPF_FIELD_POS(BATADV_BCAST, batadv_bcast_packet, orig),
+			BPF_FIELD_POS(BATADV_ICMP, batadv_icmp_packet, orig),
+			BPF_FIELD_POS(BATADV_UNICAST_4ADDR,
+				      batadv_unicast_4addr_packet, src),
+			BPF_FIELD_POS(BATADV_UNICAST_FRAG, batadv_frag_packet,
+				      orig),
+			BPF_FIELD_POS(BATADV_UNICAST_TVLV,
+				      batadv_unicast_tvlv_packet, src),
+		},
+	},
+	{
+		.name = "dst",
+		.size = ETH_ALEN,
+		.num = 5,
+		.pos = {
+			BPF_FIELD_POS(BATADV_ICMP, batadv_icmp_packet, dst),
+			BPF_FIELD_POS(BATADV_UNICAST, batadv_unicast_packet,
+				      dest),
+			BPF_FIELD_POS(BATADV_UNICAST_4ADDR,
+				      batadv_unicast_4addr_packet, u.dest),
+			BPF_FIELD_POS(BATADV_UNICAST_FRAG, batadv_frag_packet,
+				      dest),
+			BPF_FIELD_POS(BATADV_UNICAST_TVLV,
+				      batadv_unicast_tvlv_packet, dst),
+		},
+	},
+	{
+		.name = "prev_sender",
+		.size = ETH_ALEN,
+		.num = 1,
+		.pos = {
+			BPF_FIELD_POS(BATADV_IV_OGM, batadv_ogm_packet,
+				      prev_sender),
+		},
+	},
+	{
+		.name = "seqno",
+		.size = 4,
+		.num = 4,
+		.pos = {
+			BPF_FIELD_POS(BATADV_IV_OGM, batadv_ogm_packet, seqno),
+			BPF_FIELD_POS(BATADV_OGM2, batadv_ogm2_packet, seqno),
+			BPF_FIELD_POS(BATADV_ELP, batadv_elp_packet, seqno),
+			BPF_FIELD_POS(BATADV_BCAST, batadv_bcast_packet, seqno),
+		},
+	},
+	{
+		.name = "tq",
+		.size = 1,
+		.num = 1,
+		.pos = {
+			BPF_FIELD_POS(BATADV_IV_OGM, batadv_ogm_packet, tq),
+		},
+	},
+	{
+		.name = "throughput",
+		.size = 4,
+		.num = 1,
+		.pos = {
+			BPF_FIELD_POS(BATADV_OGM2, batadv_ogm2_packet,
+				      throughput),
+		},
+	},
+	{
+		.name = "version",
+		.size = 1,
+		.num = 0,	/* common to all packet types */
+	},
+};
+
+/* names of packet types - like the packet types of -p/-x */
+static const struct bpf_type_name {
+	const char *name;
+	size_t num;
+	uint8_t types[BPF_FILTER_MAX_TYPES];
+} bpf_type_names[] = {
+	{ "ogm", 1, { BATADV_IV_OGM } },
+	{ "ogm2", 1, { BATADV_OGM2 } },
+	{ "elp", 1, { BATADV_ELP } },
+	{ "icmp", 1, { BATADV_ICMP } },
+	{ "ucast", 2, { BATADV_UNICAST, BATADV_UNICAST_4ADDR } },
+	{ "4addr", 1, { BATADV_UNICAST_4ADDR } },
+	{ "bcast", 1, { BATADV_BCAST } },
+	{ "frag", 1, { BATADV_UNICAST_FRAG } },
+	{ "tvlv", 1, { BATADV_UNICAST_TVLV } },
+	{ "coded", 1, { BATADV_CODED } },
+};
+
+struct bpf_node {
+	enum bpf_node_type type;
+	struct bpf_node *left;
+	struct bpf_node *right;
+
+	/* BPF_NODE_PRIM */
+	enum bpf_prim prim;
+	const struct bpf_field *field;
+	const struct bpf_type_name *types;
+	enum bpf_op op;
+	bool has_value;
+	uint32_t value;
+	uint8_t mac[ETH_ALEN];
+};
+
+struct bpf_filter {
+	char *expr;
+	char *pos;
+	char token[64];
+	bool token_op;
+
+	struct bpf_node nodes[BPF_FILTER_MAX_NODES];
+	size_t num_nodes;
+
+	struct sock_filter insns[BPF_FILTER_MAX_INSNS];
+	int jt_label[BPF_FILTER_MAX_INSNS];
+	int jf_label[BPF_FILTER_MAX_INSNS];
+	size_t num_insns;
+	int label_pos[BPF_FILTER_MAX_LABELS];
+	int num_labels;
+	bool overflow;
+};
+
+static bool bpf_is_op_char(char c)
+{
+	return c && strchr("!=<>", c);
+}
+
+/* read the next token of the expression - empty at the end */
+static const char *bpf_next_token(struct bpf_filter *filter)
+{
+	char *pos = filter->pos;
+	size_t len;
+
+	while (*pos == ' ' || *pos == '\t')
+		pos++;
+
+	if (*pos == '(' || *pos == ')')
+		len = 1;
+	else if (bpf_is_op_char(*pos))
+		len = strspn(pos, "!=<>");
+	else
+		len = strcspn(pos, " \t()!=<>");
+
+	if (len >= sizeof(filter->token))
+		len = sizeof(filter->token) - 1;
+
+	memcpy(filter->token, pos, len);
+	filter->token[len] = '\0';
+	filter->token_op = bpf_is_op_char(*pos);
+	filter->pos = pos + len;
+
+	return filter->token;
+}
+
+static const char *bpf_peek_token(struct bpf_filter *filter)
+{
+	char *pos = filter->pos;
+	const char *token;
+
+	token = bpf_next_token(filter);
+	filter->pos = pos;
+
+	return token;
+}
+
+static struct bpf_node *bpf_node_new(struct bpf_filter *filter,
+				     enum bpf_node_type type)
+{
+	struct bpf_node *node;
+
+	if (filter->num_nodes == BPF_FILTER_MAX_NODES) {
+		fprintf(stderr, "Error - filter expression is too long\n");
+		return NULL;
+	}
+
+	node = &filter->nodes[filter->num_nodes++];
+	memset(node, 0, sizeof(*node));
+	node->type = type;
+
+	return node;
+}
+
+static int bpf_parse_op(struct bpf_filter *filter, enum bpf_op *op)
+{
+	static const struct {
+		const char *str;
+		enum bpf_op op;
+	} ops[] = {
+		{ "=", BPF_OP_EQ },
+		{ "==", BPF_OP_EQ },
+		{ "!=", BPF_OP_NE },
+		{ "<", BPF_OP_LT },
+		{ "<=", BPF_OP_LE },
+		{ ">", BPF_OP_GT },
+		{ ">=", BPF_OP_GE },
+	};
+	size_t i;
+
+	/* the operator is optional and defaults to equality */
+	*op = BPF_OP_EQ;
+
+	bpf_peek_token(filter);
+	if (!filter->token_op)
+		return 0;
+
+	bpf_next_token(filter);
+
+	for (i = 0; i < ARRAY_SIZE(ops); i++) {
+		if (strcmp(filter->token, ops[i].str) == 0) {
+			*op = ops[i].op;
+			return 0;
+		}
+	}
+
+	fprintf(stderr, "Error - invalid operator in filter expression: %s\n",
+		filter->token);
+
+	return -EINVAL;
+}
+
+static int bpf_parse_num(struct bpf_filter *filter, struct bpf_node *node)
+{
+	unsigned long value;
+	const char *token;
+	char *end;
+
+	if (bpf_parse_op(filter, &node->op) < 0)
+		return -EINVAL;
+
+	token = bpf_next_token(filter);
+	value = strtoul(token, &end, 0);
+	if (!*token || *end || value > UINT32_MAX) {
+		fprintf(stderr, "Error - invalid number in filter expression: '%s'\n",
+			token);
+		return -EINVAL;
+	}
+
+	node->has_value = true;
+	node->value = value;
+
+	return 0;
+}
+
+static int bpf_parse_mac(struct bpf_filter *filter, struct bpf_node *node)
+{
+	struct ether_addr *mac = NULL;
+	struct bat_host *bat_host;
+	char *token;
+
+	if (bpf_parse_op(filter, &node->op) < 0)
+		return -EINVAL;
+
+	if (node->op != BPF_OP_EQ && node->op != BPF_OP_NE) {
+		fprintf(stderr, "Error - addresses can only be compared with = or !=\n");
+		return -EINVAL;
+	}
+
+	token = (char *)bpf_next_token(filter);
+
+	bat_host = bat_hosts_find_by_name(token);
+	if (bat_host)
+		mac = &bat_host->mac_addr;
+
+	if (!mac && *token)
+		mac = resolve_mac(token);
+
+	if (!mac) {
+		fprintf(stderr, "Error - invalid address in filter expression: '%s'\n",
+			token);
+		return -EINVAL;
+	}
+
+	memcpy(node->mac, mac, ETH_ALEN);
+
+	return 0;
+}
+
+static const struct bpf_type_name *bpf_find_type(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(bpf_type_names); i++) {
+		if (strcmp(bpf_type_names[i].name, name) == 0)
+			return &bpf_type_names[i];
+	}
+
+	return NULL;
+}
+
+static const struct bpf_field *bpf_find_field(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(bpf_fields); i++) {
+		if (strcmp(bpf_fields[i].name, name) == 0)
+			return &bpf_fields[i];
+	}
+
+	return NULL;
+}
+
+static struct bpf_node *bpf_parse_expr(struct bpf_filter *filter);
+
+static struct bpf_node *bpf_parse_prim(struct bpf_filter *filter)
+{
+	const char *token = bpf_next_token(filter);
+	struct bpf_node *node;
+	char *end;
+
+	if (strcmp(token, "(") == 0) {
+		node = bpf_parse_expr(filter);
+		if (!node)
+			return NULL;
+
+		if (strcmp(bpf_next_token(filter), ")") != 0) {
+			fprintf(stderr, "Error - missing ')' in filter expression\n");
+			return NULL;
+		}
+
+		return node;
+	}
+
+	if (strcmp(token, "not") == 0 || strcmp(token, "!") == 0) {
+		node = bpf_node_new(filter, BPF_NODE_NOT);
+		if (!node)
+			return NULL;
+
+		node->left = bpf_parse_prim(filter);
+		if (!node->left)
+			return NULL;
+
+		return node;
+	}
+
+	node = bpf_node_new(filter, BPF_NODE_PRIM);
+	if (!node)
+		return NULL;
+
+	if (strcmp(token, "batman") == 0) {
+		node->prim = BPF_PRIM_BATMAN;
+		return node;
+	}
+
+	if (strcmp(token, "type") == 0)
+		token = bpf_next_token(filter);
+
+	node->types = bpf_find_type(token);
+	if (node->types) {
+		node->prim = BPF_PRIM_TYPE;
+		return node;
+	}
+
+	node->field = bpf_find_field(token);
+	if (node->field) {
+		node->prim = BPF_PRIM_FIELD;
+
+		if (node->field->size == ETH_ALEN) {
+			if (bpf_parse_mac(filter, node) < 0)
+				return NULL;
+		} else {
+			if (bpf_parse_num(filter, node) < 0)
+				return NULL;
+		}
+
+		return node;
+	}
+
+	if (strcmp(token, "ether") == 0) {
+		token = bpf_next_token(filter);
+
+		if (strcmp(token, "src") == 0) {
+			node->prim = BPF_PRIM_ETHER_SRC;
+		} else if (strcmp(token, "dst") == 0) {
+			node->prim = BPF_PRIM_ETHER_DST;
+		} else {
+			fprintf(stderr, "Error - expected 'src' or 'dst' after 'ether' in filter expression\n");
+			return NULL;
+		}
+
+		if (bpf_parse_mac(filter, node) < 0)
+			return NULL;
+
+		return node;
+	}
+
+	if (strcmp(token, "vlan") == 0) {
+		node->prim = BPF_PRIM_VLAN;
+
+		/* optional vid */
+		token = bpf_peek_token(filter);
+		strtoul(token, &end, 0);
+		if (*token && !*end && !filter->token_op)
+			return bpf_parse_num(filter, node) < 0 ? NULL : node;
+
+		return node;
+	}
+
+	if (strcmp(token, "len") == 0) {
+		node->prim = BPF_PRIM_LEN;
+
+		if (bpf_parse_num(filter, node) < 0)
+			return NULL;
+
+		return node;
+	}
+
+	if (*token)
+		fprintf(stderr, "Error - unknown keyword in filter expression: '%s'\n",
+			token);
+	else
+		fprintf(stderr, "Error - filter expression ends unexpectedly\n");
+
+	return NULL;
+}
+
+static struct bpf_node *bpf_parse_and(struct bpf_filter *filter)
+{
+	struct bpf_node *left;
+	struct bpf_node *node;
+	const char *token;
+
+	left = bpf_parse_prim(filter);
+
+	while (left) {
+		token = bpf_peek_token(filter);
+		if (strcmp(token, "and") != 0 && strcmp(token, "&&") != 0)
+			break;
+
+		bpf_next_token(filter);
+
+		node = bpf_node_new(filter, BPF_NODE_AND);
+		if (!node)
+			return NULL;
+
+		node->left = left;
+		node->right = bpf_parse_prim(filter);
+		if (!node->right)
+			return NULL;
+
+		left = node;
+	}
+
+	return left;
+}
+
+static struct bpf_node *bpf_parse_expr(struct bpf_filter *filter)
+{
+	struct bpf_node *left;
+	struct bpf_node *node;
+	const char *token;
+
+	left = bpf_parse_and(filter);
+
+	while (left) {
+		token = bpf_peek_token(filter);
+		if (strcmp(token, "or") != 0 && strcmp(token, "||") != 0)
+			break;
+
+		bpf_next_token(filter);
+
+		node = bpf_node_new(filter, BPF_NODE_OR);
+		if (!node)
+			return NULL;
+
+		node->left = left;
+		node->right = bpf_parse_and(filter);
+		if (!node->right)
+			return NULL;
+
+		left = node;
+	}
+
+	return left;
+}
+
+static int bpf_label_new(struct bpf_filter *filter)
+{
+	if (filter->num_labels == BPF_FILTER_MAX_LABELS) {
+		filter->overflow = true;
+		return BPF_LABEL_NEXT;
+	}
+
+	filter->label_pos[filter->num_labels] = -1;
+
+	return filter->num_labels++;
+}
+
+static void bpf_label_place(struct bpf_filter *filter, int label)
+{
+	if (label < 0)
+		return;
+
+	filter->label_pos[label] = filter->num_insns;
+}
+
+static void bpf_emit(struct bpf_filter *filter, uint16_t code, uint32_t k,
+		     int jt, int jf)
+{
+	struct sock_filter *insn;
+
+	if (filter->num_insns == BPF_FILTER_MAX_INSNS) {
+		filter->overflow = true;
+		return;
+	}
+
+	insn = &filter->insns[filter->num_insns];
+	insn->code = code;
+	insn->k = k;
+	insn->jt = 0;
+	insn->jf = 0;
+
+	filter->jt_label[filter->num_insns] = jt;
+	filter->jf_label[filter->num_insns] = jf;
+	filter->num_insns++;
+}
+
+static void bpf_emit_stmt(struct bpf_filter *filter, uint16_t code,
+			  uint32_t k)
+{
+	bpf_emit(filter, code, k, BPF_LABEL_NEXT, BPF_LABEL_NEXT);
+}
+
+/* compare the accumulator and jump to @t or @f */
+static void bpf_emit_cmp(struct bpf_filter *filter, enum bpf_op op,
+			 uint32_t value, int t, int f)
+{
+	switch (op) {
+	case BPF_OP_EQ:
+		bpf_emit(filter, BPF_JMP | BPF_JEQ | BPF_K, value, t, f);
+		break;
+	case BPF_OP_NE:
+		bpf_emit(filter, BPF_JMP | BPF_JEQ | BPF_K, value, f, t);
+		break;
+	case BPF_OP_LT:
+		bpf_emit(filter, BPF_JMP | BPF_JGE | BPF_K, value, f, t);
+		break;
+	case BPF_OP_LE:
+		bpf_emit(filter, BPF_JMP | BPF_JGT | BPF_K, value, f, t);
+		break;
+	case BPF_OP_GT:
+		bpf_emit(filter, BPF_JMP | BPF_JGT | BPF_K, value, t, f);
+		break;
+	case BPF_OP_GE:
+		bpf_emit(filter, BPF_JMP | BPF_JGE | BPF_K, value, t, f);
+		break;
+	}
+}
+
+/* compare a MAC address at @offset (relative to X when @ind is set) */
+static void bpf_emit_mac(struct bpf_filter *filter, const struct bpf_node *node,
+			 uint32_t offset, bool ind, int t, int f)
+{
+	uint16_t mode = ind ? BPF_IND : BPF_ABS;
+	const uint8_t *mac = node->mac;
+	int match = node->op == BPF_OP_EQ ? t : f;
+	int mismatch = node->op == BPF_OP_EQ ? f : t;
+
+	bpf_emit_stmt(filter, BPF_LD | BPF_W | mode, offset);
+	bpf_emit(filter, BPF_JMP | BPF_JEQ | BPF_K,
+		 (uint32_t)mac[0] << 24 | mac[1] << 16 | mac[2] << 8 | mac[3],
+		 BPF_LABEL_NEXT, mismatch);
+	bpf_emit_stmt(filter, BPF_LD | BPF_H | mode, offset + 4);
+	bpf_emit(filter, BPF_JMP | BPF_JEQ | BPF_K, mac[4] << 8 | mac[5],
+		 match, mismatch);
+}
+
+/* A = batman-adv packet type or jump to @f for other ethertypes */
+static void bpf_emit_packet_type(struct bpf_filter *filter, int f)
+{
+	bpf_emit_stmt(filter, BPF_LD | BPF_MEM, BPF_MEM_ETHERTYPE);
+	bpf_emit(filter, BPF_JMP | BPF_JEQ | BPF_K, ETH_P_BATMAN,
+		 BPF_LABEL_NEXT, f);
+	bpf_emit_stmt(filter, BPF_LD | BPF_B | BPF_IND, 0);
+}
+
+static void bpf_gen_field(struct bpf_filter *filter,
+			  const struct bpf_node *node, int t, int f)
+{
+	const struct bpf_field *field = node->field;
+	static const uint16_t sizes[] = {
+		[1] = BPF_B,
+		[2] = BPF_H,
+		[4] = BPF_W,
+	};
+	int labels[BPF_FILTER_MAX_TYPES];
+	uint8_t offsets[BPF_FILTER_MAX_TYPES];
+	size_t num_offsets = 0;
+	size_t i;
+	size_t j;
+
+	/* fields which are common to all packet types */
+	if (!field->num) {
+		bpf_emit_stmt(filter, BPF_LD | BPF_MEM, BPF_MEM_ETHERTYPE);
+		bpf_emit(filter, BPF_JMP | BPF_JEQ | BPF_K, ETH_P_BATMAN,
+			 BPF_LABEL_NEXT, f);
+		bpf_emit_stmt(filter, BPF_LD | BPF_B | BPF_IND,
+			      offsetof(struct batadv_ogm_packet, version));
+		bpf_emit_cmp(filter, node->op, node->value, t, f);
+		return;
+	}
+
+	/* the packet types with the same offset share the comparison */
+	for (i = 0; i < field->num; i++) {
+		for (j = 0; j < num_offsets; j++) {
+			if (offsets[j] == field->pos[i].offset)
+				break;
+		}
+
+		if (j == num_offsets) {
+			offsets[num_offsets] = field->pos[i].offset;
+			labels[num_offsets] = bpf_label_new(filter);
+			num_offsets++;
+		}
+	}
+
+	bpf_emit_packet_type(filter, f);
+
+	for (i = 0; i < field->num; i++) {
+		for (j = 0; j < num_offsets; j++) {
+			if (offsets[j] == field->pos[i].offset)
+				break;
+		}
+
+		bpf_emit(filter, BPF_JMP | BPF_JEQ | BPF_K,
+			 field->pos[i].type, labels[j], BPF_LABEL_NEXT);
+	}
+
+	/* packet type without this field */
+	bpf_emit(filter, BPF_JMP | BPF_JA, 0, f, f);
+
+	for (j = 0; j < num_offsets; j++) {
+		bpf_label_place(filter, labels[j]);
+
+		if (field->size == ETH_ALEN) {
+			bpf_emit_mac(filter, node, offsets[j], true, t, f);
+			continue;
+		}
+
+		bpf_emit_stmt(filter, BPF_LD | sizes[field->size] | BPF_IND,
+			      offsets[j]);
+		bpf_emit_cmp(filter, node->op, node->value, t, f);
+	}
+}
+
+static void bpf_gen_vlan(struct bpf_filter *filter,
+			 const struct bpf_node *node, int t, int f)
+{
+	int offloaded = bpf_label_new(filter);
+
+	/* tag which is still part of the frame */
+	bpf_emit_stmt(filter, BPF_LD | BPF_H | BPF_ABS,
+		      offsetof(struct ether_header, ether_type));
+	bpf_emit(filter, BPF_JMP | BPF_JEQ | BPF_K, ETH_P_8021Q,
+		 node->has_value ? BPF_LABEL_NEXT : t, offloaded);
+
+	if (node->has_value) {
+		bpf_emit_stmt(filter, BPF_LD | BPF_H | BPF_ABS, ETH_HLEN);
+		bpf_emit_stmt(filter, BPF_ALU | BPF_AND | BPF_K, 0x0fff);
+		bpf_emit_cmp(filter, node->op, node->value, t, f);
+	}
+
+	/* tag which was moved to the metadata by the driver */
+	bpf_label_place(filter, offloaded);
+	bpf_emit_stmt(filter, BPF_LD | BPF_W | BPF_ABS,
+		      SKF_AD_OFF + SKF_AD_VLAN_TAG_PRESENT);
+	bpf_emit(filter, BPF_JMP | BPF_JEQ | BPF_K, 0,
+		 f, node->has_value ? BPF_LABEL_NEXT : t);
+
+	if (node->has_value) {
+		bpf_emit_stmt(filter, BPF_LD | BPF_W | BPF_ABS,
+			      SKF_AD_OFF + SKF_AD_VLAN_TAG);
+		bpf_emit_stmt(filter, BPF_ALU | BPF_AND | BPF_K, 0x0fff);
+		bpf_emit_cmp(filter, node->op, node->value, t, f);
+	}
+}
+
+static void bpf_gen_prim(struct bpf_filter *filter,
+			 const struct bpf_node *node, int t, int f)
+{
+	size_t i;
+
+	switch (node->prim) {
+	case BPF_PRIM_BATMAN:
+		bpf_emit_stmt(filter, BPF_LD | BPF_MEM, BPF_MEM_ETHERTYPE);
+		bpf_emit(filter, BPF_JMP | BPF_JEQ | BPF_K, ETH_P_BATMAN, t, f);
+		break;
+	case BPF_PRIM_TYPE:
+		bpf_emit_packet_type(filter, f);
+
+		for (i = 0; i < node->types->num; i++)
+			bpf_emit(filter, BPF_JMP | BPF_JEQ | BPF_K,
+				 node->types->types[i], t,
+				 i + 1 < node->types->num ? BPF_LABEL_NEXT : f);
+		break;
+	case BPF_PRIM_FIELD:
+		bpf_gen_field(filter, node, t, f);
+		break;
+	case BPF_PRIM_ETHER_SRC:
+		bpf_emit_mac(filter, node,
+			     offsetof(struct ether_header, ether_shost), false,
+			     t, f);
+		break;
+	case BPF_PRIM_ETHER_DST:
+		bpf_emit_mac(filter, node,
+			     offsetof(struct ether_header, ether_dhost), false,
+			     t, f);
+		break;
+	case BPF_PRIM_VLAN:
+		bpf_gen_vlan(filter, node, t, f);
+		break;
+	case BPF_PRIM_LEN:
+		bpf_emit_stmt(filter, BPF_LD | BPF_W | BPF_LEN, 0);
+		bpf_emit_cmp(filter, node->op, node->value, t, f);
+		break;
+	}
+}
+
+/* generate code which jumps to label @t when @node matches, else to @f */
+static void bpf_gen(struct bpf_filter *filter, const struct bpf_node *node,
+		    int t, int f)
+{
+	int label;
+
+	switch (node->type) {
+	case BPF_NODE_AND:
+		label = bpf_label_new(filter);
+		bpf_gen(filter, node->left, label, f);
+		bpf_label_place(filter, label);
+		bpf_gen(filter, node->right, t, f);
+		break;
+	case BPF_NODE_OR:
+		label = bpf_label_new(filter);
+		bpf_gen(filter, node->left, t, label);
+		bpf_label_place(filter, label);
+		bpf_gen(filter, node->right, t, f);
+		break;
+	case BPF_NODE_NOT:
+		bpf_gen(filter, node->left, f, t);
+		break;
+	case BPF_NODE_PRIM:
+		bpf_gen_prim(filter, node, t, f);
+		break;
+	}
+}
+
+static int bpf_jump_offset(struct bpf_filter *filter, size_t insn, int label,
+			   uint32_t max)
+{
+	int offset;
+
+	if (label == BPF_LABEL_NEXT)
+		return 0;
+
+	offset = filter->label_pos[label] - (int)insn - 1;
+	if (offset < 0 || (uint32_t)offset > max) {
+		filter->overflow = true;
+		return 0;
+	}
+
+	return offset;
+}
+
+/* replace the labels of the jumps with the relative offsets */
+static void bpf_resolve(struct bpf_filter *filter)
+{
+	struct sock_filter *insn;
+	size_t i;
+
+	for (i = 0; i < filter->num_insns; i++) {
+		insn = &filter->insns[i];
+
+		if (BPF_CLASS(insn->code) != BPF_JMP)
+			continue;
+
+		if (BPF_OP(insn->code) == BPF_JA) {
+			insn->k = bpf_jump_offset(filter, i,
+						  filter->jt_label[i],
+						  BPF_FILTER_MAX_INSNS);
+			continue;
+		}
+
+		insn->jt = bpf_jump_offset(filter, i, filter->jt_label[i],
+					   UINT8_MAX);
+		insn->jf = bpf_jump_offset(filter, i, filter->jf_label[i],
+					   UINT8_MAX);
+	}
+}
+
+static void bpf_gen_program(struct bpf_filter *filter,
+			    const struct bpf_node *root)
+{
+	int accept = bpf_label_new(filter);
+	int reject = bpf_label_new(filter);
+	int vlan = bpf_label_new(filter);
+	int body = bpf_label_new(filter);
+
+	/* X = offset of the batman-adv header, M[0] = ethertype */
+	bpf_emit_stmt(filter, BPF_LD | BPF_H | BPF_ABS,
+		      offsetof(struct ether_header, ether_type));
+	bpf_emit(filter, BPF_JMP | BPF_JEQ | BPF_K, ETH_P_8021Q, vlan,
+		 BPF_LABEL_NEXT);
+	bpf_emit_stmt(filter, BPF_LDX | BPF_W | BPF_IMM, ETH_HLEN);
+	bpf_emit(filter, BPF_JMP | BPF_JA, 0, body, body);
+	bpf_label_place(filter, vlan);
+	bpf_emit_stmt(filter, BPF_LD | BPF_H | BPF_ABS, ETH_HLEN + 2);
+	bpf_emit_stmt(filter, BPF_LDX | BPF_W | BPF_IMM, ETH_HLEN + 4);
+	bpf_label_place(filter, body);
+	bpf_emit_stmt(filter, BPF_ST, BPF_MEM_ETHERTYPE);
+
+	bpf_gen(filter, root, accept, reject);
+
+	bpf_label_place(filter, accept);
+	bpf_emit_stmt(filter, BPF_RET | BPF_K, BPF_FILTER_SNAPLEN);
+	bpf_label_place(filter, reject);
+	bpf_emit_stmt(filter, BPF_RET | BPF_K, 0);
+
+	bpf_resolve(filter);
+}
+
+/**
+ * bpf_filter_compile - compile a filter expression to a classic BPF program
+ * @expr: filter expression (e.g. "ogm2 and orig 02:00:00:00:00:01 and ttl < 3")
+ *
+ * Return: compiled filter or NULL when the expression is invalid
+ */
+struct bpf_filter *bpf_filter_compile(const char *expr)
+{
+	struct bpf_filter *filter;
+	struct bpf_node *root;
+	const char *token;
+
+	filter = calloc(1, sizeof(*filter));
+	if (!filter) {
+		fprintf(stderr, "Error - could not allocate filter: out of memory ?\n");
+		return NULL;
+	}
+
+	filter->expr = strdup(expr);
+	if (!filter->expr) {
+		fprintf(stderr, "Error - could not allocate filter: out of memory ?\n");
+		goto err;
+	}
+
+	filter->pos = filter->expr;
+
+	root = bpf_parse_expr(filter);
+	if (!root)
+		goto err;
+
+	token = bpf_next_token(filter);
+	if (*token) {
+		fprintf(stderr, "Error - unexpected '%s' in filter expression\n",
+			token);
+		goto err;
+	}
+
+	bpf_gen_program(filter, root);
+	if (filter->overflow) {
+		fprintf(stderr, "Error - filter expression is too long\n");
+		goto err;
+	}
+
+	return filter;
+
+err:
+	bpf_filter_free(filter);
+	return NULL;
+}
+
+void bpf_filter_free(struct bpf_filter *filter)
+{
+	if (!filter)
+		return;
+
+	free(filter->expr);
+	free(filter);
+}
+
+int bpf_filter_attach(const struct bpf_filter *filter, int sock)
+{
+	struct sock_fprog prog = {
+		.len = filter->num_insns,
+		.filter = (struct sock_filter *)filter->insns,
+	};
+
+	if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog,
+		       sizeof(prog)) < 0)
+		return -errno;
+
+	return 0;
+}
@@ -20,6 +20,7 @@
  * License-Filename: LICENSES/preferred/GPL-2.0
  */
 
+#include <errno.h>
 #include <netinet/if_ether.h>
 #include <netlink/netlink.h>
 #include <netlink/genl/genl.h>
@@ -32,29 +33,56 @@
 #include "batman_adv.h"
 #include "bat-hosts.h"
 #include "debug.h"
+#include "filter.h"
 #include "functions.h"
+#include "group.h"
 #include "main.h"
 #include "netlink.h"
+#include "sort.h"
 
-static const int bla_claim_mandatory[] = {
-	BATADV_ATTR_BLA_ADDRESS,
-	BATADV_ATTR_BLA_VID,
-	BATADV_ATTR_BLA_BACKBONE,
-	BATADV_ATTR_BLA_CRC,
+struct bla_claim_row {
+	bool own;
+	const uint8_t *client;
+	uint16_t vid;
+	const uint8_t *backbone;
+	uint16_t backbone_crc;
 };
 
-static int bla_claim_callback(struct nl_msg *msg, void *arg)
+static const struct netlink_attr_desc bla_claim_attrs[] = {
+	NETLINK_ATTR_OPT(BATADV_ATTR_BLA_OWN, FLAG,
+			 struct bla_claim_row, own),
+	NETLINK_ATTR_REQ(BATADV_ATTR_BLA_ADDRESS, MAC,
+			 struct bla_claim_row, client),
+	NETLINK_ATTR_REQ(BATADV_ATTR_BLA_VID, U16,
+			 struct bla_claim_row, vid),
+	NETLINK_ATTR_REQ(BATADV_ATTR_BLA_BACKBONE, MAC,
+			 struct bla_claim_row, backbone),
+	NETLINK_ATTR_REQ(BATADV_ATTR_BLA_CRC, U16,
+			 struct bla_claim_row, backbone_crc),
+};
+
+static int bla_claim_callback(struct nlmsghdr *nlh, void *arg)
 {
-	struct nlattr *attrs[BATADV_ATTR_MAX+1];
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct bla_claim_row row;
+	netlink_attr_mask_t present;
 	struct print_opts *opts = arg;
-	struct bat_host *bat_host;
 	struct genlmsghdr *ghdr;
+	const uint8_t *backbone;
+	const uint8_t *client;
 	uint16_t backbone_crc;
-	uint8_t *backbone;
-	uint8_t *client;
 	uint16_t vid;
 	char c = ' ';
+	int ret;
+	struct {
+		uint8_t client[ETH_ALEN];
+		uint8_t backbone[ETH_ALEN];
+		uint16_t vid;
+	} key;
+	struct {
+		uint16_t crc;
+		uint8_t own;
+	} value;
+	struct output *out;
 
 	if (!genlmsg_valid_hdr(nlh, 0)) {
 		fputs("Received invalid data from kernel.\n", stderr);
@@ -66,45 +94,66 @@ static int bla_claim_callback(struct nl_msg *msg, void *arg)
 	if (ghdr->cmd != BATADV_CMD_GET_BLA_CLAIM)
 		return NL_OK;
 
-	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
-		      genlmsg_len(ghdr), batadv_netlink_policy)) {
+	ret = netlink_decode_attrs(ghdr, bla_claim_attrs,
+				   ARRAY_SIZE(bla_claim_attrs),
+				   &row, sizeof(row), &present);
+	if (ret == -ENOENT) {
+		fputs("Missing attributes from kernel\n", stderr);
+		exit(1);
+	} else if (ret < 0) {
 		fputs("Received invalid data from kernel.\n", stderr);
 		exit(1);
 	}
 
-	if (missing_mandatory_attrs(attrs, bla_claim_mandatory,
-				       ARRAY_SIZE(bla_claim_mandatory))) {
-		fputs("Missing attributes from kernel\n", stderr);
-		exit(1);
-	}
+	if (!filter_match(opts->filter, bla_claim_attrs,
+			  ARRAY_SIZE(bla_claim_attrs), &row, present))
+		return NL_OK;
 
-	if (attrs[BATADV_ATTR_BLA_OWN])
+	if (row.own)
 		c = '*';
 
-	client = nla_data(attrs[BATADV_ATTR_BLA_ADDRESS]);
-	vid = nla_get_u16(attrs[BATADV_ATTR_BLA_VID]);
-	backbone = nla_data(attrs[BATADV_ATTR_BLA_BACKBONE]);
-	backbone_crc = nla_get_u16(attrs[BATADV_ATTR_BLA_CRC]);
+	client = row.client;
+	vid = row.vid;
+	backbone = row.backbone;
+	backbone_crc = row.backbone_crc;
+
+	if (group_add(opts->group, bla_claim_attrs,
+		      ARRAY_SIZE(bla_claim_attrs), &row, present))
+		return NL_OK;
+
+	if (sort_add(opts->sort, nlh, bla_claim_attrs,
+		     ARRAY_SIZE(bla_claim_attrs), &row, present))
+		return NL_OK;
+
+	if (opts->out.format != OUTPUT_FORMAT_TEXT) {
+		netlink_print_record(opts, bla_claim_attrs,
+				     ARRAY_SIZE(bla_claim_attrs), &row, present);
+		return NL_OK;
+	}
+
+	out = netlink_row_begin(opts);
 
-	bat_host = bat_hosts_find_by_mac((char *)client);
-	if (!(opts->read_opt & USE_BAT_HOSTS) || !bat_host)
-		printf("%02x:%02x:%02x:%02x:%02x:%02x ",
-		       client[0], client[1], client[2],
-		       client[3], client[4], client[5]);
-	else
-		printf("%17s ", bat_host->name);
+	output_host(out, client, opts->read_opt);
+	output_str(out, " on ");
+	output_int(out, BATADV_PRINT_VID(vid), 5);
+	output_str(out, " by ");
+	output_host(out, backbone, opts->read_opt);
+	output_str(out, " [");
+	output_char(out, c);
+	output_str(out, "] (0x");
+	output_hex(out, backbone_crc, 4);
+	output_str(out, ")\n");
 
-	printf("on %5d by ", BATADV_PRINT_VID(vid));
+	memset(&key, 0, sizeof(key));
+	memcpy(key.client, client, ETH_ALEN);
+	memcpy(key.backbone, backbone, ETH_ALEN);
+	key.vid = vid;
 
-	bat_host = bat_hosts_find_by_mac((char *)backbone);
-	if (!(opts->read_opt & USE_BAT_HOSTS) || !bat_host)
-		printf("%02x:%02x:%02x:%02x:%02x:%02x ",
-		       backbone[0], backbone[1], backbone[2],
-		       backbone[3], backbone[4], backbone[5]);
-	else
-		printf("%17s ", bat_host->name);
+	memset(&value, 0, sizeof(value));
+	value.crc = backbone_crc;
+	value.own = row.own;
 
-	printf("[%c] (0x%04x)\n", c, backbone_crc);
+	netlink_row_end(opts, &key, sizeof(key), &value, sizeof(value));
 
 	return NL_OK;
 }
@@ -124,6 +173,8 @@ static struct debug_table_data batctl_debug_table_claimtable = {
 	.debugfs_name = DEBUG_CLAIMTABLE,
 	.header_lines = 2,
 	.netlink_fn = netlink_print_bla_claim,
+	.nl_cmd = BATADV_CMD_GET_BLA_CLAIM,
+	.netlink_cb = bla_claim_callback,
 };
 
 COMMAND_NAMED(DEBUGTABLE, claimtable, "cl", handle_debug_table,
@@ -21,6 +21,7 @@
  */
 
 #include <arpa/inet.h>
+#include <errno.h>
 #include <netinet/if_ether.h>
 #include <netinet/in.h>
 #include <netlink/netlink.h>
@@ -35,29 +36,51 @@
 #include "batman_adv.h"
 #include "bat-hosts.h"
 #include "debug.h"
+#include "filter.h"
 #include "functions.h"
+#include "group.h"
 #include "main.h"
 #include "netlink.h"
+#include "sort.h"
 
-static const int dat_cache_mandatory[] = {
-	BATADV_ATTR_DAT_CACHE_IP4ADDRESS,
-	BATADV_ATTR_DAT_CACHE_HWADDRESS,
-	BATADV_ATTR_DAT_CACHE_VID,
-	BATADV_ATTR_LAST_SEEN_MSECS,
+struct dat_cache_row {
+	uint32_t ip4;
+	const uint8_t *hwaddr;
+	uint16_t vid;
+	uint32_t last_seen_msecs;
 };
 
-static int dat_cache_callback(struct nl_msg *msg, void *arg)
+static const struct netlink_attr_desc dat_cache_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_DAT_CACHE_IP4ADDRESS, U32,
+			 struct dat_cache_row, ip4),
+	NETLINK_ATTR_REQ(BATADV_ATTR_DAT_CACHE_HWADDRESS, MAC,
+			 struct dat_cache_row, hwaddr),
+	NETLINK_ATTR_REQ(BATADV_ATTR_DAT_CACHE_VID, U16,
+			 struct dat_cache_row, vid),
+	NETLINK_ATTR_REQ(BATADV_ATTR_LAST_SEEN_MSECS, U32,
+			 struct dat_cache_row, last_seen_msecs),
+};
+
+static int dat_cache_callback(struct nlmsghdr *nlh, void *arg)
 {
 	int last_seen_msecs, last_seen_secs, last_seen_mins;
-	struct nlattr *attrs[BATADV_ATTR_MAX+1];
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
 	struct print_opts *opts = arg;
-	struct bat_host *bat_host;
+	struct dat_cache_row row;
+	netlink_attr_mask_t present;
 	struct genlmsghdr *ghdr;
 	struct in_addr in_addr;
-	uint8_t *hwaddr;
+	const uint8_t *hwaddr;
 	int16_t vid;
 	char *addr;
+	int ret;
+	struct {
+		uint32_t ip4;
+		int16_t vid;
+	} key;
+	struct {
+		uint8_t hwaddr[ETH_ALEN];
+	} value;
+	struct output *out;
 
 	if (!genlmsg_valid_hdr(nlh, 0)) {
 		fputs("Received invalid data from kernel.\n", stderr);
@@ -69,24 +92,27 @@ static int dat_cache_callback(struct nl_msg *msg, void *arg)
 	if (ghdr->cmd != BATADV_CMD_GET_DAT_CACHE)
 		return NL_OK;
 
-	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
-		      genlmsg_len(ghdr), batadv_netlink_policy)) {
+	ret = netlink_decode_attrs(ghdr, dat_cache_attrs,
+				   ARRAY_SIZE(dat_cache_attrs),
+				   &row, sizeof(row), &present);
+	if (ret == -ENOENT) {
+		fputs("Missing attributes from kernel\n", stderr);
+		exit(1);
+	} else if (ret < 0) {
 		fputs("Received invalid data from kernel.\n", stderr);
 		exit(1);
 	}
 
-	if (missing_mandatory_attrs(attrs, dat_cache_mandatory,
-				    ARRAY_SIZE(dat_cache_mandatory))) {
-		fputs("Missing attributes from kernel\n", stderr);
-		exit(1);
-	}
+	if (!filter_match(opts->filter, dat_cache_attrs,
+			  ARRAY_SIZE(dat_cache_attrs), &row, present))
+		return NL_OK;
 
-	in_addr.s_addr = nla_get_u32(attrs[BATADV_ATTR_DAT_CACHE_IP4ADDRESS]);
+	in_addr.s_addr = row.ip4;
 	addr = inet_ntoa(in_addr);
-	hwaddr = nla_data(attrs[BATADV_ATTR_DAT_CACHE_HWADDRESS]);
-	vid = nla_get_u16(attrs[BATADV_ATTR_DAT_CACHE_VID]);
+	hwaddr = row.hwaddr;
+	vid = row.vid;
 
-	last_seen_msecs = nla_get_u32(attrs[BATADV_ATTR_LAST_SEEN_MSECS]);
+	last_seen_msecs = row.last_seen_msecs;
 	last_seen_mins = last_seen_msecs / 60000;
 	last_seen_msecs = last_seen_msecs % 60000;
 	last_seen_secs = last_seen_msecs / 1000;
@@ -97,18 +123,42 @@ static int dat_cache_callback(struct nl_msg *msg, void *arg)
 	if (opts->read_opt & UNICAST_ONLY && (addr[0] & 0x01))
 		return NL_OK;
 
-	printf(" * %15s ", addr);
+	if (group_add(opts->group, dat_cache_attrs,
+		      ARRAY_SIZE(dat_cache_attrs), &row, present))
+		return NL_OK;
+
+	if (sort_add(opts->sort, nlh, dat_cache_attrs,
+		     ARRAY_SIZE(dat_cache_attrs), &row, present))
+		return NL_OK;
+
+	if (opts->out.format != OUTPUT_FORMAT_TEXT) {
+		netlink_print_record(opts, dat_cache_attrs,
+				     ARRAY_SIZE(dat_cache_attrs), &row, present);
+		return NL_OK;
+	}
+
+	out = netlink_row_begin(opts);
+
+	output_str(out, " * ");
+	output_str_right(out, addr, 15);
+	output_char(out, ' ');
+	output_host(out, hwaddr, opts->read_opt);
+	output_char(out, ' ');
+	output_int(out, BATADV_PRINT_VID(vid), 4);
+	output_char(out, ' ');
+	output_int(out, last_seen_mins, 6);
+	output_char(out, ':');
+	output_uint_zero(out, last_seen_secs, 2);
+	output_char(out, '\n');
+
+	memset(&key, 0, sizeof(key));
+	key.ip4 = in_addr.s_addr;
+	key.vid = vid;
 
-	bat_host = bat_hosts_find_by_mac((char *)hwaddr);
-	if (!(opts->read_opt & USE_BAT_HOSTS) || !bat_host)
-		printf("%02x:%02x:%02x:%02x:%02x:%02x ",
-		       hwaddr[0], hwaddr[1], hwaddr[2],
-		       hwaddr[3], hwaddr[4], hwaddr[5]);
-	else
-		printf("%17s ", bat_host->name);
+	memset(&value, 0, sizeof(value));
+	memcpy(value.hwaddr, hwaddr, ETH_ALEN);
 
-	printf("%4i %6i:%02i\n",
-	       BATADV_PRINT_VID(vid), last_seen_mins, last_seen_secs);
+	netlink_row_end(opts, &key, sizeof(key), &value, sizeof(value));
 
 	return NL_OK;
 }
@@ -140,6 +190,8 @@ static struct debug_table_data batctl_debug_table_dat_cache = {
 	.debugfs_name = DEBUG_DAT_CACHE,
 	.header_lines = 2,
 	.netlink_fn = netlink_print_dat_cache,
+	.nl_cmd = BATADV_CMD_GET_DAT_CACHE,
+	.netlink_cb = dat_cache_callback,
 };
 
 COMMAND_NAMED(DEBUGTABLE, dat_cache, "dc", handle_debug_table,
@@ -24,14 +24,21 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #include "debug.h"
 #include "debugfs.h"
+#include "filter.h"
 #include "functions.h"
+#include "group.h"
 #include "netlink.h"
+#include "sort.h"
 #include "sys.h"
 
+extern const struct command *__start___command[];
+extern const struct command *__stop___command[];
+
 static void debug_table_usage(struct state *state)
 {
 	struct debug_table_data *debug_table = state->cmd->arg;
@@ -43,6 +50,11 @@ static void debug_table_usage(struct state *state)
 	fprintf(stderr, " \t -n don't replace mac addresses with bat-host names\n");
 	fprintf(stderr, " \t -H don't show the header\n");
 	fprintf(stderr, " \t -w [interval] watch mode - refresh the table continuously\n");
+	fprintf(stderr, " \t -d delta mode - only print added (+), removed (-) and changed (~) entries in watch mode\n");
+	fprintf(stderr, " \t -s field[,field] sort the entries (a leading '-' sorts in descending order)\n");
+	fprintf(stderr, " \t -l limit - only print the first N entries (after sorting)\n");
+	fprintf(stderr, " \t -g field[,field] only print the number of entries per group (fields with a leading '+' are summed)\n");
+	fprintf(stderr, " \t -F filter - only print entries matching all comma separated terms, e.g. orig=<mac>,vid=1,iface=<iface>,age<5\n");
 
 	if (debug_table->option_timeout_interval)
 		fprintf(stderr, " \t -t timeout interval - don't print originators not seen for x.y seconds \n");
@@ -66,9 +78,13 @@ int handle_debug_table(struct state *state, int argc, char **argv)
 	char *orig_iface = NULL;
 	float orig_timeout = 0.0f;
 	float watch_interval = 1;
+	char *group_expr = NULL;
+	char *sort_expr = NULL;
+	unsigned long limit = 0;
+	char *end;
 	int err;
 
-	while ((optchar = getopt(argc, argv, "hnw:t:Humi:")) != -1) {
+	while ((optchar = getopt(argc, argv, "hnw:t:Humi:dF:s:l:g:")) != -1) {
 		switch (optchar) {
 		case 'h':
 			debug_table_usage(state);
@@ -104,6 +120,32 @@ int handle_debug_table(struct state *state, int argc, char **argv)
 		case 'H':
 			read_opt |= SKIP_HEADER;
 			break;
+		case 'd':
+			read_opt |= DELTA_READ;
+			break;
+		case 's':
+			sort_expr = optarg;
+			break;
+		case 'g':
+			group_expr = optarg;
+			break;
+		case 'l':
+			limit = strtoul(optarg, &end, 10);
+			if (!limit || *end) {
+				fprintf(stderr, "Error - the limit of '-%c' must be a positive number\n", optchar);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'F':
+			if (state->filter) {
+				fprintf(stderr, "Error - multiple filters specified, combine the terms with ','\n");
+				return EXIT_FAILURE;
+			}
+
+			state->filter = filter_compile(optarg);
+			if (!state->filter)
+				return EXIT_FAILURE;
+			break;
 		case 'u':
 			if (!debug_table->option_unicast_only) {
 				fprintf(stderr, "Error - unrecognised option '-%c'\n", optchar);
@@ -139,6 +181,14 @@ int handle_debug_table(struct state *state, int argc, char **argv)
 				fprintf(stderr, "Error - option '-t' needs a number as argument\n");
 			} else if (optopt == 'i') {
 				fprintf(stderr, "Error - option '-i' needs an interface as argument\n");
+			} else if (optopt == 's') {
+				fprintf(stderr, "Error - option '-s' needs a list of fields as argument\n");
+			} else if (optopt == 'g') {
+				fprintf(stderr, "Error - option '-g' needs a list of fields as argument\n");
+			} else if (optopt == 'l') {
+				fprintf(stderr, "Error - option '-l' needs a number as argument\n");
+			} else if (optopt == 'F') {
+				fprintf(stderr, "Error - option '-F' needs a filter expression as argument\n");
 			} else if (optopt == 'w') {
 				read_opt |= CLR_CONT_READ;
 				break;
@@ -155,6 +205,40 @@ int handle_debug_table(struct state *state, int argc, char **argv)
 
 	check_root_or_die("batctl");
 
+	if (group_expr) {
+		if (sort_expr) {
+			fprintf(stderr, "Error - groups are always sorted by the number of entries, '-s' can't be used with '-g'\n");
+			return EXIT_FAILURE;
+		}
+
+		if (read_opt & DELTA_READ) {
+			fprintf(stderr, "Error - delta mode can't be used with '-g'\n");
+			return EXIT_FAILURE;
+		}
+
+		/* the limit applies to the groups */
+		state->group = group_compile(group_expr, limit);
+		if (!state->group)
+			return EXIT_FAILURE;
+	} else if (sort_expr || limit) {
+		state->sort = sort_compile(sort_expr, limit);
+		if (!state->sort)
+			return EXIT_FAILURE;
+	}
+
+	if (state->output_format != OUTPUT_FORMAT_TEXT) {
+		if (read_opt & DELTA_READ) {
+			fprintf(stderr, "Error - delta mode is only available for the text output format\n");
+			return EXIT_FAILURE;
+		}
+
+		if (!debug_table->netlink_fn) {
+			fprintf(stderr, "Error - %s only supports the text output format\n",
+				state->cmd->name);
+			return EXIT_FAILURE;
+		}
+	}
+
 	if (read_opt & UNICAST_ONLY && read_opt & MULTICAST_ONLY) {
 		fprintf(stderr, "Error - '-u' and '-m' are exclusive options\n");
 		debug_table_usage(state);
@@ -171,7 +255,25 @@ int handle_debug_table(struct state *state, int argc, char **argv)
 		err = debug_table->netlink_fn(state , orig_iface, read_opt,
 					      orig_timeout, watch_interval);
 		if (err != -EOPNOTSUPP)
-			return err;
+			goto out;
+	}
+
+	if (state->output_format != OUTPUT_FORMAT_TEXT) {
+		fprintf(stderr, "Error - the output format requires the batman-adv netlink interface\n");
+		err = EXIT_FAILURE;
+		goto out;
+	}
+
+	if (state->filter || state->sort || state->group) {
+		fprintf(stderr, "Error - filters, sorting and grouping require the batman-adv netlink interface\n");
+		err = EXIT_FAILURE;
+		goto out;
+	}
+
+	if (read_opt & DELTA_READ) {
+		fprintf(stderr, "Error - printing only the changes requires the batman-adv netlink interface\n");
+		err = EXIT_FAILURE;
+		goto out;
 	}
 
 	if (orig_iface)
@@ -179,7 +281,41 @@ int handle_debug_table(struct state *state, int argc, char **argv)
 	else
 		debugfs_make_path(DEBUG_BATIF_PATH_FMT "/", state->mesh_iface, full_path, sizeof(full_path));
 
-	return read_file(full_path, debug_table->debugfs_name,
-			 read_opt, orig_timeout, watch_interval,
-			 debug_table->header_lines);
+	err = read_file(full_path, debug_table->debugfs_name,
+			read_opt, orig_timeout, watch_interval,
+			debug_table->header_lines);
+
+out:
+	filter_free(state->filter);
+	state->filter = NULL;
+	sort_free(state->sort);
+	state->sort = NULL;
+	group_free(state->group);
+	state->group = NULL;
+
+	return err;
+}
+
+/* debug table with netlink support by name or abbreviation */
+const struct command *debug_table_find(const char *name)
+{
+	const struct debug_table_data *debug_table;
+	const struct command **p;
+
+	for (p = __start___command; p < __stop___command; p++) {
+		if ((*p)->type != DEBUGTABLE)
+			continue;
+
+		if (strcmp((*p)->name, name) != 0 &&
+		    strcmp((*p)->abbr, name) != 0)
+			continue;
+
+		debug_table = (*p)->arg;
+		if (!debug_table || !debug_table->netlink_fn)
+			return NULL;
+
+		return *p;
+	}
+
+	return NULL;
 }
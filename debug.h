@@ -24,7 +24,10 @@
 #define _BATCTL_DEBUG_H
 
 #include <stddef.h>
+#include <stdint.h>
+
 #include "main.h"
+#include "netlink.h"
 
 #define DEBUG_BATIF_PATH_FMT "%s/batman_adv/%s"
 #define DEBUG_TRANSTABLE_GLOBAL "transtable_global"
@@ -41,6 +44,9 @@ struct debug_table_data {
 	size_t header_lines;
 	int (*netlink_fn)(struct state *state, char *hard_iface, int read_opt,
 			 float orig_timeout, float watch_interval);
+	/* dump command and row printer of netlink_fn (for recorded dumps) */
+	uint8_t nl_cmd;
+	netlink_dump_cb_t netlink_cb;
 	unsigned int option_unicast_only:1;
 	unsigned int option_multicast_only:1;
 	unsigned int option_timeout_interval:1;
@@ -48,5 +54,6 @@ struct debug_table_data {
 };
 
 int handle_debug_table(struct state *state, int argc, char **argv);
+const struct command *debug_table_find(const char *name);
 
 #endif
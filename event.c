@@ -22,33 +22,91 @@
 
 #include <errno.h>
 #include <getopt.h>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
 #include <netinet/if_ether.h>
 #include <netlink/netlink.h>
 #include <netlink/genl/genl.h>
 #include <netlink/genl/ctrl.h>
+#include <signal.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
-#include <sys/time.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "batadv_packet.h"
 #include "batman_adv.h"
 #include "bat-hosts.h"
 #include "debug.h"
 #include "functions.h"
-#include "genl.h"
+#include "hash.h"
 #include "main.h"
 #include "netlink.h"
 
+#define EVENT_MAX_POLLS 8
+#define EVENT_MAX_FDS (EVENT_MAX_POLLS + 3)
+
 enum event_time_mode {
 	EVENT_TIME_NO,
 	EVENT_TIME_LOCAL,
 	EVENT_TIME_RELATIVE,
+	EVENT_TIME_MONOTONIC,
+};
+
+/* sources which are multiplexed by the epoll loop */
+enum event_source {
+	EVENT_SOURCE_BATADV,
+	EVENT_SOURCE_RTNL,
+	EVENT_SOURCE_SIGNAL,
+	EVENT_SOURCE_POLL,
+};
+
+/* debug table which is printed periodically */
+struct event_poll {
+	const struct command *cmd;
+	float interval;
+	int fd;
+};
+
+/* last known state of a network interface */
+struct event_link {
+	int ifindex;
+	char name[IF_NAMESIZE];
+	int master;
+	bool mesh;
+	bool up;
 };
 
 struct event_args {
+	struct state *state;
 	enum event_time_mode mode;
-	struct timeval tv;
+
+	/* monotonic time of the event which is handled */
+	struct timespec now;
+	struct timespec last;
+	struct timespec start_mono;
+	struct timespec start_real;
+
+	struct nl_sock *batadv_sock;
+	struct nl_cb *batadv_cb;
+	struct nl_sock *rtnl_sock;
+	struct nl_cb *rtnl_cb;
+	struct hashtable_t *links;
+	bool links_initial;
+
+	struct event_poll polls[EVENT_MAX_POLLS];
+	size_t num_polls;
+
+	int epoll_fd;
+	int signal_fd;
+	bool stop;
 };
 
 static void event_usage(void)
@@ -58,36 +116,58 @@ static void event_usage(void)
 	fprintf(stderr, " \t -h print this help\n");
 	fprintf(stderr, " \t -t print local timestamp\n");
 	fprintf(stderr, " \t -r print relative timestamp\n");
+	fprintf(stderr, " \t -m print monotonic timestamp\n");
+	fprintf(stderr, " \t -p table[=interval] print a debug table every x.y seconds (default: 10)\n");
 }
 
-static int event_prepare(struct state *state)
+static int compare_event_link(void *data1, void *data2)
 {
-	int ret;
-	int mcid;
+	const struct event_link *link1 = data1;
+	const struct event_link *link2 = data2;
 
-	if (!state->sock)
-		return -EOPNOTSUPP;
+	return (link1->ifindex == link2->ifindex ? 1 : 0);
+}
 
-	mcid = nl_get_multicast_id(state->sock, BATADV_NL_NAME,
-				   BATADV_NL_MCAST_GROUP_TPMETER);
-	if (mcid < 0) {
-		fprintf(stderr, "Failed to resolve batadv tp_meter multicast group: %d\n",
-			mcid);
-		/* ignore error for now */
-		goto skip_tp_meter;
-	}
+static int choose_event_link(void *data, int32_t size)
+{
+	const struct event_link *link = data;
 
-	ret = nl_socket_add_membership(state->sock, mcid);
-	if (ret) {
-		fprintf(stderr, "Failed to join batadv tp_meter multicast group: %d\n",
-			ret);
-		/* ignore error for now */
-		goto skip_tp_meter;
+	return ((uint32_t)link->ifindex % size);
+}
+
+static void event_print_timestamp(struct event_args *event_args)
+{
+	struct timespec ts = event_args->now;
+
+	switch (event_args->mode) {
+	case EVENT_TIME_NO:
+		return;
+	case EVENT_TIME_LOCAL:
+		/* wall clock derived from the monotonic event time */
+		ts.tv_sec += event_args->start_real.tv_sec -
+			     event_args->start_mono.tv_sec;
+		ts.tv_nsec += event_args->start_real.tv_nsec -
+			      event_args->start_mono.tv_nsec;
+		break;
+	case EVENT_TIME_RELATIVE:
+		ts.tv_sec -= event_args->last.tv_sec;
+		ts.tv_nsec -= event_args->last.tv_nsec;
+		event_args->last = event_args->now;
+		break;
+	case EVENT_TIME_MONOTONIC:
+		break;
 	}
 
-skip_tp_meter:
+	if (ts.tv_nsec < 0) {
+		ts.tv_sec--;
+		ts.tv_nsec += 1000000000L;
+	} else if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
 
-	return 0;
+	printf("%llu.%06ld: ", (unsigned long long)ts.tv_sec,
+	       ts.tv_nsec / 1000);
 }
 
 static int no_seq_check(struct nl_msg *msg __maybe_unused,
@@ -145,29 +225,11 @@ static void event_parse_tp_meter(struct nlattr **attrs)
 	printf("tp_meter 0x%08x: %s\n", cookie, result_str);
 }
 
-static unsigned long long get_timestamp(struct event_args *event_args)
-{
-	unsigned long long prevtime = 0;
-	unsigned long long now;
-	struct timeval tv;
-
-	gettimeofday(&tv, NULL);
-	now = 1000000ULL * tv.tv_sec + tv.tv_usec;
-
-	if (event_args->mode == EVENT_TIME_RELATIVE) {
-		prevtime = 1000000ULL * event_args->tv.tv_sec + event_args->tv.tv_usec;
-		event_args->tv = tv;
-	}
-
-	return now - prevtime;
-}
-
 static int event_parse(struct nl_msg *msg, void *arg)
 {
 	struct nlmsghdr *nlh = nlmsg_hdr(msg);
 	struct nlattr *attrs[NUM_BATADV_ATTR];
 	struct event_args *event_args = arg;
-	unsigned long long timestamp;
 	struct genlmsghdr *ghdr;
 
 	if (!genlmsg_valid_hdr(nlh, 0))
@@ -181,10 +243,7 @@ static int event_parse(struct nl_msg *msg, void *arg)
 		return NL_OK;
 	}
 
-	if (event_args->mode != EVENT_TIME_NO) {
-		timestamp = get_timestamp(event_args);
-		printf("%llu.%06llu: ", timestamp / 1000000, timestamp % 1000000);
-	}
+	event_print_timestamp(event_args);
 
 	switch (ghdr->cmd) {
 	case BATADV_CMD_TP_METER:
@@ -198,15 +257,524 @@ static int event_parse(struct nl_msg *msg, void *arg)
 	return NL_OK;
 }
 
+static struct nla_policy event_link_policy[IFLA_MAX + 1] = {
+	[IFLA_IFNAME] = { .type = NLA_STRING, .maxlen = IFNAMSIZ },
+	[IFLA_MASTER] = { .type = NLA_U32 },
+	[IFLA_LINKINFO] = { .type = NLA_NESTED },
+};
+
+static struct nla_policy event_link_info_policy[IFLA_INFO_MAX + 1] = {
+	[IFLA_INFO_KIND] = { .type = NLA_STRING },
+};
+
+static bool event_link_is_mesh(struct nlattr *linkinfo)
+{
+	struct nlattr *info[IFLA_INFO_MAX + 1];
+
+	if (!linkinfo)
+		return false;
+
+	if (nla_parse_nested(info, IFLA_INFO_MAX, linkinfo,
+			     event_link_info_policy) < 0)
+		return false;
+
+	if (!info[IFLA_INFO_KIND])
+		return false;
+
+	return strcmp(nla_get_string(info[IFLA_INFO_KIND]), "batadv") == 0;
+}
+
+static struct event_link *event_link_find(struct event_args *event_args,
+					  int ifindex)
+{
+	struct event_link lookup = {
+		.ifindex = ifindex,
+	};
+
+	return hash_find(event_args->links, &lookup);
+}
+
+static bool event_link_in_mesh(struct event_args *event_args, int master)
+{
+	struct event_link *link;
+
+	if (!master)
+		return false;
+
+	link = event_link_find(event_args, master);
+
+	return link && link->mesh;
+}
+
+static void event_print_link(struct event_args *event_args,
+			     const struct event_link *link, int master,
+			     const char *what)
+{
+	struct event_link *mesh;
+
+	event_print_timestamp(event_args);
+
+	if (link->mesh) {
+		printf("mesh interface %s: %s\n", link->name, what);
+		return;
+	}
+
+	mesh = event_link_find(event_args, master);
+	printf("hard interface %s (%s): %s\n", link->name,
+	       mesh ? mesh->name : "?", what);
+}
+
+static int event_parse_link(struct nl_msg *msg, void *arg)
+{
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct event_args *event_args = arg;
+	struct nlattr *attrs[IFLA_MAX + 1];
+	struct hashtable_t *swaphash;
+	struct event_link *link;
+	struct ifinfomsg *ifm;
+	bool was_member;
+	bool is_member;
+	bool up;
+
+	if (nlh->nlmsg_type != RTM_NEWLINK && nlh->nlmsg_type != RTM_DELLINK)
+		return NL_OK;
+
+	ifm = nlmsg_data(nlh);
+	if (ifm->ifi_family != AF_UNSPEC)
+		return NL_OK;
+
+	if (nlmsg_parse(nlh, sizeof(*ifm), attrs, IFLA_MAX,
+			event_link_policy) < 0)
+		return NL_OK;
+
+	link = event_link_find(event_args, ifm->ifi_index);
+
+	if (nlh->nlmsg_type == RTM_DELLINK) {
+		if (!link)
+			return NL_OK;
+
+		if (link->mesh || event_link_in_mesh(event_args, link->master))
+			event_print_link(event_args, link, link->master,
+					 "removed");
+
+		hash_remove(event_args->links, link);
+		free(link);
+		return NL_OK;
+	}
+
+	if (!link) {
+		link = calloc(1, sizeof(*link));
+		if (!link)
+			return NL_OK;
+
+		link->ifindex = ifm->ifi_index;
+
+		if (hash_add(event_args->links, link) < 0) {
+			free(link);
+			return NL_OK;
+		}
+
+		if (event_args->links->elements * 4 > event_args->links->size) {
+			swaphash = hash_resize(event_args->links,
+					       event_args->links->size * 2);
+			if (swaphash)
+				event_args->links = swaphash;
+		}
+
+		/* everything which exists at the start is only recorded */
+		if (!event_args->links_initial)
+			link->master = -1;
+	}
+
+	if (attrs[IFLA_IFNAME])
+		snprintf(link->name, sizeof(link->name), "%s",
+			 nla_get_string(attrs[IFLA_IFNAME]));
+
+	up = (ifm->ifi_flags & IFF_UP) && (ifm->ifi_flags & IFF_RUNNING);
+
+	if (event_args->links_initial) {
+		link->mesh = event_link_is_mesh(attrs[IFLA_LINKINFO]);
+		link->master = attrs[IFLA_MASTER] ?
+			       nla_get_u32(attrs[IFLA_MASTER]) : 0;
+		link->up = up;
+		return NL_OK;
+	}
+
+	/* new mesh interface */
+	if (link->master < 0 && event_link_is_mesh(attrs[IFLA_LINKINFO])) {
+		link->mesh = true;
+		link->master = 0;
+		link->up = up;
+		event_print_link(event_args, link, 0, "added");
+		return NL_OK;
+	}
+
+	if (link->master < 0)
+		link->master = 0;
+
+	if (!link->mesh) {
+		was_member = event_link_in_mesh(event_args, link->master);
+		is_member = attrs[IFLA_MASTER] &&
+			    event_link_in_mesh(event_args,
+					       nla_get_u32(attrs[IFLA_MASTER]));
+
+		if (was_member && !is_member)
+			event_print_link(event_args, link, link->master,
+					 "removed");
+
+		link->master = attrs[IFLA_MASTER] ?
+			       nla_get_u32(attrs[IFLA_MASTER]) : 0;
+
+		if (!was_member && is_member) {
+			link->up = up;
+			event_print_link(event_args, link, link->master,
+					 "added");
+			return NL_OK;
+		}
+
+		if (!is_member) {
+			link->up = up;
+			return NL_OK;
+		}
+	}
+
+	if (link->up != up)
+		event_print_link(event_args, link, link->master,
+				 up ? "up" : "down");
+
+	link->up = up;
+
+	return NL_OK;
+}
+
+static int event_epoll_add(struct event_args *event_args, int fd,
+			   enum event_source source, uint32_t index)
+{
+	struct epoll_event ev = {
+		.events = EPOLLIN,
+		.data.u64 = ((uint64_t)index << 32) | source,
+	};
+
+	if (epoll_ctl(event_args->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+		return -errno;
+
+	return 0;
+}
+
+static int event_prepare_batadv(struct event_args *event_args)
+{
+	struct state *state = event_args->state;
+	int ret;
+
+	if (!state->sock)
+		return -EOPNOTSUPP;
+
+	/* multicast messages would be dropped by the dumps of polled tables
+	 * on the shared socket
+	 */
+	event_args->batadv_sock = nl_socket_alloc();
+	if (!event_args->batadv_sock)
+		return -ENOMEM;
+
+	ret = genl_connect(event_args->batadv_sock);
+	if (ret < 0)
+		return -EOPNOTSUPP;
+
+	if (state->tpmeter_mcid < 0) {
+		fprintf(stderr, "Failed to resolve batadv tp_meter multicast group: %d\n",
+			state->tpmeter_mcid);
+		/* ignore error for now */
+		goto skip_tp_meter;
+	}
+
+	ret = nl_socket_add_membership(event_args->batadv_sock,
+				       state->tpmeter_mcid);
+	if (ret) {
+		fprintf(stderr, "Failed to join batadv tp_meter multicast group: %d\n",
+			ret);
+		/* ignore error for now */
+		goto skip_tp_meter;
+	}
+
+skip_tp_meter:
+	event_args->batadv_cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!event_args->batadv_cb)
+		return -ENOMEM;
+
+	nl_cb_set(event_args->batadv_cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM,
+		  no_seq_check, NULL);
+	nl_cb_set(event_args->batadv_cb, NL_CB_VALID, NL_CB_CUSTOM,
+		  event_parse, event_args);
+
+	nl_socket_set_nonblocking(event_args->batadv_sock);
+
+	return event_epoll_add(event_args,
+			       nl_socket_get_fd(event_args->batadv_sock),
+			       EVENT_SOURCE_BATADV, 0);
+}
+
+static int event_prepare_rtnl(struct event_args *event_args)
+{
+	struct ifinfomsg ifm = {
+		.ifi_family = AF_UNSPEC,
+	};
+	int ret;
+
+	event_args->links = hash_new(64, compare_event_link,
+				     choose_event_link);
+	if (!event_args->links)
+		return -ENOMEM;
+
+	event_args->rtnl_sock = nl_socket_alloc();
+	if (!event_args->rtnl_sock)
+		return -ENOMEM;
+
+	ret = nl_connect(event_args->rtnl_sock, NETLINK_ROUTE);
+	if (ret < 0)
+		return -EOPNOTSUPP;
+
+	event_args->rtnl_cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!event_args->rtnl_cb)
+		return -ENOMEM;
+
+	nl_cb_set(event_args->rtnl_cb, NL_CB_VALID, NL_CB_CUSTOM,
+		  event_parse_link, event_args);
+
+	/* the current interfaces are the base for the reported changes */
+	event_args->links_initial = true;
+
+	ret = nl_send_simple(event_args->rtnl_sock, RTM_GETLINK, NLM_F_DUMP,
+			     &ifm, sizeof(ifm));
+	if (ret >= 0)
+		ret = nl_recvmsgs(event_args->rtnl_sock, event_args->rtnl_cb);
+
+	event_args->links_initial = false;
+
+	if (ret < 0)
+		return -EIO;
+
+	ret = nl_socket_add_membership(event_args->rtnl_sock, RTNLGRP_LINK);
+	if (ret < 0)
+		return -EIO;
+
+	nl_cb_set(event_args->rtnl_cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM,
+		  no_seq_check, NULL);
+	nl_socket_set_nonblocking(event_args->rtnl_sock);
+
+	return event_epoll_add(event_args,
+			       nl_socket_get_fd(event_args->rtnl_sock),
+			       EVENT_SOURCE_RTNL, 0);
+}
+
+static int event_prepare_signals(struct event_args *event_args)
+{
+	sigset_t mask;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+
+	if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0)
+		return -errno;
+
+	event_args->signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+	if (event_args->signal_fd < 0)
+		return -errno;
+
+	return event_epoll_add(event_args, event_args->signal_fd,
+			       EVENT_SOURCE_SIGNAL, 0);
+}
+
+static int event_prepare_polls(struct event_args *event_args)
+{
+	struct itimerspec its;
+	struct event_poll *poll;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < event_args->num_polls; i++) {
+		poll = &event_args->polls[i];
+
+		poll->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+		if (poll->fd < 0)
+			return -errno;
+
+		its.it_interval.tv_sec = poll->interval;
+		its.it_interval.tv_nsec = (poll->interval -
+					   its.it_interval.tv_sec) * 1000000000L;
+
+		/* first dump right away */
+		its.it_value.tv_sec = 0;
+		its.it_value.tv_nsec = 1;
+
+		if (timerfd_settime(poll->fd, 0, &its, NULL) < 0)
+			return -errno;
+
+		ret = event_epoll_add(event_args, poll->fd, EVENT_SOURCE_POLL,
+				      i);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static void event_handle_poll(struct event_args *event_args,
+			      struct event_poll *poll)
+{
+	const struct debug_table_data *debug_table = poll->cmd->arg;
+	uint64_t expirations;
+
+	if (read(poll->fd, &expirations, sizeof(expirations)) < 0)
+		return;
+
+	event_print_timestamp(event_args);
+	printf("table %s:\n", poll->cmd->name);
+
+	debug_table->netlink_fn(event_args->state, NULL, USE_BAT_HOSTS, 0.0f,
+				0.0f);
+}
+
+static void event_handle_signal(struct event_args *event_args)
+{
+	struct signalfd_siginfo info;
+
+	if (read(event_args->signal_fd, &info, sizeof(info)) < 0)
+		return;
+
+	event_args->stop = true;
+}
+
+static void event_loop(struct event_args *event_args)
+{
+	struct epoll_event events[EVENT_MAX_FDS];
+	uint32_t index;
+	int ret;
+	int i;
+
+	while (!event_args->stop) {
+		ret = epoll_wait(event_args->epoll_fd, events,
+				 ARRAY_SIZE(events), -1);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			fprintf(stderr, "Error - failed to wait for events: %s\n",
+				strerror(errno));
+			break;
+		}
+
+		for (i = 0; i < ret && !event_args->stop; i++) {
+			index = events[i].data.u64 >> 32;
+
+			clock_gettime(CLOCK_MONOTONIC, &event_args->now);
+
+			switch (events[i].data.u64 & 0xffffffff) {
+			case EVENT_SOURCE_BATADV:
+				nl_recvmsgs(event_args->batadv_sock,
+					    event_args->batadv_cb);
+				break;
+			case EVENT_SOURCE_RTNL:
+				nl_recvmsgs(event_args->rtnl_sock,
+					    event_args->rtnl_cb);
+				break;
+			case EVENT_SOURCE_SIGNAL:
+				event_handle_signal(event_args);
+				break;
+			case EVENT_SOURCE_POLL:
+				event_handle_poll(event_args,
+						  &event_args->polls[index]);
+				break;
+			}
+		}
+
+		/* the output is often piped into a logger */
+		fflush(stdout);
+	}
+}
+
+static void event_free(struct event_args *event_args)
+{
+	size_t i;
+
+	for (i = 0; i < event_args->num_polls; i++) {
+		if (event_args->polls[i].fd >= 0)
+			close(event_args->polls[i].fd);
+	}
+
+	if (event_args->signal_fd >= 0)
+		close(event_args->signal_fd);
+
+	if (event_args->epoll_fd >= 0)
+		close(event_args->epoll_fd);
+
+	if (event_args->links)
+		hash_delete(event_args->links, free);
+
+	if (event_args->rtnl_cb)
+		nl_cb_put(event_args->rtnl_cb);
+
+	if (event_args->rtnl_sock)
+		nl_socket_free(event_args->rtnl_sock);
+
+	if (event_args->batadv_cb)
+		nl_cb_put(event_args->batadv_cb);
+
+	if (event_args->batadv_sock)
+		nl_socket_free(event_args->batadv_sock);
+}
+
+static int event_add_poll(struct event_args *event_args, char *arg)
+{
+	struct event_poll *poll;
+	char *interval;
+	char *end;
+
+	if (event_args->num_polls == EVENT_MAX_POLLS) {
+		fprintf(stderr, "Error - at most %d tables can be polled\n",
+			EVENT_MAX_POLLS);
+		return -EINVAL;
+	}
+
+	poll = &event_args->polls[event_args->num_polls];
+	poll->interval = 10.0f;
+	poll->fd = -1;
+
+	interval = strchr(arg, '=');
+	if (interval) {
+		*interval++ = '\0';
+
+		poll->interval = strtof(interval, &end);
+		if (*end || poll->interval < 0.001f) {
+			fprintf(stderr, "Error - invalid poll interval: %s\n",
+				interval);
+			return -EINVAL;
+		}
+	}
+
+	poll->cmd = debug_table_find(arg);
+	if (!poll->cmd) {
+		fprintf(stderr, "Error - unknown debug table: %s\n", arg);
+		return -EINVAL;
+	}
+
+	event_args->num_polls++;
+
+	return 0;
+}
+
 static int event(struct state *state, int argc, char **argv)
 {
 	struct event_args event_args = {
+		.state = state,
 		.mode = EVENT_TIME_NO,
+		.epoll_fd = -1,
+		.signal_fd = -1,
 	};
 	int opt;
 	int ret;
 
-	while ((opt = getopt(argc, argv, "htr")) != -1) {
+	while ((opt = getopt(argc, argv, "htrmp:")) != -1) {
 		switch (opt) {
 		case 'h':
 			event_usage();
@@ -217,29 +785,56 @@ static int event(struct state *state, int argc, char **argv)
 		case 'r':
 			event_args.mode = EVENT_TIME_RELATIVE;
 			break;
+		case 'm':
+			event_args.mode = EVENT_TIME_MONOTONIC;
+			break;
+		case 'p':
+			if (event_add_poll(&event_args, optarg) < 0)
+				return EXIT_FAILURE;
+			break;
 		default:
 			event_usage();
 			return  EXIT_FAILURE;
 		}
 	}
 
-	ret = event_prepare(state);
-	if (ret < 0) {
-		fprintf(stderr, "Failed to prepare event netlink: %s (%d)\n",
-			strerror(-ret), -ret);
-		return 1;
+	clock_gettime(CLOCK_MONOTONIC, &event_args.start_mono);
+	clock_gettime(CLOCK_REALTIME, &event_args.start_real);
+	event_args.last = event_args.start_mono;
+
+	event_args.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (event_args.epoll_fd < 0) {
+		ret = -errno;
+		goto err;
 	}
 
-	if (event_args.mode == EVENT_TIME_RELATIVE)
-		get_timestamp(&event_args);
+	ret = event_prepare_batadv(&event_args);
+	if (ret < 0)
+		goto err;
 
-	nl_cb_set(state->cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, no_seq_check, NULL);
-	nl_cb_set(state->cb, NL_CB_VALID, NL_CB_CUSTOM, event_parse, &event_args);
+	ret = event_prepare_rtnl(&event_args);
+	if (ret < 0)
+		goto err;
 
-	while (1)
-		nl_recvmsgs(state->sock, state->cb);
+	ret = event_prepare_polls(&event_args);
+	if (ret < 0)
+		goto err;
 
-	return 0;
+	ret = event_prepare_signals(&event_args);
+	if (ret < 0)
+		goto err;
+
+	event_loop(&event_args);
+	event_free(&event_args);
+
+	return EXIT_SUCCESS;
+
+err:
+	fprintf(stderr, "Failed to prepare event netlink: %s (%d)\n",
+		strerror(-ret), -ret);
+	event_free(&event_args);
+
+	return EXIT_FAILURE;
 }
 
 COMMAND(SUBCOMMAND, event, "e", COMMAND_FLAG_NETLINK, NULL,
@@ -0,0 +1,464 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#include <errno.h>
+#include <net/if.h>
+#include <netinet/ether.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bat-hosts.h"
+#include "batadv_packet.h"
+#include "batman_adv.h"
+#include "filter.h"
+#include "functions.h"
+#include "main.h"
+
+enum filter_op {
+	FILTER_EQ,
+	FILTER_NE,
+	FILTER_LT,
+	FILTER_LE,
+	FILTER_GT,
+	FILTER_GE,
+};
+
+enum filter_value {
+	FILTER_VALUE_NUM,	/* plain number */
+	FILTER_VALUE_IFACE,	/* interface name -> ifindex */
+	FILTER_VALUE_AGE,	/* seconds -> milliseconds */
+};
+
+struct filter_key {
+	const char *name;
+	netlink_attr_mask_t attrs;
+	enum filter_value value;
+};
+
+/* short names for attributes which mean the same in different tables */
+static const struct filter_key filter_keys[] = {
+	{
+		.name = "orig",
+		.attrs = NETLINK_ATTR_BIT(BATADV_ATTR_ORIG_ADDRESS),
+	},
+	{
+		.name = "neigh",
+		.attrs = NETLINK_ATTR_BIT(BATADV_ATTR_NEIGH_ADDRESS) |
+			 NETLINK_ATTR_BIT(BATADV_ATTR_ROUTER),
+	},
+	{
+		.name = "client",
+		.attrs = NETLINK_ATTR_BIT(BATADV_ATTR_TT_ADDRESS) |
+			 NETLINK_ATTR_BIT(BATADV_ATTR_BLA_ADDRESS) |
+			 NETLINK_ATTR_BIT(BATADV_ATTR_DAT_CACHE_HWADDRESS),
+	},
+	{
+		.name = "vid",
+		.attrs = NETLINK_ATTR_BIT(BATADV_ATTR_TT_VID) |
+			 NETLINK_ATTR_BIT(BATADV_ATTR_BLA_VID) |
+			 NETLINK_ATTR_BIT(BATADV_ATTR_DAT_CACHE_VID),
+	},
+	{
+		.name = "iface",
+		.attrs = NETLINK_ATTR_BIT(BATADV_ATTR_HARD_IFINDEX) |
+			 NETLINK_ATTR_BIT(BATADV_ATTR_HARD_IFNAME),
+		.value = FILTER_VALUE_IFACE,
+	},
+	{
+		.name = "age",
+		.attrs = NETLINK_ATTR_BIT(BATADV_ATTR_LAST_SEEN_MSECS),
+		.value = FILTER_VALUE_AGE,
+	},
+};
+
+struct filter_term {
+	const char *name;
+	netlink_attr_mask_t attrs;
+	enum filter_op op;
+	const char *str;
+	bool has_mac;
+	long long mac;
+	bool has_num;
+	long long num;
+
+	/* entry in the descriptors of the table which is tested */
+	size_t desc_idx;
+};
+
+struct filter {
+	char *expr;
+
+	/* descriptors the terms were resolved for */
+	const struct netlink_attr_desc *desc;
+
+	/* the terms don't fit the table of the last row */
+	int err;
+
+	size_t num;
+	struct filter_term terms[];
+};
+
+static const char *filter_parse_op(char *term, enum filter_op *op)
+{
+	static const struct {
+		const char *str;
+		enum filter_op op;
+	} ops[] = {
+		/* two character operators first */
+		{ "!=", FILTER_NE },
+		{ "<=", FILTER_LE },
+		{ ">=", FILTER_GE },
+		{ "=", FILTER_EQ },
+		{ "<", FILTER_LT },
+		{ ">", FILTER_GT },
+	};
+	char *pos = term + strcspn(term, "!=<>");
+	size_t i;
+
+	if (!*pos)
+		return NULL;
+
+	for (i = 0; i < ARRAY_SIZE(ops); i++) {
+		if (strncmp(pos, ops[i].str, strlen(ops[i].str)) != 0)
+			continue;
+
+		*op = ops[i].op;
+		*pos = '\0';
+		return pos + strlen(ops[i].str);
+	}
+
+	return NULL;
+}
+
+/* attributes which are compared for a field name of filters or sort keys */
+netlink_attr_mask_t filter_field_attrs(const char *name)
+{
+	size_t i;
+	int attr;
+
+	for (i = 0; i < ARRAY_SIZE(filter_keys); i++) {
+		if (strcmp(filter_keys[i].name, name) == 0)
+			return filter_keys[i].attrs;
+	}
+
+	attr = netlink_attr_lookup(name);
+	if (attr < 0)
+		return 0;
+
+	return NETLINK_ATTR_BIT(attr);
+}
+
+static int filter_parse_term(struct filter_term *term, char *str)
+{
+	enum filter_value value = FILTER_VALUE_NUM;
+	struct ether_addr *mac = NULL;
+	struct bat_host *bat_host;
+	const char *val;
+	char *end;
+	size_t i;
+
+	val = filter_parse_op(str, &term->op);
+	if (!val || !*str || !*val) {
+		fprintf(stderr, "Error - invalid filter expression: %s\n", str);
+		return -EINVAL;
+	}
+
+	term->name = str;
+	term->str = val;
+	term->attrs = filter_field_attrs(str);
+
+	if (!term->attrs) {
+		fprintf(stderr, "Error - unknown filter field: %s\n", str);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(filter_keys); i++) {
+		if (strcmp(filter_keys[i].name, str) == 0)
+			value = filter_keys[i].value;
+	}
+
+	switch (value) {
+	case FILTER_VALUE_IFACE:
+		term->num = if_nametoindex(val);
+		if (!term->num) {
+			fprintf(stderr, "Error - interface %s is unknown\n",
+				val);
+			return -ENODEV;
+		}
+
+		term->has_num = true;
+		break;
+	case FILTER_VALUE_AGE:
+		term->num = strtof(val, &end) * 1000;
+		term->has_num = !*end;
+		break;
+	default:
+		term->num = strtoll(val, &end, 0);
+		term->has_num = !*end;
+		break;
+	}
+
+	mac = ether_aton(val);
+	if (!mac) {
+		bat_host = bat_hosts_find_by_name((char *)val);
+		if (bat_host)
+			mac = &bat_host->mac_addr;
+	}
+
+	if (mac) {
+		for (i = 0; i < ETH_ALEN; i++)
+			term->mac = (term->mac << 8) | mac->ether_addr_octet[i];
+		term->has_mac = true;
+
+		if (term->op != FILTER_EQ && term->op != FILTER_NE) {
+			fprintf(stderr, "Error - addresses can only be compared with '=' or '!=': %s\n",
+				str);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/* comma separated list of "field<op>value" terms which must all match */
+struct filter *filter_compile(const char *expr)
+{
+	struct filter *filter;
+	char *saveptr;
+	size_t terms;
+	char *str;
+
+	terms = 1;
+	for (str = strchr(expr, ','); str; str = strchr(str + 1, ','))
+		terms++;
+
+	filter = calloc(1, sizeof(*filter) + terms * sizeof(filter->terms[0]));
+	if (!filter)
+		return NULL;
+
+	filter->expr = strdup(expr);
+	if (!filter->expr)
+		goto err;
+
+	/* bat-host names can be used instead of addresses */
+	bat_hosts_init(0);
+
+	for (str = strtok_r(filter->expr, ",", &saveptr); str;
+	     str = strtok_r(NULL, ",", &saveptr)) {
+		if (filter_parse_term(&filter->terms[filter->num], str) < 0) {
+			bat_hosts_free();
+			goto err;
+		}
+
+		filter->num++;
+	}
+
+	bat_hosts_free();
+
+	if (!filter->num) {
+		fprintf(stderr, "Error - empty filter expression\n");
+		goto err;
+	}
+
+	return filter;
+
+err:
+	filter_free(filter);
+	return NULL;
+}
+
+void filter_free(struct filter *filter)
+{
+	if (!filter)
+		return;
+
+	free(filter->expr);
+	free(filter);
+}
+
+/* find the descriptor of each term once for the table */
+static int filter_resolve(struct filter *filter,
+			  const struct netlink_attr_desc *desc, size_t num)
+{
+	struct filter_term *term;
+	bool found;
+	size_t i;
+	size_t j;
+
+	for (i = 0; i < filter->num; i++) {
+		term = &filter->terms[i];
+		found = false;
+
+		for (j = 0; j < num; j++) {
+			if (term->attrs & NETLINK_ATTR_BIT(desc[j].type)) {
+				term->desc_idx = j;
+				found = true;
+				break;
+			}
+		}
+
+		if (!found) {
+			fprintf(stderr, "Error - the table has no field '%s' to filter on\n",
+				term->name);
+			return -EINVAL;
+		}
+
+		switch (desc[term->desc_idx].kind) {
+		case NETLINK_ATTR_MAC:
+			if (term->has_mac)
+				break;
+
+			fprintf(stderr, "Error - '%s' needs a mac address or bat-host name: %s\n",
+				term->name, term->str);
+			return -EINVAL;
+		case NETLINK_ATTR_STRING:
+			if (term->op == FILTER_EQ || term->op == FILTER_NE)
+				break;
+
+			fprintf(stderr, "Error - '%s' can only be compared with '=' or '!='\n",
+				term->name);
+			return -EINVAL;
+		default:
+			if (term->has_num)
+				break;
+
+			fprintf(stderr, "Error - '%s' needs a number: %s\n",
+				term->name, term->str);
+			return -EINVAL;
+		}
+	}
+
+	filter->desc = desc;
+
+	return 0;
+}
+
+static bool filter_cmp(enum filter_op op, long long a, long long b)
+{
+	switch (op) {
+	case FILTER_EQ:
+		return a == b;
+	case FILTER_NE:
+		return a != b;
+	case FILTER_LT:
+		return a < b;
+	case FILTER_LE:
+		return a <= b;
+	case FILTER_GT:
+		return a > b;
+	case FILTER_GE:
+		return a >= b;
+	}
+
+	return false;
+}
+
+static bool filter_term_match(const struct filter_term *term,
+			      const struct netlink_attr_desc *desc,
+			      const void *row, netlink_attr_mask_t present)
+{
+	const uint8_t *src = (const uint8_t *)row + desc->offset;
+	long long val;
+	int ret;
+
+	if (desc->kind == NETLINK_ATTR_STRING) {
+		if (!(present & NETLINK_ATTR_BIT(desc->type)))
+			return false;
+
+		val = strcmp(*(const char * const *)src, term->str) != 0;
+		return filter_cmp(term->op, val, 0);
+	}
+
+	ret = netlink_attr_value(desc, row, present, &val);
+	if (ret < 0)
+		return false;
+
+	if (desc->kind == NETLINK_ATTR_MAC)
+		return filter_cmp(term->op, val, term->mac);
+
+	return filter_cmp(term->op, val, term->num);
+}
+
+/**
+ * filter_match() - check a decoded row against the filter
+ * @filter: compiled filter or NULL
+ * @desc: descriptors which were used to decode the row
+ * @num: number of entries in @desc
+ * @row: the decoded row
+ * @present: attributes found by netlink_decode_attrs()
+ *
+ * Return: true when the row should be printed, false when it doesn't match or
+ *  the filter doesn't fit the table - see filter_error()
+ */
+bool filter_match(struct filter *filter, const struct netlink_attr_desc *desc,
+		  size_t num, const void *row, netlink_attr_mask_t present)
+{
+	const struct filter_term *term;
+	size_t i;
+
+	if (!filter)
+		return true;
+
+	if (filter->desc != desc) {
+		filter->err = filter_resolve(filter, desc, num);
+		if (filter->err < 0)
+			return false;
+	}
+
+	for (i = 0; i < filter->num; i++) {
+		term = &filter->terms[i];
+
+		if (!filter_term_match(term, &desc[term->desc_idx], row,
+				       present))
+			return false;
+	}
+
+	return true;
+}
+
+/* error of the last filter_match() - the table can't be filtered */
+int filter_error(const struct filter *filter)
+{
+	if (!filter)
+		return 0;
+
+	return filter->err;
+}
+
+/* ifindex of an "iface=" term which can be handed to the kernel or 0 */
+int filter_hard_ifindex(const struct filter *filter)
+{
+	size_t i;
+
+	if (!filter)
+		return 0;
+
+	for (i = 0; i < filter->num; i++) {
+		if (filter->terms[i].op != FILTER_EQ)
+			continue;
+
+		if (filter->terms[i].attrs &
+		    NETLINK_ATTR_BIT(BATADV_ATTR_HARD_IFINDEX))
+			return filter->terms[i].num;
+	}
+
+	return 0;
+}
@@ -59,11 +59,11 @@
 #include "debug.h"
 #include "debugfs.h"
 #include "netlink.h"
+#include "hash.h"
 
 #define PATH_BUFF_LEN 400
 
 static struct timespec start_time;
-static char *host_name;
 char *line_ptr = NULL;
 
 void start_timer(void)
@@ -89,7 +89,8 @@ double end_timer(void)
 
 char *ether_ntoa_long(const struct ether_addr *addr)
 {
-	static char asc[18];
+	/* per thread - tcpdump dissects captures from several threads */
+	static __thread char asc[18];
 
 	sprintf(asc, "%02x:%02x:%02x:%02x:%02x:%02x",
 		addr->ether_addr_octet[0], addr->ether_addr_octet[1],
@@ -107,11 +108,9 @@ char *get_name_by_macaddr(struct ether_addr *mac_addr, int read_opt)
 		bat_host = bat_hosts_find_by_mac((char *)mac_addr);
 
 	if (!bat_host)
-		host_name = ether_ntoa_long((struct ether_addr *)mac_addr);
-	else
-		host_name = bat_host->name;
+		return ether_ntoa_long((struct ether_addr *)mac_addr);
 
-	return host_name;
+	return bat_host->name;
 }
 
 char *get_name_by_macstr(char *mac_str, int read_opt)
@@ -441,7 +440,17 @@ static int translate_mac_debugfs(const char *mesh_iface,
 		return -ENOENT;
 }
 
-struct ether_addr *translate_mac(const char *mesh_iface,
+int compare_mac(void *data1, void *data2)
+{
+	return (memcmp(data1, data2, sizeof(struct ether_addr)) == 0 ? 1 : 0);
+}
+
+int choose_mac(void *data, int32_t size)
+{
+	return (hash_bytes(data, sizeof(struct ether_addr)) % size);
+}
+
+struct ether_addr *translate_mac(struct state *state,
 				 const struct ether_addr *mac)
 {
 	struct ether_addr in_mac;
@@ -459,10 +468,10 @@ struct ether_addr *translate_mac(const char *mesh_iface,
 	if (!ether_addr_valid(in_mac.ether_addr_octet))
 		return mac_result;
 
-	ret = translate_mac_netlink(mesh_iface, &in_mac, mac_result);
+	ret = translate_mac_netlink(state, &in_mac, mac_result);
 
 	if (ret == -EOPNOTSUPP)
-		translate_mac_debugfs(mesh_iface, &in_mac, mac_result);
+		translate_mac_debugfs(state->mesh_iface, &in_mac, mac_result);
 
 	return mac_result;
 }
@@ -502,7 +511,7 @@ static int resolve_l3addr(int ai_family, const char *asc, void *l3addr)
 	return ret;
 }
 
-static void request_mac_resolve(int ai_family, const void *l3addr)
+void request_mac_resolve(int ai_family, const void *l3addr)
 {
 	const struct sockaddr *sockaddr;
 	struct sockaddr_in inet4;
@@ -667,6 +676,177 @@ static struct ether_addr *resolve_mac_from_cache(int ai_family,
 	return mac_result;
 }
 
+struct neigh_cache_entry {
+	uint8_t l3addr[16];
+	struct ether_addr mac;
+};
+
+struct neigh_cache_nl_arg {
+	int ai_family;
+	struct hashtable_t *hash;
+};
+
+static int compare_l3addr(void *data1, void *data2)
+{
+	return (memcmp(data1, data2, 16) == 0 ? 1 : 0);
+}
+
+static int choose_l3addr(void *data, int32_t size)
+{
+	return (hash_bytes(data, 16) % size);
+}
+
+static int neigh_cache_parse(struct nl_msg *msg, void *arg)
+{
+	struct neigh_cache_nl_arg *nl_arg = arg;
+	struct neigh_cache_entry *entry;
+	struct hashtable_t *swaphash;
+	struct nlattr *tb[NDA_MAX + 1];
+	struct ndmsg *nm;
+	uint8_t *mac;
+	int l3_len;
+	int ret;
+
+	nm = nlmsg_data(nlmsg_hdr(msg));
+	ret = nlmsg_parse(nlmsg_hdr(msg), sizeof(*nm), tb, NDA_MAX,
+			  neigh_policy);
+	if (ret < 0)
+		return NL_OK;
+
+	if (nl_arg->ai_family != nm->ndm_family)
+		return NL_OK;
+
+	switch (nl_arg->ai_family) {
+	case AF_INET:
+		l3_len = 4;
+		break;
+	case AF_INET6:
+		l3_len = 16;
+		break;
+	default:
+		return NL_OK;
+	}
+
+	if (!tb[NDA_LLADDR] || !tb[NDA_DST])
+		return NL_OK;
+
+	if (nla_len(tb[NDA_LLADDR]) != ETH_ALEN)
+		return NL_OK;
+
+	if (nla_len(tb[NDA_DST]) != l3_len)
+		return NL_OK;
+
+	mac = nla_data(tb[NDA_LLADDR]);
+	if (!ether_addr_valid(mac))
+		return NL_OK;
+
+	entry = malloc(sizeof(*entry));
+	if (!entry)
+		return NL_OK;
+
+	memset(entry->l3addr, 0, sizeof(entry->l3addr));
+	memcpy(entry->l3addr, nla_data(tb[NDA_DST]), l3_len);
+	memcpy(&entry->mac, mac, ETH_ALEN);
+
+	if (hash_find(nl_arg->hash, entry) || hash_add(nl_arg->hash, entry) < 0) {
+		free(entry);
+		return NL_OK;
+	}
+
+	if (nl_arg->hash->elements * 4 > nl_arg->hash->size) {
+		swaphash = hash_resize(nl_arg->hash, nl_arg->hash->size * 2);
+		if (swaphash)
+			nl_arg->hash = swaphash;
+	}
+
+	return NL_OK;
+}
+
+/**
+ * neigh_cache_dump - index the kernel neighbor table with a single dump
+ * @ai_family: AF_INET or AF_INET6
+ *
+ * Return: hash of struct neigh_cache_entry or NULL on error
+ */
+struct hashtable_t *neigh_cache_dump(int ai_family)
+{
+	struct neigh_cache_nl_arg arg = {
+		.ai_family = ai_family,
+	};
+	struct rtgenmsg gmsg = {
+		.rtgen_family = ai_family,
+	};
+	struct nl_sock *sock;
+	struct nl_cb *cb = NULL;
+	int ret;
+
+	arg.hash = hash_new(64, compare_l3addr, choose_l3addr);
+	if (!arg.hash)
+		return NULL;
+
+	sock = nl_socket_alloc();
+	if (!sock)
+		goto err;
+
+	ret = nl_connect(sock, NETLINK_ROUTE);
+	if (ret < 0)
+		goto err;
+
+	ret = nl_send_simple(sock, RTM_GETNEIGH, NLM_F_REQUEST | NLM_F_DUMP,
+			     &gmsg, sizeof(gmsg));
+	if (ret < 0)
+		goto err;
+
+	cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!cb)
+		goto err;
+
+	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, neigh_cache_parse, &arg);
+	ret = nl_recvmsgs(sock, cb);
+	if (ret < 0)
+		goto err;
+
+	nl_cb_put(cb);
+	nl_socket_free(sock);
+
+	return arg.hash;
+
+err:
+	if (cb)
+		nl_cb_put(cb);
+	if (sock)
+		nl_socket_free(sock);
+
+	hash_delete(arg.hash, free);
+
+	return NULL;
+}
+
+struct ether_addr *neigh_cache_find(struct hashtable_t *neigh_cache,
+				    const void *l3addr, size_t l3_len)
+{
+	struct neigh_cache_entry key;
+	struct neigh_cache_entry *entry;
+
+	if (!neigh_cache || l3_len > sizeof(key.l3addr))
+		return NULL;
+
+	memset(key.l3addr, 0, sizeof(key.l3addr));
+	memcpy(key.l3addr, l3addr, l3_len);
+
+	entry = hash_find(neigh_cache, &key);
+	if (!entry)
+		return NULL;
+
+	return &entry->mac;
+}
+
+void neigh_cache_free(struct hashtable_t *neigh_cache)
+{
+	if (neigh_cache)
+		hash_delete(neigh_cache, free);
+}
+
 static struct ether_addr *resolve_mac_from_addr(int ai_family, const char *asc)
 {
 	uint8_t ipv4_addr[4];
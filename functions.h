@@ -27,7 +27,10 @@
 #include <netlink/netlink.h>
 #include <netlink/handlers.h>
 #include <stddef.h>
+#include <stdint.h>
 
+struct hashtable_t;
+struct state;
 
 #define ETH_STR_LEN 17
 #define BATMAN_ADV_TAG "batman-adv:"
@@ -45,9 +48,16 @@ int read_file(const char *dir, const char *path, int read_opt,
 	      float orig_timeout, float watch_interval, size_t header_lines);
 int write_file(const char *dir, const char *fname, const char *arg1,
 	       const char *arg2);
-struct ether_addr *translate_mac(const char *mesh_iface,
+int compare_mac(void *data1, void *data2);
+int choose_mac(void *data, int32_t size);
+struct ether_addr *translate_mac(struct state *state,
 				 const struct ether_addr *mac);
 struct ether_addr *resolve_mac(const char *asc);
+void request_mac_resolve(int ai_family, const void *l3addr);
+struct hashtable_t *neigh_cache_dump(int ai_family);
+struct ether_addr *neigh_cache_find(struct hashtable_t *neigh_cache,
+				    const void *l3addr, size_t l3_len);
+void neigh_cache_free(struct hashtable_t *neigh_cache);
 int vlan_get_link(const char *ifname, char **parent);\
 int query_rtnl_link(int ifindex, nl_recvmsg_msg_cb_t func, void *arg);
 int netlink_simple_request(struct nl_msg *msg);
@@ -72,6 +82,7 @@ enum {
 	SKIP_HEADER = 0x100,
 	UNICAST_ONLY = 0x200,
 	MULTICAST_ONLY = 0x400,
+	DELTA_READ = 0x800,
 };
 
 #endif
@@ -35,33 +35,68 @@
 #include "batman_adv.h"
 #include "bat-hosts.h"
 #include "debug.h"
+#include "filter.h"
 #include "functions.h"
+#include "group.h"
 #include "main.h"
 #include "netlink.h"
+#include "sort.h"
 
-static const int gateways_mandatory[] = {
-	BATADV_ATTR_ORIG_ADDRESS,
-	BATADV_ATTR_ROUTER,
-	BATADV_ATTR_HARD_IFNAME,
-	BATADV_ATTR_BANDWIDTH_DOWN,
-	BATADV_ATTR_BANDWIDTH_UP,
+struct gateways_row {
+	const uint8_t *orig;
+	uint8_t tq;
+	uint32_t throughput;
+	const uint8_t *router;
+	const char *primary_if;
+	uint32_t bandwidth_down;
+	uint32_t bandwidth_up;
+	bool best;
+};
+
+static const struct netlink_attr_desc gateways_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_ORIG_ADDRESS, MAC,
+			 struct gateways_row, orig),
+	NETLINK_ATTR_OPT(BATADV_ATTR_TQ, U8,
+			 struct gateways_row, tq),
+	NETLINK_ATTR_OPT(BATADV_ATTR_THROUGHPUT, U32,
+			 struct gateways_row, throughput),
+	NETLINK_ATTR_REQ(BATADV_ATTR_ROUTER, MAC,
+			 struct gateways_row, router),
+	NETLINK_ATTR_REQ(BATADV_ATTR_HARD_IFNAME, STRING,
+			 struct gateways_row, primary_if),
+	NETLINK_ATTR_REQ(BATADV_ATTR_BANDWIDTH_DOWN, U32,
+			 struct gateways_row, bandwidth_down),
+	NETLINK_ATTR_REQ(BATADV_ATTR_BANDWIDTH_UP, U32,
+			 struct gateways_row, bandwidth_up),
+	NETLINK_ATTR_OPT(BATADV_ATTR_FLAG_BEST, FLAG,
+			 struct gateways_row, best),
 };
 
-static int gateways_callback(struct nl_msg *msg, void *arg)
+static int gateways_callback(struct nlmsghdr *nlh, void *arg)
 {
-	struct nlattr *attrs[BATADV_ATTR_MAX+1];
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct gateways_row row;
+	netlink_attr_mask_t present;
 	struct print_opts *opts = arg;
-	struct bat_host *bat_host;
 	struct genlmsghdr *ghdr;
 	const char *primary_if;
 	uint32_t bandwidth_down;
 	uint32_t bandwidth_up;
-	uint32_t throughput;
-	uint8_t *router;
-	uint8_t *orig;
+	const uint8_t *router;
+	const uint8_t *orig;
 	char c = ' ';
-	uint8_t tq;
+	int ret;
+	struct {
+		uint8_t orig[ETH_ALEN];
+	} key;
+	struct {
+		uint8_t router[ETH_ALEN];
+		uint8_t best;
+		uint8_t tq;
+		uint32_t throughput;
+		uint32_t bandwidth_down;
+		uint32_t bandwidth_up;
+	} value;
+	struct output *out;
 
 	if (!genlmsg_valid_hdr(nlh, 0)) {
 		fputs("Received invalid data from kernel.\n", stderr);
@@ -73,56 +108,88 @@ static int gateways_callback(struct nl_msg *msg, void *arg)
 	if (ghdr->cmd != BATADV_CMD_GET_GATEWAYS)
 		return NL_OK;
 
-	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
-		      genlmsg_len(ghdr), batadv_netlink_policy)) {
+	ret = netlink_decode_attrs(ghdr, gateways_attrs,
+				   ARRAY_SIZE(gateways_attrs),
+				   &row, sizeof(row), &present);
+	if (ret == -ENOENT) {
+		fputs("Missing attributes from kernel\n", stderr);
+		exit(1);
+	} else if (ret < 0) {
 		fputs("Received invalid data from kernel.\n", stderr);
 		exit(1);
 	}
 
-	if (missing_mandatory_attrs(attrs, gateways_mandatory,
-				    ARRAY_SIZE(gateways_mandatory))) {
-		fputs("Missing attributes from kernel\n", stderr);
-		exit(1);
-	}
+	if (!filter_match(opts->filter, gateways_attrs,
+			  ARRAY_SIZE(gateways_attrs), &row, present))
+		return NL_OK;
 
-	if (attrs[BATADV_ATTR_FLAG_BEST])
+	if (row.best)
 		c = '*';
 
-	orig = nla_data(attrs[BATADV_ATTR_ORIG_ADDRESS]);
-	router = nla_data(attrs[BATADV_ATTR_ROUTER]);
-	primary_if = nla_get_string(attrs[BATADV_ATTR_HARD_IFNAME]);
-	bandwidth_down = nla_get_u32(attrs[BATADV_ATTR_BANDWIDTH_DOWN]);
-	bandwidth_up = nla_get_u32(attrs[BATADV_ATTR_BANDWIDTH_UP]);
-
-	printf("%c ", c);
-
-	bat_host = bat_hosts_find_by_mac((char *)orig);
-	if (!(opts->read_opt & USE_BAT_HOSTS) || !bat_host)
-		printf("%02x:%02x:%02x:%02x:%02x:%02x ",
-		       orig[0], orig[1], orig[2],
-		       orig[3], orig[4], orig[5]);
-	else
-		printf("%17s ", bat_host->name);
-
-	if (attrs[BATADV_ATTR_THROUGHPUT]) {
-		throughput = nla_get_u32(attrs[BATADV_ATTR_THROUGHPUT]);
-		printf("(%9u.%1u) ", throughput / 10, throughput % 10);
-	} else if (attrs[BATADV_ATTR_TQ]) {
-		tq = nla_get_u8(attrs[BATADV_ATTR_TQ]);
-		printf("(%3i) ", tq);
+	orig = row.orig;
+	router = row.router;
+	primary_if = row.primary_if;
+	bandwidth_down = row.bandwidth_down;
+	bandwidth_up = row.bandwidth_up;
+
+	if (group_add(opts->group, gateways_attrs,
+		      ARRAY_SIZE(gateways_attrs), &row, present))
+		return NL_OK;
+
+	if (sort_add(opts->sort, nlh, gateways_attrs,
+		     ARRAY_SIZE(gateways_attrs), &row, present))
+		return NL_OK;
+
+	if (opts->out.format != OUTPUT_FORMAT_TEXT) {
+		netlink_print_record(opts, gateways_attrs,
+				     ARRAY_SIZE(gateways_attrs), &row, present);
+		return NL_OK;
 	}
 
-	bat_host = bat_hosts_find_by_mac((char *)router);
-	if (!(opts->read_opt & USE_BAT_HOSTS) || !bat_host)
-		printf("%02x:%02x:%02x:%02x:%02x:%02x ",
-		       router[0], router[1], router[2],
-		       router[3], router[4], router[5]);
-	else
-		printf("%17s ", bat_host->name);
+	out = netlink_row_begin(opts);
+
+	output_char(out, c);
+	output_char(out, ' ');
+	output_host(out, orig, opts->read_opt);
+	output_char(out, ' ');
+
+	if (present & NETLINK_ATTR_BIT(BATADV_ATTR_THROUGHPUT)) {
+		output_char(out, '(');
+		output_uint(out, row.throughput / 10, 9);
+		output_char(out, '.');
+		output_uint(out, row.throughput % 10, 1);
+		output_str(out, ") ");
+	} else if (present & NETLINK_ATTR_BIT(BATADV_ATTR_TQ)) {
+		output_char(out, '(');
+		output_uint(out, row.tq, 3);
+		output_str(out, ") ");
+	}
 
-	printf("[%10s]: %u.%u/%u.%u MBit\n",
-	       primary_if, bandwidth_down / 10, bandwidth_down % 10,
-	       bandwidth_up / 10, bandwidth_up % 10);
+	output_host(out, router, opts->read_opt);
+	output_str(out, " [");
+	output_str_right(out, primary_if, 10);
+	output_str(out, "]: ");
+	output_uint(out, bandwidth_down / 10, 0);
+	output_char(out, '.');
+	output_uint(out, bandwidth_down % 10, 0);
+	output_char(out, '/');
+	output_uint(out, bandwidth_up / 10, 0);
+	output_char(out, '.');
+	output_uint(out, bandwidth_up % 10, 0);
+	output_str(out, " MBit\n");
+
+	memset(&key, 0, sizeof(key));
+	memcpy(key.orig, orig, ETH_ALEN);
+
+	memset(&value, 0, sizeof(value));
+	memcpy(value.router, router, ETH_ALEN);
+	value.best = row.best;
+	value.throughput = row.throughput;
+	value.tq = row.tq;
+	value.bandwidth_down = bandwidth_down;
+	value.bandwidth_up = bandwidth_up;
+
+	netlink_row_end(opts, &key, sizeof(key), &value, sizeof(value));
 
 	return NL_OK;
 }
@@ -132,7 +199,7 @@ static int netlink_print_gateways(struct state *state, char *orig_iface,
 				  float watch_interval)
 {
 	char *header = NULL;
-	char *info_header;
+	const struct netlink_mesh_info *info;
 	int ifindex;
 
 	ifindex = if_nametoindex(state->mesh_iface);
@@ -143,15 +210,13 @@ static int netlink_print_gateways(struct state *state, char *orig_iface,
 
 	/* only parse routing algorithm name */
 	last_err = -EINVAL;
-	info_header = netlink_get_info(ifindex, BATADV_CMD_GET_ORIGINATORS, NULL);
-	free(info_header);
-
-	if (strlen(algo_name_buf) == 0)
+	info = netlink_get_mesh_info(state, ifindex, false);
+	if (!info || strlen(info->algo_name) == 0)
 		return last_err;
 
-	if (!strcmp("BATMAN_IV", algo_name_buf))
+	if (!strcmp("BATMAN_IV", info->algo_name))
 		header = "  Router            ( TQ) Next Hop          [outgoingIf]  Bandwidth\n";
-	if (!strcmp("BATMAN_V", algo_name_buf))
+	if (!strcmp("BATMAN_V", info->algo_name))
 		header = "  Router            ( throughput) Next Hop          [outgoingIf]  Bandwidth\n";
 
 	if (!header)
@@ -168,6 +233,8 @@ static struct debug_table_data batctl_debug_table_gateways = {
 	.debugfs_name = "gateways",
 	.header_lines = 1,
 	.netlink_fn = netlink_print_gateways,
+	.nl_cmd = BATADV_CMD_GET_GATEWAYS,
+	.netlink_cb = gateways_callback,
 };
 
 COMMAND_NAMED(DEBUGTABLE, gateways, "gwl", handle_debug_table,
@@ -0,0 +1,560 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#include <errno.h>
+#include <net/if.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batman_adv.h"
+#include "filter.h"
+#include "functions.h"
+#include "group.h"
+#include "hash.h"
+#include "main.h"
+#include "output.h"
+
+#define GROUP_MAX_KEYS 4
+#define GROUP_MAX_SUMS 4
+#define GROUP_STR_LEN 32
+
+struct group_field {
+	const char *name;
+	netlink_attr_mask_t attrs;
+	char record_name[64];
+
+	/* entry in the descriptors of the table which is grouped */
+	size_t desc_idx;
+};
+
+struct group_key {
+	long long num;
+	char str[GROUP_STR_LEN];
+	bool present;
+};
+
+struct group_entry {
+	/* hash key - must stay the first member */
+	struct group_key keys[GROUP_MAX_KEYS];
+
+	unsigned long long count;
+	long long sums[GROUP_MAX_SUMS];
+};
+
+struct group {
+	char *expr;
+	size_t num_keys;
+	struct group_field keys[GROUP_MAX_KEYS];
+	size_t num_sums;
+	struct group_field sums[GROUP_MAX_SUMS];
+
+	/* descriptors the fields were resolved for */
+	const struct netlink_attr_desc *desc;
+
+	/* the fields don't fit the table of the last row */
+	int err;
+
+	/* maximum number of printed groups - 0 prints all */
+	size_t limit;
+
+	struct hashtable_t *hash;
+
+	/* groups of the last dump in print order */
+	struct group_entry **entries;
+	size_t entries_size;
+};
+
+static int compare_group_key(void *data1, void *data2)
+{
+	size_t len = sizeof(((struct group_entry *)0)->keys);
+
+	return (memcmp(data1, data2, len) == 0 ? 1 : 0);
+}
+
+static int choose_group_key(void *data, int32_t size)
+{
+	size_t len = sizeof(((struct group_entry *)0)->keys);
+
+	return (hash_bytes(data, len) % size);
+}
+
+/* comma separated list of key fields, fields with a leading '+' are summed */
+struct group *group_compile(const char *expr, size_t limit)
+{
+	struct group_field *field;
+	struct group *group;
+	char *saveptr;
+	bool sum;
+	char *str;
+
+	group = calloc(1, sizeof(*group));
+	if (!group)
+		return NULL;
+
+	group->limit = limit;
+
+	group->expr = strdup(expr);
+	if (!group->expr)
+		goto err;
+
+	group->hash = hash_new(128, compare_group_key, choose_group_key);
+	if (!group->hash)
+		goto err;
+
+	for (str = strtok_r(group->expr, ",", &saveptr); str;
+	     str = strtok_r(NULL, ",", &saveptr)) {
+		sum = *str == '+';
+		if (sum)
+			str++;
+
+		if (sum && group->num_sums == GROUP_MAX_SUMS) {
+			fprintf(stderr, "Error - at most %d summed fields are supported\n",
+				GROUP_MAX_SUMS);
+			goto err;
+		}
+
+		if (!sum && group->num_keys == GROUP_MAX_KEYS) {
+			fprintf(stderr, "Error - at most %d group fields are supported\n",
+				GROUP_MAX_KEYS);
+			goto err;
+		}
+
+		if (sum)
+			field = &group->sums[group->num_sums++];
+		else
+			field = &group->keys[group->num_keys++];
+
+		field->name = str;
+		field->attrs = filter_field_attrs(str);
+		if (!field->attrs) {
+			fprintf(stderr, "Error - unknown group field: %s\n", str);
+			goto err;
+		}
+	}
+
+	if (!group->num_keys) {
+		fprintf(stderr, "Error - no field to group by\n");
+		goto err;
+	}
+
+	return group;
+
+err:
+	group_free(group);
+	return NULL;
+}
+
+void group_free(struct group *group)
+{
+	if (!group)
+		return;
+
+	if (group->hash)
+		hash_delete(group->hash, free);
+
+	free(group->entries);
+	free(group->expr);
+	free(group);
+}
+
+static int group_resolve_field(struct group_field *field,
+			       const struct netlink_attr_desc *desc,
+			       size_t num, bool sum)
+{
+	size_t i;
+
+	for (i = 0; i < num; i++) {
+		if (field->attrs & NETLINK_ATTR_BIT(desc[i].type))
+			break;
+	}
+
+	if (i == num) {
+		fprintf(stderr, "Error - the table has no field '%s' to group by\n",
+			field->name);
+		return -EINVAL;
+	}
+
+	field->desc_idx = i;
+
+	if (!sum) {
+		snprintf(field->record_name, sizeof(field->record_name), "%s",
+			 field->name);
+		return 0;
+	}
+
+	if (desc[i].kind == NETLINK_ATTR_MAC ||
+	    desc[i].kind == NETLINK_ATTR_STRING) {
+		fprintf(stderr, "Error - '%s' is not a number and can't be summed\n",
+			field->name);
+		return -EINVAL;
+	}
+
+	snprintf(field->record_name, sizeof(field->record_name), "sum_%s",
+		 field->name);
+
+	return 0;
+}
+
+/* find the descriptor of each field once for the table */
+static int group_resolve(struct group *group,
+			 const struct netlink_attr_desc *desc, size_t num)
+{
+	size_t i;
+	int ret;
+
+	for (i = 0; i < group->num_keys; i++) {
+		ret = group_resolve_field(&group->keys[i], desc, num, false);
+		if (ret < 0)
+			return ret;
+	}
+
+	for (i = 0; i < group->num_sums; i++) {
+		ret = group_resolve_field(&group->sums[i], desc, num, true);
+		if (ret < 0)
+			return ret;
+	}
+
+	group->desc = desc;
+
+	return 0;
+}
+
+/**
+ * group_add() - account a row in its group instead of printing it
+ * @group: group state or NULL
+ * @desc: descriptors which were used to decode the row
+ * @num: number of entries in @desc
+ * @row: the decoded row
+ * @present: attributes found by netlink_decode_attrs()
+ *
+ * Return: true when the row must not be printed - also when the group
+ *  fields don't fit the table, see group_error()
+ */
+bool group_add(struct group *group, const struct netlink_attr_desc *desc,
+	       size_t num, const void *row, netlink_attr_mask_t present)
+{
+	const struct netlink_attr_desc *d;
+	struct hashtable_t *swaphash;
+	struct group_entry *entry;
+	struct group_entry lookup;
+	struct group_key *key;
+	const char *str;
+	long long val;
+	size_t i;
+
+	if (!group)
+		return false;
+
+	if (group->desc != desc) {
+		group->err = group_resolve(group, desc, num);
+		if (group->err < 0)
+			return true;
+	}
+
+	memset(&lookup, 0, sizeof(lookup));
+
+	for (i = 0; i < group->num_keys; i++) {
+		d = &desc[group->keys[i].desc_idx];
+		key = &lookup.keys[i];
+
+		if (d->kind == NETLINK_ATTR_STRING) {
+			if (!(present & NETLINK_ATTR_BIT(d->type)))
+				continue;
+
+			str = *(const char * const *)((const uint8_t *)row +
+						      d->offset);
+			snprintf(key->str, sizeof(key->str), "%s", str);
+			key->present = true;
+		} else {
+			key->present = netlink_attr_value(d, row, present,
+							  &key->num) == 0;
+		}
+	}
+
+	entry = hash_find(group->hash, &lookup);
+	if (!entry) {
+		entry = malloc(sizeof(*entry));
+		if (!entry)
+			return true;
+
+		memcpy(entry, &lookup, sizeof(*entry));
+
+		if (hash_add(group->hash, entry) < 0) {
+			free(entry);
+			return true;
+		}
+
+		if (group->hash->elements * 4 > group->hash->size) {
+			swaphash = hash_resize(group->hash,
+					       group->hash->size * 2);
+			if (swaphash)
+				group->hash = swaphash;
+		}
+	}
+
+	entry->count++;
+
+	for (i = 0; i < group->num_sums; i++) {
+		d = &desc[group->sums[i].desc_idx];
+
+		if (netlink_attr_value(d, row, present, &val) == 0)
+			entry->sums[i] += val;
+	}
+
+	return true;
+}
+
+/* largest groups first */
+static int group_entry_cmp(const void *a, const void *b)
+{
+	const struct group_entry *ea = *(const struct group_entry **)a;
+	const struct group_entry *eb = *(const struct group_entry **)b;
+
+	const struct group_key *ka;
+	const struct group_key *kb;
+	size_t i;
+	int ret;
+
+	if (ea->count != eb->count)
+		return ea->count < eb->count ? 1 : -1;
+
+	for (i = 0; i < GROUP_MAX_KEYS; i++) {
+		ka = &ea->keys[i];
+		kb = &eb->keys[i];
+
+		if (ka->present != kb->present)
+			return ka->present ? -1 : 1;
+
+		if (ka->num != kb->num)
+			return ka->num < kb->num ? -1 : 1;
+
+		ret = strcmp(ka->str, kb->str);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static void group_mac(const struct group_key *key, uint8_t *mac)
+{
+	unsigned long long val = key->num;
+	int i;
+
+	for (i = ETH_ALEN - 1; i >= 0; i--) {
+		mac[i] = val & 0xff;
+		val >>= 8;
+	}
+}
+
+static int group_width(const struct group_field *field, int width)
+{
+	int len = strlen(field->record_name);
+
+	return len > width ? len : width;
+}
+
+static void group_print_header(struct group *group, struct output *out)
+{
+	const struct netlink_attr_desc *d;
+	size_t i;
+
+	for (i = 0; i < group->num_keys; i++) {
+		d = &group->desc[group->keys[i].desc_idx];
+
+		if (d->kind == NETLINK_ATTR_MAC)
+			output_str_right(out, group->keys[i].name, 17);
+		else
+			output_str_right(out, group->keys[i].name,
+					 group_width(&group->keys[i], 10));
+
+		output_char(out, ' ');
+	}
+
+	output_str_right(out, "count", 10);
+
+	for (i = 0; i < group->num_sums; i++) {
+		output_char(out, ' ');
+		output_str_right(out, group->sums[i].record_name,
+				 group_width(&group->sums[i], 14));
+	}
+
+	output_char(out, '\n');
+}
+
+static void group_print_text(struct group *group, struct output *out,
+			     const struct group_entry *entry, int read_opt)
+{
+	const struct netlink_attr_desc *d;
+	const struct group_key *key;
+	char ifname[IF_NAMESIZE];
+	uint8_t mac[ETH_ALEN];
+	int width;
+	size_t i;
+
+	for (i = 0; i < group->num_keys; i++) {
+		d = &group->desc[group->keys[i].desc_idx];
+		key = &entry->keys[i];
+		width = group_width(&group->keys[i], 10);
+
+		if (!key->present) {
+			output_str_right(out, "-",
+					 d->kind == NETLINK_ATTR_MAC ? 17 : width);
+		} else if (d->kind == NETLINK_ATTR_MAC) {
+			group_mac(key, mac);
+			output_host(out, mac, read_opt);
+		} else if (d->kind == NETLINK_ATTR_STRING) {
+			output_str_right(out, key->str, width);
+		} else if (d->type == BATADV_ATTR_HARD_IFINDEX &&
+			   if_indextoname(key->num, ifname)) {
+			output_str_right(out, ifname, width);
+		} else {
+			output_int(out, key->num, width);
+		}
+
+		output_char(out, ' ');
+	}
+
+	output_uint(out, entry->count, 10);
+
+	for (i = 0; i < group->num_sums; i++) {
+		output_char(out, ' ');
+		output_int(out, entry->sums[i],
+			   group_width(&group->sums[i], 14));
+	}
+
+	output_char(out, '\n');
+}
+
+static void group_print_record(struct group *group, struct output *out,
+			       const struct group_entry *entry)
+{
+	const struct netlink_attr_desc *d;
+	const struct group_key *key;
+	uint8_t mac[ETH_ALEN];
+	const char *name;
+	size_t i;
+
+	output_record_begin(out);
+
+	for (i = 0; i < group->num_keys; i++) {
+		d = &group->desc[group->keys[i].desc_idx];
+		key = &entry->keys[i];
+		name = group->keys[i].record_name;
+
+		if (!key->present) {
+			output_field_none(out, name);
+		} else if (d->kind == NETLINK_ATTR_MAC) {
+			group_mac(key, mac);
+			output_field_mac(out, name, mac);
+		} else if (d->kind == NETLINK_ATTR_STRING) {
+			output_field_str(out, name, key->str);
+		} else {
+			output_field_int(out, name, key->num);
+		}
+	}
+
+	output_field_uint(out, "count", entry->count);
+
+	for (i = 0; i < group->num_sums; i++)
+		output_field_int(out, group->sums[i].record_name,
+				 entry->sums[i]);
+
+	output_record_end(out);
+}
+
+/* error of the last group_add() - the table can't be grouped */
+int group_error(const struct group *group)
+{
+	if (!group)
+		return 0;
+
+	return group->err;
+}
+
+/* print the aggregates of the last dump and start over
+ *
+ * The groups stay in the table with a zero count. Only groups which didn't
+ * get a row during the whole dump are removed - a stable mesh is grouped
+ * without allocations in watch mode
+ */
+void group_flush(struct group *group, struct output *out, int read_opt)
+{
+	struct group_entry **entries;
+	struct group_entry *entry;
+	struct element_t *bucket;
+	size_t num = 0;
+	size_t size;
+	size_t i;
+
+	if (!group)
+		return;
+
+	if (group->entries_size < (size_t)group->hash->elements) {
+		size = group->hash->elements * 2;
+		entries = realloc(group->entries, size * sizeof(*entries));
+		if (!entries)
+			return;
+
+		group->entries = entries;
+		group->entries_size = size;
+	}
+
+	/* walk the buckets directly - hash_iterate() allocates an iterator */
+	for (i = 0; i < (size_t)group->hash->size; i++) {
+		bucket = group->hash->table[i];
+
+		while (bucket) {
+			entry = bucket->data;
+			bucket = bucket->next;
+
+			if (!entry->count) {
+				hash_remove(group->hash, entry);
+				free(entry);
+				continue;
+			}
+
+			group->entries[num++] = entry;
+		}
+	}
+
+	qsort(group->entries, num, sizeof(*group->entries),
+	      group_entry_cmp);
+
+	/* the fields were never resolved when the table was empty */
+	if (out->format == OUTPUT_FORMAT_TEXT && group->desc &&
+	    !(read_opt & SKIP_HEADER))
+		group_print_header(group, out);
+
+	for (i = 0; i < num; i++) {
+		entry = group->entries[i];
+
+		if (!group->limit || i < group->limit) {
+			if (out->format == OUTPUT_FORMAT_TEXT)
+				group_print_text(group, out, entry, read_opt);
+			else
+				group_print_record(group, out, entry);
+		}
+
+		entry->count = 0;
+		memset(entry->sums, 0, sizeof(entry->sums));
+	}
+}
@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#ifndef _BATCTL_GROUP_H
+#define _BATCTL_GROUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "netlink.h"
+
+struct group;
+struct output;
+
+struct group *group_compile(const char *expr, size_t limit);
+void group_free(struct group *group);
+bool group_add(struct group *group, const struct netlink_attr_desc *desc,
+	       size_t num, const void *row, netlink_attr_mask_t present);
+int group_error(const struct group *group);
+void group_flush(struct group *group, struct output *out, int read_opt);
+
+#endif
@@ -24,8 +24,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "functions.h"
+#include "main.h"
+#include "output.h"
 #include "sys.h"
 
 #define SYS_GW_MODE		"gw_mode"
@@ -45,6 +48,58 @@ static void gw_mode_usage(void)
 	fprintf(stderr, " \t -h print this help\n");
 }
 
+/* value: gw_sel_class (client) or gw_bandwidth (server) from sysfs */
+static void gw_mode_print_record(enum output_format format, char gw_mode,
+				 const char *value)
+{
+	unsigned int down, down_frac, up, up_frac;
+	struct output out;
+	int n;
+
+	if (output_init(&out, STDOUT_FILENO, 256) < 0)
+		return;
+
+	output_set_format(&out, format, true);
+	output_record_begin(&out);
+
+	switch (gw_mode) {
+	case GW_MODE_CLIENT:
+		output_field_str(&out, "mode", "client");
+		output_field_uint(&out, "sel_class", strtoul(value, NULL, 10));
+		output_field_none(&out, "bandwidth_down");
+		output_field_none(&out, "bandwidth_up");
+		break;
+	case GW_MODE_SERVER:
+		output_field_str(&out, "mode", "server");
+		output_field_none(&out, "sel_class");
+
+		/* "%u.%u/%u.%u MBit" - printed in 100 kbit/s like the
+		 * bandwidth in the gateways table
+		 */
+		n = sscanf(value, "%u.%u/%u.%u", &down, &down_frac, &up,
+			   &up_frac);
+		if (n == 4) {
+			output_field_uint(&out, "bandwidth_down",
+					  down * 10 + down_frac);
+			output_field_uint(&out, "bandwidth_up",
+					  up * 10 + up_frac);
+		} else {
+			output_field_none(&out, "bandwidth_down");
+			output_field_none(&out, "bandwidth_up");
+		}
+		break;
+	default:
+		output_field_str(&out, "mode", "off");
+		output_field_none(&out, "sel_class");
+		output_field_none(&out, "bandwidth_down");
+		output_field_none(&out, "bandwidth_up");
+		break;
+	}
+
+	output_record_end(&out);
+	output_free(&out);
+}
+
 static int gw_mode(struct state *state, int argc, char **argv)
 {
 	int optchar, res = EXIT_FAILURE;
@@ -97,7 +152,11 @@ static int gw_mode(struct state *state, int argc, char **argv)
 			res = read_file(path_buff, SYS_GW_BW, USE_READ_BUFF, 0, 0, 0);
 			break;
 		default:
-			printf("off\n");
+			if (state->output_format != OUTPUT_FORMAT_TEXT)
+				gw_mode_print_record(state->output_format,
+						     gw_mode, NULL);
+			else
+				printf("off\n");
 			goto out;
 		}
 
@@ -107,6 +166,14 @@ static int gw_mode(struct state *state, int argc, char **argv)
 		if (line_ptr[strlen(line_ptr) - 1] == '\n')
 			line_ptr[strlen(line_ptr) - 1] = '\0';
 
+		if (state->output_format != OUTPUT_FORMAT_TEXT) {
+			gw_mode_print_record(state->output_format, gw_mode,
+					     line_ptr);
+			free(line_ptr);
+			line_ptr = NULL;
+			goto out;
+		}
+
 		switch (gw_mode) {
 		case GW_MODE_CLIENT:
 			printf("client (selection class: %s)\n", line_ptr);
@@ -167,5 +234,6 @@ static int gw_mode(struct state *state, int argc, char **argv)
 	return res;
 }
 
-COMMAND(SUBCOMMAND, gw_mode, "gw", COMMAND_FLAG_MESH_IFACE, NULL,
+COMMAND(SUBCOMMAND, gw_mode, "gw",
+	COMMAND_FLAG_MESH_IFACE | COMMAND_FLAG_OUTPUT_FORMAT, NULL,
 	"[mode]            \tdisplay or modify the gateway mode");
@@ -26,6 +26,25 @@
 #include <stdio.h>
 #include "allocate.h"
 
+uint32_t hash_bytes(const void *data, size_t len)
+{
+	const unsigned char *key = data;
+	uint32_t hash = 0;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hash += key[i];
+		hash += (hash << 10);
+		hash ^= (hash >> 6);
+	}
+
+	hash += (hash << 3);
+	hash ^= (hash >> 11);
+	hash += (hash << 15);
+
+	return hash;
+}
+
 /* clears the hash */
 void hash_init(struct hashtable_t *hash)
 {
@@ -22,7 +22,8 @@
 #ifndef _BATMAN_HASH_H
 #define _BATMAN_HASH_H
 
-
+#include <stddef.h>
+#include <stdint.h>
 
 typedef int (*hashdata_compare_cb)(void *, void *);
 typedef int (*hashdata_choose_cb)(void *, int);
@@ -55,6 +56,9 @@ struct hashtable_t {
 					 * the second */
 };
 
+/* Jenkins one-at-a-time hash of a buffer - for the choose callbacks */
+uint32_t hash_bytes(const void *data, size_t len);
+
 /* clears the hash */
 void hash_init(struct hashtable_t *hash);
 
@@ -54,6 +54,7 @@ static void print_usage(void)
 	fprintf(stderr, "options:\n");
 	fprintf(stderr, " \t-m mesh interface or VLAN created on top of a mesh interface (default 'bat0')\n");
 	fprintf(stderr, " \t-h print this help (or 'batctl <command|debug table> -h' for the parameter help)\n");
+	fprintf(stderr, " \t-o output format: text (default), json or csv\n");
 	fprintf(stderr, " \t-v print version\n");
 
 	for (i = 0; i < sizeof(type) / sizeof(*type); i++) {
@@ -127,11 +128,13 @@ int main(int argc, char **argv)
 	struct state state = {
 		.mesh_iface = mesh_dfl_iface,
 		.cmd = NULL,
+		.output_format = OUTPUT_FORMAT_TEXT,
+		.snapshot_max_age = NETLINK_SNAPSHOT_MAX_AGE,
 	};
 	int opt;
 	int ret;
 
-	while ((opt = getopt(argc, argv, "+hm:v")) != -1) {
+	while ((opt = getopt(argc, argv, "+hm:o:v")) != -1) {
 		switch (opt) {
 		case 'h':
 			print_usage();
@@ -144,7 +147,15 @@ int main(int argc, char **argv)
 				goto err;
 			}
 
-			state.mesh_iface = argv[2];
+			state.mesh_iface = optarg;
+			break;
+		case 'o':
+			if (output_parse_format(optarg, &state.output_format) < 0) {
+				fprintf(stderr,
+					"Error - unknown output format: %s\n",
+					optarg);
+				goto err;
+			}
 			break;
 		case 'v':
 			version();
@@ -173,6 +184,15 @@ int main(int argc, char **argv)
 
 	state.cmd = cmd;
 
+	if (state.output_format != OUTPUT_FORMAT_TEXT &&
+	    cmd->type != DEBUGTABLE &&
+	    !(cmd->flags & COMMAND_FLAG_OUTPUT_FORMAT)) {
+		fprintf(stderr,
+			"Error - command %s only supports the text output format\n",
+			cmd->name);
+		exit(EXIT_FAILURE);
+	}
+
 	if (cmd->flags & COMMAND_FLAG_MESH_IFACE &&
 	    check_mesh_iface(state.mesh_iface) < 0) {
 		fprintf(stderr,
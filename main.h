@@ -29,6 +29,8 @@
 #include <netlink/genl/genl.h>
 #include <netlink/netlink.h>
 
+#include "output.h"
+
 #ifndef SOURCE_VERSION
 #define SOURCE_VERSION "2019.1"
 #endif
@@ -66,6 +68,7 @@ extern char module_ver_path[];
 enum command_flags {
 	COMMAND_FLAG_MESH_IFACE = BIT(0),
 	COMMAND_FLAG_NETLINK = BIT(1),
+	COMMAND_FLAG_OUTPUT_FORMAT = BIT(2),
 };
 
 enum command_type {
@@ -73,13 +76,34 @@ enum command_type {
 	DEBUGTABLE,
 };
 
+struct filter;
+struct group;
+struct netlink_dump_buf;
+struct netlink_mesh_info;
+struct netlink_snapshot;
+struct netlink_table_probe;
+struct sort;
+
 struct state {
 	char *mesh_iface;
 	const struct command *cmd;
+	enum output_format output_format;
+	struct filter *filter;
+	struct group *group;
+	struct sort *sort;
 
 	struct nl_sock *sock;
 	struct nl_cb *cb;
 	int batadv_family;
+	int tpmeter_mcid;
+	struct netlink_mesh_info *mesh_info;
+	struct nl_msg *mesh_info_msg;
+	int mesh_info_msg_ifindex;
+	struct netlink_dump_buf *dump_buf;
+	struct netlink_snapshot *tt_snapshot;
+	struct netlink_snapshot *orig_snapshot;
+	float snapshot_max_age;
+	struct netlink_table_probe *table_probe;
 };
 
 struct command {
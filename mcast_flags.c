@@ -35,23 +35,42 @@
 #include "batman_adv.h"
 #include "bat-hosts.h"
 #include "debug.h"
+#include "filter.h"
 #include "functions.h"
+#include "group.h"
 #include "main.h"
 #include "netlink.h"
+#include "sort.h"
 
-static const int mcast_flags_mandatory[] = {
-	BATADV_ATTR_ORIG_ADDRESS,
+struct mcast_flags_row {
+	const uint8_t *addr;
+	uint32_t flags;
+};
+
+static const struct netlink_attr_desc mcast_flags_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_ORIG_ADDRESS, MAC,
+			 struct mcast_flags_row, addr),
+	NETLINK_ATTR_OPT(BATADV_ATTR_MCAST_FLAGS, U32,
+			 struct mcast_flags_row, flags),
 };
 
-static int mcast_flags_callback(struct nl_msg *msg, void *arg)
+static int mcast_flags_callback(struct nlmsghdr *nlh, void *arg)
 {
-	struct nlattr *attrs[BATADV_ATTR_MAX+1];
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct mcast_flags_row row;
+	netlink_attr_mask_t present;
 	struct print_opts *opts = arg;
-	struct bat_host *bat_host;
 	struct genlmsghdr *ghdr;
+	const uint8_t *addr;
 	uint32_t flags;
-	uint8_t *addr;
+	int ret;
+	struct {
+		uint8_t orig[ETH_ALEN];
+	} key;
+	struct {
+		uint32_t flags;
+		uint8_t valid;
+	} value;
+	struct output *out;
 
 	if (!genlmsg_valid_hdr(nlh, 0)) {
 		fputs("Received invalid data from kernel.\n", stderr);
@@ -63,19 +82,22 @@ static int mcast_flags_callback(struct nl_msg *msg, void *arg)
 	if (ghdr->cmd != BATADV_CMD_GET_MCAST_FLAGS)
 		return NL_OK;
 
-	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
-		      genlmsg_len(ghdr), batadv_netlink_policy)) {
+	ret = netlink_decode_attrs(ghdr, mcast_flags_attrs,
+				   ARRAY_SIZE(mcast_flags_attrs),
+				   &row, sizeof(row), &present);
+	if (ret == -ENOENT) {
+		fputs("Missing attributes from kernel\n", stderr);
+		exit(1);
+	} else if (ret < 0) {
 		fputs("Received invalid data from kernel.\n", stderr);
 		exit(1);
 	}
 
-	if (missing_mandatory_attrs(attrs, mcast_flags_mandatory,
-				    ARRAY_SIZE(mcast_flags_mandatory))) {
-		fputs("Missing attributes from kernel\n", stderr);
-		exit(1);
-	}
+	if (!filter_match(opts->filter, mcast_flags_attrs,
+			  ARRAY_SIZE(mcast_flags_attrs), &row, present))
+		return NL_OK;
 
-	addr = nla_data(attrs[BATADV_ATTR_ORIG_ADDRESS]);
+	addr = row.addr;
 
 	if (opts->read_opt & MULTICAST_ONLY && !(addr[0] & 0x01))
 		return NL_OK;
@@ -83,25 +105,48 @@ static int mcast_flags_callback(struct nl_msg *msg, void *arg)
 	if (opts->read_opt & UNICAST_ONLY && (addr[0] & 0x01))
 		return NL_OK;
 
-	bat_host = bat_hosts_find_by_mac((char *)addr);
-	if (!(opts->read_opt & USE_BAT_HOSTS) || !bat_host)
-		printf("%02x:%02x:%02x:%02x:%02x:%02x ",
-		       addr[0], addr[1], addr[2],
-		       addr[3], addr[4], addr[5]);
-	else
-		printf("%17s ", bat_host->name);
-
-	if (attrs[BATADV_ATTR_MCAST_FLAGS]) {
-		flags = nla_get_u32(attrs[BATADV_ATTR_MCAST_FLAGS]);
-
-		printf("[%c%c%c]\n",
-		       flags & BATADV_MCAST_WANT_ALL_UNSNOOPABLES ? 'U' : '.',
-		       flags & BATADV_MCAST_WANT_ALL_IPV4 ? '4' : '.',
-		       flags & BATADV_MCAST_WANT_ALL_IPV6 ? '6' : '.');
+	if (group_add(opts->group, mcast_flags_attrs,
+		      ARRAY_SIZE(mcast_flags_attrs), &row, present))
+		return NL_OK;
+
+	if (sort_add(opts->sort, nlh, mcast_flags_attrs,
+		     ARRAY_SIZE(mcast_flags_attrs), &row, present))
+		return NL_OK;
+
+	if (opts->out.format != OUTPUT_FORMAT_TEXT) {
+		netlink_print_record(opts, mcast_flags_attrs,
+				     ARRAY_SIZE(mcast_flags_attrs), &row, present);
+		return NL_OK;
+	}
+
+	out = netlink_row_begin(opts);
+
+	output_host(out, addr, opts->read_opt);
+	output_char(out, ' ');
+
+	if (present & NETLINK_ATTR_BIT(BATADV_ATTR_MCAST_FLAGS)) {
+		flags = row.flags;
+
+		output_char(out, '[');
+		output_char(out, flags & BATADV_MCAST_WANT_ALL_UNSNOOPABLES ? 'U' : '.');
+		output_char(out, flags & BATADV_MCAST_WANT_ALL_IPV4 ? '4' : '.');
+		output_char(out, flags & BATADV_MCAST_WANT_ALL_IPV6 ? '6' : '.');
+		output_str(out, "]\n");
 	} else {
-		printf("-\n");
+		output_str(out, "-\n");
 	}
 
+	memset(&key, 0, sizeof(key));
+	memcpy(key.orig, addr, ETH_ALEN);
+
+	memset(&value, 0, sizeof(value));
+	if (present & NETLINK_ATTR_BIT(BATADV_ATTR_MCAST_FLAGS)) {
+		value.flags = row.flags;
+		value.valid = 1;
+	}
+
+	netlink_row_end(opts, &key, sizeof(key), &value, sizeof(value));
+
 	return NL_OK;
 }
 
@@ -110,7 +155,9 @@ static int netlink_print_mcast_flags(struct state *state, char *orig_iface,
 				     float watch_interval)
 {
 	char querier4, querier6, shadowing4, shadowing6;
-	char *info_header;
+	const struct netlink_mesh_info *info;
+	int64_t mcast_flags_priv;
+	int64_t mcast_flags;
 	char *header;
 	bool bridged;
 	int ifindex;
@@ -123,8 +170,12 @@ static int netlink_print_mcast_flags(struct state *state, char *orig_iface,
 	}
 
 	/* only parse own multicast flags */
-	info_header = netlink_get_info(ifindex, BATADV_CMD_GET_MCAST_FLAGS, NULL);
-	free(info_header);
+	info = netlink_get_mesh_info(state, ifindex, true);
+	if (!info)
+		return -EOPNOTSUPP;
+
+	mcast_flags = info->mcast_flags;
+	mcast_flags_priv = info->mcast_flags_priv;
 
 	if (mcast_flags == -EOPNOTSUPP || mcast_flags_priv == -EOPNOTSUPP)
 		return -EOPNOTSUPP;
@@ -173,6 +224,8 @@ static struct debug_table_data batctl_debug_table_mcast_flags = {
 	.debugfs_name = DEBUG_MCAST_FLAGS,
 	.header_lines = 6,
 	.netlink_fn = netlink_print_mcast_flags,
+	.nl_cmd = BATADV_CMD_GET_MCAST_FLAGS,
+	.netlink_cb = mcast_flags_callback,
 };
 
 COMMAND_NAMED(DEBUGTABLE, mcast_flags, "mf", handle_debug_table,
@@ -20,6 +20,7 @@
  * License-Filename: LICENSES/preferred/GPL-2.0
  */
 
+#include <errno.h>
 #include <net/if.h>
 #include <netinet/if_ether.h>
 #include <netlink/netlink.h>
@@ -33,27 +34,49 @@
 #include "batman_adv.h"
 #include "bat-hosts.h"
 #include "debug.h"
+#include "filter.h"
 #include "functions.h"
+#include "group.h"
 #include "main.h"
 #include "netlink.h"
+#include "sort.h"
 
-static const int neighbors_mandatory[] = {
-	BATADV_ATTR_NEIGH_ADDRESS,
-	BATADV_ATTR_HARD_IFINDEX,
-	BATADV_ATTR_LAST_SEEN_MSECS,
+struct neighbors_row {
+	const uint8_t *neigh;
+	uint32_t hard_ifindex;
+	uint32_t last_seen_msecs;
+	uint32_t throughput;
 };
 
-static int neighbors_callback(struct nl_msg *msg, void *arg)
+static const struct netlink_attr_desc neighbors_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_NEIGH_ADDRESS, MAC,
+			 struct neighbors_row, neigh),
+	NETLINK_ATTR_REQ(BATADV_ATTR_HARD_IFINDEX, U32,
+			 struct neighbors_row, hard_ifindex),
+	NETLINK_ATTR_REQ(BATADV_ATTR_LAST_SEEN_MSECS, U32,
+			 struct neighbors_row, last_seen_msecs),
+	NETLINK_ATTR_OPT(BATADV_ATTR_THROUGHPUT, U32,
+			 struct neighbors_row, throughput),
+};
+
+static int neighbors_callback(struct nlmsghdr *nlh, void *arg)
 {
 	unsigned throughput_mbits, throughput_kbits;
-	struct nlattr *attrs[BATADV_ATTR_MAX+1];
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
-	int last_seen_msecs, last_seen_secs;
+	struct neighbors_row row;
+	netlink_attr_mask_t present;
 	struct print_opts *opts = arg;
-	struct bat_host *bat_host;
 	char ifname[IF_NAMESIZE];
 	struct genlmsghdr *ghdr;
-	uint8_t *neigh;
+	const uint8_t *neigh;
+	int ret;
+	struct {
+		uint8_t neigh[ETH_ALEN];
+		uint32_t hard_ifindex;
+	} key;
+	struct {
+		uint32_t throughput;
+	} value;
+	struct output *out;
 
 	if (!genlmsg_valid_hdr(nlh, 0)) {
 		fputs("Received invalid data from kernel.\n", stderr);
@@ -65,57 +88,75 @@ static int neighbors_callback(struct nl_msg *msg, void *arg)
 	if (ghdr->cmd != BATADV_CMD_GET_NEIGHBORS)
 		return NL_OK;
 
-	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
-		      genlmsg_len(ghdr), batadv_netlink_policy)) {
+	ret = netlink_decode_attrs(ghdr, neighbors_attrs,
+				   ARRAY_SIZE(neighbors_attrs),
+				   &row, sizeof(row), &present);
+	if (ret == -ENOENT) {
+		fputs("Missing attributes from kernel\n", stderr);
+		exit(1);
+	} else if (ret < 0) {
 		fputs("Received invalid data from kernel.\n", stderr);
 		exit(1);
 	}
 
-	if (missing_mandatory_attrs(attrs, neighbors_mandatory,
-				    ARRAY_SIZE(neighbors_mandatory))) {
-		fputs("Missing attributes from kernel\n", stderr);
-		exit(1);
-	}
+	if (!filter_match(opts->filter, neighbors_attrs,
+			  ARRAY_SIZE(neighbors_attrs), &row, present))
+		return NL_OK;
 
-	neigh = nla_data(attrs[BATADV_ATTR_NEIGH_ADDRESS]);
-	bat_host = bat_hosts_find_by_mac((char *)neigh);
+	neigh = row.neigh;
 
-	if (!if_indextoname(nla_get_u32(attrs[BATADV_ATTR_HARD_IFINDEX]),
-			    ifname))
+	if (!if_indextoname(row.hard_ifindex, ifname))
 		ifname[0] = '\0';
 
-	last_seen_msecs = nla_get_u32(attrs[BATADV_ATTR_LAST_SEEN_MSECS]);
-	last_seen_secs = last_seen_msecs / 1000;
-	last_seen_msecs = last_seen_msecs % 1000;
+	if (group_add(opts->group, neighbors_attrs,
+		      ARRAY_SIZE(neighbors_attrs), &row, present))
+		return NL_OK;
+
+	if (sort_add(opts->sort, nlh, neighbors_attrs,
+		     ARRAY_SIZE(neighbors_attrs), &row, present))
+		return NL_OK;
+
+	if (opts->out.format != OUTPUT_FORMAT_TEXT) {
+		netlink_print_record(opts, neighbors_attrs,
+				     ARRAY_SIZE(neighbors_attrs), &row, present);
+		return NL_OK;
+	}
 
-	if (attrs[BATADV_ATTR_THROUGHPUT]) {
-		throughput_kbits = nla_get_u32(attrs[BATADV_ATTR_THROUGHPUT]);
+	out = netlink_row_begin(opts);
+
+	if (present & NETLINK_ATTR_BIT(BATADV_ATTR_THROUGHPUT)) {
+		throughput_kbits = row.throughput;
 		throughput_mbits = throughput_kbits / 1000;
 		throughput_kbits = throughput_kbits % 1000;
 
-		if (!(opts->read_opt & USE_BAT_HOSTS) || !bat_host)
-			printf("%02x:%02x:%02x:%02x:%02x:%02x ",
-			       neigh[0], neigh[1], neigh[2],
-			       neigh[3], neigh[4], neigh[5]);
-		else
-			printf("%17s ", bat_host->name);
-
-		printf("%4i.%03is (%9u.%1u) [%10s]\n",
-		       last_seen_secs, last_seen_msecs,
-		       throughput_mbits, throughput_kbits / 100,
-		       ifname);
+		output_host(out, neigh, opts->read_opt);
+		output_char(out, ' ');
+		output_seconds(out, row.last_seen_msecs, 4);
+		output_str(out, "s (");
+		output_uint(out, throughput_mbits, 9);
+		output_char(out, '.');
+		output_uint(out, throughput_kbits / 100, 1);
+		output_str(out, ") [");
+		output_str_right(out, ifname, 10);
+		output_str(out, "]\n");
 	} else {
-		printf("   %10s	  ", ifname);
+		output_str(out, "   ");
+		output_str_right(out, ifname, 10);
+		output_str(out, "\t  ");
+		output_host(out, neigh, opts->read_opt);
+		output_char(out, ' ');
+		output_seconds(out, row.last_seen_msecs, 4);
+		output_str(out, "s\n");
+	}
 
-		if (!(opts->read_opt & USE_BAT_HOSTS) || !bat_host)
-			printf("%02x:%02x:%02x:%02x:%02x:%02x ",
-			       neigh[0], neigh[1], neigh[2],
-			       neigh[3], neigh[4], neigh[5]);
-		else
-			printf("%17s ", bat_host->name);
+	memset(&key, 0, sizeof(key));
+	memcpy(key.neigh, neigh, ETH_ALEN);
+	key.hard_ifindex = row.hard_ifindex;
 
-		printf("%4i.%03is\n", last_seen_secs, last_seen_msecs);
-	}
+	memset(&value, 0, sizeof(value));
+	value.throughput = row.throughput;
+
+	netlink_row_end(opts, &key, sizeof(key), &value, sizeof(value));
 
 	return NL_OK;
 }
@@ -135,6 +176,8 @@ static struct debug_table_data batctl_debug_table_neighbors = {
 	.debugfs_name = "neighbors",
 	.header_lines = 2,
 	.netlink_fn = netlink_print_neighbors,
+	.nl_cmd = BATADV_CMD_GET_NEIGHBORS,
+	.netlink_cb = neighbors_callback,
 };
 
 COMMAND_NAMED(DEBUGTABLE, neighbors, "n", handle_debug_table,
@@ -22,12 +22,15 @@
 
 #include "netlink.h"
 #include "main.h"
+#include "output.h"
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
 #include <net/ethernet.h>
 #include <net/if.h>
 #include <netlink/netlink.h>
@@ -40,8 +43,13 @@
 #include "batadv_packet.h"
 #include "batman_adv.h"
 #include "netlink.h"
+#include "filter.h"
 #include "functions.h"
+#include "genl.h"
+#include "group.h"
+#include "hash.h"
 #include "main.h"
+#include "sort.h"
 
 struct nlquery_opts {
 	int err;
@@ -116,6 +124,11 @@ int netlink_create(struct state *state)
 	state->sock = NULL;
 	state->cb = NULL;
 	state->batadv_family = 0;
+	state->tpmeter_mcid = -ENOENT;
+	state->mesh_info = NULL;
+	state->tt_snapshot = NULL;
+	state->orig_snapshot = NULL;
+	state->dump_buf = NULL;
 
 	state->sock = nl_socket_alloc();
 	if (!state->sock)
@@ -131,16 +144,42 @@ int netlink_create(struct state *state)
 		goto err_free_sock;
 	}
 
+	/* resolving the multicast groups depends on acks - so it has to be
+	 * done before auto acks are disabled
+	 */
+	state->tpmeter_mcid = nl_get_multicast_id(state->sock, BATADV_NL_NAME,
+						  BATADV_NL_MCAST_GROUP_TPMETER);
+
+	/* the socket is shared by all requests of this process. Every request
+	 * is either answered or rejected with an error message. An additional
+	 * ack would only stay in the receive queue and confuse the next
+	 * request
+	 */
+	nl_socket_disable_auto_ack(state->sock);
+
+	netlink_dump_sock_setup(state->sock);
+
+	state->dump_buf = netlink_dump_buf_alloc();
+	if (!state->dump_buf) {
+		ret = -ENOMEM;
+		goto err_free_family;
+	}
+
 	state->cb = nl_cb_alloc(NL_CB_DEFAULT);
 	if (!state->cb) {
 		ret = -ENOMEM;
-		goto err_free_family;
+		goto err_free_buf;
 	}
 
 	return 0;
 
+err_free_buf:
+	netlink_dump_buf_free(state->dump_buf);
+	state->dump_buf = NULL;
+
 err_free_family:
 	state->batadv_family = 0;
+	state->tpmeter_mcid = -ENOENT;
 
 err_free_sock:
 	nl_socket_free(state->sock);
@@ -151,6 +190,19 @@ int netlink_create(struct state *state)
 
 void netlink_destroy(struct state *state)
 {
+	netlink_snapshots_free(state);
+
+	free(state->mesh_info);
+	state->mesh_info = NULL;
+
+	netlink_dump_buf_free(state->dump_buf);
+	state->dump_buf = NULL;
+
+	if (state->mesh_info_msg) {
+		nlmsg_free(state->mesh_info_msg);
+		state->mesh_info_msg = NULL;
+	}
+
 	if (state->cb) {
 		nl_cb_put(state->cb);
 		state->cb = NULL;
@@ -163,9 +215,6 @@ void netlink_destroy(struct state *state)
 }
 
 int last_err;
-char algo_name_buf[256] = "";
-int64_t mcast_flags = -EOPNOTSUPP;
-int64_t mcast_flags_priv = -EOPNOTSUPP;
 
 int missing_mandatory_attrs(struct nlattr *attrs[], const int mandatory[],
 			    int num)
@@ -179,6 +228,341 @@ int missing_mandatory_attrs(struct nlattr *attrs[], const int mandatory[],
 	return 0;
 }
 
+_Static_assert(NUM_BATADV_ATTR <= sizeof(netlink_attr_mask_t) * 8,
+	       "netlink_attr_mask_t cannot hold all batman-adv attributes");
+
+/**
+ * netlink_decode_attrs - extract the wanted attributes of a batman-adv message
+ * @ghdr: generic netlink header of the message
+ * @desc: attributes to extract and their location in @row
+ * @num: number of entries in @desc
+ * @row: destination structure described by @desc
+ * @row_len: size of @row
+ * @present: optional return of the attributes found in the message
+ *
+ * The attribute stream is walked once and only the attributes listed in @desc
+ * are validated and stored. @row is cleared first, so missing optional
+ * attributes read as 0, false or NULL. MAC and string attributes point into
+ * the message and are only valid as long as the message itself.
+ *
+ * Return: 0 on success, -EINVAL on malformed attributes or -ENOENT when a
+ *  mandatory attribute is missing
+ */
+int netlink_decode_attrs(struct genlmsghdr *ghdr,
+			 const struct netlink_attr_desc *desc, size_t num,
+			 void *row, size_t row_len,
+			 netlink_attr_mask_t *present)
+{
+	const struct netlink_attr_desc *d;
+	netlink_attr_mask_t found = 0;
+	struct nlattr *nla;
+	size_t next = 0;
+	uint16_t type;
+	uint8_t *dst;
+	char *data;
+	size_t i;
+	int len;
+	int rem;
+
+	memset(row, 0, row_len);
+
+	nla = genlmsg_attrdata(ghdr, 0);
+	rem = genlmsg_len(ghdr);
+
+	while (rem >= NLA_HDRLEN) {
+		if (nla->nla_len < NLA_HDRLEN || nla->nla_len > rem)
+			return -EINVAL;
+
+		type = nla->nla_type & NLA_TYPE_MASK;
+		data = (char *)nla + NLA_HDRLEN;
+		len = nla->nla_len - NLA_HDRLEN;
+
+		/* the kernel emits the attributes of a dump in the same order
+		 * for every entry, so start searching after the last match
+		 */
+		d = NULL;
+		for (i = 0; i < num; i++) {
+			if (desc[(next + i) % num].type == type) {
+				d = &desc[(next + i) % num];
+				next = (next + i + 1) % num;
+				break;
+			}
+		}
+
+		if (d) {
+			dst = (uint8_t *)row + d->offset;
+
+			switch (d->kind) {
+			case NETLINK_ATTR_FLAG:
+				*(bool *)dst = true;
+				break;
+			case NETLINK_ATTR_U8:
+				if (len < 1)
+					return -EINVAL;
+				*dst = *(uint8_t *)data;
+				break;
+			case NETLINK_ATTR_U16:
+				if (len < 2)
+					return -EINVAL;
+				memcpy(dst, data, sizeof(uint16_t));
+				break;
+			case NETLINK_ATTR_U32:
+				if (len < 4)
+					return -EINVAL;
+				memcpy(dst, data, sizeof(uint32_t));
+				break;
+			case NETLINK_ATTR_U64:
+				if (len < 8)
+					return -EINVAL;
+				memcpy(dst, data, sizeof(uint64_t));
+				break;
+			case NETLINK_ATTR_MAC:
+				if (len != ETH_ALEN)
+					return -EINVAL;
+				*(const uint8_t **)dst = (uint8_t *)data;
+				break;
+			case NETLINK_ATTR_STRING:
+				if (len < 1 || data[len - 1] != '\0')
+					return -EINVAL;
+				*(const char **)dst = data;
+				break;
+			default:
+				return -EINVAL;
+			}
+
+			found |= NETLINK_ATTR_BIT(type);
+		}
+
+		if (NLA_ALIGN(nla->nla_len) >= rem)
+			break;
+
+		rem -= NLA_ALIGN(nla->nla_len);
+		nla = (struct nlattr *)((char *)nla + NLA_ALIGN(nla->nla_len));
+	}
+
+	for (i = 0; i < num; i++) {
+		if (desc[i].mandatory && !(found & NETLINK_ATTR_BIT(desc[i].type)))
+			return -ENOENT;
+	}
+
+	if (present)
+		*present = found;
+
+	return 0;
+}
+
+/* field names of the decoded attributes in json/csv records */
+static const char *netlink_attr_names[NUM_BATADV_ATTR] = {
+	[BATADV_ATTR_VERSION] = "version",
+	[BATADV_ATTR_ALGO_NAME] = "algo_name",
+	[BATADV_ATTR_MESH_IFINDEX] = "mesh_ifindex",
+	[BATADV_ATTR_MESH_IFNAME] = "mesh_ifname",
+	[BATADV_ATTR_MESH_ADDRESS] = "mesh_address",
+	[BATADV_ATTR_HARD_IFINDEX] = "hard_ifindex",
+	[BATADV_ATTR_HARD_IFNAME] = "hard_ifname",
+	[BATADV_ATTR_HARD_ADDRESS] = "hard_address",
+	[BATADV_ATTR_ORIG_ADDRESS] = "orig_address",
+	[BATADV_ATTR_TPMETER_RESULT] = "tpmeter_result",
+	[BATADV_ATTR_TPMETER_TEST_TIME] = "tpmeter_test_time",
+	[BATADV_ATTR_TPMETER_BYTES] = "tpmeter_bytes",
+	[BATADV_ATTR_TPMETER_COOKIE] = "tpmeter_cookie",
+	[BATADV_ATTR_ACTIVE] = "active",
+	[BATADV_ATTR_TT_ADDRESS] = "tt_address",
+	[BATADV_ATTR_TT_TTVN] = "tt_ttvn",
+	[BATADV_ATTR_TT_LAST_TTVN] = "tt_last_ttvn",
+	[BATADV_ATTR_TT_CRC32] = "tt_crc32",
+	[BATADV_ATTR_TT_VID] = "tt_vid",
+	[BATADV_ATTR_TT_FLAGS] = "tt_flags",
+	[BATADV_ATTR_FLAG_BEST] = "best",
+	[BATADV_ATTR_LAST_SEEN_MSECS] = "last_seen_msecs",
+	[BATADV_ATTR_NEIGH_ADDRESS] = "neigh_address",
+	[BATADV_ATTR_TQ] = "tq",
+	[BATADV_ATTR_THROUGHPUT] = "throughput",
+	[BATADV_ATTR_BANDWIDTH_UP] = "bandwidth_up",
+	[BATADV_ATTR_BANDWIDTH_DOWN] = "bandwidth_down",
+	[BATADV_ATTR_ROUTER] = "router",
+	[BATADV_ATTR_BLA_OWN] = "bla_own",
+	[BATADV_ATTR_BLA_ADDRESS] = "bla_address",
+	[BATADV_ATTR_BLA_VID] = "bla_vid",
+	[BATADV_ATTR_BLA_BACKBONE] = "bla_backbone",
+	[BATADV_ATTR_BLA_CRC] = "bla_crc",
+	[BATADV_ATTR_DAT_CACHE_IP4ADDRESS] = "dat_cache_ip4address",
+	[BATADV_ATTR_DAT_CACHE_HWADDRESS] = "dat_cache_hwaddress",
+	[BATADV_ATTR_DAT_CACHE_VID] = "dat_cache_vid",
+	[BATADV_ATTR_MCAST_FLAGS] = "mcast_flags",
+	[BATADV_ATTR_MCAST_FLAGS_PRIV] = "mcast_flags_priv",
+};
+
+/* BATADV_ATTR_* of a json/csv field name or -1 */
+int netlink_attr_lookup(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(netlink_attr_names); i++) {
+		if (netlink_attr_names[i] && strcmp(netlink_attr_names[i], name) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+/**
+ * netlink_attr_value() - numeric value of a decoded attribute for comparisons
+ * @desc: descriptor of the attribute
+ * @row: the decoded row
+ * @present: attributes found by netlink_decode_attrs()
+ * @val: returns the value
+ *
+ * MAC addresses are packed into the lower 48 bit (in the order of their
+ * bytes), VLAN ids use the -1 notation for untagged entries.
+ *
+ * Return: 0 on success, -ENOENT when the attribute is missing, -EINVAL for
+ *  strings
+ */
+int netlink_attr_value(const struct netlink_attr_desc *desc, const void *row,
+		       netlink_attr_mask_t present, long long *val)
+{
+	const uint8_t *src = (const uint8_t *)row + desc->offset;
+	const uint8_t *mac;
+	uint16_t val16;
+	uint32_t val32;
+	uint64_t val64;
+	size_t i;
+
+	if (desc->kind != NETLINK_ATTR_FLAG &&
+	    !(present & NETLINK_ATTR_BIT(desc->type)))
+		return -ENOENT;
+
+	switch (desc->kind) {
+	case NETLINK_ATTR_FLAG:
+		*val = *(const bool *)src;
+		break;
+	case NETLINK_ATTR_U8:
+		*val = *src;
+		break;
+	case NETLINK_ATTR_U16:
+		memcpy(&val16, src, sizeof(val16));
+		*val = val16;
+
+		switch (desc->type) {
+		case BATADV_ATTR_TT_VID:
+		case BATADV_ATTR_BLA_VID:
+		case BATADV_ATTR_DAT_CACHE_VID:
+			*val = BATADV_PRINT_VID(val16);
+			break;
+		}
+		break;
+	case NETLINK_ATTR_U32:
+		memcpy(&val32, src, sizeof(val32));
+		*val = val32;
+		break;
+	case NETLINK_ATTR_U64:
+		memcpy(&val64, src, sizeof(val64));
+		*val = val64;
+		break;
+	case NETLINK_ATTR_MAC:
+		mac = *(const uint8_t * const *)src;
+		*val = 0;
+		for (i = 0; i < ETH_ALEN; i++)
+			*val = (*val << 8) | mac[i];
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * netlink_print_record() - print a row decoded by netlink_decode_attrs() as
+ *  json/csv record
+ * @opts: print options of the table
+ * @desc: descriptors which were used to decode the row
+ * @num: number of entries in @desc
+ * @row: the decoded row
+ * @present: attributes found by netlink_decode_attrs()
+ *
+ * Values are printed unformatted - only VLAN ids are converted to the
+ * -1 (untagged) notation of the text output and IPv4 addresses to the dotted
+ * notation.
+ */
+void netlink_print_record(struct print_opts *opts,
+			  const struct netlink_attr_desc *desc, size_t num,
+			  const void *row, netlink_attr_mask_t present)
+{
+	const uint8_t *src;
+	struct in_addr in;
+	const char *name;
+	uint16_t val16;
+	uint32_t val32;
+	uint64_t val64;
+	size_t i;
+
+	output_record_begin(&opts->out);
+
+	for (i = 0; i < num; i++) {
+		name = netlink_attr_names[desc[i].type];
+		src = (const uint8_t *)row + desc[i].offset;
+
+		if (desc[i].kind == NETLINK_ATTR_FLAG) {
+			output_field_bool(&opts->out, name, *(const bool *)src);
+			continue;
+		}
+
+		if (!(present & NETLINK_ATTR_BIT(desc[i].type))) {
+			output_field_none(&opts->out, name);
+			continue;
+		}
+
+		switch (desc[i].kind) {
+		case NETLINK_ATTR_U8:
+			output_field_uint(&opts->out, name, *src);
+			break;
+		case NETLINK_ATTR_U16:
+			memcpy(&val16, src, sizeof(val16));
+
+			switch (desc[i].type) {
+			case BATADV_ATTR_TT_VID:
+			case BATADV_ATTR_BLA_VID:
+			case BATADV_ATTR_DAT_CACHE_VID:
+				output_field_int(&opts->out, name,
+						 BATADV_PRINT_VID(val16));
+				break;
+			default:
+				output_field_uint(&opts->out, name, val16);
+				break;
+			}
+			break;
+		case NETLINK_ATTR_U32:
+			memcpy(&val32, src, sizeof(val32));
+
+			if (desc[i].type == BATADV_ATTR_DAT_CACHE_IP4ADDRESS) {
+				in.s_addr = val32;
+				output_field_str(&opts->out, name, inet_ntoa(in));
+			} else {
+				output_field_uint(&opts->out, name, val32);
+			}
+			break;
+		case NETLINK_ATTR_U64:
+			memcpy(&val64, src, sizeof(val64));
+			output_field_uint(&opts->out, name, val64);
+			break;
+		case NETLINK_ATTR_MAC:
+			output_field_mac(&opts->out, name,
+					 *(const uint8_t * const *)src);
+			break;
+		case NETLINK_ATTR_STRING:
+			output_field_str(&opts->out, name,
+					 *(const char * const *)src);
+			break;
+		default:
+			break;
+		}
+	}
+
+	output_record_end(&opts->out);
+}
+
 int netlink_print_error(struct sockaddr_nl *nla __maybe_unused,
 			struct nlmsgerr *nlerr,	void *arg __maybe_unused)
 {
@@ -191,45 +575,57 @@ int netlink_print_error(struct sockaddr_nl *nla __maybe_unused,
 	return NL_STOP;
 }
 
-int netlink_stop_callback(struct nl_msg *msg, void *arg __maybe_unused)
-{
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
-	int *error = nlmsg_data(nlh);
-
-	if (*error)
-		fprintf(stderr, "Error received: %s\n", strerror(-*error));
-
-	return NL_STOP;
-}
-
-static const int info_mandatory[] = {
-	BATADV_ATTR_MESH_IFINDEX,
-	BATADV_ATTR_MESH_IFNAME,
+struct info_row {
+	uint32_t mesh_ifindex;
+	const char *mesh_ifname;
+	const uint8_t *mesh_address;
+	const char *version;
+	const char *algo_name;
+	const char *hard_ifname;
+	const uint8_t *hard_address;
+	uint8_t ttvn;
+	uint16_t bla_crc;
+	uint32_t mcast_flags;
+	uint32_t mcast_flags_priv;
 };
 
-static const int info_hard_mandatory[] = {
-	BATADV_ATTR_VERSION,
-	BATADV_ATTR_ALGO_NAME,
-	BATADV_ATTR_HARD_IFNAME,
-	BATADV_ATTR_HARD_ADDRESS,
+static const struct netlink_attr_desc info_attrs[] = {
+	NETLINK_ATTR_OPT(BATADV_ATTR_VERSION, STRING,
+			 struct info_row, version),
+	NETLINK_ATTR_OPT(BATADV_ATTR_ALGO_NAME, STRING,
+			 struct info_row, algo_name),
+	NETLINK_ATTR_REQ(BATADV_ATTR_MESH_IFINDEX, U32,
+			 struct info_row, mesh_ifindex),
+	NETLINK_ATTR_REQ(BATADV_ATTR_MESH_IFNAME, STRING,
+			 struct info_row, mesh_ifname),
+	NETLINK_ATTR_OPT(BATADV_ATTR_MESH_ADDRESS, MAC,
+			 struct info_row, mesh_address),
+	NETLINK_ATTR_OPT(BATADV_ATTR_TT_TTVN, U8,
+			 struct info_row, ttvn),
+	NETLINK_ATTR_OPT(BATADV_ATTR_BLA_CRC, U16,
+			 struct info_row, bla_crc),
+	NETLINK_ATTR_OPT(BATADV_ATTR_MCAST_FLAGS, U32,
+			 struct info_row, mcast_flags),
+	NETLINK_ATTR_OPT(BATADV_ATTR_MCAST_FLAGS_PRIV, U32,
+			 struct info_row, mcast_flags_priv),
+	NETLINK_ATTR_OPT(BATADV_ATTR_HARD_IFNAME, STRING,
+			 struct info_row, hard_ifname),
+	NETLINK_ATTR_OPT(BATADV_ATTR_HARD_ADDRESS, MAC,
+			 struct info_row, hard_address),
 };
 
-static int info_callback(struct nl_msg *msg, void *arg)
+/* mandatory when the mesh interface has a primary interface */
+#define INFO_HARD_MANDATORY (NETLINK_ATTR_BIT(BATADV_ATTR_VERSION) | \
+			     NETLINK_ATTR_BIT(BATADV_ATTR_ALGO_NAME) | \
+			     NETLINK_ATTR_BIT(BATADV_ATTR_HARD_IFNAME) | \
+			     NETLINK_ATTR_BIT(BATADV_ATTR_HARD_ADDRESS))
+
+static int info_callback(struct nlmsghdr *nlh, void *arg)
 {
-	struct nlattr *attrs[BATADV_ATTR_MAX+1];
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
-	struct print_opts *opts = arg;
-	const uint8_t *primary_mac;
+	struct netlink_mesh_info *info = arg;
+	netlink_attr_mask_t present;
 	struct genlmsghdr *ghdr;
-	const uint8_t *mesh_mac;
-	const char *primary_if;
-	const char *mesh_name;
-	const char *version;
-	char *extra_info = NULL;
-	uint8_t ttvn = 0;
-	uint16_t bla_group_id = 0;
-	const char *algo_name;
-	const char *extra_header;
+	struct info_row row;
 	int ret;
 
 	if (!genlmsg_valid_hdr(nlh, 0)) {
@@ -242,177 +638,618 @@ static int info_callback(struct nl_msg *msg, void *arg)
 	if (ghdr->cmd != BATADV_CMD_GET_MESH_INFO)
 		return NL_OK;
 
-	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
-		      genlmsg_len(ghdr), batadv_netlink_policy)) {
+	ret = netlink_decode_attrs(ghdr, info_attrs, ARRAY_SIZE(info_attrs),
+				   &row, sizeof(row), &present);
+	if (ret == -ENOENT) {
+		fputs("Missing attributes from kernel\n", stderr);
+		exit(1);
+	} else if (ret < 0) {
 		fputs("Received invalid data from kernel.\n", stderr);
 		exit(1);
 	}
 
-	if (missing_mandatory_attrs(attrs, info_mandatory,
-				    ARRAY_SIZE(info_mandatory))) {
-		fputs("Missing attributes from kernel\n", stderr);
+	info->ifindex = row.mesh_ifindex;
+	snprintf(info->mesh_name, sizeof(info->mesh_name), "%s",
+		 row.mesh_ifname);
+
+	if (row.mesh_address)
+		memcpy(info->mesh_mac, row.mesh_address, ETH_ALEN);
+
+	info->enabled = false;
+	info->version[0] = '\0';
+	info->algo_name[0] = '\0';
+	info->primary_if[0] = '\0';
+	info->ttvn = 0;
+	info->bla_group_id = 0;
+	info->mcast_flags = -EOPNOTSUPP;
+	info->mcast_flags_priv = -EOPNOTSUPP;
+
+	if (!row.hard_ifname)
+		return NL_STOP;
+
+	if ((present & INFO_HARD_MANDATORY) != INFO_HARD_MANDATORY) {
+		fputs("Missing attributes from kernel\n",
+		      stderr);
 		exit(1);
 	}
 
-	mesh_name = nla_get_string(attrs[BATADV_ATTR_MESH_IFNAME]);
-	mesh_mac = nla_data(attrs[BATADV_ATTR_MESH_ADDRESS]);
+	info->enabled = true;
+	snprintf(info->version, sizeof(info->version), "%s", row.version);
+	snprintf(info->algo_name, sizeof(info->algo_name), "%s",
+		 row.algo_name);
+	snprintf(info->primary_if, sizeof(info->primary_if), "%s",
+		 row.hard_ifname);
+	memcpy(info->primary_mac, row.hard_address, ETH_ALEN);
 
-	if (attrs[BATADV_ATTR_HARD_IFNAME]) {
-		if (missing_mandatory_attrs(attrs, info_hard_mandatory,
-					    ARRAY_SIZE(info_hard_mandatory))) {
-			fputs("Missing attributes from kernel\n",
-			      stderr);
-			exit(1);
-		}
+	info->ttvn = row.ttvn;
+	info->bla_group_id = row.bla_crc;
+
+	if (present & NETLINK_ATTR_BIT(BATADV_ATTR_MCAST_FLAGS))
+		info->mcast_flags = row.mcast_flags;
+
+	if (present & NETLINK_ATTR_BIT(BATADV_ATTR_MCAST_FLAGS_PRIV))
+		info->mcast_flags_priv = row.mcast_flags_priv;
+
+	return NL_STOP;
+}
+
+/**
+ * netlink_get_mesh_info - get (cached) information about a mesh interface
+ * @state: state of the batctl process
+ * @ifindex: index of the mesh interface
+ * @refresh: always query the kernel even when cached information is available
+ *
+ * Return: information about the mesh interface or NULL on error
+ */
+const struct netlink_mesh_info *netlink_get_mesh_info(struct state *state,
+						      int ifindex,
+						      bool refresh)
+{
+	struct netlink_mesh_info *info;
+	uint32_t seq;
+	int nl_err;
+	int ret;
 
-		version = nla_get_string(attrs[BATADV_ATTR_VERSION]);
-		algo_name = nla_get_string(attrs[BATADV_ATTR_ALGO_NAME]);
-		primary_if = nla_get_string(attrs[BATADV_ATTR_HARD_IFNAME]);
-		primary_mac = nla_data(attrs[BATADV_ATTR_HARD_ADDRESS]);
+	if (!state->sock)
+		return NULL;
 
-		snprintf(algo_name_buf, sizeof(algo_name_buf), "%s", algo_name);
+	if (!state->mesh_info) {
+		state->mesh_info = calloc(1, sizeof(*state->mesh_info));
+		if (!state->mesh_info)
+			return NULL;
+	}
 
-		if (attrs[BATADV_ATTR_TT_TTVN])
-			ttvn = nla_get_u8(attrs[BATADV_ATTR_TT_TTVN]);
+	info = state->mesh_info;
+	if (!refresh && info->ifindex && info->ifindex == ifindex)
+		return info;
 
-		if (attrs[BATADV_ATTR_BLA_CRC])
-			bla_group_id = nla_get_u16(attrs[BATADV_ATTR_BLA_CRC]);
+	info->ifindex = 0;
 
-		if (attrs[BATADV_ATTR_MCAST_FLAGS])
-			mcast_flags = nla_get_u32(attrs[BATADV_ATTR_MCAST_FLAGS]);
-		else
-			mcast_flags = -EOPNOTSUPP;
+	/* the request is kept for the refreshes in watch mode */
+	if (state->mesh_info_msg && state->mesh_info_msg_ifindex != ifindex) {
+		nlmsg_free(state->mesh_info_msg);
+		state->mesh_info_msg = NULL;
+	}
 
-		if (attrs[BATADV_ATTR_MCAST_FLAGS_PRIV])
-			mcast_flags_priv = nla_get_u32(attrs[BATADV_ATTR_MCAST_FLAGS_PRIV]);
-		else
-			mcast_flags_priv = -EOPNOTSUPP;
+	if (!state->mesh_info_msg) {
+		state->mesh_info_msg = nlmsg_alloc();
+		if (!state->mesh_info_msg)
+			return NULL;
+
+		/* auto acks are disabled for the socket - the explicit ack
+		 * terminates the reply for netlink_dump_recv()
+		 */
+		genlmsg_put(state->mesh_info_msg, NL_AUTO_PID, NL_AUTO_SEQ,
+			    state->batadv_family, 0, NLM_F_ACK,
+			    BATADV_CMD_GET_MESH_INFO, 1);
+
+		nla_put_u32(state->mesh_info_msg, BATADV_ATTR_MESH_IFINDEX,
+			    ifindex);
+		state->mesh_info_msg_ifindex = ifindex;
+	}
 
-		switch (opts->nl_cmd) {
-		case BATADV_CMD_GET_TRANSTABLE_LOCAL:
-			ret = asprintf(&extra_info, ", TTVN: %u", ttvn);
-			if (ret < 0)
-				extra_info = NULL;
-			break;
-		case BATADV_CMD_GET_BLA_BACKBONE:
-		case BATADV_CMD_GET_BLA_CLAIM:
-			ret = asprintf(&extra_info, ", group id: 0x%04x",
-				       bla_group_id);
-			if (ret < 0)
-				extra_info = NULL;
-			break;
-		default:
-			extra_info = strdup("");
-			break;
+	nlmsg_hdr(state->mesh_info_msg)->nlmsg_seq = NL_AUTO_SEQ;
+	nl_send_auto_complete(state->sock, state->mesh_info_msg);
+	seq = nlmsg_hdr(state->mesh_info_msg)->nlmsg_seq;
+
+	ret = netlink_dump_recv(state->sock, state->dump_buf, seq,
+				info_callback, info, &nl_err);
+	if (ret < 0) {
+		last_err = ret;
+	} else if (nl_err < 0) {
+		if (nl_err != -EOPNOTSUPP)
+			fprintf(stderr, "Error received: %s\n",
+				strerror(-nl_err));
+
+		last_err = nl_err;
+	}
+
+	if (info->ifindex != ifindex) {
+		info->ifindex = 0;
+		return NULL;
+	}
+
+	return info;
+}
+
+/**
+ * netlink_get_info - append the header line of a debug table
+ * @state: state of the batctl process
+ * @ifindex: index of the mesh interface
+ * @nl_cmd: dump command of the table
+ * @header: column header of the table (or NULL)
+ * @out: buffer for the header
+ *
+ * Return: 0 on success or negative error
+ */
+int netlink_get_info(struct state *state, int ifindex, uint8_t nl_cmd,
+		     const char *header, struct output *out)
+{
+	const struct netlink_mesh_info *info;
+	const char *extra_header;
+	char extra_info[32];
+	bool refresh;
+
+	/* only the TTVN and the BLA group id can change while the header
+	 * is printed again in watch mode
+	 */
+	switch (nl_cmd) {
+	case BATADV_CMD_GET_TRANSTABLE_LOCAL:
+	case BATADV_CMD_GET_BLA_BACKBONE:
+	case BATADV_CMD_GET_BLA_CLAIM:
+		refresh = true;
+		break;
+	default:
+		refresh = false;
+		break;
+	}
+
+	info = netlink_get_mesh_info(state, ifindex, refresh);
+	if (!info)
+		return -EOPNOTSUPP;
+
+	if (!info->enabled) {
+		output_printf(out, "BATMAN mesh %s disabled\n",
+			      info->mesh_name);
+		return 0;
+	}
+
+	switch (nl_cmd) {
+	case BATADV_CMD_GET_TRANSTABLE_LOCAL:
+		snprintf(extra_info, sizeof(extra_info), ", TTVN: %u",
+			 info->ttvn);
+		break;
+	case BATADV_CMD_GET_BLA_BACKBONE:
+	case BATADV_CMD_GET_BLA_CLAIM:
+		snprintf(extra_info, sizeof(extra_info), ", group id: 0x%04x",
+			 info->bla_group_id);
+		break;
+	default:
+		extra_info[0] = '\0';
+		break;
+	}
+
+	if (header)
+		extra_header = header;
+	else
+		extra_header = "";
+
+	output_printf(out,
+		      "[B.A.T.M.A.N. adv %s, MainIF/MAC: %s/%02x:%02x:%02x:%02x:%02x:%02x (%s/%02x:%02x:%02x:%02x:%02x:%02x %s)%s]\n%s",
+		      info->version, info->primary_if,
+		      info->primary_mac[0], info->primary_mac[1],
+		      info->primary_mac[2], info->primary_mac[3],
+		      info->primary_mac[4], info->primary_mac[5],
+		      info->mesh_name,
+		      info->mesh_mac[0], info->mesh_mac[1], info->mesh_mac[2],
+		      info->mesh_mac[3], info->mesh_mac[4], info->mesh_mac[5],
+		      info->algo_name, extra_info, extra_header);
+
+	return 0;
+}
+
+void netlink_print_remaining_header(struct print_opts *opts)
+{
+	if (!opts->remaining_header)
+		return;
+
+	output_str(&opts->out, opts->remaining_header);
+	opts->remaining_header = NULL;
+}
+
+/* row of the last dump - the key and value are stored behind the entry */
+struct netlink_delta_entry {
+	const uint8_t *key;
+	size_t key_len;
+	uint8_t *value;
+	size_t value_len;
+	bool seen;
+	char *row;
+	size_t row_size;
+	uint8_t data[];
+};
+
+static int compare_delta_key(void *data1, void *data2)
+{
+	const struct netlink_delta_entry *entry1 = data1;
+	const struct netlink_delta_entry *entry2 = data2;
+
+	if (entry1->key_len != entry2->key_len)
+		return 0;
+
+	return (memcmp(entry1->key, entry2->key, entry1->key_len) == 0 ? 1 : 0);
+}
+
+static int choose_delta_key(void *data, int32_t size)
+{
+	const struct netlink_delta_entry *entry = data;
+
+	return (hash_bytes(entry->key, entry->key_len) % size);
+}
+
+static void netlink_delta_entry_free(void *data)
+{
+	struct netlink_delta_entry *entry = data;
+
+	free(entry->row);
+	free(entry);
+}
+
+static int netlink_delta_init(struct print_opts *opts)
+{
+	opts->delta_hash = hash_new(128, compare_delta_key, choose_delta_key);
+	if (!opts->delta_hash)
+		return -ENOMEM;
+
+	if (output_init(&opts->row, -1, 256) < 0) {
+		hash_destroy(opts->delta_hash);
+		opts->delta_hash = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void netlink_delta_free(struct print_opts *opts)
+{
+	if (opts->delta_hash)
+		hash_delete(opts->delta_hash, netlink_delta_entry_free);
+
+	output_free(&opts->row);
+
+	opts->delta_hash = NULL;
+}
+
+/* print rows which were not part of the last dump and prepare the
+ * remaining rows for the next dump
+ */
+static void netlink_delta_sweep(struct print_opts *opts)
+{
+	struct netlink_delta_entry *entry;
+	struct element_t *bucket;
+	int i;
+
+	/* walk the buckets directly - hash_iterate() allocates an iterator */
+	for (i = 0; i < opts->delta_hash->size; i++) {
+		bucket = opts->delta_hash->table[i];
+
+		while (bucket) {
+			entry = bucket->data;
+			bucket = bucket->next;
+
+			if (entry->seen) {
+				entry->seen = false;
+				continue;
+			}
+
+			output_str(&opts->out, "- ");
+			output_str(&opts->out, entry->row);
+			hash_remove(opts->delta_hash, entry);
+			netlink_delta_entry_free(entry);
 		}
+	}
+}
 
-		if (opts->static_header)
-			extra_header = opts->static_header;
-		else
-			extra_header = "";
-
-		ret = asprintf(&opts->remaining_header,
-			       "[B.A.T.M.A.N. adv %s, MainIF/MAC: %s/%02x:%02x:%02x:%02x:%02x:%02x (%s/%02x:%02x:%02x:%02x:%02x:%02x %s)%s]\n%s",
-			       version, primary_if,
-			       primary_mac[0], primary_mac[1], primary_mac[2],
-			       primary_mac[3], primary_mac[4], primary_mac[5],
-			       mesh_name,
-			       mesh_mac[0], mesh_mac[1], mesh_mac[2],
-			       mesh_mac[3], mesh_mac[4], mesh_mac[5],
-			       algo_name, extra_info, extra_header);
-		if (ret < 0)
-			opts->remaining_header = NULL;
-
-		if (extra_info)
-			free(extra_info);
-	} else {
-		ret = asprintf(&opts->remaining_header,
-			       "BATMAN mesh %s disabled\n", mesh_name);
-		if (ret < 0)
-			opts->remaining_header = NULL;
+/* store the printed row - its buffer is only grown when the row doesn't fit */
+static int netlink_delta_set_row(struct netlink_delta_entry *entry,
+				 const struct output *row)
+{
+	char *buf;
+
+	if (row->len >= entry->row_size) {
+		buf = realloc(entry->row, row->len + 1);
+		if (!buf)
+			return -ENOMEM;
+
+		entry->row = buf;
+		entry->row_size = row->len + 1;
 	}
 
-	return NL_STOP;
+	memcpy(entry->row, row->buf, row->len);
+	entry->row[row->len] = '\0';
+
+	return 0;
+}
+
+/**
+ * netlink_row_begin - get output buffer for the next table row
+ * @opts: print options of the table
+ *
+ * Return: the table output or the row buffer when the rows are compared in
+ *  delta mode
+ */
+struct output *netlink_row_begin(struct print_opts *opts)
+{
+	if (!opts->delta_hash)
+		return &opts->out;
+
+	output_reset(&opts->row);
+
+	return &opts->row;
 }
 
-char *netlink_get_info(int ifindex, uint8_t nl_cmd, const char *header)
+/**
+ * netlink_row_end - finish row started with netlink_row_begin
+ * @opts: print options of the table
+ * @key: natural key of the row
+ * @key_len: length of @key
+ * @value: fields of the row which are compared to detect changes
+ * @value_len: length of @value
+ *
+ * In delta mode, the row is only printed when it was added ("+") or
+ * changed ("~") since the last dump. The rows of a table are expected to
+ * use the same @value_len, a row with another one is stored again.
+ */
+void netlink_row_end(struct print_opts *opts, const void *key, size_t key_len,
+		     const void *value, size_t value_len)
 {
-	struct nl_sock *sock;
-	struct nl_msg *msg;
-	struct nl_cb *cb;
-	int family;
-	struct print_opts opts = {
-		.read_opt = 0,
-		.nl_cmd = nl_cmd,
-		.remaining_header = NULL,
-		.static_header = header,
-	};
+	struct netlink_delta_entry *entry;
+	struct netlink_delta_entry lookup;
+	const char *prefix = "+ ";
 
-	sock = nl_socket_alloc();
-	if (!sock)
-		return NULL;
+	if (!opts->delta_hash)
+		return;
 
-	genl_connect(sock);
+	lookup.key = key;
+	lookup.key_len = key_len;
 
-	family = genl_ctrl_resolve(sock, BATADV_NL_NAME);
-	if (family < 0) {
-		nl_socket_free(sock);
-		return NULL;
+	/* unchanged rows are neither copied nor printed */
+	entry = hash_find(opts->delta_hash, &lookup);
+	if (entry && entry->value_len == value_len) {
+		entry->seen = true;
+
+		if (memcmp(entry->value, value, value_len) == 0)
+			return;
+
+		output_str(&opts->out, "~ ");
+		output_mem(&opts->out, opts->row.buf, opts->row.len);
+		memcpy(entry->value, value, value_len);
+		netlink_delta_set_row(entry, &opts->row);
+		return;
 	}
 
-	msg = nlmsg_alloc();
-	if (!msg) {
-		nl_socket_free(sock);
+	if (entry) {
+		hash_remove(opts->delta_hash, entry);
+		netlink_delta_entry_free(entry);
+		prefix = "~ ";
+	}
+
+	entry = malloc(sizeof(*entry) + key_len + value_len);
+	if (!entry)
+		return;
+
+	memcpy(entry->data, key, key_len);
+	entry->key = entry->data;
+	entry->key_len = key_len;
+	memcpy(entry->data + key_len, value, value_len);
+	entry->value = entry->data + key_len;
+	entry->value_len = value_len;
+	entry->seen = true;
+	entry->row = NULL;
+	entry->row_size = 0;
+
+	if (netlink_delta_set_row(entry, &opts->row) < 0 ||
+	    hash_add(opts->delta_hash, entry) < 0) {
+		netlink_delta_entry_free(entry);
+		return;
+	}
+
+	output_str(&opts->out, prefix);
+	output_mem(&opts->out, opts->row.buf, opts->row.len);
+
+	if (opts->delta_hash->elements * 4 > opts->delta_hash->size) {
+		struct hashtable_t *swaphash;
+
+		swaphash = hash_resize(opts->delta_hash,
+				       opts->delta_hash->size * 2);
+		if (swaphash)
+			opts->delta_hash = swaphash;
+	}
+}
+
+/**
+ * netlink_dump_sock_setup - prepare socket for large dumps
+ * @sock: generic netlink socket
+ *
+ * The kernel only fills the next dump skb when the receive queue has room.
+ * A large receive buffer therefore allows it to queue several skbs which are
+ * then picked up with a single recvmmsg().
+ */
+void netlink_dump_sock_setup(struct nl_sock *sock)
+{
+	int size = NETLINK_DUMP_RCVBUF;
+	int fd = nl_socket_get_fd(sock);
+
+	if (fd < 0)
+		return;
+
+	/* privileged users can exceed rmem_max */
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0)
+		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+}
+
+struct netlink_dump_buf *netlink_dump_buf_alloc(void)
+{
+	struct netlink_dump_buf *buf;
+	size_t i;
+
+	buf = malloc(sizeof(*buf));
+	if (!buf)
 		return NULL;
+
+	for (i = 0; i < NETLINK_DUMP_BATCH; i++) {
+		buf->iov[i].iov_base = buf->data[i];
+		buf->iov[i].iov_len = sizeof(buf->data[i]);
+
+		memset(&buf->msgs[i], 0, sizeof(buf->msgs[i]));
+		buf->msgs[i].msg_hdr.msg_iov = &buf->iov[i];
+		buf->msgs[i].msg_hdr.msg_iovlen = 1;
 	}
 
-	genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, family, 0, 0,
-		    BATADV_CMD_GET_MESH_INFO, 1);
+	return buf;
+}
 
-	nla_put_u32(msg, BATADV_ATTR_MESH_IFINDEX, ifindex);
+void netlink_dump_buf_free(struct netlink_dump_buf *buf)
+{
+	free(buf);
+}
 
-	nl_send_auto_complete(sock, msg);
+/**
+ * netlink_dump_recv - receive all messages of a dump
+ * @sock: socket on which the dump request was sent
+ * @buf: receive buffers
+ * @seq: sequence number of the dump request
+ * @callback: called for each (non-control) message of the dump
+ * @arg: argument for @callback
+ * @nl_err: set to the error reported by the kernel (or 0)
+ *
+ * Multiple datagrams are received with one recvmmsg() and the netlink
+ * messages are parsed directly from the receive buffers. Messages of
+ * other requests are ignored.
+ *
+ * Return: 0 when the dump was received, negative error when the dump is
+ *  incomplete because of a local receive problem
+ */
+int netlink_dump_recv(struct nl_sock *sock, struct netlink_dump_buf *buf,
+		      uint32_t seq, netlink_dump_cb_t callback, void *arg,
+		      int *nl_err)
+{
+	struct nlmsgerr *nlerr;
+	struct nlmsghdr *nlh;
+	bool stopped = false;
+	bool done = false;
+	int fd;
+	int len;
+	int ret;
+	int i;
 
-	nlmsg_free(msg);
+	*nl_err = 0;
 
-	cb = nl_cb_alloc(NL_CB_DEFAULT);
-	if (!cb)
-		goto err_free_sock;
+	fd = nl_socket_get_fd(sock);
+	if (fd < 0)
+		return -EBADF;
 
-	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, info_callback, &opts);
-	nl_cb_err(cb, NL_CB_CUSTOM, netlink_print_error, NULL);
+	while (!done) {
+		ret = recvmmsg(fd, buf->msgs, NETLINK_DUMP_BATCH,
+			       MSG_WAITFORONE, NULL);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
 
-	nl_recvmsgs(sock, cb);
+			if (errno == ENOBUFS)
+				fprintf(stderr, "Error - netlink receive buffer overrun, dump is incomplete\n");
+			else
+				fprintf(stderr, "Error - failed to receive netlink dump: %s\n",
+					strerror(errno));
 
-err_free_sock:
-	nl_socket_free(sock);
+			return -errno;
+		}
+
+		for (i = 0; i < ret && !done; i++) {
+			if (buf->msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+				fprintf(stderr, "Error - netlink message truncated, dump is incomplete\n");
+				return -EMSGSIZE;
+			}
+
+			len = buf->msgs[i].msg_len;
+			nlh = (struct nlmsghdr *)buf->data[i];
+
+			for (; NLMSG_OK(nlh, (unsigned int)len);
+			     nlh = NLMSG_NEXT(nlh, len)) {
+				if (nlh->nlmsg_seq != seq)
+					continue;
+
+				switch (nlh->nlmsg_type) {
+				case NLMSG_NOOP:
+					continue;
+				case NLMSG_OVERRUN:
+					fprintf(stderr, "Error - netlink overrun, dump is incomplete\n");
+					return -EOVERFLOW;
+				case NLMSG_DONE:
+					if (nlh->nlmsg_len >= NLMSG_LENGTH(sizeof(int)))
+						*nl_err = *(int *)NLMSG_DATA(nlh);
+					done = true;
+					break;
+				case NLMSG_ERROR:
+					nlerr = NLMSG_DATA(nlh);
+					if (nlh->nlmsg_len >= NLMSG_LENGTH(sizeof(*nlerr)))
+						*nl_err = nlerr->error;
+					done = true;
+					break;
+				default:
+					/* the rest of the dump still has to be
+					 * read from the socket
+					 */
+					if (stopped)
+						continue;
+
+					if (callback(nlh, arg) == NL_STOP)
+						stopped = true;
+					continue;
+				}
+
+				break;
+			}
+		}
+	}
 
-	return opts.remaining_header;
+	return 0;
 }
 
-void netlink_print_remaining_header(struct print_opts *opts)
+/* the filter, group or sort expression doesn't fit the dumped table */
+static int netlink_print_opts_error(const struct print_opts *opts)
 {
-	if (!opts->remaining_header)
-		return;
+	int ret;
 
-	fputs(opts->remaining_header, stdout);
-	free(opts->remaining_header);
-	opts->remaining_header = NULL;
+	ret = filter_error(opts->filter);
+	if (ret < 0)
+		return ret;
+
+	ret = group_error(opts->group);
+	if (ret < 0)
+		return ret;
+
+	return sort_error(opts->sort);
 }
 
-int netlink_print_common_cb(struct nl_msg *msg, void *arg)
+int netlink_print_common_cb(struct nlmsghdr *nlh, void *arg)
 {
 	struct print_opts *opts = arg;
+	int ret;
 
 	netlink_print_remaining_header(opts);
 
-	return opts->callback(msg, arg);
+	ret = opts->callback(nlh, arg);
+	if (netlink_print_opts_error(opts) < 0)
+		return NL_STOP;
+
+	return ret;
 }
 
 int netlink_print_common(struct state *state, char *orig_iface, int read_opt,
 			 float orig_timeout, float watch_interval,
 			 const char *header, uint8_t nl_cmd,
-			 nl_recvmsg_msg_cb_t callback)
+			 netlink_dump_cb_t callback)
 {
 	struct print_opts opts = {
 		.read_opt = read_opt,
@@ -420,16 +1257,35 @@ int netlink_print_common(struct state *state, char *orig_iface, int read_opt,
 		.watch_interval = watch_interval,
 		.remaining_header = NULL,
 		.callback = callback,
+		.filter = state->filter,
+		.group = state->group,
+		.sort = state->sort,
 	};
+	struct output info_header;
 	int hardifindex = 0;
 	struct nl_msg *msg;
+	bool first = true;
+	uint32_t seq;
 	int ifindex;
+	int nl_err;
+	int ret;
 
 	if (!state->sock) {
 		last_err = -EOPNOTSUPP;
 		return last_err;
 	}
 
+	if (state->table_probe) {
+		free(state->table_probe->header);
+		state->table_probe->header = strdup(header ? header : "");
+		if (!state->table_probe->header)
+			return -ENOMEM;
+
+		state->table_probe->nl_cmd = nl_cmd;
+		state->table_probe->callback = callback;
+		return 0;
+	}
+
 	ifindex = if_nametoindex(state->mesh_iface);
 	if (!ifindex) {
 		fprintf(stderr, "Interface %s is unknown\n", state->mesh_iface);
@@ -447,257 +1303,404 @@ int netlink_print_common(struct state *state, char *orig_iface, int read_opt,
 		}
 	}
 
-	bat_hosts_init(read_opt);
+	/* the kernel only dumps the neighbors of the given hard interface.
+	 * The other dumps interpret it as the outgoing interface of the
+	 * multi-interface view - it can't be used as filter there
+	 */
+	if (!hardifindex && nl_cmd == BATADV_CMD_GET_NEIGHBORS)
+		hardifindex = filter_hard_ifindex(state->filter);
 
-	nl_cb_set(state->cb, NL_CB_VALID, NL_CB_CUSTOM, netlink_print_common_cb, &opts);
-	nl_cb_set(state->cb, NL_CB_FINISH, NL_CB_CUSTOM, netlink_stop_callback, NULL);
-	nl_cb_err(state->cb, NL_CB_CUSTOM, netlink_print_error, NULL);
+	last_err = output_init(&opts.out, STDOUT_FILENO, OUTPUT_BUF_SIZE);
+	if (last_err < 0)
+		return last_err;
 
-	do {
-		if (read_opt & CLR_CONT_READ)
-			/* clear screen, set cursor back to 0,0 */
-			printf("\033[2J\033[0;0f");
+	/* everything which is needed again in watch mode is allocated
+	 * before the first dump - the following rounds reuse it
+	 */
+	last_err = output_init(&info_header, -1, 512);
+	if (last_err < 0)
+		goto err_free_out;
 
-		if (!(read_opt & SKIP_HEADER))
-			opts.remaining_header = netlink_get_info(ifindex,
-								 nl_cmd,
-								 header);
+	msg = nlmsg_alloc();
+	if (!msg) {
+		last_err = -ENOMEM;
+		goto err_free_info;
+	}
 
-		msg = nlmsg_alloc();
-		if (!msg)
-			continue;
+	genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, state->batadv_family,
+		    0, NLM_F_DUMP, nl_cmd, 1);
 
-		genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, state->batadv_family,
-			    0, NLM_F_DUMP, nl_cmd, 1);
+	nla_put_u32(msg, BATADV_ATTR_MESH_IFINDEX, ifindex);
+	if (hardifindex)
+		nla_put_u32(msg, BATADV_ATTR_HARD_IFINDEX, hardifindex);
 
-		nla_put_u32(msg, BATADV_ATTR_MESH_IFINDEX, ifindex);
-		if (hardifindex)
-			nla_put_u32(msg, BATADV_ATTR_HARD_IFINDEX,
-				    hardifindex);
+	output_set_format(&opts.out, state->output_format,
+			  !(read_opt & SKIP_HEADER));
 
-		nl_send_auto_complete(state->sock, msg);
+	/* records are streamed - no text header and no screen clearing */
+	if (opts.out.format != OUTPUT_FORMAT_TEXT) {
+		if (read_opt & CLR_CONT_READ) {
+			read_opt &= ~CLR_CONT_READ;
+			read_opt |= CONT_READ;
+		}
+
+		read_opt |= SKIP_HEADER;
+		opts.read_opt = read_opt;
+	}
+
+	bat_hosts_init(read_opt);
+
+	/* only changes are printed - the screen must not be cleared */
+	if (read_opt & DELTA_READ) {
+		read_opt &= ~CLR_CONT_READ;
+		read_opt |= CONT_READ;
+		opts.read_opt = read_opt;
 
-		nlmsg_free(msg);
+		last_err = netlink_delta_init(&opts);
+		if (last_err < 0)
+			goto err_free_delta;
+	}
+
+	do {
+		if (read_opt & CLR_CONT_READ)
+			/* clear screen, set cursor back to 0,0 */
+			output_str(&opts.out, "\033[2J\033[0;0f");
+
+		/* the columns of the aggregates are printed by group_flush() */
+		if (!(read_opt & SKIP_HEADER) &&
+		    (first || !(read_opt & DELTA_READ))) {
+			output_reset(&info_header);
+			if (netlink_get_info(state, ifindex, nl_cmd,
+					     opts.group ? "" : header,
+					     &info_header) == 0) {
+				output_char(&info_header, '\0');
+				opts.remaining_header = info_header.buf;
+			}
+		}
+
+		/* every round is a new request */
+		nlmsg_hdr(msg)->nlmsg_seq = NL_AUTO_SEQ;
+		nl_send_auto_complete(state->sock, msg);
+		seq = nlmsg_hdr(msg)->nlmsg_seq;
 
 		last_err = 0;
-		nl_recvmsgs(state->sock, state->cb);
+		ret = netlink_dump_recv(state->sock, state->dump_buf, seq,
+					netlink_print_common_cb, &opts,
+					&nl_err);
+		if (ret < 0) {
+			last_err = ret;
+		} else if (netlink_print_opts_error(&opts) < 0) {
+			last_err = netlink_print_opts_error(&opts);
+		} else if (nl_err < 0) {
+			if (nl_err != -EOPNOTSUPP)
+				fprintf(stderr, "Error received: %s\n",
+					strerror(-nl_err));
+
+			last_err = nl_err;
+		}
 
 		/* the header should still be printed when no entry was received */
 		if (!last_err)
 			netlink_print_remaining_header(&opts);
 
+		if (!last_err)
+			sort_flush(opts.sort, opts.callback, &opts);
+
+		if (!last_err)
+			group_flush(opts.group, &opts.out, read_opt);
+
+		if (!last_err && read_opt & DELTA_READ)
+			netlink_delta_sweep(&opts);
+
+		output_flush(&opts.out);
+
+		first = false;
+
 		if (!last_err && read_opt & (CONT_READ|CLR_CONT_READ))
 			usleep(1000000 * watch_interval);
 
 	} while (!last_err && read_opt & (CONT_READ|CLR_CONT_READ));
 
+err_free_delta:
+	netlink_delta_free(&opts);
 	bat_hosts_free();
+	nlmsg_free(msg);
+err_free_info:
+	output_free(&info_header);
+err_free_out:
+	output_free(&opts.out);
 
 	return last_err;
 }
 
-static int nlquery_error_cb(struct sockaddr_nl *nla __maybe_unused,
-			    struct nlmsgerr *nlerr, void *arg)
+/**
+ * netlink_dump - dump a batadv table of a mesh interface
+ * @sock: connected generic netlink socket
+ * @buf: receive buffers
+ * @family: id of the batadv generic netlink family
+ * @ifindex: index of the mesh interface
+ * @nl_cmd: dump command
+ * @callback: called for each message of the dump
+ * @arg: argument for @callback
+ *
+ * Return: 0 on success, negative error when the dump could not be received or
+ *  was rejected by the kernel
+ */
+int netlink_dump(struct nl_sock *sock, struct netlink_dump_buf *buf,
+		 int family, int ifindex, uint8_t nl_cmd,
+		 netlink_dump_cb_t callback, void *arg)
 {
-	struct nlquery_opts *query_opts = arg;
+	struct nl_msg *msg;
+	uint32_t seq;
+	int nl_err;
+	int ret;
 
-	query_opts->err = nlerr->error;
+	msg = nlmsg_alloc();
+	if (!msg)
+		return -ENOMEM;
 
-	return NL_STOP;
-}
+	genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, family, 0, NLM_F_DUMP,
+		    nl_cmd, 1);
 
-static int nlquery_stop_cb(struct nl_msg *msg, void *arg)
-{
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
-	struct nlquery_opts *query_opts = arg;
-	int *error = nlmsg_data(nlh);
+	nla_put_u32(msg, BATADV_ATTR_MESH_IFINDEX, ifindex);
+	nl_send_auto_complete(sock, msg);
+	seq = nlmsg_hdr(msg)->nlmsg_seq;
+	nlmsg_free(msg);
 
-	if (*error)
-		query_opts->err = *error;
+	ret = netlink_dump_recv(sock, buf, seq, callback, arg, &nl_err);
+	if (ret < 0)
+		return ret;
 
-	return NL_STOP;
+	return nl_err;
 }
 
-static int netlink_query_common(const char *mesh_iface, uint8_t nl_cmd,
-				nl_recvmsg_msg_cb_t callback, int flags,
+static int netlink_query_common(struct state *state, uint8_t nl_cmd,
+				netlink_dump_cb_t callback,
 				struct nlquery_opts *query_opts)
 {
-	struct nl_sock *sock;
-	struct nl_msg *msg;
-	struct nl_cb *cb;
 	int ifindex;
-	int family;
 	int ret;
 
 	query_opts->err = 0;
 
-	sock = nl_socket_alloc();
-	if (!sock)
-		return -ENOMEM;
-
-	ret = genl_connect(sock);
-	if (ret < 0) {
-		query_opts->err = ret;
-		goto err_free_sock;
-	}
-
-	family = genl_ctrl_resolve(sock, BATADV_NL_NAME);
-	if (family < 0) {
-		query_opts->err = -EOPNOTSUPP;
-		goto err_free_sock;
-	}
-
-	ifindex = if_nametoindex(mesh_iface);
-	if (!ifindex) {
-		query_opts->err = -ENODEV;
-		goto err_free_sock;
-	}
-
-	cb = nl_cb_alloc(NL_CB_DEFAULT);
-	if (!cb) {
-		query_opts->err = -ENOMEM;
-		goto err_free_sock;
-	}
-
-	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, callback, query_opts);
-	nl_cb_set(cb, NL_CB_FINISH, NL_CB_CUSTOM, nlquery_stop_cb, query_opts);
-	nl_cb_err(cb, NL_CB_CUSTOM, nlquery_error_cb, query_opts);
-
-	msg = nlmsg_alloc();
-	if (!msg) {
-		query_opts->err = -ENOMEM;
-		goto err_free_cb;
-	}
-
-	genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, family, 0, flags,
-		    nl_cmd, 1);
-
-	nla_put_u32(msg, BATADV_ATTR_MESH_IFINDEX, ifindex);
-	nl_send_auto_complete(sock, msg);
-	nlmsg_free(msg);
+	if (!state->sock)
+		return -EOPNOTSUPP;
 
-	nl_recvmsgs(sock, cb);
+	ifindex = if_nametoindex(state->mesh_iface);
+	if (!ifindex)
+		return -ENODEV;
 
-err_free_cb:
-	nl_cb_put(cb);
-err_free_sock:
-	nl_socket_free(sock);
+	ret = netlink_dump(state->sock, state->dump_buf, state->batadv_family,
+			   ifindex, nl_cmd, callback, query_opts);
+	if (ret < 0)
+		return ret;
 
 	return query_opts->err;
 }
 
-static const int translate_mac_netlink_mandatory[] = {
-	BATADV_ATTR_TT_ADDRESS,
-	BATADV_ATTR_ORIG_ADDRESS,
+struct netlink_snapshot {
+	struct hashtable_t *hash;
+	struct timespec created;
 };
 
-struct translate_mac_netlink_opts {
-	struct ether_addr mac;
-	bool found;
+struct netlink_snapshot_opts {
+	struct hashtable_t *hash;
 	struct nlquery_opts query_opts;
 };
 
-static int translate_mac_netlink_cb(struct nl_msg *msg, void *arg)
+/* entries of the client index - client MAC is the hash key */
+struct tt_snapshot_entry {
+	struct ether_addr client;
+	struct ether_addr orig;
+};
+
+/* entries of the originator index - originator MAC is the hash key */
+struct orig_snapshot_entry {
+	struct ether_addr orig;
+	uint8_t nexthop[ETH_ALEN];
+	uint32_t hard_ifindex;
+};
+
+static void netlink_snapshot_free(struct netlink_snapshot *snapshot)
 {
-	struct nlattr *attrs[BATADV_ATTR_MAX+1];
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
-	struct nlquery_opts *query_opts = arg;
-	struct translate_mac_netlink_opts *opts;
-	struct genlmsghdr *ghdr;
-	uint8_t *addr;
-	uint8_t *orig;
+	if (!snapshot)
+		return;
 
-	opts = container_of(query_opts, struct translate_mac_netlink_opts,
-			    query_opts);
+	if (snapshot->hash)
+		hash_delete(snapshot->hash, free);
 
-	if (!genlmsg_valid_hdr(nlh, 0))
-		return NL_OK;
+	free(snapshot);
+}
 
-	ghdr = nlmsg_data(nlh);
+static bool netlink_snapshot_expired(struct state *state,
+				     struct netlink_snapshot *snapshot)
+{
+	struct timespec now;
+	double age;
 
-	if (ghdr->cmd != BATADV_CMD_GET_TRANSTABLE_GLOBAL)
-		return NL_OK;
+	if (!snapshot)
+		return true;
 
-	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
-		      genlmsg_len(ghdr), batadv_netlink_policy)) {
-		return NL_OK;
-	}
+	/* negative max age: keep the first snapshot */
+	if (state->snapshot_max_age < 0)
+		return false;
 
-	if (missing_mandatory_attrs(attrs, translate_mac_netlink_mandatory,
-				    ARRAY_SIZE(translate_mac_netlink_mandatory)))
-		return NL_OK;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	age = now.tv_sec - snapshot->created.tv_sec;
+	age += (now.tv_nsec - snapshot->created.tv_nsec) / 1000000000.0;
 
-	addr = nla_data(attrs[BATADV_ATTR_TT_ADDRESS]);
-	orig = nla_data(attrs[BATADV_ATTR_ORIG_ADDRESS]);
+	return age >= state->snapshot_max_age;
+}
 
-	if (!attrs[BATADV_ATTR_FLAG_BEST])
-		return NL_OK;
+/* only the first entry for a key is kept - it is also the one which the
+ * lookup on the full dump returned before
+ */
+static int netlink_snapshot_add(struct netlink_snapshot_opts *opts,
+				void *entry)
+{
+	struct hashtable_t *swaphash;
 
-	if (memcmp(&opts->mac, addr, ETH_ALEN) != 0)
-		return NL_OK;
+	if (!opts->hash || hash_find(opts->hash, entry)) {
+		free(entry);
+		return 0;
+	}
 
-	memcpy(&opts->mac, orig, ETH_ALEN);
-	opts->found = true;
-	opts->query_opts.err = 0;
+	if (hash_add(opts->hash, entry) < 0) {
+		free(entry);
+		return -ENOMEM;
+	}
 
-	return NL_STOP;
+	if (opts->hash->elements * 4 > opts->hash->size) {
+		swaphash = hash_resize(opts->hash, opts->hash->size * 2);
+		if (swaphash)
+			opts->hash = swaphash;
+	}
+
+	return 0;
 }
 
-int translate_mac_netlink(const char *mesh_iface, const struct ether_addr *mac,
-			  struct ether_addr *mac_out)
+static int netlink_snapshot_refresh(struct state *state,
+				    struct netlink_snapshot **snapshot,
+				    uint8_t nl_cmd,
+				    netlink_dump_cb_t callback)
 {
-	struct translate_mac_netlink_opts opts = {
-		.found = false,
+	struct netlink_snapshot_opts opts = {
 		.query_opts = {
 			.err = 0,
 		},
 	};
+	struct netlink_snapshot *new_snapshot;
 	int ret;
 
-	memcpy(&opts.mac, mac, ETH_ALEN);
+	netlink_snapshot_free(*snapshot);
+	*snapshot = NULL;
 
-	ret = netlink_query_common(mesh_iface,
-				   BATADV_CMD_GET_TRANSTABLE_GLOBAL,
-			           translate_mac_netlink_cb, NLM_F_DUMP,
-				   &opts.query_opts);
-	if (ret < 0)
-		return ret;
+	new_snapshot = malloc(sizeof(*new_snapshot));
+	if (!new_snapshot)
+		return -ENOMEM;
 
-	if (!opts.found)
-		return -ENOENT;
+	opts.hash = hash_new(128, compare_mac, choose_mac);
+	if (!opts.hash) {
+		free(new_snapshot);
+		return -ENOMEM;
+	}
 
-	memcpy(mac_out, &opts.mac, ETH_ALEN);
+	ret = netlink_query_common(state, nl_cmd, callback, &opts.query_opts);
+	if (ret < 0) {
+		hash_delete(opts.hash, free);
+		free(new_snapshot);
+		return ret;
+	}
+
+	new_snapshot->hash = opts.hash;
+	clock_gettime(CLOCK_MONOTONIC, &new_snapshot->created);
+	*snapshot = new_snapshot;
 
 	return 0;
 }
 
-static const int get_nexthop_netlink_mandatory[] = {
-	BATADV_ATTR_ORIG_ADDRESS,
-	BATADV_ATTR_NEIGH_ADDRESS,
-	BATADV_ATTR_HARD_IFINDEX,
+/**
+ * netlink_snapshot_lookup - find entry in an indexed dump of a batadv table
+ * @state: state of the batctl process
+ * @snapshot: cached snapshot of the table
+ * @nl_cmd: dump command to (re)create the snapshot
+ * @callback: callback adding the dumped entries to the index
+ * @mac: key to search for
+ *
+ * The snapshot is recreated when it is older than state->snapshot_max_age
+ * or when the key cannot be found in an older snapshot. A negative max age
+ * keeps the first snapshot for all lookups.
+ *
+ * Return: found entry or NULL when it was not found or on error (*err set)
+ */
+static void *netlink_snapshot_lookup(struct state *state,
+				     struct netlink_snapshot **snapshot,
+				     uint8_t nl_cmd,
+				     netlink_dump_cb_t callback,
+				     const struct ether_addr *mac, int *err)
+{
+	struct ether_addr key;
+	bool refreshed = false;
+	void *entry;
+
+	*err = 0;
+	memcpy(&key, mac, sizeof(key));
+
+	if (netlink_snapshot_expired(state, *snapshot)) {
+		*err = netlink_snapshot_refresh(state, snapshot, nl_cmd,
+						callback);
+		if (*err < 0)
+			return NULL;
+
+		refreshed = true;
+	}
+
+	entry = hash_find((*snapshot)->hash, &key);
+	if (entry || refreshed || state->snapshot_max_age < 0)
+		return entry;
+
+	/* the entry may have been added after the snapshot was created */
+	*err = netlink_snapshot_refresh(state, snapshot, nl_cmd, callback);
+	if (*err < 0)
+		return NULL;
+
+	return hash_find((*snapshot)->hash, &key);
+}
+
+void netlink_snapshots_free(struct state *state)
+{
+	netlink_snapshot_free(state->tt_snapshot);
+	state->tt_snapshot = NULL;
+
+	netlink_snapshot_free(state->orig_snapshot);
+	state->orig_snapshot = NULL;
+}
+
+struct translate_mac_row {
+	const uint8_t *client;
+	const uint8_t *orig;
+	bool best;
 };
 
-struct get_nexthop_netlink_opts {
-	struct ether_addr mac;
-	uint8_t *nexthop;
-	char *ifname;
-	bool found;
-	struct nlquery_opts query_opts;
+static const struct netlink_attr_desc translate_mac_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_TT_ADDRESS, MAC,
+			 struct translate_mac_row, client),
+	NETLINK_ATTR_REQ(BATADV_ATTR_ORIG_ADDRESS, MAC,
+			 struct translate_mac_row, orig),
+	NETLINK_ATTR_OPT(BATADV_ATTR_FLAG_BEST, FLAG,
+			 struct translate_mac_row, best),
 };
 
-static int get_nexthop_netlink_cb(struct nl_msg *msg, void *arg)
+static int translate_mac_netlink_cb(struct nlmsghdr *nlh, void *arg)
 {
-	struct nlattr *attrs[BATADV_ATTR_MAX+1];
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct translate_mac_row row;
 	struct nlquery_opts *query_opts = arg;
-	struct get_nexthop_netlink_opts *opts;
+	struct netlink_snapshot_opts *opts;
+	struct tt_snapshot_entry *entry;
 	struct genlmsghdr *ghdr;
-	const uint8_t *orig;
-	const uint8_t *neigh;
-	uint32_t index;
-	const char *ifname;
+	int ret;
 
-	opts = container_of(query_opts, struct get_nexthop_netlink_opts,
+	opts = container_of(query_opts, struct netlink_snapshot_opts,
 			    query_opts);
 
 	if (!genlmsg_valid_hdr(nlh, 0))
@@ -705,88 +1708,81 @@ static int get_nexthop_netlink_cb(struct nl_msg *msg, void *arg)
 
 	ghdr = nlmsg_data(nlh);
 
-	if (ghdr->cmd != BATADV_CMD_GET_ORIGINATORS)
-		return NL_OK;
-
-	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
-		      genlmsg_len(ghdr), batadv_netlink_policy)) {
+	if (ghdr->cmd != BATADV_CMD_GET_TRANSTABLE_GLOBAL)
 		return NL_OK;
-	}
 
-	if (missing_mandatory_attrs(attrs, get_nexthop_netlink_mandatory,
-				    ARRAY_SIZE(get_nexthop_netlink_mandatory)))
+	if (netlink_decode_attrs(ghdr, translate_mac_attrs,
+				 ARRAY_SIZE(translate_mac_attrs),
+				 &row, sizeof(row), NULL) < 0)
 		return NL_OK;
 
-	orig = nla_data(attrs[BATADV_ATTR_ORIG_ADDRESS]);
-	neigh = nla_data(attrs[BATADV_ATTR_NEIGH_ADDRESS]);
-	index = nla_get_u32(attrs[BATADV_ATTR_HARD_IFINDEX]);
-
-	if (!attrs[BATADV_ATTR_FLAG_BEST])
+	if (!row.best)
 		return NL_OK;
 
-	if (memcmp(&opts->mac, orig, ETH_ALEN) != 0)
+	entry = malloc(sizeof(*entry));
+	if (!entry) {
+		query_opts->err = -ENOMEM;
 		return NL_OK;
+	}
 
-	/* save result */
-	memcpy(opts->nexthop, neigh, ETH_ALEN);
-	ifname = if_indextoname(index, opts->ifname);
-	if (!ifname)
-		return NL_OK;
+	memcpy(&entry->client, row.client, ETH_ALEN);
+	memcpy(&entry->orig, row.orig, ETH_ALEN);
 
-	opts->found = true;
-	opts->query_opts.err = 0;
+	ret = netlink_snapshot_add(opts, entry);
+	if (ret < 0)
+		query_opts->err = ret;
 
-	return NL_STOP;
+	return NL_OK;
 }
 
-int get_nexthop_netlink(const char *mesh_iface, const struct ether_addr *mac,
-			uint8_t *nexthop, char *ifname)
+int translate_mac_netlink(struct state *state, const struct ether_addr *mac,
+			  struct ether_addr *mac_out)
 {
-	struct get_nexthop_netlink_opts opts = {
-		.nexthop = 0,
-		.found = false,
-		.query_opts = {
-			.err = 0,
-		},
-	};
+	struct tt_snapshot_entry *entry;
 	int ret;
 
-	memcpy(&opts.mac, mac, ETH_ALEN);
-	opts.nexthop = nexthop;
-	opts.ifname = ifname;
-
-	ret = netlink_query_common(mesh_iface,  BATADV_CMD_GET_ORIGINATORS,
-			           get_nexthop_netlink_cb, NLM_F_DUMP,
-				   &opts.query_opts);
+	entry = netlink_snapshot_lookup(state, &state->tt_snapshot,
+					BATADV_CMD_GET_TRANSTABLE_GLOBAL,
+					translate_mac_netlink_cb, mac, &ret);
 	if (ret < 0)
 		return ret;
 
-	if (!opts.found)
+	if (!entry)
 		return -ENOENT;
 
+	memcpy(mac_out, &entry->orig, ETH_ALEN);
+
 	return 0;
 }
 
-static const int get_primarymac_netlink_mandatory[] = {
-	BATADV_ATTR_HARD_ADDRESS,
+struct get_nexthop_row {
+	const uint8_t *orig;
+	const uint8_t *neigh;
+	uint32_t hard_ifindex;
+	bool best;
 };
 
-struct get_primarymac_netlink_opts {
-	uint8_t *primarymac;
-	bool found;
-	struct nlquery_opts query_opts;
+static const struct netlink_attr_desc get_nexthop_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_ORIG_ADDRESS, MAC,
+			 struct get_nexthop_row, orig),
+	NETLINK_ATTR_REQ(BATADV_ATTR_NEIGH_ADDRESS, MAC,
+			 struct get_nexthop_row, neigh),
+	NETLINK_ATTR_REQ(BATADV_ATTR_HARD_IFINDEX, U32,
+			 struct get_nexthop_row, hard_ifindex),
+	NETLINK_ATTR_OPT(BATADV_ATTR_FLAG_BEST, FLAG,
+			 struct get_nexthop_row, best),
 };
 
-static int get_primarymac_netlink_cb(struct nl_msg *msg, void *arg)
+static int get_nexthop_netlink_cb(struct nlmsghdr *nlh, void *arg)
 {
-	struct nlattr *attrs[BATADV_ATTR_MAX+1];
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct get_nexthop_row row;
 	struct nlquery_opts *query_opts = arg;
-	struct get_primarymac_netlink_opts *opts;
+	struct netlink_snapshot_opts *opts;
+	struct orig_snapshot_entry *entry;
 	struct genlmsghdr *ghdr;
-	const uint8_t *primary_mac;
+	int ret;
 
-	opts = container_of(query_opts, struct get_primarymac_netlink_opts,
+	opts = container_of(query_opts, struct netlink_snapshot_opts,
 			    query_opts);
 
 	if (!genlmsg_valid_hdr(nlh, 0))
@@ -794,50 +1790,74 @@ static int get_primarymac_netlink_cb(struct nl_msg *msg, void *arg)
 
 	ghdr = nlmsg_data(nlh);
 
-	if (ghdr->cmd != BATADV_CMD_GET_MESH_INFO)
+	if (ghdr->cmd != BATADV_CMD_GET_ORIGINATORS)
 		return NL_OK;
 
-	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
-		      genlmsg_len(ghdr), batadv_netlink_policy)) {
+	if (netlink_decode_attrs(ghdr, get_nexthop_attrs,
+				 ARRAY_SIZE(get_nexthop_attrs),
+				 &row, sizeof(row), NULL) < 0)
 		return NL_OK;
-	}
 
-	if (missing_mandatory_attrs(attrs, get_primarymac_netlink_mandatory,
-				    ARRAY_SIZE(get_primarymac_netlink_mandatory)))
+	if (!row.best)
 		return NL_OK;
 
-	primary_mac = nla_data(attrs[BATADV_ATTR_HARD_ADDRESS]);
+	entry = malloc(sizeof(*entry));
+	if (!entry) {
+		query_opts->err = -ENOMEM;
+		return NL_OK;
+	}
 
-	/* save result */
-	memcpy(opts->primarymac, primary_mac, ETH_ALEN);
+	memcpy(&entry->orig, row.orig, ETH_ALEN);
+	memcpy(entry->nexthop, row.neigh, ETH_ALEN);
+	entry->hard_ifindex = row.hard_ifindex;
 
-	opts->found = true;
-	opts->query_opts.err = 0;
+	ret = netlink_snapshot_add(opts, entry);
+	if (ret < 0)
+		query_opts->err = ret;
 
-	return NL_STOP;
+	return NL_OK;
 }
 
-int get_primarymac_netlink(const char *mesh_iface, uint8_t *primarymac)
+int get_nexthop_netlink(struct state *state, const struct ether_addr *mac,
+			uint8_t *nexthop, char *ifname)
 {
-	struct get_primarymac_netlink_opts opts = {
-		.primarymac = 0,
-		.found = false,
-		.query_opts = {
-			.err = 0,
-		},
-	};
+	struct orig_snapshot_entry *entry;
 	int ret;
 
-	opts.primarymac = primarymac;
-
-	ret = netlink_query_common(mesh_iface, BATADV_CMD_GET_MESH_INFO,
-			           get_primarymac_netlink_cb, 0,
-				   &opts.query_opts);
+	entry = netlink_snapshot_lookup(state, &state->orig_snapshot,
+					BATADV_CMD_GET_ORIGINATORS,
+					get_nexthop_netlink_cb, mac, &ret);
 	if (ret < 0)
 		return ret;
 
-	if (!opts.found)
+	if (!entry)
+		return -ENOENT;
+
+	if (!if_indextoname(entry->hard_ifindex, ifname))
 		return -ENOENT;
 
+	memcpy(nexthop, entry->nexthop, ETH_ALEN);
+
+	return 0;
+}
+
+int get_primarymac_netlink(struct state *state, uint8_t *primarymac)
+{
+	const struct netlink_mesh_info *info;
+	int ifindex;
+
+	if (!state->sock)
+		return -EOPNOTSUPP;
+
+	ifindex = if_nametoindex(state->mesh_iface);
+	if (!ifindex)
+		return -ENODEV;
+
+	info = netlink_get_mesh_info(state, ifindex, true);
+	if (!info || !info->enabled)
+		return -ENOENT;
+
+	memcpy(primarymac, info->primary_mac, ETH_ALEN);
+
 	return 0;
 }
@@ -25,50 +25,168 @@
 
 #include <netlink/genl/genl.h>
 #include <netlink/genl/ctrl.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
+#include "output.h"
+
+struct filter;
+struct group;
+struct hashtable_t;
+struct sort;
 struct state;
 
+/* receive buffer of the socket and buffers for a single recvmmsg() call.
+ * The kernel never creates dump skbs larger than 32KiB
+ */
+#define NETLINK_DUMP_RCVBUF (4 * 1024 * 1024)
+#define NETLINK_DUMP_MSG_SIZE (32 * 1024)
+#define NETLINK_DUMP_BATCH 16
+
+struct netlink_dump_buf {
+	struct mmsghdr msgs[NETLINK_DUMP_BATCH];
+	struct iovec iov[NETLINK_DUMP_BATCH];
+	uint8_t data[NETLINK_DUMP_BATCH][NETLINK_DUMP_MSG_SIZE];
+};
+
+typedef int (*netlink_dump_cb_t)(struct nlmsghdr *nlh, void *arg);
+
+/* default maximum age (in seconds) of the indexed originator/TT dumps */
+#define NETLINK_SNAPSHOT_MAX_AGE 5.0
+
+struct netlink_mesh_info {
+	int ifindex;
+	bool enabled;
+	char mesh_name[IF_NAMESIZE];
+	uint8_t mesh_mac[ETH_ALEN];
+	char version[64];
+	char algo_name[64];
+	char primary_if[IF_NAMESIZE];
+	uint8_t primary_mac[ETH_ALEN];
+	uint8_t ttvn;
+	uint16_t bla_group_id;
+	int64_t mcast_flags;
+	int64_t mcast_flags_priv;
+};
+
 struct print_opts {
 	int read_opt;
 	float orig_timeout;
 	float watch_interval;
-	nl_recvmsg_msg_cb_t callback;
-	char *remaining_header;
+	netlink_dump_cb_t callback;
+	const char *remaining_header;
 	const char *static_header;
 	uint8_t nl_cmd;
+	struct filter *filter;
+	struct group *group;
+	struct sort *sort;
+
+	struct output out;
+
+	/* delta mode (DELTA_READ) */
+	struct hashtable_t *delta_hash;
+	struct output row;
 };
 
+/* how a debug table is dumped - filled by netlink_print_common() instead of
+ * dumping the table while state->table_probe is set
+ */
+struct netlink_table_probe {
+	char *header;
+	uint8_t nl_cmd;
+	netlink_dump_cb_t callback;
+};
+
+/* type of the destination field of a decoded attribute */
+enum netlink_attr_kind {
+	NETLINK_ATTR_NONE,
+	NETLINK_ATTR_FLAG,	/* bool */
+	NETLINK_ATTR_U8,	/* uint8_t */
+	NETLINK_ATTR_U16,	/* uint16_t */
+	NETLINK_ATTR_U32,	/* uint32_t */
+	NETLINK_ATTR_U64,	/* uint64_t */
+	NETLINK_ATTR_MAC,	/* const uint8_t *, ETH_ALEN bytes */
+	NETLINK_ATTR_STRING,	/* const char *, NUL terminated */
+};
+
+struct netlink_attr_desc {
+	uint16_t type;
+	uint8_t kind;
+	bool mandatory;
+	uint16_t offset;
+};
+
+#define NETLINK_ATTR_REQ(_type, _kind, _row, _member) \
+	{ .type = (_type), .kind = NETLINK_ATTR_ ## _kind, .mandatory = true, \
+	  .offset = offsetof(_row, _member) }
+
+#define NETLINK_ATTR_OPT(_type, _kind, _row, _member) \
+	{ .type = (_type), .kind = NETLINK_ATTR_ ## _kind, .mandatory = false, \
+	  .offset = offsetof(_row, _member) }
+
+/* bitmask of the BATADV_ATTR_* found by netlink_decode_attrs() */
+typedef uint64_t netlink_attr_mask_t;
+
+#define NETLINK_ATTR_BIT(_type) ((netlink_attr_mask_t)1 << (_type))
+
 struct ether_addr;
 
 int netlink_create(struct state *state);
 void netlink_destroy(struct state *state);
 
-char *netlink_get_info(int ifindex, uint8_t nl_cmd, const char *header);
-int translate_mac_netlink(const char *mesh_iface, const struct ether_addr *mac,
+const struct netlink_mesh_info *netlink_get_mesh_info(struct state *state,
+						      int ifindex,
+						      bool refresh);
+int netlink_get_info(struct state *state, int ifindex, uint8_t nl_cmd,
+		     const char *header, struct output *out);
+int translate_mac_netlink(struct state *state, const struct ether_addr *mac,
 			  struct ether_addr *mac_out);
-int get_nexthop_netlink(const char *mesh_iface, const struct ether_addr *mac,
+int get_nexthop_netlink(struct state *state, const struct ether_addr *mac,
 			uint8_t *nexthop, char *ifname);
-int get_primarymac_netlink(const char *mesh_iface, uint8_t *primarymac);
+int get_primarymac_netlink(struct state *state, uint8_t *primarymac);
+void netlink_snapshots_free(struct state *state);
 
 extern struct nla_policy batadv_netlink_policy[];
 
 int missing_mandatory_attrs(struct nlattr *attrs[], const int mandatory[],
 			    int num);
+int netlink_decode_attrs(struct genlmsghdr *ghdr,
+			 const struct netlink_attr_desc *desc, size_t num,
+			 void *row, size_t row_len,
+			 netlink_attr_mask_t *present);
+int netlink_attr_lookup(const char *name);
+int netlink_attr_value(const struct netlink_attr_desc *desc, const void *row,
+		       netlink_attr_mask_t present, long long *val);
+void netlink_print_record(struct print_opts *opts,
+			  const struct netlink_attr_desc *desc, size_t num,
+			  const void *row, netlink_attr_mask_t present);
 int netlink_print_common(struct state *state, char *orig_iface, int read_opt,
 			 float orig_timeout, float watch_interval,
 			 const char *header, uint8_t nl_cmd,
-			 nl_recvmsg_msg_cb_t callback);
+			 netlink_dump_cb_t callback);
 
-int netlink_print_common_cb(struct nl_msg *msg, void *arg);
-int netlink_stop_callback(struct nl_msg *msg, void *arg);
+void netlink_dump_sock_setup(struct nl_sock *sock);
+struct netlink_dump_buf *netlink_dump_buf_alloc(void);
+void netlink_dump_buf_free(struct netlink_dump_buf *buf);
+int netlink_dump_recv(struct nl_sock *sock, struct netlink_dump_buf *buf,
+		      uint32_t seq, netlink_dump_cb_t callback, void *arg,
+		      int *nl_err);
+int netlink_dump(struct nl_sock *sock, struct netlink_dump_buf *buf,
+		 int family, int ifindex, uint8_t nl_cmd,
+		 netlink_dump_cb_t callback, void *arg);
+int netlink_print_common_cb(struct nlmsghdr *nlh, void *arg);
 int netlink_print_error(struct sockaddr_nl *nla, struct nlmsgerr *nlerr,
 			void *arg);
 void netlink_print_remaining_header(struct print_opts *opts);
+struct output *netlink_row_begin(struct print_opts *opts);
+void netlink_row_end(struct print_opts *opts, const void *key, size_t key_len,
+		     const void *value, size_t value_len);
 
-extern char algo_name_buf[256];
 extern int last_err;
-extern int64_t mcast_flags;
-extern int64_t mcast_flags_priv;
 
 #endif /* _BATCTL_NETLINK_H */
@@ -36,32 +36,64 @@
 #include "batman_adv.h"
 #include "bat-hosts.h"
 #include "debug.h"
+#include "filter.h"
 #include "functions.h"
+#include "group.h"
 #include "main.h"
 #include "netlink.h"
+#include "sort.h"
+
+struct originators_row {
+	const uint8_t *orig;
+	const uint8_t *neigh;
+	uint32_t hard_ifindex;
+	uint32_t last_seen_msecs;
+	uint32_t throughput;
+	uint8_t tq;
+	bool best;
+};
 
-static const int originators_mandatory[] = {
-	BATADV_ATTR_ORIG_ADDRESS,
-	BATADV_ATTR_NEIGH_ADDRESS,
-	BATADV_ATTR_HARD_IFINDEX,
-	BATADV_ATTR_LAST_SEEN_MSECS,
+static const struct netlink_attr_desc originators_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_ORIG_ADDRESS, MAC,
+			 struct originators_row, orig),
+	NETLINK_ATTR_REQ(BATADV_ATTR_NEIGH_ADDRESS, MAC,
+			 struct originators_row, neigh),
+	NETLINK_ATTR_REQ(BATADV_ATTR_HARD_IFINDEX, U32,
+			 struct originators_row, hard_ifindex),
+	NETLINK_ATTR_REQ(BATADV_ATTR_LAST_SEEN_MSECS, U32,
+			 struct originators_row, last_seen_msecs),
+	NETLINK_ATTR_OPT(BATADV_ATTR_TQ, U8,
+			 struct originators_row, tq),
+	NETLINK_ATTR_OPT(BATADV_ATTR_THROUGHPUT, U32,
+			 struct originators_row, throughput),
+	NETLINK_ATTR_OPT(BATADV_ATTR_FLAG_BEST, FLAG,
+			 struct originators_row, best),
 };
 
-static int originators_callback(struct nl_msg *msg, void *arg)
+static int originators_callback(struct nlmsghdr *nlh, void *arg)
 {
 	unsigned throughput_mbits, throughput_kbits;
-	struct nlattr *attrs[BATADV_ATTR_MAX+1];
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
-	int last_seen_msecs, last_seen_secs;
+	struct originators_row row;
+	netlink_attr_mask_t present;
 	struct print_opts *opts = arg;
-	struct bat_host *bat_host;
 	struct genlmsghdr *ghdr;
 	char ifname[IF_NAMESIZE];
+	const uint8_t *neigh;
+	const uint8_t *orig;
 	float last_seen;
-	uint8_t *neigh;
-	uint8_t *orig;
 	char c = ' ';
-	uint8_t tq;
+	int ret;
+	struct {
+		uint8_t orig[ETH_ALEN];
+		uint8_t neigh[ETH_ALEN];
+		uint32_t hard_ifindex;
+	} key;
+	struct {
+		uint32_t throughput;
+		uint8_t tq;
+		uint8_t best;
+	} value;
+	struct output *out;
 
 	if (!genlmsg_valid_hdr(nlh, 0)) {
 		fputs("Received invalid data from kernel.\n", stderr);
@@ -73,109 +105,97 @@ static int originators_callback(struct nl_msg *msg, void *arg)
 	if (ghdr->cmd != BATADV_CMD_GET_ORIGINATORS)
 		return NL_OK;
 
-	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
-		      genlmsg_len(ghdr), batadv_netlink_policy)) {
+	ret = netlink_decode_attrs(ghdr, originators_attrs,
+				   ARRAY_SIZE(originators_attrs),
+				   &row, sizeof(row), &present);
+	if (ret == -ENOENT) {
+		fputs("Missing attributes from kernel\n", stderr);
+		exit(1);
+	} else if (ret < 0) {
 		fputs("Received invalid data from kernel.\n", stderr);
 		exit(1);
 	}
 
-	if (missing_mandatory_attrs(attrs, originators_mandatory,
-				       ARRAY_SIZE(originators_mandatory))) {
-		fputs("Missing attributes from kernel\n", stderr);
-		exit(1);
-	}
+	if (!filter_match(opts->filter, originators_attrs,
+			  ARRAY_SIZE(originators_attrs), &row, present))
+		return NL_OK;
 
-	orig = nla_data(attrs[BATADV_ATTR_ORIG_ADDRESS]);
-	neigh = nla_data(attrs[BATADV_ATTR_NEIGH_ADDRESS]);
+	orig = row.orig;
+	neigh = row.neigh;
 
-	if (!if_indextoname(nla_get_u32(attrs[BATADV_ATTR_HARD_IFINDEX]),
-			    ifname))
+	if (!if_indextoname(row.hard_ifindex, ifname))
 		ifname[0] = '\0';
 
-	if (attrs[BATADV_ATTR_FLAG_BEST])
+	if (row.best)
 		c = '*';
 
-	last_seen_msecs = nla_get_u32(attrs[BATADV_ATTR_LAST_SEEN_MSECS]);
-	last_seen = (float)last_seen_msecs / 1000.0;
-	last_seen_secs = last_seen_msecs / 1000;
-	last_seen_msecs = last_seen_msecs % 1000;
+	last_seen = (float)row.last_seen_msecs / 1000.0;
 
 	/* skip timed out originators */
 	if (opts->read_opt & NO_OLD_ORIGS)
 		if (last_seen > opts->orig_timeout)
 			return NL_OK;
 
-	if (attrs[BATADV_ATTR_THROUGHPUT]) {
-		throughput_kbits = nla_get_u32(attrs[BATADV_ATTR_THROUGHPUT]);
+	if (group_add(opts->group, originators_attrs,
+		      ARRAY_SIZE(originators_attrs), &row, present))
+		return NL_OK;
+
+	if (sort_add(opts->sort, nlh, originators_attrs,
+		     ARRAY_SIZE(originators_attrs), &row, present))
+		return NL_OK;
+
+	if (opts->out.format != OUTPUT_FORMAT_TEXT) {
+		netlink_print_record(opts, originators_attrs,
+				     ARRAY_SIZE(originators_attrs), &row, present);
+		return NL_OK;
+	}
+
+	if (!(present & (NETLINK_ATTR_BIT(BATADV_ATTR_THROUGHPUT) |
+			 NETLINK_ATTR_BIT(BATADV_ATTR_TQ))))
+		return NL_OK;
+
+	out = netlink_row_begin(opts);
+
+	output_char(out, ' ');
+	output_char(out, c);
+	output_char(out, ' ');
+	output_host(out, orig, opts->read_opt);
+	output_char(out, ' ');
+	output_seconds(out, row.last_seen_msecs, 4);
+	output_str(out, "s ");
+
+	if (present & NETLINK_ATTR_BIT(BATADV_ATTR_THROUGHPUT)) {
+		throughput_kbits = row.throughput;
 		throughput_mbits = throughput_kbits / 1000;
 		throughput_kbits = throughput_kbits % 1000;
 
-		if (!(opts->read_opt & USE_BAT_HOSTS)) {
-			printf(" %c %02x:%02x:%02x:%02x:%02x:%02x %4i.%03is (%9u.%1u) %02x:%02x:%02x:%02x:%02x:%02x [%10s]\n",
-			       c,
-			       orig[0], orig[1], orig[2],
-			       orig[3], orig[4], orig[5],
-			       last_seen_secs, last_seen_msecs,
-			       throughput_mbits, throughput_kbits / 100,
-			       neigh[0], neigh[1], neigh[2],
-			       neigh[3], neigh[4], neigh[5],
-			       ifname);
-		} else {
-			bat_host = bat_hosts_find_by_mac((char *)orig);
-			if (bat_host)
-				printf(" %c %17s ", c, bat_host->name);
-			else
-				printf(" %c %02x:%02x:%02x:%02x:%02x:%02x ",
-				       c,
-				       orig[0], orig[1], orig[2],
-				       orig[3], orig[4], orig[5]);
-			printf("%4i.%03is (%9u.%1u) ",
-			       last_seen_secs, last_seen_msecs,
-			       throughput_mbits, throughput_kbits / 100);
-			bat_host = bat_hosts_find_by_mac((char *)neigh);
-			if (bat_host)
-				printf(" %c %17s ", c, bat_host->name);
-			else
-				printf(" %02x:%02x:%02x:%02x:%02x:%02x ",
-				       neigh[0], neigh[1], neigh[2],
-				       neigh[3], neigh[4], neigh[5]);
-			printf("[%10s]\n", ifname);
-		}
-	}
-	if (attrs[BATADV_ATTR_TQ]) {
-		tq = nla_get_u8(attrs[BATADV_ATTR_TQ]);
-
-		if (!(opts->read_opt & USE_BAT_HOSTS)) {
-			printf(" %c %02x:%02x:%02x:%02x:%02x:%02x %4i.%03is   (%3i) %02x:%02x:%02x:%02x:%02x:%02x [%10s]\n",
-			       c,
-			       orig[0], orig[1], orig[2],
-			       orig[3], orig[4], orig[5],
-			       last_seen_secs, last_seen_msecs, tq,
-			       neigh[0], neigh[1], neigh[2],
-			       neigh[3], neigh[4], neigh[5],
-			       ifname);
-		} else {
-			bat_host = bat_hosts_find_by_mac((char *)orig);
-			if (bat_host)
-				printf(" %c %17s ", c, bat_host->name);
-			else
-				printf(" %c %02x:%02x:%02x:%02x:%02x:%02x ",
-				       c,
-				       orig[0], orig[1], orig[2],
-				       orig[3], orig[4], orig[5]);
-			printf("%4i.%03is   (%3i) ",
-			       last_seen_secs, last_seen_msecs, tq);
-			bat_host = bat_hosts_find_by_mac((char *)neigh);
-			if (bat_host)
-				printf("%17s ", bat_host->name);
-			else
-				printf("%02x:%02x:%02x:%02x:%02x:%02x ",
-				       neigh[0], neigh[1], neigh[2],
-				       neigh[3], neigh[4], neigh[5]);
-			printf("[%10s]\n", ifname);
-		}
+		output_char(out, '(');
+		output_uint(out, throughput_mbits, 9);
+		output_char(out, '.');
+		output_uint(out, throughput_kbits / 100, 1);
+	} else {
+		output_str(out, "  (");
+		output_uint(out, row.tq, 3);
 	}
 
+	output_str(out, ") ");
+	output_host(out, neigh, opts->read_opt);
+	output_str(out, " [");
+	output_str_right(out, ifname, 10);
+	output_str(out, "]\n");
+
+	memset(&key, 0, sizeof(key));
+	memcpy(key.orig, orig, ETH_ALEN);
+	memcpy(key.neigh, neigh, ETH_ALEN);
+	key.hard_ifindex = row.hard_ifindex;
+
+	memset(&value, 0, sizeof(value));
+	value.best = row.best;
+	value.throughput = row.throughput;
+	value.tq = row.tq;
+
+	netlink_row_end(opts, &key, sizeof(key), &value, sizeof(value));
+
 	return NL_OK;
 }
 
@@ -184,7 +204,7 @@ static int netlink_print_originators(struct state *state, char *orig_iface,
 				     float watch_interval)
 {
 	char *header = NULL;
-	char *info_header;
+	const struct netlink_mesh_info *info;
 	int ifindex;
 
 	ifindex = if_nametoindex(state->mesh_iface);
@@ -195,15 +215,13 @@ static int netlink_print_originators(struct state *state, char *orig_iface,
 
 	/* only parse routing algorithm name */
 	last_err = -EINVAL;
-	info_header = netlink_get_info(ifindex, BATADV_CMD_GET_ORIGINATORS, NULL);
-	free(info_header);
-
-	if (strlen(algo_name_buf) == 0)
+	info = netlink_get_mesh_info(state, ifindex, false);
+	if (!info || strlen(info->algo_name) == 0)
 		return last_err;
 
-	if (!strcmp("BATMAN_IV", algo_name_buf))
+	if (!strcmp("BATMAN_IV", info->algo_name))
 		header = "   Originator        last-seen (#/255) Nexthop           [outgoingIF]\n";
-	if (!strcmp("BATMAN_V", algo_name_buf))
+	if (!strcmp("BATMAN_V", info->algo_name))
 		header = "   Originator        last-seen ( throughput)  Nexthop           [outgoingIF]\n";
 
 	if (!header)
@@ -219,6 +237,8 @@ static struct debug_table_data batctl_debug_table_originators = {
 	.debugfs_name = "originators",
 	.header_lines = 2,
 	.netlink_fn = netlink_print_originators,
+	.nl_cmd = BATADV_CMD_GET_ORIGINATORS,
+	.netlink_cb = originators_callback,
 	.option_timeout_interval = 1,
 	.option_orig_iface = 1,
 };
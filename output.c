@@ -0,0 +1,507 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bat-hosts.h"
+#include "functions.h"
+#include "output.h"
+
+#define HEX2(x) \
+	"0123456789abcdef"[((x) >> 4) & 0xf], "0123456789abcdef"[(x) & 0xf]
+#define HEX_ROW(h) \
+	{ HEX2(h + 0x0) }, { HEX2(h + 0x1) }, { HEX2(h + 0x2) }, \
+	{ HEX2(h + 0x3) }, { HEX2(h + 0x4) }, { HEX2(h + 0x5) }, \
+	{ HEX2(h + 0x6) }, { HEX2(h + 0x7) }, { HEX2(h + 0x8) }, \
+	{ HEX2(h + 0x9) }, { HEX2(h + 0xa) }, { HEX2(h + 0xb) }, \
+	{ HEX2(h + 0xc) }, { HEX2(h + 0xd) }, { HEX2(h + 0xe) }, \
+	{ HEX2(h + 0xf) }
+
+/* two lowercase hex digits for every byte value */
+static const char hex_lut[256][2] = {
+	HEX_ROW(0x00), HEX_ROW(0x10), HEX_ROW(0x20), HEX_ROW(0x30),
+	HEX_ROW(0x40), HEX_ROW(0x50), HEX_ROW(0x60), HEX_ROW(0x70),
+	HEX_ROW(0x80), HEX_ROW(0x90), HEX_ROW(0xa0), HEX_ROW(0xb0),
+	HEX_ROW(0xc0), HEX_ROW(0xd0), HEX_ROW(0xe0), HEX_ROW(0xf0),
+};
+
+int output_init(struct output *out, int fd, size_t size)
+{
+	out->fd = fd;
+	out->len = 0;
+	out->size = size;
+	out->format = OUTPUT_FORMAT_TEXT;
+	out->fields = 0;
+	out->csv_header = false;
+	out->csv_values = NULL;
+	out->buf = malloc(size);
+	if (!out->buf) {
+		out->size = 0;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void output_free(struct output *out)
+{
+	output_flush(out);
+
+	if (out->csv_values) {
+		output_free(out->csv_values);
+		free(out->csv_values);
+		out->csv_values = NULL;
+	}
+
+	free(out->buf);
+	out->buf = NULL;
+	out->size = 0;
+}
+
+/* write everything in one go - stdio buffers of the same fd are flushed
+ * first to keep the order of the output
+ */
+void output_flush(struct output *out)
+{
+	size_t pos = 0;
+	ssize_t ret;
+
+	if (out->fd < 0 || !out->len)
+		return;
+
+	fflush(stdout);
+
+	while (pos < out->len) {
+		ret = write(out->fd, out->buf + pos, out->len - pos);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			break;
+		}
+
+		pos += ret;
+	}
+
+	out->len = 0;
+}
+
+int output_make_room(struct output *out, size_t len)
+{
+	size_t size;
+	char *buf;
+
+	if (out->fd >= 0) {
+		output_flush(out);
+		if (len <= out->size)
+			return 0;
+	}
+
+	size = out->size ? out->size : 256;
+	while (size < out->len + len)
+		size *= 2;
+
+	buf = realloc(out->buf, size);
+	if (!buf)
+		return -ENOMEM;
+
+	out->buf = buf;
+	out->size = size;
+
+	return 0;
+}
+
+void output_str(struct output *out, const char *str)
+{
+	output_mem(out, str, strlen(str));
+}
+
+/* like "%*s" */
+void output_str_right(struct output *out, const char *str, int width)
+{
+	size_t len = strlen(str);
+
+	output_spaces(out, width - (int)len);
+	output_mem(out, str, len);
+}
+
+/* like "%-*s" */
+void output_str_left(struct output *out, const char *str, int width)
+{
+	size_t len = strlen(str);
+
+	output_mem(out, str, len);
+	output_spaces(out, width - (int)len);
+}
+
+static void output_digits(struct output *out, unsigned long long val,
+			  int width, char pad, const char *sign)
+{
+	char digits[24];
+	int pos = sizeof(digits);
+	int len;
+
+	do {
+		digits[--pos] = '0' + val % 10;
+		val /= 10;
+	} while (val);
+
+	len = sizeof(digits) - pos + (sign ? 1 : 0);
+
+	if (pad == ' ')
+		output_spaces(out, width - len);
+
+	if (sign)
+		output_char(out, *sign);
+
+	while (pad == '0' && width-- > len)
+		output_char(out, '0');
+
+	output_mem(out, digits + pos, sizeof(digits) - pos);
+}
+
+/* like "%*u" */
+void output_uint(struct output *out, unsigned long long val, int width)
+{
+	output_digits(out, val, width, ' ', NULL);
+}
+
+/* like "%0*u" */
+void output_uint_zero(struct output *out, unsigned long long val, int width)
+{
+	output_digits(out, val, width, '0', NULL);
+}
+
+/* like "%*i" */
+void output_int(struct output *out, long long val, int width)
+{
+	if (val < 0)
+		output_digits(out, -(unsigned long long)val, width, ' ', "-");
+	else
+		output_digits(out, val, width, ' ', NULL);
+}
+
+/* like "%0*x" */
+void output_hex(struct output *out, uint32_t val, int digits)
+{
+	char hex[8];
+	int i;
+
+	if (digits > 8)
+		digits = 8;
+
+	for (i = digits - 1; i >= 0; i--) {
+		hex[i] = "0123456789abcdef"[val & 0xf];
+		val >>= 4;
+	}
+
+	output_mem(out, hex, digits);
+}
+
+/* like "%*u.%03u" of seconds and milliseconds */
+void output_seconds(struct output *out, uint32_t msecs, int width)
+{
+	output_uint(out, msecs / 1000, width);
+	output_char(out, '.');
+	output_uint_zero(out, msecs % 1000, 3);
+}
+
+void output_mac(struct output *out, const uint8_t *mac)
+{
+	char str[17];
+	int i;
+
+	for (i = 0; i < 6; i++) {
+		str[i * 3] = hex_lut[mac[i]][0];
+		str[i * 3 + 1] = hex_lut[mac[i]][1];
+		if (i < 5)
+			str[i * 3 + 2] = ':';
+	}
+
+	output_mem(out, str, sizeof(str));
+}
+
+/* 17 character wide column with the bat-host name or the mac address */
+void output_host(struct output *out, const uint8_t *mac, int read_opt)
+{
+	struct bat_host *bat_host;
+
+	if (read_opt & USE_BAT_HOSTS) {
+		bat_host = bat_hosts_find_by_mac((char *)mac);
+		if (bat_host) {
+			output_str_right(out, bat_host->name, 17);
+			return;
+		}
+	}
+
+	output_mac(out, mac);
+}
+
+void output_printf(struct output *out, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(out->buf + out->len, out->size - out->len, fmt, args);
+	va_end(args);
+
+	if (len < 0 || (size_t)len < out->size - out->len) {
+		if (len > 0)
+			out->len += len;
+		return;
+	}
+
+	if (output_make_room(out, len + 1) < 0)
+		return;
+
+	va_start(args, fmt);
+	len = vsnprintf(out->buf + out->len, out->size - out->len, fmt, args);
+	va_end(args);
+
+	if (len > 0)
+		out->len += len;
+}
+
+int output_parse_format(const char *name, enum output_format *format)
+{
+	if (strcmp(name, "text") == 0)
+		*format = OUTPUT_FORMAT_TEXT;
+	else if (strcmp(name, "json") == 0)
+		*format = OUTPUT_FORMAT_JSON;
+	else if (strcmp(name, "csv") == 0)
+		*format = OUTPUT_FORMAT_CSV;
+	else
+		return -EINVAL;
+
+	return 0;
+}
+
+/* header: print a line with the field names before the first csv record */
+void output_set_format(struct output *out, enum output_format format,
+		       bool header)
+{
+	out->format = format;
+	out->csv_header = format == OUTPUT_FORMAT_CSV && header;
+}
+
+static void output_json_str(struct output *out, const char *str)
+{
+	unsigned char c;
+
+	output_char(out, '"');
+
+	for (; *str; str++) {
+		c = *str;
+
+		switch (c) {
+		case '"':
+		case '\\':
+			output_char(out, '\\');
+			output_char(out, c);
+			break;
+		case '\n':
+			output_str(out, "\\n");
+			break;
+		case '\t':
+			output_str(out, "\\t");
+			break;
+		default:
+			if (c < 0x20) {
+				output_str(out, "\\u00");
+				output_hex(out, c, 2);
+			} else {
+				output_char(out, c);
+			}
+			break;
+		}
+	}
+
+	output_char(out, '"');
+}
+
+static void output_csv_str(struct output *out, const char *str)
+{
+	if (!str[strcspn(str, ",\"\r\n")]) {
+		output_str(out, str);
+		return;
+	}
+
+	output_char(out, '"');
+
+	for (; *str; str++) {
+		if (*str == '"')
+			output_char(out, '"');
+
+		output_char(out, *str);
+	}
+
+	output_char(out, '"');
+}
+
+void output_record_begin(struct output *out)
+{
+	out->fields = 0;
+
+	switch (out->format) {
+	case OUTPUT_FORMAT_JSON:
+		output_char(out, '{');
+		break;
+	case OUTPUT_FORMAT_CSV:
+		if (!out->csv_header)
+			break;
+
+		/* the field names are only known once the first record is
+		 * written - its values are collected separately meanwhile
+		 */
+		out->csv_values = malloc(sizeof(*out->csv_values));
+		if (!out->csv_values ||
+		    output_init(out->csv_values, -1, 256) < 0) {
+			free(out->csv_values);
+			out->csv_values = NULL;
+			out->csv_header = false;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void output_record_end(struct output *out)
+{
+	switch (out->format) {
+	case OUTPUT_FORMAT_JSON:
+		output_str(out, "}\n");
+		break;
+	case OUTPUT_FORMAT_CSV:
+		if (out->csv_values) {
+			output_char(out, '\n');
+			output_mem(out, out->csv_values->buf,
+				   out->csv_values->len);
+			output_free(out->csv_values);
+			free(out->csv_values);
+			out->csv_values = NULL;
+			out->csv_header = false;
+		}
+
+		output_char(out, '\n');
+		break;
+	default:
+		break;
+	}
+}
+
+/* writes the name (json) or separator (csv) of the next field and returns
+ * the output which receives its value
+ */
+static struct output *output_field_begin(struct output *out, const char *name)
+{
+	struct output *values = out;
+
+	switch (out->format) {
+	case OUTPUT_FORMAT_JSON:
+		if (out->fields)
+			output_char(out, ',');
+
+		output_json_str(out, name);
+		output_char(out, ':');
+		break;
+	case OUTPUT_FORMAT_CSV:
+		if (out->csv_values) {
+			if (out->fields)
+				output_char(out, ',');
+
+			output_csv_str(out, name);
+			values = out->csv_values;
+		}
+
+		if (out->fields)
+			output_char(values, ',');
+		break;
+	default:
+		break;
+	}
+
+	out->fields++;
+
+	return values;
+}
+
+void output_field_str(struct output *out, const char *name, const char *val)
+{
+	struct output *values = output_field_begin(out, name);
+
+	if (out->format == OUTPUT_FORMAT_JSON)
+		output_json_str(values, val);
+	else
+		output_csv_str(values, val);
+}
+
+void output_field_uint(struct output *out, const char *name,
+		       unsigned long long val)
+{
+	output_uint(output_field_begin(out, name), val, 0);
+}
+
+void output_field_int(struct output *out, const char *name, long long val)
+{
+	output_int(output_field_begin(out, name), val, 0);
+}
+
+void output_field_double(struct output *out, const char *name, double val)
+{
+	output_printf(output_field_begin(out, name), "%.3f", val);
+}
+
+void output_field_bool(struct output *out, const char *name, bool val)
+{
+	struct output *values = output_field_begin(out, name);
+
+	if (out->format == OUTPUT_FORMAT_JSON)
+		output_str(values, val ? "true" : "false");
+	else
+		output_char(values, val ? '1' : '0');
+}
+
+void output_field_mac(struct output *out, const char *name,
+		      const uint8_t *mac)
+{
+	struct output *values = output_field_begin(out, name);
+
+	if (out->format == OUTPUT_FORMAT_JSON) {
+		output_char(values, '"');
+		output_mac(values, mac);
+		output_char(values, '"');
+	} else {
+		output_mac(values, mac);
+	}
+}
+
+/* json leaves out missing fields, csv keeps an empty column */
+void output_field_none(struct output *out, const char *name)
+{
+	if (out->format == OUTPUT_FORMAT_CSV)
+		output_field_begin(out, name);
+}
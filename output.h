@@ -0,0 +1,119 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#ifndef _BATCTL_OUTPUT_H
+#define _BATCTL_OUTPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* size of the block which is handed to write() at once */
+#define OUTPUT_BUF_SIZE (64 * 1024)
+
+enum output_format {
+	OUTPUT_FORMAT_TEXT,
+	OUTPUT_FORMAT_JSON,
+	OUTPUT_FORMAT_CSV,
+};
+
+/* buffered output of table rows
+ *
+ * With a file descriptor, the buffer is written out whenever it is full
+ * (and on output_flush()). Without one (fd < 0), the buffer grows and keeps
+ * everything until output_reset().
+ */
+struct output {
+	int fd;
+	char *buf;
+	size_t len;
+	size_t size;
+
+	/* records (OUTPUT_FORMAT_JSON/OUTPUT_FORMAT_CSV) */
+	enum output_format format;
+	unsigned int fields;
+	bool csv_header;
+	struct output *csv_values;
+};
+
+int output_init(struct output *out, int fd, size_t size);
+void output_free(struct output *out);
+void output_flush(struct output *out);
+int output_make_room(struct output *out, size_t len);
+
+void output_str(struct output *out, const char *str);
+void output_str_right(struct output *out, const char *str, int width);
+void output_str_left(struct output *out, const char *str, int width);
+void output_uint(struct output *out, unsigned long long val, int width);
+void output_uint_zero(struct output *out, unsigned long long val, int width);
+void output_int(struct output *out, long long val, int width);
+void output_hex(struct output *out, uint32_t val, int digits);
+void output_seconds(struct output *out, uint32_t msecs, int width);
+void output_mac(struct output *out, const uint8_t *mac);
+void output_host(struct output *out, const uint8_t *mac, int read_opt);
+void output_printf(struct output *out, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+int output_parse_format(const char *name, enum output_format *format);
+void output_set_format(struct output *out, enum output_format format,
+		       bool header);
+void output_record_begin(struct output *out);
+void output_record_end(struct output *out);
+void output_field_str(struct output *out, const char *name, const char *val);
+void output_field_uint(struct output *out, const char *name,
+		       unsigned long long val);
+void output_field_int(struct output *out, const char *name, long long val);
+void output_field_double(struct output *out, const char *name, double val);
+void output_field_bool(struct output *out, const char *name, bool val);
+void output_field_mac(struct output *out, const char *name,
+		      const uint8_t *mac);
+void output_field_none(struct output *out, const char *name);
+
+static inline void output_reset(struct output *out)
+{
+	out->len = 0;
+}
+
+static inline void output_mem(struct output *out, const char *data,
+			      size_t len)
+{
+	if (out->len + len > out->size && output_make_room(out, len) < 0)
+		return;
+
+	memcpy(out->buf + out->len, data, len);
+	out->len += len;
+}
+
+static inline void output_char(struct output *out, char c)
+{
+	if (out->len + 1 > out->size && output_make_room(out, 1) < 0)
+		return;
+
+	out->buf[out->len++] = c;
+}
+
+static inline void output_spaces(struct output *out, int num)
+{
+	while (num-- > 0)
+		output_char(out, ' ');
+}
+
+#endif
@@ -0,0 +1,1159 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "main.h"
+#include "pcapng.h"
+
+#define PCAPNG_BLOCK_SHB 0x0a0d0d0a
+#define PCAPNG_BLOCK_IDB 0x00000001
+#define PCAPNG_BLOCK_PB 0x00000002
+#define PCAPNG_BLOCK_SPB 0x00000003
+#define PCAPNG_BLOCK_EPB 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1a2b3c4d
+
+/* classic pcap files */
+#define PCAP_MAGIC_USEC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAP_FILE_HDR_LEN 24
+#define PCAP_RECORD_HDR_LEN 16
+
+#define PCAPNG_OPT_ENDOFOPT 0
+#define PCAPNG_OPT_SHB_USERAPPL 4
+#define PCAPNG_OPT_IF_NAME 2
+#define PCAPNG_OPT_IF_TSRESOL 9
+
+#define PCAPNG_MAX_INTERFACES 32
+#define PCAPNG_FILE_BUFFER (1024 * 1024)
+
+/* record in the queue which only fills the space up to the end of the queue */
+#define PCAPNG_RECORD_PAD UINT32_MAX
+
+#define PCAPNG_ALIGN(len, align) (((len) + (align) - 1) & ~((size_t)(align) - 1))
+
+struct pcapng_shb {
+	uint32_t type;
+	uint32_t len;
+	uint32_t magic;
+	uint16_t major;
+	uint16_t minor;
+	int64_t section_len;
+} __attribute__((packed));
+
+struct pcapng_idb {
+	uint32_t type;
+	uint32_t len;
+	uint16_t linktype;
+	uint16_t reserved;
+	uint32_t snaplen;
+} __attribute__((packed));
+
+struct pcapng_epb {
+	uint32_t type;
+	uint32_t len;
+	uint32_t if_id;
+	uint32_t ts_high;
+	uint32_t ts_low;
+	uint32_t caplen;
+	uint32_t origlen;
+} __attribute__((packed));
+
+struct pcapng_option {
+	uint16_t code;
+	uint16_t len;
+} __attribute__((packed));
+
+/* packet in the queue - followed by caplen bytes of the frame */
+struct pcapng_record {
+	uint32_t len;
+	uint32_t if_id;
+	uint64_t ts_nsec;
+	uint32_t caplen;
+	uint32_t origlen;
+};
+
+/* single producer, single consumer byte queue */
+struct pcapng_queue {
+	uint8_t *buf;
+	size_t size;
+	size_t head;	/* written by the capture */
+	size_t tail;	/* written by the writer thread */
+	unsigned long drops;
+};
+
+struct pcapng_interface {
+	char *name;
+	uint16_t linktype;
+
+	/* each interface is captured by its own thread */
+	struct pcapng_queue queue;
+};
+
+struct pcapng_writer {
+	int event_fd;
+	bool stop;
+
+	pthread_t thread;
+	bool started;
+	int err;
+
+	/* only used by the writer thread after pcapng_writer_start() */
+	char *path;
+	FILE *file;
+	char *file_buffer;
+	size_t file_size;
+	unsigned int file_num;
+	size_t file_packets;
+	size_t rotate_size;
+	unsigned int rotate_secs;
+	struct timespec file_start;
+
+	struct pcapng_interface interfaces[PCAPNG_MAX_INTERFACES];
+	unsigned int num_interfaces;
+};
+
+/* interface of a capture file which is read */
+struct pcapng_read_interface {
+	uint16_t linktype;
+	/* timestamps are in units of 10^-tsresol or 2^-(tsresol & 0x7f) s */
+	uint8_t tsresol;
+};
+
+struct pcapng_section {
+	size_t offset;
+	bool swap;
+	struct pcapng_read_interface *interfaces;
+	unsigned int num_interfaces;
+};
+
+struct pcapng_reader {
+	uint8_t *map;
+	size_t size;
+	bool pcapng;
+
+	struct pcapng_section **sections;
+	size_t num_sections;
+	/* sections and interfaces in front of it are known */
+	size_t scanned;
+};
+
+static int pcapng_write(struct pcapng_writer *writer, const void *data,
+			size_t len)
+{
+	if (len && fwrite(data, len, 1, writer->file) != 1)
+		return -errno ? -errno : -EIO;
+
+	writer->file_size += len;
+
+	return 0;
+}
+
+static int pcapng_write_option(struct pcapng_writer *writer, uint16_t code,
+			       const void *data, uint16_t len)
+{
+	static const uint8_t padding[4];
+	struct pcapng_option opt = {
+		.code = code,
+		.len = len,
+	};
+	int ret;
+
+	ret = pcapng_write(writer, &opt, sizeof(opt));
+	if (ret < 0)
+		return ret;
+
+	ret = pcapng_write(writer, data, len);
+	if (ret < 0)
+		return ret;
+
+	return pcapng_write(writer, padding, PCAPNG_ALIGN(len, 4) - len);
+}
+
+static size_t pcapng_option_len(size_t len)
+{
+	return sizeof(struct pcapng_option) + PCAPNG_ALIGN(len, 4);
+}
+
+static int pcapng_write_shb(struct pcapng_writer *writer)
+{
+	static const char userappl[] = "batctl " SOURCE_VERSION;
+	struct pcapng_shb shb = {
+		.type = PCAPNG_BLOCK_SHB,
+		.magic = PCAPNG_BYTE_ORDER_MAGIC,
+		.major = 1,
+		.minor = 0,
+		.section_len = -1,
+	};
+	uint32_t len;
+	int ret;
+
+	len = sizeof(shb) + pcapng_option_len(strlen(userappl)) +
+	      pcapng_option_len(0) + sizeof(len);
+	shb.len = len;
+
+	ret = pcapng_write(writer, &shb, sizeof(shb));
+	if (ret < 0)
+		return ret;
+
+	ret = pcapng_write_option(writer, PCAPNG_OPT_SHB_USERAPPL, userappl,
+				  strlen(userappl));
+	if (ret < 0)
+		return ret;
+
+	ret = pcapng_write_option(writer, PCAPNG_OPT_ENDOFOPT, NULL, 0);
+	if (ret < 0)
+		return ret;
+
+	return pcapng_write(writer, &len, sizeof(len));
+}
+
+static int pcapng_write_idb(struct pcapng_writer *writer,
+			    const struct pcapng_interface *iface)
+{
+	/* timestamps are written in nanoseconds */
+	static const uint8_t tsresol = 9;
+	struct pcapng_idb idb = {
+		.type = PCAPNG_BLOCK_IDB,
+		.linktype = iface->linktype,
+		.snaplen = 0,
+	};
+	uint32_t len;
+	int ret;
+
+	len = sizeof(idb) + pcapng_option_len(strlen(iface->name)) +
+	      pcapng_option_len(sizeof(tsresol)) + pcapng_option_len(0) +
+	      sizeof(len);
+	idb.len = len;
+
+	ret = pcapng_write(writer, &idb, sizeof(idb));
+	if (ret < 0)
+		return ret;
+
+	ret = pcapng_write_option(writer, PCAPNG_OPT_IF_NAME, iface->name,
+				  strlen(iface->name));
+	if (ret < 0)
+		return ret;
+
+	ret = pcapng_write_option(writer, PCAPNG_OPT_IF_TSRESOL, &tsresol,
+				  sizeof(tsresol));
+	if (ret < 0)
+		return ret;
+
+	ret = pcapng_write_option(writer, PCAPNG_OPT_ENDOFOPT, NULL, 0);
+	if (ret < 0)
+		return ret;
+
+	return pcapng_write(writer, &len, sizeof(len));
+}
+
+static int pcapng_write_epb(struct pcapng_writer *writer,
+			    const struct pcapng_record *record)
+{
+	static const uint8_t padding[4];
+	struct pcapng_epb epb = {
+		.type = PCAPNG_BLOCK_EPB,
+		.if_id = record->if_id,
+		.ts_high = record->ts_nsec >> 32,
+		.ts_low = record->ts_nsec & 0xffffffff,
+		.caplen = record->caplen,
+		.origlen = record->origlen,
+	};
+	size_t data_len = PCAPNG_ALIGN(record->caplen, 4);
+	uint32_t len;
+	int ret;
+
+	len = sizeof(epb) + data_len + sizeof(len);
+	epb.len = len;
+
+	ret = pcapng_write(writer, &epb, sizeof(epb));
+	if (ret < 0)
+		return ret;
+
+	ret = pcapng_write(writer, record + 1, record->caplen);
+	if (ret < 0)
+		return ret;
+
+	ret = pcapng_write(writer, padding, data_len - record->caplen);
+	if (ret < 0)
+		return ret;
+
+	return pcapng_write(writer, &len, sizeof(len));
+}
+
+/* start a new file: <path> for the first one, then <path>.1, <path>.2, ... */
+static int pcapng_file_open(struct pcapng_writer *writer)
+{
+	char *path = writer->path;
+	unsigned int i;
+	size_t len;
+	int ret;
+
+	if (writer->file_num > 0) {
+		len = strlen(writer->path) + 12;
+		path = malloc(len);
+		if (!path)
+			return -ENOMEM;
+
+		snprintf(path, len, "%s.%u", writer->path, writer->file_num);
+	}
+
+	writer->file = fopen(path, "w");
+	if (!writer->file) {
+		ret = -errno;
+		fprintf(stderr, "Error - can't open capture file '%s': %s\n",
+			path, strerror(errno));
+		goto out;
+	}
+
+	setvbuf(writer->file, writer->file_buffer, _IOFBF, PCAPNG_FILE_BUFFER);
+
+	writer->file_size = 0;
+	writer->file_packets = 0;
+	writer->file_num++;
+	clock_gettime(CLOCK_MONOTONIC, &writer->file_start);
+
+	/* every file is readable on its own */
+	ret = pcapng_write_shb(writer);
+	for (i = 0; ret == 0 && i < writer->num_interfaces; i++)
+		ret = pcapng_write_idb(writer, &writer->interfaces[i]);
+
+out:
+	if (path != writer->path)
+		free(path);
+
+	return ret;
+}
+
+static int pcapng_file_close(struct pcapng_writer *writer)
+{
+	int ret = 0;
+
+	if (!writer->file)
+		return 0;
+
+	if (fclose(writer->file) != 0)
+		ret = -errno;
+
+	writer->file = NULL;
+
+	return ret;
+}
+
+static bool pcapng_needs_rotate(struct pcapng_writer *writer,
+				const struct pcapng_record *record)
+{
+	struct timespec now;
+
+	/* never start a file without a packet */
+	if (!writer->file_packets)
+		return false;
+
+	if (writer->rotate_size &&
+	    writer->file_size + sizeof(struct pcapng_epb) + record->caplen +
+	    sizeof(uint32_t) + 3 > writer->rotate_size)
+		return true;
+
+	if (writer->rotate_secs) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (now.tv_sec - writer->file_start.tv_sec >=
+		    (time_t)writer->rotate_secs)
+			return true;
+	}
+
+	return false;
+}
+
+static int pcapng_write_record(struct pcapng_writer *writer,
+			       const struct pcapng_record *record)
+{
+	int ret;
+
+	if (pcapng_needs_rotate(writer, record)) {
+		ret = pcapng_file_close(writer);
+		if (ret < 0)
+			return ret;
+
+		ret = pcapng_file_open(writer);
+		if (ret < 0)
+			return ret;
+	}
+
+	ret = pcapng_write_epb(writer, record);
+	if (ret < 0)
+		return ret;
+
+	writer->file_packets++;
+
+	return 0;
+}
+
+/* write all packets which are in a queue - returns false when it was empty */
+static bool pcapng_drain_queue(struct pcapng_writer *writer,
+			       struct pcapng_queue *queue)
+{
+	const struct pcapng_record *record;
+	size_t head;
+	size_t tail;
+	int ret;
+
+	head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+	tail = queue->tail;
+
+	if (head == tail)
+		return false;
+
+	while (tail != head) {
+		record = (struct pcapng_record *)(queue->buf +
+			 (tail & (queue->size - 1)));
+
+		/* a failed file is not written anymore but still drained */
+		if (record->if_id != PCAPNG_RECORD_PAD && !writer->err) {
+			ret = pcapng_write_record(writer, record);
+			if (ret < 0)
+				__atomic_store_n(&writer->err, ret,
+						 __ATOMIC_RELEASE);
+		}
+
+		tail += record->len;
+	}
+
+	__atomic_store_n(&queue->tail, tail, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+static bool pcapng_drain(struct pcapng_writer *writer)
+{
+	bool drained = false;
+	unsigned int i;
+
+	for (i = 0; i < writer->num_interfaces; i++) {
+		if (pcapng_drain_queue(writer, &writer->interfaces[i].queue))
+			drained = true;
+	}
+
+	return drained;
+}
+
+static void *pcapng_writer_thread(void *arg)
+{
+	struct pcapng_writer *writer = arg;
+	struct pollfd pfd = {
+		.fd = writer->event_fd,
+		.events = POLLIN,
+	};
+	uint64_t events;
+
+	while (!__atomic_load_n(&writer->stop, __ATOMIC_ACQUIRE)) {
+		if (pcapng_drain(writer))
+			continue;
+
+		/* the queue is empty - write out the buffered data meanwhile */
+		if (writer->file && !writer->err && fflush(writer->file) != 0)
+			__atomic_store_n(&writer->err, -errno, __ATOMIC_RELEASE);
+
+		if (poll(&pfd, 1, 1000) > 0 &&
+		    read(writer->event_fd, &events, sizeof(events)) < 0 &&
+		    errno != EAGAIN)
+			break;
+	}
+
+	pcapng_drain(writer);
+
+	return NULL;
+}
+
+/**
+ * pcapng_writer_open - prepare writing captured packets to a pcapng file
+ * @path: file which is written
+ * @rotate_size: size in bytes after which the next file is started (or 0)
+ * @rotate_secs: seconds after which the next file is started (or 0)
+ *
+ * The interfaces have to be added with pcapng_writer_add_interface() before
+ * the writer thread is started with pcapng_writer_start().
+ *
+ * Return: writer or NULL on error
+ */
+struct pcapng_writer *pcapng_writer_open(const char *path, size_t rotate_size,
+					 unsigned int rotate_secs)
+{
+	struct pcapng_writer *writer;
+
+	writer = calloc(1, sizeof(*writer));
+	if (!writer)
+		goto err_nomem;
+
+	writer->event_fd = -1;
+	writer->rotate_size = rotate_size;
+	writer->rotate_secs = rotate_secs;
+
+	writer->path = strdup(path);
+	writer->file_buffer = malloc(PCAPNG_FILE_BUFFER);
+	if (!writer->path || !writer->file_buffer)
+		goto err_nomem;
+
+	writer->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (writer->event_fd < 0) {
+		perror("Error - can't create eventfd for the capture writer");
+		goto err;
+	}
+
+	if (pcapng_file_open(writer) < 0)
+		goto err;
+
+	return writer;
+
+err_nomem:
+	fprintf(stderr, "Error - could not allocate capture writer: out of memory ?\n");
+err:
+	pcapng_writer_close(writer);
+	return NULL;
+}
+
+/**
+ * pcapng_writer_add_interface - describe an interface of the capture
+ * @writer: writer which was not started yet
+ * @name: name of the interface
+ * @linktype: PCAPNG_LINKTYPE_* of the captured frames
+ *
+ * Return: interface id for pcapng_writer_packet() or negative error
+ */
+int pcapng_writer_add_interface(struct pcapng_writer *writer,
+				const char *name, uint16_t linktype)
+{
+	struct pcapng_interface *iface;
+	int ret;
+
+	if (writer->started ||
+	    writer->num_interfaces == PCAPNG_MAX_INTERFACES)
+		return -EINVAL;
+
+	iface = &writer->interfaces[writer->num_interfaces];
+	iface->name = strdup(name);
+	if (!iface->name)
+		return -ENOMEM;
+
+	iface->linktype = linktype;
+	iface->queue.size = PCAPNG_QUEUE_SIZE;
+	iface->queue.buf = malloc(iface->queue.size);
+	if (!iface->queue.buf) {
+		free(iface->name);
+		return -ENOMEM;
+	}
+
+	ret = pcapng_write_idb(writer, iface);
+	if (ret < 0) {
+		free(iface->queue.buf);
+		free(iface->name);
+		return ret;
+	}
+
+	return writer->num_interfaces++;
+}
+
+int pcapng_writer_start(struct pcapng_writer *writer)
+{
+	sigset_t sigset;
+	sigset_t oldset;
+	int ret;
+
+	/* signals are handled by the capture thread */
+	sigfillset(&sigset);
+	pthread_sigmask(SIG_BLOCK, &sigset, &oldset);
+	ret = pthread_create(&writer->thread, NULL, pcapng_writer_thread,
+			     writer);
+	pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+
+	if (ret != 0) {
+		fprintf(stderr, "Error - can't start capture writer: %s\n",
+			strerror(ret));
+		return -ret;
+	}
+
+	writer->started = true;
+
+	return 0;
+}
+
+/**
+ * pcapng_writer_packet - queue a captured packet for the writer thread
+ * @writer: started writer
+ * @if_id: interface id returned by pcapng_writer_add_interface()
+ * @ts_nsec: receive time in nanoseconds since the epoch
+ * @data: captured frame
+ * @caplen: number of bytes in @data
+ * @origlen: length of the frame on the wire
+ *
+ * Never waits for the writer thread. The packet is dropped when the queue is
+ * full. Each interface may only be fed by a single thread.
+ *
+ * Return: 0 on success or -ENOBUFS when the packet was dropped
+ */
+int pcapng_writer_packet(struct pcapng_writer *writer, unsigned int if_id,
+			 uint64_t ts_nsec, const void *data, uint32_t caplen,
+			 uint32_t origlen)
+{
+	struct pcapng_queue *queue = &writer->interfaces[if_id].queue;
+	struct pcapng_record *record;
+	size_t mask = queue->size - 1;
+	size_t head = queue->head;
+	size_t len;
+	size_t pad;
+	size_t tail;
+
+	len = PCAPNG_ALIGN(sizeof(*record) + caplen, sizeof(uint64_t));
+
+	/* records are never split at the end of the queue */
+	pad = queue->size - (head & mask);
+	if (pad >= len)
+		pad = 0;
+
+	tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+	if (queue->size - (head - tail) < pad + len) {
+		queue->drops++;
+		return -ENOBUFS;
+	}
+
+	/* only len and if_id are used - the padding is at least 8 bytes */
+	if (pad) {
+		record = (struct pcapng_record *)(queue->buf + (head & mask));
+		record->len = pad;
+		record->if_id = PCAPNG_RECORD_PAD;
+		head += pad;
+	}
+
+	record = (struct pcapng_record *)(queue->buf + (head & mask));
+	record->len = len;
+	record->if_id = if_id;
+	record->ts_nsec = ts_nsec;
+	record->caplen = caplen;
+	record->origlen = origlen;
+	memcpy(record + 1, data, caplen);
+
+	__atomic_store_n(&queue->head, head + len, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+/* wake up the writer thread after a batch of packets was queued */
+void pcapng_writer_kick(struct pcapng_writer *writer)
+{
+	uint64_t event = 1;
+
+	if (write(writer->event_fd, &event, sizeof(event)) < 0 &&
+	    errno != EAGAIN)
+		return;
+}
+
+/* first error of the writer thread (or 0) */
+int pcapng_writer_error(struct pcapng_writer *writer)
+{
+	return __atomic_load_n(&writer->err, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * pcapng_writer_close - write the remaining packets and close the file
+ * @writer: writer to close
+ *
+ * Return: 0 on success or the first error while writing the capture
+ */
+int pcapng_writer_close(struct pcapng_writer *writer)
+{
+	unsigned int i;
+	int ret;
+
+	if (!writer)
+		return 0;
+
+	if (writer->started) {
+		__atomic_store_n(&writer->stop, true, __ATOMIC_RELEASE);
+		pcapng_writer_kick(writer);
+		pthread_join(writer->thread, NULL);
+	}
+
+	ret = pcapng_file_close(writer);
+	if (writer->err)
+		ret = writer->err;
+
+	for (i = 0; i < writer->num_interfaces; i++) {
+		if (writer->interfaces[i].queue.drops)
+			fprintf(stderr, "%s: %lu packets dropped by the capture writer\n",
+				writer->interfaces[i].name,
+				writer->interfaces[i].queue.drops);
+
+		free(writer->interfaces[i].queue.buf);
+		free(writer->interfaces[i].name);
+	}
+
+	if (writer->event_fd >= 0)
+		close(writer->event_fd);
+
+	free(writer->file_buffer);
+	free(writer->path);
+	free(writer);
+
+	return ret;
+}
+
+static uint32_t pcapng_get32(const struct pcapng_section *section,
+			     const uint8_t *ptr)
+{
+	uint32_t value;
+
+	memcpy(&value, ptr, sizeof(value));
+
+	return section->swap ? __builtin_bswap32(value) : value;
+}
+
+static uint16_t pcapng_get16(const struct pcapng_section *section,
+			     const uint8_t *ptr)
+{
+	uint16_t value;
+
+	memcpy(&value, ptr, sizeof(value));
+
+	return section->swap ? __builtin_bswap16(value) : value;
+}
+
+static uint64_t pcapng_ts_nsec(uint8_t tsresol, uint64_t ts)
+{
+	uint64_t units = 1;
+	uint8_t exp = tsresol & 0x7f;
+	uint8_t i;
+
+	/* binary fractions of a second */
+	if (tsresol & 0x80) {
+		if (exp >= 64)
+			return 0;
+
+		return (ts >> exp) * 1000000000ULL +
+		       (((ts & ((1ULL << exp) - 1)) * 1000000000ULL) >> exp);
+	}
+
+	if (exp <= 9) {
+		for (i = exp; i < 9; i++)
+			units *= 10;
+
+		return ts * units;
+	}
+
+	for (i = 9; i < exp && i < 27; i++)
+		units *= 10;
+
+	return ts / units;
+}
+
+static struct pcapng_section *pcapng_section_new(struct pcapng_reader *reader,
+						 size_t offset, bool swap)
+{
+	struct pcapng_section **sections;
+	struct pcapng_section *section;
+
+	sections = realloc(reader->sections,
+			   (reader->num_sections + 1) * sizeof(*sections));
+	if (!sections)
+		return NULL;
+
+	reader->sections = sections;
+
+	section = calloc(1, sizeof(*section));
+	if (!section)
+		return NULL;
+
+	section->offset = offset;
+	section->swap = swap;
+	reader->sections[reader->num_sections++] = section;
+
+	return section;
+}
+
+static struct pcapng_section *pcapng_section_find(struct pcapng_reader *reader,
+						  size_t offset)
+{
+	size_t i;
+
+	for (i = 0; i < reader->num_sections; i++) {
+		if (reader->sections[i]->offset == offset)
+			return reader->sections[i];
+	}
+
+	return NULL;
+}
+
+static int pcapng_section_add_interface(struct pcapng_section *section,
+					uint16_t linktype, uint8_t tsresol)
+{
+	struct pcapng_read_interface *interfaces;
+
+	interfaces = realloc(section->interfaces,
+			     (section->num_interfaces + 1) *
+			     sizeof(*interfaces));
+	if (!interfaces)
+		return -ENOMEM;
+
+	section->interfaces = interfaces;
+	interfaces[section->num_interfaces].linktype = linktype;
+	interfaces[section->num_interfaces].tsresol = tsresol;
+	section->num_interfaces++;
+
+	return 0;
+}
+
+/**
+ * pcapng_reader_open - map a pcap or pcapng capture file
+ * @path: file which is read
+ *
+ * The file is mapped copy-on-write so the dissectors can modify the frames
+ * in place.
+ *
+ * Return: reader or NULL on error
+ */
+struct pcapng_reader *pcapng_reader_open(const char *path)
+{
+	struct pcapng_section *section;
+	struct pcapng_reader *reader;
+	uint32_t magic;
+	struct stat st;
+	void *map;
+	int fd;
+
+	reader = calloc(1, sizeof(*reader));
+	if (!reader) {
+		fprintf(stderr, "Error - could not allocate capture reader: out of memory ?\n");
+		return NULL;
+	}
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "Error - can't open capture file '%s': %s\n",
+			path, strerror(errno));
+		goto err;
+	}
+
+	if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(magic)) {
+		fprintf(stderr, "Error - capture file '%s' is too short\n", path);
+		close(fd);
+		goto err;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+		   0);
+	close(fd);
+
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "Error - can't map capture file '%s': %s\n",
+			path, strerror(errno));
+		goto err;
+	}
+
+	reader->map = map;
+	reader->size = st.st_size;
+
+	memcpy(&magic, reader->map, sizeof(magic));
+
+	if (magic == PCAPNG_BLOCK_SHB) {
+		reader->pcapng = true;
+		return reader;
+	}
+
+	if (reader->size < PCAP_FILE_HDR_LEN)
+		goto err_format;
+
+	/* a classic pcap file is a single section with one interface */
+	switch (magic) {
+	case PCAP_MAGIC_USEC:
+	case PCAP_MAGIC_NSEC:
+		section = pcapng_section_new(reader, 0, false);
+		break;
+	case __builtin_bswap32(PCAP_MAGIC_USEC):
+	case __builtin_bswap32(PCAP_MAGIC_NSEC):
+		section = pcapng_section_new(reader, 0, true);
+		break;
+	default:
+		goto err_format;
+	}
+
+	if (!section ||
+	    pcapng_section_add_interface(section,
+					 pcapng_get32(section, reader->map + 20),
+					 pcapng_get32(section, reader->map) == PCAP_MAGIC_NSEC ? 9 : 6) < 0) {
+		fprintf(stderr, "Error - could not allocate capture reader: out of memory ?\n");
+		goto err;
+	}
+
+	reader->scanned = PCAP_FILE_HDR_LEN;
+
+	return reader;
+
+err_format:
+	fprintf(stderr, "Error - '%s' is no pcap or pcapng file\n", path);
+err:
+	pcapng_reader_close(reader);
+	return NULL;
+}
+
+/* position in front of the first packet */
+void pcapng_reader_start(struct pcapng_reader *reader,
+			 struct pcapng_cursor *cursor)
+{
+	if (reader->pcapng) {
+		cursor->offset = 0;
+		cursor->section = NULL;
+	} else {
+		cursor->offset = PCAP_FILE_HDR_LEN;
+		cursor->section = reader->sections[0];
+	}
+}
+
+static int pcap_read_record(struct pcapng_reader *reader,
+			    struct pcapng_cursor *cursor,
+			    struct pcapng_packet *packet)
+{
+	const struct pcapng_section *section = cursor->section;
+	uint8_t *hdr = reader->map + cursor->offset;
+	uint32_t ts_frac;
+	uint32_t ts_sec;
+
+	if (reader->size - cursor->offset < PCAP_RECORD_HDR_LEN)
+		return -EINVAL;
+
+	ts_sec = pcapng_get32(section, hdr);
+	ts_frac = pcapng_get32(section, hdr + 4);
+	packet->caplen = pcapng_get32(section, hdr + 8);
+	packet->origlen = pcapng_get32(section, hdr + 12);
+
+	if (reader->size - cursor->offset - PCAP_RECORD_HDR_LEN < packet->caplen)
+		return -EINVAL;
+
+	packet->data = hdr + PCAP_RECORD_HDR_LEN;
+	packet->linktype = section->interfaces[0].linktype;
+	packet->ts_nsec = ts_sec * 1000000000ULL +
+			  pcapng_ts_nsec(section->interfaces[0].tsresol, ts_frac);
+
+	cursor->offset += PCAP_RECORD_HDR_LEN + packet->caplen;
+
+	return 1;
+}
+
+/* interface description of a section which was seen the first time */
+static int pcapng_read_idb(struct pcapng_section *section, const uint8_t *block,
+			   uint32_t len)
+{
+	uint8_t tsresol = 6;
+	uint32_t offset = 16;
+	uint16_t code;
+	uint16_t optlen;
+
+	if (len < 20)
+		return -EINVAL;
+
+	while (offset + 4 <= len - 4) {
+		code = pcapng_get16(section, block + offset);
+		optlen = pcapng_get16(section, block + offset + 2);
+
+		if (code == PCAPNG_OPT_ENDOFOPT)
+			break;
+
+		if (offset + 4 + optlen > len - 4)
+			return -EINVAL;
+
+		if (code == PCAPNG_OPT_IF_TSRESOL && optlen == 1)
+			tsresol = block[offset + 4];
+
+		offset += 4 + ((optlen + 3) & ~3U);
+	}
+
+	return pcapng_section_add_interface(section,
+					    pcapng_get16(section, block + 8),
+					    tsresol);
+}
+
+static int pcapng_read_packet(const struct pcapng_section *section,
+			      const uint8_t *block, uint32_t type,
+			      uint32_t len, struct pcapng_packet *packet)
+{
+	const struct pcapng_read_interface *iface;
+	uint32_t if_id;
+	uint64_t ts;
+
+	switch (type) {
+	case PCAPNG_BLOCK_SPB:
+		if (len < 16 || !section->num_interfaces)
+			return -EINVAL;
+
+		if_id = 0;
+		ts = 0;
+		packet->origlen = pcapng_get32(section, block + 8);
+		packet->caplen = packet->origlen;
+		if (packet->caplen > len - 16)
+			packet->caplen = len - 16;
+		packet->data = (uint8_t *)block + 12;
+		break;
+	case PCAPNG_BLOCK_PB:
+	case PCAPNG_BLOCK_EPB:
+		if (len < 32)
+			return -EINVAL;
+
+		if (type == PCAPNG_BLOCK_PB)
+			if_id = pcapng_get16(section, block + 8);
+		else
+			if_id = pcapng_get32(section, block + 8);
+
+		ts = (uint64_t)pcapng_get32(section, block + 12) << 32 |
+		     pcapng_get32(section, block + 16);
+		packet->caplen = pcapng_get32(section, block + 20);
+		packet->origlen = pcapng_get32(section, block + 24);
+		packet->data = (uint8_t *)block + 28;
+
+		if (if_id >= section->num_interfaces ||
+		    packet->caplen > len - 32)
+			return -EINVAL;
+		break;
+	default:
+		return 0;
+	}
+
+	iface = &section->interfaces[if_id];
+	packet->linktype = iface->linktype;
+	packet->ts_nsec = pcapng_ts_nsec(iface->tsresol, ts);
+
+	return 1;
+}
+
+/**
+ * pcapng_reader_next - read the packet at a position of the capture file
+ * @reader: reader of the file
+ * @cursor: position which is advanced behind the returned packet
+ * @packet: returned packet
+ *
+ * The sections and interfaces are collected the first time a part of the
+ * file is read. Other threads may only read from positions in front of the
+ * part which was read by the first thread.
+ *
+ * Return: 1 on success, 0 at the end of the file or a negative error when the
+ * file is malformed at the position of the cursor
+ */
+int pcapng_reader_next(struct pcapng_reader *reader,
+		       struct pcapng_cursor *cursor,
+		       struct pcapng_packet *packet)
+{
+	struct pcapng_section *section;
+	bool learn;
+	uint8_t *block;
+	uint32_t magic;
+	uint32_t type;
+	uint32_t len;
+	int ret;
+
+	while (cursor->offset < reader->size) {
+		if (!reader->pcapng)
+			return pcap_read_record(reader, cursor, packet);
+
+		if (reader->size - cursor->offset < 12)
+			return -EINVAL;
+
+		block = reader->map + cursor->offset;
+		learn = cursor->offset >= reader->scanned;
+		memcpy(&type, block, sizeof(type));
+
+		if (type == PCAPNG_BLOCK_SHB) {
+			memcpy(&magic, block + 8, sizeof(magic));
+			if (magic != PCAPNG_BYTE_ORDER_MAGIC &&
+			    magic != __builtin_bswap32(PCAPNG_BYTE_ORDER_MAGIC))
+				return -EINVAL;
+
+			if (learn)
+				section = pcapng_section_new(reader,
+							     cursor->offset,
+							     magic != PCAPNG_BYTE_ORDER_MAGIC);
+			else
+				section = pcapng_section_find(reader,
+							      cursor->offset);
+
+			if (!section)
+				return -ENOMEM;
+
+			cursor->section = section;
+		} else if (!cursor->section) {
+			return -EINVAL;
+		}
+
+		section = (struct pcapng_section *)cursor->section;
+		type = pcapng_get32(section, block);
+		len = pcapng_get32(section, block + 4);
+
+		if (len < 12 || len % 4 || len > reader->size - cursor->offset)
+			return -EINVAL;
+
+		ret = 0;
+		if (type == PCAPNG_BLOCK_IDB && learn)
+			ret = pcapng_read_idb(section, block, len);
+		else if (type != PCAPNG_BLOCK_SHB && type != PCAPNG_BLOCK_IDB)
+			ret = pcapng_read_packet(section, block, type, len,
+						 packet);
+
+		if (ret < 0)
+			return ret;
+
+		cursor->offset += len;
+		if (cursor->offset > reader->scanned)
+			reader->scanned = cursor->offset;
+
+		if (ret > 0)
+			return 1;
+	}
+
+	return 0;
+}
+
+void pcapng_reader_close(struct pcapng_reader *reader)
+{
+	size_t i;
+
+	if (!reader)
+		return;
+
+	for (i = 0; i < reader->num_sections; i++) {
+		free(reader->sections[i]->interfaces);
+		free(reader->sections[i]);
+	}
+
+	free(reader->sections);
+
+	if (reader->map)
+		munmap(reader->map, reader->size);
+
+	free(reader);
+}
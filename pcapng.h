@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#ifndef _BATCTL_PCAPNG_H
+#define _BATCTL_PCAPNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* link types of the interface description block */
+#define PCAPNG_LINKTYPE_ETHERNET 1
+#define PCAPNG_LINKTYPE_IEEE802_11_PRISM 119
+#define PCAPNG_LINKTYPE_IEEE802_11_RADIOTAP 127
+
+/* buffer between the capture of an interface and the writer thread */
+#define PCAPNG_QUEUE_SIZE (16 * 1024 * 1024)
+
+struct pcapng_writer;
+struct pcapng_reader;
+struct pcapng_section;
+
+/* packet in a capture file - data points into the mapped file */
+struct pcapng_packet {
+	uint8_t *data;
+	uint32_t caplen;
+	uint32_t origlen;
+	uint64_t ts_nsec;
+	uint16_t linktype;
+};
+
+/* position in a capture file */
+struct pcapng_cursor {
+	size_t offset;
+	const struct pcapng_section *section;
+};
+
+struct pcapng_writer *pcapng_writer_open(const char *path, size_t rotate_size,
+					 unsigned int rotate_secs);
+int pcapng_writer_add_interface(struct pcapng_writer *writer,
+				const char *name, uint16_t linktype);
+int pcapng_writer_start(struct pcapng_writer *writer);
+int pcapng_writer_packet(struct pcapng_writer *writer, unsigned int if_id,
+			 uint64_t ts_nsec, const void *data, uint32_t caplen,
+			 uint32_t origlen);
+void pcapng_writer_kick(struct pcapng_writer *writer);
+int pcapng_writer_error(struct pcapng_writer *writer);
+int pcapng_writer_close(struct pcapng_writer *writer);
+
+struct pcapng_reader *pcapng_reader_open(const char *path);
+void pcapng_reader_start(struct pcapng_reader *reader,
+			 struct pcapng_cursor *cursor);
+int pcapng_reader_next(struct pcapng_reader *reader,
+		       struct pcapng_cursor *cursor,
+		       struct pcapng_packet *packet);
+void pcapng_reader_close(struct pcapng_reader *reader);
+
+#endif
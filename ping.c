@@ -43,6 +43,7 @@
 #include "bat-hosts.h"
 #include "debugfs.h"
 #include "icmp_helper.h"
+#include "netlink.h"
 
 
 static volatile sig_atomic_t is_aborted = 0;
@@ -52,6 +53,8 @@ static void ping_usage(void)
 {
 	fprintf(stderr, "Usage: batctl [options] ping [parameters] mac|bat-host|host_name|IPv4_address \n");
 	fprintf(stderr, "parameters:\n");
+	fprintf(stderr, " \t -a maximum age of cached originator/TT lookups in seconds (default %.0f)\n",
+		NETLINK_SNAPSHOT_MAX_AGE);
 	fprintf(stderr, " \t -c ping packet count \n");
 	fprintf(stderr, " \t -h print this help\n");
 	fprintf(stderr, " \t -i interval in seconds\n");
@@ -89,9 +92,19 @@ static int ping(struct state *state, int argc, char **argv)
 	size_t packet_len;
 	char *debugfs_mnt;
 	int disable_translate_mac = 0;
+	bool text = state->output_format == OUTPUT_FORMAT_TEXT;
+	/* stdout only carries the summary record of the json/csv formats */
+	FILE *notice = text ? stdout : stderr;
+	struct output out;
 
-	while ((optchar = getopt(argc, argv, "hc:i:t:RT")) != -1) {
+	while ((optchar = getopt(argc, argv, "a:hc:i:t:RT")) != -1) {
 		switch (optchar) {
+		case 'a':
+			state->snapshot_max_age = strtof(optarg, NULL);
+			if (state->snapshot_max_age < 0)
+				state->snapshot_max_age = 0;
+			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
+			break;
 		case 'c':
 			loop_count = strtol(optarg, NULL , 10);
 			if (loop_count < 1)
@@ -152,7 +165,7 @@ static int ping(struct state *state, int argc, char **argv)
 	}
 
 	if (!disable_translate_mac)
-		dst_mac = translate_mac(state->mesh_iface, dst_mac);
+		dst_mac = translate_mac(state, dst_mac);
 
 	mac_string = ether_ntoa_long(dst_mac);
 	signal(SIGINT, sig_handler);
@@ -184,8 +197,10 @@ static int ping(struct state *state, int argc, char **argv)
 		((struct batadv_icmp_packet *)&icmp_packet_out)->reserved = 0;
 	}
 
-	printf("PING %s (%s) %zu(%zu) bytes of data\n", dst_string, mac_string,
-		packet_len, packet_len + 28);
+	/* only the summary is printed as record */
+	if (text)
+		printf("PING %s (%s) %zu(%zu) bytes of data\n", dst_string,
+		       mac_string, packet_len, packet_len + 28);
 
 	while (!is_aborted) {
 		tv.tv_sec = timeout;
@@ -199,7 +214,7 @@ static int ping(struct state *state, int argc, char **argv)
 
 		icmp_packet_out.seqno = htons(++seq_counter);
 
-		res = icmp_interface_write(state->mesh_iface,
+		res = icmp_interface_write(state,
 					   (struct batadv_icmp_header *)&icmp_packet_out,
 					   packet_len);
 		if (res < 0) {
@@ -219,7 +234,8 @@ static int ping(struct state *state, int argc, char **argv)
 		packets_out++;
 
 		if (read_len == 0) {
-			printf("Reply from host %s timed out\n", dst_string);
+			if (text)
+				printf("Reply from host %s timed out\n", dst_string);
 			goto sleep;
 		}
 
@@ -229,7 +245,7 @@ static int ping(struct state *state, int argc, char **argv)
 		}
 
 		if ((size_t)read_len < packet_len) {
-			printf("Warning - dropping received packet as it is smaller than expected (%zu): %zd\n",
+			fprintf(notice, "Warning - dropping received packet as it is smaller than expected (%zu): %zd\n",
 				packet_len, read_len);
 			goto sleep;
 		}
@@ -241,6 +257,10 @@ static int ping(struct state *state, int argc, char **argv)
 		switch (icmp_packet_in.msg_type) {
 		case BATADV_ECHO_REPLY:
 			time_delta = end_timer();
+
+			if (!text)
+				goto update_rtt;
+
 			printf("%zd bytes from %s icmp_seq=%hu ttl=%d time=%.2f ms",
 					read_len, dst_string,
 					ntohs(icmp_packet_in.seqno),
@@ -278,6 +298,7 @@ static int ping(struct state *state, int argc, char **argv)
 
 			printf("\n");
 
+update_rtt:
 			if ((time_delta < min) || (min == 0.0))
 				min = time_delta;
 			if (time_delta > max)
@@ -287,19 +308,21 @@ static int ping(struct state *state, int argc, char **argv)
 			packets_in++;
 			break;
 		case BATADV_DESTINATION_UNREACHABLE:
-			printf("From %s: Destination Host Unreachable (icmp_seq %hu)\n", dst_string, ntohs(icmp_packet_in.seqno));
+			if (text)
+				printf("From %s: Destination Host Unreachable (icmp_seq %hu)\n", dst_string, ntohs(icmp_packet_in.seqno));
 			break;
 		case BATADV_TTL_EXCEEDED:
-			printf("From %s: Time to live exceeded (icmp_seq %hu)\n", dst_string, ntohs(icmp_packet_in.seqno));
+			if (text)
+				printf("From %s: Time to live exceeded (icmp_seq %hu)\n", dst_string, ntohs(icmp_packet_in.seqno));
 			break;
 		case BATADV_PARAMETER_PROBLEM:
 			fprintf(stderr, "Error - the batman adv kernel module version (%d) differs from ours (%d)\n",
 				icmp_packet_in.version, BATADV_COMPAT_VERSION);
-			printf("Please make sure to use compatible versions!\n");
+			fprintf(notice, "Please make sure to use compatible versions!\n");
 			goto out;
 		default:
-			printf("Unknown message type %d len %zd received\n",
-			       icmp_packet_in.msg_type, read_len);
+			fprintf(notice, "Unknown message type %d len %zd received\n",
+				icmp_packet_in.msg_type, read_len);
 			break;
 		}
 
@@ -328,11 +351,28 @@ static int ping(struct state *state, int argc, char **argv)
 		mdev = 0.0;
 	}
 
-	printf("--- %s ping statistics ---\n", dst_string);
-	printf("%u packets transmitted, %u received, %u%% packet loss\n",
-		packets_out, packets_in, packets_loss);
-	printf("rtt min/avg/max/mdev = %.3f/%.3f/%.3f/%.3f ms\n",
-		min, avg, max, mdev);
+	if (text) {
+		printf("--- %s ping statistics ---\n", dst_string);
+		printf("%u packets transmitted, %u received, %u%% packet loss\n",
+			packets_out, packets_in, packets_loss);
+		printf("rtt min/avg/max/mdev = %.3f/%.3f/%.3f/%.3f ms\n",
+			min, avg, max, mdev);
+	} else if (output_init(&out, STDOUT_FILENO, 1024) == 0) {
+		output_set_format(&out, state->output_format, true);
+		output_record_begin(&out);
+		output_field_str(&out, "destination", dst_string);
+		output_field_mac(&out, "destination_address",
+				 (uint8_t *)dst_mac);
+		output_field_uint(&out, "transmitted", packets_out);
+		output_field_uint(&out, "received", packets_in);
+		output_field_uint(&out, "loss", packets_loss);
+		output_field_double(&out, "rtt_min", min);
+		output_field_double(&out, "rtt_avg", avg);
+		output_field_double(&out, "rtt_max", max);
+		output_field_double(&out, "rtt_mdev", mdev);
+		output_record_end(&out);
+		output_free(&out);
+	}
 
 	if (packets_in)
 		ret = EXIT_SUCCESS;
@@ -345,5 +385,7 @@ static int ping(struct state *state, int argc, char **argv)
 	return ret;
 }
 
-COMMAND(SUBCOMMAND, ping, "p", COMMAND_FLAG_MESH_IFACE, NULL,
+COMMAND(SUBCOMMAND, ping, "p",
+	COMMAND_FLAG_MESH_IFACE | COMMAND_FLAG_NETLINK |
+	COMMAND_FLAG_OUTPUT_FORMAT, NULL,
 	"<destination>     \tping another batman adv host via layer 2");
@@ -0,0 +1,466 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <net/if.h>
+#include <netlink/netlink.h>
+#include <netlink/genl/genl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "batman_adv.h"
+#include "debug.h"
+#include "functions.h"
+#include "main.h"
+#include "netlink.h"
+#include "output.h"
+#include "recorder.h"
+
+extern const struct command *__start___command[];
+extern const struct command *__stop___command[];
+
+#define RECORD_MAX_TABLES 16
+
+struct record_table {
+	const struct command *cmd;
+	const struct debug_table_data *data;
+
+	/* column header of the table */
+	char *header;
+};
+
+struct record {
+	struct state *state;
+	int ifindex;
+	uint64_t interval_ns;
+	struct recorder *rec;
+	int err;
+
+	struct record_table tables[RECORD_MAX_TABLES];
+	size_t num_tables;
+	struct output header;
+
+	/* batadv multicast events */
+	struct nl_sock *event_sock;
+	struct nl_cb *event_cb;
+	uint64_t event_ts;
+};
+
+static volatile sig_atomic_t record_stop;
+
+static void record_usage(void)
+{
+	fprintf(stderr, "Usage: batctl [options] record [parameters] [table ...]\n");
+	fprintf(stderr, "parameters:\n");
+	fprintf(stderr, " \t -h print this help\n");
+	fprintf(stderr, " \t -o file - write the recording to file\n");
+	fprintf(stderr, " \t -w interval - sample the tables every x.y seconds (default: 10)\n");
+	fprintf(stderr, " \t -R size - start a new file when the current one has size MiB\n");
+	fprintf(stderr, " \t -k count - keep count rotated files (at least 1, default: 4)\n");
+}
+
+static void record_sig_handler(int sig __maybe_unused)
+{
+	record_stop = 1;
+}
+
+static int record_add_table(struct record *record, const struct command *cmd)
+{
+	const struct debug_table_data *data = cmd->arg;
+	struct netlink_table_probe probe = {
+		.header = NULL,
+	};
+	struct record_table *table;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < record->num_tables; i++) {
+		if (record->tables[i].cmd == cmd)
+			return 0;
+	}
+
+	if (record->num_tables == RECORD_MAX_TABLES)
+		return -ENOSPC;
+
+	/* let the table tell which header it prints */
+	record->state->table_probe = &probe;
+	ret = data->netlink_fn(record->state, NULL, 0, 0.0f, 0.0f);
+	record->state->table_probe = NULL;
+
+	if (ret < 0 || !probe.callback) {
+		free(probe.header);
+		return ret < 0 ? ret : -EOPNOTSUPP;
+	}
+
+	table = &record->tables[record->num_tables++];
+	table->cmd = cmd;
+	table->data = data;
+	table->header = probe.header;
+
+	return 0;
+}
+
+static int record_tables_init(struct record *record, int argc, char **argv)
+{
+	const struct debug_table_data *data;
+	const struct command **p;
+	const struct command *cmd;
+	int ret;
+	int i;
+
+	for (i = 0; i < argc; i++) {
+		cmd = debug_table_find(argv[i]);
+		if (!cmd || !((struct debug_table_data *)cmd->arg)->netlink_cb) {
+			fprintf(stderr, "Error - unknown debug table: %s\n",
+				argv[i]);
+			return -EINVAL;
+		}
+
+		ret = record_add_table(record, cmd);
+		if (ret < 0) {
+			fprintf(stderr, "Error - table %s is not available: %s\n",
+				argv[i], strerror(-ret));
+			return ret;
+		}
+	}
+
+	if (argc)
+		return 0;
+
+	/* all tables which are available on this mesh interface */
+	for (p = __start___command; p < __stop___command; p++) {
+		if ((*p)->type != DEBUGTABLE)
+			continue;
+
+		data = (*p)->arg;
+		if (!data || !data->netlink_fn || !data->netlink_cb)
+			continue;
+
+		record_add_table(record, *p);
+	}
+
+	if (!record->num_tables) {
+		fprintf(stderr, "Error - no debug table is available\n");
+		return -ENOENT;
+	}
+
+	return 0;
+}
+
+static int record_store_row(struct nlmsghdr *nlh, void *arg)
+{
+	struct record *record = arg;
+	int ret;
+
+	ret = recorder_sample_row(record->rec, nlh);
+	if (ret < 0) {
+		record->err = ret;
+		return NL_STOP;
+	}
+
+	return NL_OK;
+}
+
+static int record_sample(struct record *record)
+{
+	struct state *state = record->state;
+	struct record_table *table;
+	uint64_t ts;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < record->num_tables; i++) {
+		table = &record->tables[i];
+
+		output_reset(&record->header);
+		netlink_get_info(state, record->ifindex, table->data->nl_cmd,
+				 table->header, &record->header);
+
+		ts = recorder_now();
+		ret = recorder_sample_begin(record->rec, table->data->nl_cmd,
+					    ts, record->header.buf,
+					    record->header.len);
+		if (ret < 0)
+			return ret;
+
+		ret = netlink_dump(state->sock, state->dump_buf,
+				   state->batadv_family, record->ifindex,
+				   table->data->nl_cmd, record_store_row,
+				   record);
+		if (record->err < 0)
+			return record->err;
+
+		ret = recorder_sample_end(record->rec, ret);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int no_seq_check(struct nl_msg *msg __maybe_unused,
+			void *arg __maybe_unused)
+{
+	return NL_OK;
+}
+
+static int record_store_event(struct nl_msg *msg, void *arg)
+{
+	struct record *record = arg;
+	int ret;
+
+	ret = recorder_event(record->rec, record->event_ts, nlmsg_hdr(msg));
+	if (ret < 0) {
+		record->err = ret;
+		return NL_STOP;
+	}
+
+	return NL_OK;
+}
+
+/* the dumps use the socket of the state - events need their own one */
+static int record_events_init(struct record *record)
+{
+	struct state *state = record->state;
+	int ret;
+
+	if (state->tpmeter_mcid < 0)
+		return 0;
+
+	record->event_sock = nl_socket_alloc();
+	if (!record->event_sock)
+		return -ENOMEM;
+
+	ret = genl_connect(record->event_sock);
+	if (ret < 0)
+		return -EOPNOTSUPP;
+
+	ret = nl_socket_add_membership(record->event_sock,
+				       state->tpmeter_mcid);
+	if (ret < 0)
+		return -EOPNOTSUPP;
+
+	record->event_cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!record->event_cb)
+		return -ENOMEM;
+
+	nl_cb_set(record->event_cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM,
+		  no_seq_check, NULL);
+	nl_cb_set(record->event_cb, NL_CB_VALID, NL_CB_CUSTOM,
+		  record_store_event, record);
+
+	nl_socket_set_nonblocking(record->event_sock);
+
+	return 0;
+}
+
+static int record_run(struct record *record)
+{
+	struct pollfd pfd = {
+		.fd = -1,
+		.events = POLLIN,
+	};
+	uint64_t next;
+	uint64_t now;
+	int timeout;
+	int ret;
+
+	if (record->event_sock)
+		pfd.fd = nl_socket_get_fd(record->event_sock);
+
+	next = recorder_now();
+
+	while (!record_stop) {
+		now = recorder_now();
+		if (now >= next) {
+			ret = record_sample(record);
+			if (ret < 0)
+				return ret;
+
+			next += record->interval_ns;
+			if (next < now)
+				next = now + record->interval_ns;
+			continue;
+		}
+
+		timeout = (next - now) / 1000000 + 1;
+
+		ret = poll(&pfd, 1, timeout);
+		if (ret <= 0)
+			continue;
+
+		/* all events of this wakeup share the time of the wakeup */
+		record->event_ts = recorder_now();
+		nl_recvmsgs(record->event_sock, record->event_cb);
+
+		if (record->err < 0)
+			return record->err;
+	}
+
+	return 0;
+}
+
+static void record_free(struct record *record)
+{
+	size_t i;
+
+	for (i = 0; i < record->num_tables; i++)
+		free(record->tables[i].header);
+
+	if (record->event_cb)
+		nl_cb_put(record->event_cb);
+
+	if (record->event_sock)
+		nl_socket_free(record->event_sock);
+
+	output_free(&record->header);
+}
+
+static int record(struct state *state, int argc, char **argv)
+{
+	struct record record = {
+		.state = state,
+		.interval_ns = 10000000000ULL,
+	};
+	unsigned long rotate_size = 0;
+	unsigned long rotate_keep = 4;
+	char *path = NULL;
+	float interval;
+	int close_ret;
+	int optchar;
+	char *end;
+	int ret;
+
+	while ((optchar = getopt(argc, argv, "ho:w:R:k:")) != -1) {
+		switch (optchar) {
+		case 'h':
+			record_usage();
+			return EXIT_SUCCESS;
+		case 'o':
+			path = optarg;
+			break;
+		case 'w':
+			if (!sscanf(optarg, "%f", &interval) ||
+			    interval <= 0.0f) {
+				fprintf(stderr, "Error - provided argument of '-%c' is not a positive number\n",
+					optchar);
+				return EXIT_FAILURE;
+			}
+
+			record.interval_ns = interval * 1000000000.0;
+			break;
+		case 'R':
+			rotate_size = strtoul(optarg, &end, 10);
+			if (!*optarg || *end || !rotate_size) {
+				fprintf(stderr, "Error - provided argument of '-%c' is not a positive number\n",
+					optchar);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'k':
+			rotate_keep = strtoul(optarg, &end, 10);
+			if (!*optarg || *end || !rotate_keep) {
+				fprintf(stderr, "Error - provided argument of '-%c' is not a positive number\n",
+					optchar);
+				return EXIT_FAILURE;
+			}
+			break;
+		default:
+			record_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!path) {
+		fprintf(stderr, "Error - no output file given\n");
+		record_usage();
+		return EXIT_FAILURE;
+	}
+
+	check_root_or_die("batctl record");
+
+	if (!state->sock) {
+		fprintf(stderr, "Error - batman-adv netlink interface is not available\n");
+		return EXIT_FAILURE;
+	}
+
+	record.ifindex = if_nametoindex(state->mesh_iface);
+	if (!record.ifindex) {
+		fprintf(stderr, "Interface %s is unknown\n", state->mesh_iface);
+		return EXIT_FAILURE;
+	}
+
+	if (output_init(&record.header, -1, 512) < 0) {
+		fprintf(stderr, "Error - could not allocate output buffers\n");
+		return EXIT_FAILURE;
+	}
+
+	ret = record_tables_init(&record, argc - optind, argv + optind);
+	if (ret < 0)
+		goto err;
+
+	ret = record_events_init(&record);
+	if (ret < 0) {
+		fprintf(stderr, "Error - failed to join batadv multicast groups: %s\n",
+			strerror(-ret));
+		goto err;
+	}
+
+	record.rec = recorder_open(path, state->mesh_iface,
+				   rotate_size * 1024 * 1024, rotate_keep);
+	if (!record.rec) {
+		fprintf(stderr, "Error - can't create '%s': %s\n", path,
+			strerror(errno));
+		goto err;
+	}
+
+	signal(SIGINT, record_sig_handler);
+	signal(SIGTERM, record_sig_handler);
+
+	ret = record_run(&record);
+	close_ret = recorder_close(record.rec);
+	if (ret == 0)
+		ret = close_ret;
+
+	if (ret < 0) {
+		fprintf(stderr, "Error - failed to write the recording: %s\n",
+			strerror(-ret));
+		goto err;
+	}
+
+	record_free(&record);
+
+	return EXIT_SUCCESS;
+
+err:
+	record_free(&record);
+
+	return EXIT_FAILURE;
+}
+
+COMMAND(SUBCOMMAND, record, "rc", COMMAND_FLAG_MESH_IFACE | COMMAND_FLAG_NETLINK,
+	NULL, "                  \trecord debug tables and events to a file");
@@ -0,0 +1,825 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hash.h"
+#include "output.h"
+#include "recorder.h"
+
+#define RECORDER_MAX_TABLES 16
+
+/* size of the buffered records which is handed to write() at once */
+#define RECORDER_FLUSH_SIZE (64 * 1024)
+
+/* row of the previous sample - hash entry */
+struct recorder_row {
+	const uint8_t *data;
+	uint32_t len;
+	uint32_t idx;
+};
+
+struct recorder_table {
+	uint8_t nl_cmd;
+
+	/* header of the last sample */
+	char *header;
+	size_t header_len;
+
+	/* rows of the current and of the previous sample */
+	struct recorder_rows rows[2];
+	unsigned int cur;
+
+	/* rows of the previous sample by their content */
+	struct hashtable_t *hash;
+	struct recorder_row *entries;
+	size_t entries_size;
+
+	/* pending run of rows which are equal to previous ones */
+	struct recorder_ref run;
+	size_t next_ref;
+};
+
+struct recorder {
+	char *path;
+	int fd;
+	size_t file_size;
+	size_t rotate_size;
+	unsigned int rotate_keep;
+	char mesh_iface[IF_NAMESIZE];
+	struct output out;
+	int err;
+
+	struct recorder_table tables[RECORDER_MAX_TABLES];
+	size_t num_tables;
+
+	/* table of the sample which is written */
+	struct recorder_table *table;
+};
+
+uint64_t recorder_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int compare_recorder_row(void *data1, void *data2)
+{
+	const struct recorder_row *row1 = data1;
+	const struct recorder_row *row2 = data2;
+
+	if (row1->len != row2->len)
+		return 0;
+
+	return (memcmp(row1->data, row2->data, row1->len) == 0 ? 1 : 0);
+}
+
+static int choose_recorder_row(void *data, int32_t size)
+{
+	const struct recorder_row *row = data;
+
+	return (hash_bytes(row->data, row->len) % size);
+}
+
+int recorder_rows_add(struct recorder_rows *rows, const struct nlmsghdr *nlh)
+{
+	size_t len = NLMSG_ALIGN(nlh->nlmsg_len);
+	size_t *offs;
+	uint8_t *buf;
+	size_t size;
+
+	if (rows->len + len > rows->size) {
+		size = rows->size ? rows->size : 64 * 1024;
+		while (size < rows->len + len)
+			size *= 2;
+
+		buf = realloc(rows->buf, size);
+		if (!buf)
+			return -ENOMEM;
+
+		rows->buf = buf;
+		rows->size = size;
+	}
+
+	if (rows->num == rows->offs_size) {
+		size = rows->offs_size ? rows->offs_size * 2 : 256;
+
+		offs = realloc(rows->offs, size * sizeof(*offs));
+		if (!offs)
+			return -ENOMEM;
+
+		rows->offs = offs;
+		rows->offs_size = size;
+	}
+
+	memcpy(rows->buf + rows->len, nlh, nlh->nlmsg_len);
+	memset(rows->buf + rows->len + nlh->nlmsg_len, 0,
+	       len - nlh->nlmsg_len);
+	rows->offs[rows->num++] = rows->len;
+	rows->len += len;
+
+	return 0;
+}
+
+/**
+ * recorder_rows_apply - add the rows of a record to a sample
+ * @rows: rows of the sample which is read
+ * @prev: rows of the previous sample of the same table
+ * @rec: RECORDER_ROW or RECORDER_ROW_REF record
+ * @payload: payload of @rec
+ *
+ * Return: 0 on success, negative error when the record is malformed
+ */
+int recorder_rows_apply(struct recorder_rows *rows,
+			const struct recorder_rows *prev,
+			const struct recorder_rec *rec, const uint8_t *payload)
+{
+	const struct nlmsghdr *nlh;
+	struct recorder_ref ref;
+	size_t i;
+	int ret;
+
+	switch (rec->type) {
+	case RECORDER_ROW:
+		nlh = (const struct nlmsghdr *)payload;
+
+		if (rec->len < sizeof(*nlh) || nlh->nlmsg_len > rec->len ||
+		    nlh->nlmsg_len < sizeof(*nlh))
+			return -EINVAL;
+
+		return recorder_rows_add(rows, nlh);
+	case RECORDER_ROW_REF:
+		if (rec->len < sizeof(ref))
+			return -EINVAL;
+
+		memcpy(&ref, payload, sizeof(ref));
+		if (ref.first > prev->num || ref.count > prev->num - ref.first)
+			return -EINVAL;
+
+		for (i = ref.first; i < ref.first + ref.count; i++) {
+			ret = recorder_rows_add(rows,
+						recorder_rows_get(prev, i));
+			if (ret < 0)
+				return ret;
+		}
+
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+void recorder_rows_free(struct recorder_rows *rows)
+{
+	free(rows->buf);
+	free(rows->offs);
+	memset(rows, 0, sizeof(*rows));
+}
+
+static int recorder_write(int fd, const void *data, size_t len)
+{
+	const uint8_t *buf = data;
+	ssize_t ret;
+
+	while (len) {
+		ret = write(fd, buf, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			return -errno;
+		}
+
+		buf += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+static int recorder_flush(struct recorder *rec)
+{
+	int ret;
+
+	if (rec->err)
+		return rec->err;
+
+	ret = recorder_write(rec->fd, rec->out.buf, rec->out.len);
+	output_reset(&rec->out);
+
+	if (ret < 0)
+		rec->err = ret;
+
+	return ret;
+}
+
+static void recorder_put(struct recorder *rec, uint8_t type, uint8_t nl_cmd,
+			 const void *data1, size_t len1,
+			 const void *data2, size_t len2)
+{
+	static const uint8_t padding[4];
+	struct recorder_rec hdr = {
+		.len = len1 + len2,
+		.type = type,
+		.nl_cmd = nl_cmd,
+	};
+	size_t pad = RECORDER_ALIGN(hdr.len) - hdr.len;
+
+	output_mem(&rec->out, (const char *)&hdr, sizeof(hdr));
+	output_mem(&rec->out, data1, len1);
+	output_mem(&rec->out, data2, len2);
+	output_mem(&rec->out, (const char *)padding, pad);
+
+	rec->file_size += sizeof(hdr) + hdr.len + pad;
+
+	if (rec->out.len >= RECORDER_FLUSH_SIZE)
+		recorder_flush(rec);
+}
+
+static int recorder_file_open(struct recorder *rec)
+{
+	struct recorder_file_hdr hdr;
+	struct timespec ts;
+	int ret;
+
+	rec->fd = open(rec->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+		       0644);
+	if (rec->fd < 0)
+		return -errno;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, RECORDER_MAGIC, sizeof(hdr.magic));
+	hdr.version = RECORDER_VERSION;
+	hdr.start_mono_ns = recorder_now();
+	clock_gettime(CLOCK_REALTIME, &ts);
+	hdr.start_real_ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	memcpy(hdr.mesh_iface, rec->mesh_iface, sizeof(hdr.mesh_iface));
+
+	ret = recorder_write(rec->fd, &hdr, sizeof(hdr));
+	if (ret < 0)
+		return ret;
+
+	rec->file_size = sizeof(hdr);
+
+	return 0;
+}
+
+static void recorder_table_reset(struct recorder_table *table)
+{
+	free(table->header);
+	table->header = NULL;
+	table->header_len = 0;
+
+	recorder_rows_reset(&table->rows[0]);
+	recorder_rows_reset(&table->rows[1]);
+
+	if (table->hash) {
+		hash_delete(table->hash, NULL);
+		table->hash = NULL;
+	}
+}
+
+/* continue in a new file - the old ones are kept as <path>.1 .. <path>.N */
+static int recorder_rotate(struct recorder *rec)
+{
+	char *oldpath = NULL;
+	char *newpath = NULL;
+	unsigned int i;
+	size_t len;
+	int ret;
+
+	ret = recorder_flush(rec);
+	if (ret < 0)
+		return ret;
+
+	close(rec->fd);
+	rec->fd = -1;
+
+	len = strlen(rec->path) + 12;
+	oldpath = malloc(len);
+	newpath = malloc(len);
+	if (!oldpath || !newpath) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (i = rec->rotate_keep; i > 0; i--) {
+		if (i == 1)
+			snprintf(oldpath, len, "%s", rec->path);
+		else
+			snprintf(oldpath, len, "%s.%u", rec->path, i - 1);
+
+		snprintf(newpath, len, "%s.%u", rec->path, i);
+
+		if (rename(oldpath, newpath) < 0 && errno != ENOENT) {
+			ret = -errno;
+			goto out;
+		}
+	}
+
+	/* every file starts with full samples */
+	for (i = 0; i < rec->num_tables; i++)
+		recorder_table_reset(&rec->tables[i]);
+
+	ret = recorder_file_open(rec);
+
+out:
+	free(oldpath);
+	free(newpath);
+
+	if (ret < 0)
+		rec->err = ret;
+
+	return ret;
+}
+
+/**
+ * recorder_open - start a recording
+ * @path: file which is written
+ * @mesh_iface: name of the recorded mesh interface
+ * @rotate_size: size in bytes after which the next file is started (or 0)
+ * @rotate_keep: number of rotated files which are kept
+ *
+ * Return: recorder on success, NULL on error (with errno set)
+ */
+struct recorder *recorder_open(const char *path, const char *mesh_iface,
+			       size_t rotate_size, unsigned int rotate_keep)
+{
+	struct recorder *rec;
+	int ret;
+
+	rec = calloc(1, sizeof(*rec));
+	if (!rec) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	rec->fd = -1;
+	rec->rotate_size = rotate_size;
+	rec->rotate_keep = rotate_keep;
+	snprintf(rec->mesh_iface, sizeof(rec->mesh_iface), "%s", mesh_iface);
+
+	rec->path = strdup(path);
+	if (!rec->path) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	ret = output_init(&rec->out, -1, 2 * RECORDER_FLUSH_SIZE);
+	if (ret < 0)
+		goto err;
+
+	ret = recorder_file_open(rec);
+	if (ret < 0)
+		goto err;
+
+	return rec;
+
+err:
+	recorder_close(rec);
+	errno = -ret;
+
+	return NULL;
+}
+
+/**
+ * recorder_close - write the buffered records and free the recorder
+ * @rec: recorder
+ *
+ * Return: 0 when everything was written, negative error otherwise
+ */
+int recorder_close(struct recorder *rec)
+{
+	size_t i;
+	int ret;
+
+	if (rec->fd >= 0) {
+		recorder_flush(rec);
+
+		if (close(rec->fd) < 0 && !rec->err)
+			rec->err = -errno;
+	}
+
+	for (i = 0; i < rec->num_tables; i++) {
+		recorder_table_reset(&rec->tables[i]);
+		recorder_rows_free(&rec->tables[i].rows[0]);
+		recorder_rows_free(&rec->tables[i].rows[1]);
+		free(rec->tables[i].entries);
+	}
+
+	ret = rec->err;
+
+	output_free(&rec->out);
+	free(rec->path);
+	free(rec);
+
+	return ret;
+}
+
+static int recorder_check_rotate(struct recorder *rec)
+{
+	if (rec->err)
+		return rec->err;
+
+	if (!rec->rotate_size || rec->file_size < rec->rotate_size)
+		return 0;
+
+	return recorder_rotate(rec);
+}
+
+static struct recorder_table *recorder_table_get(struct recorder *rec,
+						 uint8_t nl_cmd)
+{
+	struct recorder_table *table;
+	size_t i;
+
+	for (i = 0; i < rec->num_tables; i++) {
+		if (rec->tables[i].nl_cmd == nl_cmd)
+			return &rec->tables[i];
+	}
+
+	if (rec->num_tables == RECORDER_MAX_TABLES)
+		return NULL;
+
+	table = &rec->tables[rec->num_tables++];
+	table->nl_cmd = nl_cmd;
+
+	return table;
+}
+
+/**
+ * recorder_sample_begin - start the sample of a debug table
+ * @rec: recorder
+ * @nl_cmd: dump command of the table
+ * @ts: CLOCK_MONOTONIC timestamp of the sample in ns
+ * @header: text header of the table
+ * @header_len: length of @header
+ *
+ * Return: 0 on success, negative error otherwise
+ */
+int recorder_sample_begin(struct recorder *rec, uint8_t nl_cmd, uint64_t ts,
+			  const char *header, size_t header_len)
+{
+	struct recorder_table *table;
+	int ret;
+
+	ret = recorder_check_rotate(rec);
+	if (ret < 0)
+		return ret;
+
+	table = recorder_table_get(rec, nl_cmd);
+	if (!table)
+		return -ENOSPC;
+
+	rec->table = table;
+
+	recorder_put(rec, RECORDER_SAMPLE, nl_cmd, &ts, sizeof(ts), NULL, 0);
+
+	if (!table->header || table->header_len != header_len ||
+	    memcmp(table->header, header, header_len) != 0) {
+		free(table->header);
+		table->header_len = 0;
+
+		table->header = malloc(header_len + 1);
+		if (table->header) {
+			memcpy(table->header, header, header_len);
+			table->header_len = header_len;
+		}
+
+		recorder_put(rec, RECORDER_HEADER, nl_cmd, header, header_len,
+			     NULL, 0);
+	}
+
+	recorder_rows_reset(&table->rows[table->cur]);
+	table->run.count = 0;
+	table->next_ref = 0;
+
+	return rec->err;
+}
+
+static void recorder_flush_run(struct recorder *rec)
+{
+	struct recorder_table *table = rec->table;
+
+	if (!table->run.count)
+		return;
+
+	recorder_put(rec, RECORDER_ROW_REF, table->nl_cmd, &table->run,
+		     sizeof(table->run), NULL, 0);
+	table->run.count = 0;
+}
+
+static bool recorder_find_row(struct recorder_table *table,
+			      struct recorder_row *row)
+{
+	const struct recorder_rows *prev = &table->rows[!table->cur];
+	const struct nlmsghdr *nlh;
+	struct recorder_row *found;
+
+	/* most tables are dumped in the same order again */
+	if (table->next_ref < prev->num) {
+		nlh = recorder_rows_get(prev, table->next_ref);
+
+		if (nlh->nlmsg_len == row->len &&
+		    memcmp(nlh, row->data, row->len) == 0) {
+			row->idx = table->next_ref;
+			return true;
+		}
+	}
+
+	if (!table->hash)
+		return false;
+
+	found = hash_find(table->hash, row);
+	if (!found)
+		return false;
+
+	row->idx = found->idx;
+
+	return true;
+}
+
+/**
+ * recorder_sample_row - add a message of the dump to the sample
+ * @rec: recorder
+ * @nlh: message of the dump
+ *
+ * Return: 0 on success, negative error otherwise
+ */
+int recorder_sample_row(struct recorder *rec, const struct nlmsghdr *nlh)
+{
+	struct recorder_table *table = rec->table;
+	struct recorder_rows *rows;
+	struct recorder_row row;
+	struct nlmsghdr *copy;
+	int ret;
+
+	rows = &table->rows[table->cur];
+
+	ret = recorder_rows_add(rows, nlh);
+	if (ret < 0)
+		return ret;
+
+	/* sequence number and port change in every dump */
+	copy = recorder_rows_get(rows, rows->num - 1);
+	copy->nlmsg_flags = 0;
+	copy->nlmsg_seq = 0;
+	copy->nlmsg_pid = 0;
+
+	row.data = (const uint8_t *)copy;
+	row.len = copy->nlmsg_len;
+
+	if (!recorder_find_row(table, &row)) {
+		recorder_flush_run(rec);
+		recorder_put(rec, RECORDER_ROW, table->nl_cmd, copy, row.len,
+			     NULL, 0);
+		return rec->err;
+	}
+
+	if (table->run.count &&
+	    table->run.first + table->run.count == row.idx) {
+		table->run.count++;
+	} else {
+		recorder_flush_run(rec);
+		table->run.first = row.idx;
+		table->run.count = 1;
+	}
+
+	table->next_ref = row.idx + 1;
+
+	return rec->err;
+}
+
+/* index the rows of the sample for the comparison with the next one */
+static int recorder_index_rows(struct recorder_table *table)
+{
+	const struct recorder_rows *rows = &table->rows[table->cur];
+	struct recorder_row *entries;
+	const struct nlmsghdr *nlh;
+	size_t size;
+	size_t i;
+
+	if (table->hash) {
+		hash_delete(table->hash, NULL);
+		table->hash = NULL;
+	}
+
+	if (!rows->num)
+		return 0;
+
+	if (rows->num > table->entries_size) {
+		size = rows->num * 2;
+
+		entries = realloc(table->entries, size * sizeof(*entries));
+		if (!entries)
+			return -ENOMEM;
+
+		table->entries = entries;
+		table->entries_size = size;
+	}
+
+	size = rows->num < 64 ? 128 : rows->num * 2;
+
+	table->hash = hash_new(size, compare_recorder_row,
+			       choose_recorder_row);
+	if (!table->hash)
+		return -ENOMEM;
+
+	for (i = 0; i < rows->num; i++) {
+		nlh = recorder_rows_get(rows, i);
+
+		table->entries[i].data = (const uint8_t *)nlh;
+		table->entries[i].len = nlh->nlmsg_len;
+		table->entries[i].idx = i;
+
+		/* duplicates are referenced by their first occurrence */
+		if (!hash_find(table->hash, &table->entries[i]))
+			hash_add(table->hash, &table->entries[i]);
+	}
+
+	return 0;
+}
+
+/**
+ * recorder_sample_end - finish the sample of a debug table
+ * @rec: recorder
+ * @err: 0 when the table was dumped, negative error otherwise
+ *
+ * Return: 0 on success, negative error otherwise
+ */
+int recorder_sample_end(struct recorder *rec, int err)
+{
+	struct recorder_table *table = rec->table;
+	int32_t dump_err = err;
+
+	recorder_flush_run(rec);
+	recorder_put(rec, RECORDER_SAMPLE_END, table->nl_cmd, &dump_err,
+		     sizeof(dump_err), NULL, 0);
+
+	/* a failed dump is not a base for the next sample */
+	if (err < 0)
+		recorder_rows_reset(&table->rows[table->cur]);
+
+	/* without index, all rows of the next sample are stored in full */
+	if (recorder_index_rows(table) < 0 && table->hash) {
+		hash_delete(table->hash, NULL);
+		table->hash = NULL;
+	}
+
+	table->cur = !table->cur;
+	rec->table = NULL;
+
+	recorder_flush(rec);
+
+	return rec->err;
+}
+
+/**
+ * recorder_event - store a batadv netlink event
+ * @rec: recorder
+ * @ts: CLOCK_MONOTONIC timestamp of the event in ns
+ * @nlh: message of the event
+ *
+ * Return: 0 on success, negative error otherwise
+ */
+int recorder_event(struct recorder *rec, uint64_t ts,
+		   const struct nlmsghdr *nlh)
+{
+	int ret;
+
+	ret = recorder_check_rotate(rec);
+	if (ret < 0)
+		return ret;
+
+	recorder_put(rec, RECORDER_EVENT, 0, &ts, sizeof(ts), nlh,
+		     nlh->nlmsg_len);
+
+	return recorder_flush(rec);
+}
+
+/**
+ * recorder_reader_open - map a recording for reading
+ * @reader: reader which is initialized
+ * @path: recorded file
+ *
+ * Return: 0 on success, negative error otherwise
+ */
+int recorder_reader_open(struct recorder_reader *reader, const char *path)
+{
+	struct stat st;
+	void *map;
+	int ret;
+	int fd;
+
+	memset(reader, 0, sizeof(*reader));
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	if (fstat(fd, &st) < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	if ((size_t)st.st_size < sizeof(*reader->hdr)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		ret = -errno;
+		goto out;
+	}
+
+	reader->map = map;
+	reader->size = st.st_size;
+	reader->hdr = map;
+	reader->pos = sizeof(*reader->hdr);
+
+	if (memcmp(reader->hdr->magic, RECORDER_MAGIC,
+		   sizeof(reader->hdr->magic)) != 0 ||
+	    reader->hdr->version != RECORDER_VERSION) {
+		recorder_reader_close(reader);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	ret = 0;
+
+out:
+	close(fd);
+	return ret;
+}
+
+void recorder_reader_close(struct recorder_reader *reader)
+{
+	if (reader->map)
+		munmap((void *)reader->map, reader->size);
+
+	memset(reader, 0, sizeof(*reader));
+}
+
+/**
+ * recorder_read - get the next record of a recording
+ * @reader: reader
+ * @rec: returns the record
+ * @payload: returns the payload of the record
+ *
+ * Return: 1 when a record was read, 0 at the end of the file, negative error
+ *  when the file is truncated or corrupted
+ */
+int recorder_read(struct recorder_reader *reader,
+		  const struct recorder_rec **rec, const uint8_t **payload)
+{
+	size_t left = reader->size - reader->pos;
+	const struct recorder_rec *hdr;
+
+	if (!left)
+		return 0;
+
+	if (left < sizeof(*hdr))
+		return -EINVAL;
+
+	hdr = (const struct recorder_rec *)(reader->map + reader->pos);
+	left -= sizeof(*hdr);
+
+	if (hdr->len > left || RECORDER_ALIGN(hdr->len) > left)
+		return -EINVAL;
+
+	*rec = hdr;
+	*payload = (const uint8_t *)(hdr + 1);
+	reader->pos += sizeof(*hdr) + RECORDER_ALIGN(hdr->len);
+
+	return 1;
+}
@@ -0,0 +1,140 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#ifndef _BATCTL_RECORDER_H
+#define _BATCTL_RECORDER_H
+
+#include <net/if.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct nlmsghdr;
+struct recorder;
+
+/* On-disk format of batctl record
+ *
+ * A file starts with struct recorder_file_hdr which is followed by a stream
+ * of records. Each record is a struct recorder_rec and rec->len bytes of
+ * payload - padded to RECORDER_ALIGN(rec->len). All values are stored in the
+ * byte order of the recording host, just like the netlink messages which
+ * are embedded in the records.
+ *
+ * A sample of a debug table consists of RECORDER_SAMPLE, an optional
+ * RECORDER_HEADER (only when the header differs from the one of the last
+ * sample of the table), the rows and RECORDER_SAMPLE_END. Rows which are
+ * byte-identical to rows of the previous sample of the same table are only
+ * stored as RECORDER_ROW_REF runs.
+ */
+#define RECORDER_MAGIC "BATREC"
+#define RECORDER_VERSION 1
+#define RECORDER_ALIGN(len) (((len) + 3U) & ~3U)
+
+struct recorder_file_hdr {
+	char magic[6];
+	uint8_t version;
+	uint8_t reserved;
+
+	/* CLOCK_MONOTONIC and CLOCK_REALTIME when the file was started */
+	uint64_t start_mono_ns;
+	uint64_t start_real_ns;
+	char mesh_iface[IF_NAMESIZE];
+};
+
+enum recorder_type {
+	/* u64 CLOCK_MONOTONIC timestamp in ns */
+	RECORDER_SAMPLE,
+	/* text header of the table - not NUL terminated */
+	RECORDER_HEADER,
+	/* netlink message of the dump */
+	RECORDER_ROW,
+	/* u32 first row and u32 number of rows of the previous sample */
+	RECORDER_ROW_REF,
+	/* s32 error of the dump */
+	RECORDER_SAMPLE_END,
+	/* u64 CLOCK_MONOTONIC timestamp in ns + batadv netlink event */
+	RECORDER_EVENT,
+};
+
+struct recorder_rec {
+	uint32_t len;
+	uint8_t type;
+	uint8_t nl_cmd;
+	uint16_t reserved;
+};
+
+struct recorder_ref {
+	uint32_t first;
+	uint32_t count;
+};
+
+/* netlink messages of a sample */
+struct recorder_rows {
+	uint8_t *buf;
+	size_t len;
+	size_t size;
+	size_t *offs;
+	size_t num;
+	size_t offs_size;
+};
+
+struct recorder_reader {
+	const uint8_t *map;
+	size_t size;
+	size_t pos;
+	const struct recorder_file_hdr *hdr;
+};
+
+uint64_t recorder_now(void);
+
+struct recorder *recorder_open(const char *path, const char *mesh_iface,
+			       size_t rotate_size, unsigned int rotate_keep);
+int recorder_close(struct recorder *rec);
+int recorder_sample_begin(struct recorder *rec, uint8_t nl_cmd, uint64_t ts,
+			  const char *header, size_t header_len);
+int recorder_sample_row(struct recorder *rec, const struct nlmsghdr *nlh);
+int recorder_sample_end(struct recorder *rec, int err);
+int recorder_event(struct recorder *rec, uint64_t ts,
+		   const struct nlmsghdr *nlh);
+
+int recorder_reader_open(struct recorder_reader *reader, const char *path);
+void recorder_reader_close(struct recorder_reader *reader);
+int recorder_read(struct recorder_reader *reader,
+		  const struct recorder_rec **rec, const uint8_t **payload);
+
+int recorder_rows_add(struct recorder_rows *rows, const struct nlmsghdr *nlh);
+int recorder_rows_apply(struct recorder_rows *rows,
+			const struct recorder_rows *prev,
+			const struct recorder_rec *rec, const uint8_t *payload);
+void recorder_rows_free(struct recorder_rows *rows);
+
+static inline void recorder_rows_reset(struct recorder_rows *rows)
+{
+	rows->len = 0;
+	rows->num = 0;
+}
+
+static inline struct nlmsghdr *recorder_rows_get(const struct recorder_rows *rows,
+						 size_t idx)
+{
+	return (struct nlmsghdr *)(rows->buf + rows->offs[idx]);
+}
+
+#endif
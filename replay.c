@@ -0,0 +1,459 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <netlink/netlink.h>
+#include <netlink/genl/genl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "batman_adv.h"
+#include "bat-hosts.h"
+#include "debug.h"
+#include "functions.h"
+#include "main.h"
+#include "netlink.h"
+#include "output.h"
+#include "recorder.h"
+
+extern const struct command *__start___command[];
+extern const struct command *__stop___command[];
+
+struct replay {
+	struct recorder_reader reader;
+	int read_opt;
+	bool all;
+
+	/* CLOCK_MONOTONIC time up to which samples are used (or 0) */
+	uint64_t limit;
+
+	/* replayed table */
+	const struct command *cmd;
+	const struct debug_table_data *data;
+	struct recorder_rows rows[2];
+	unsigned int cur;
+	const char *header;
+	size_t header_len;
+	uint64_t ts;
+	int err;
+	bool in_sample;
+
+	/* last complete sample */
+	bool complete;
+	unsigned int complete_idx;
+	uint64_t complete_ts;
+	const char *complete_header;
+	size_t complete_header_len;
+	int complete_err;
+
+	/* rows per table of the samples which are listed */
+	size_t num_rows[256];
+
+	struct print_opts opts;
+	struct output header_buf;
+};
+
+static void replay_usage(void)
+{
+	fprintf(stderr, "Usage: batctl [options] replay [parameters] file [table]\n");
+	fprintf(stderr, "parameters:\n");
+	fprintf(stderr, " \t -h print this help\n");
+	fprintf(stderr, " \t -a print every sample of the table\n");
+	fprintf(stderr, " \t -t time - print the table x.y seconds after the start of the recording (default: end)\n");
+	fprintf(stderr, " \t -n don't replace mac addresses with bat-host names\n");
+	fprintf(stderr, " \t -H don't show the header\n");
+}
+
+static const struct command *replay_table_cmd(uint8_t nl_cmd)
+{
+	const struct debug_table_data *data;
+	const struct command **p;
+
+	for (p = __start___command; p < __stop___command; p++) {
+		if ((*p)->type != DEBUGTABLE)
+			continue;
+
+		data = (*p)->arg;
+		if (data && data->netlink_cb && data->nl_cmd == nl_cmd)
+			return *p;
+	}
+
+	return NULL;
+}
+
+static void replay_print_time(struct replay *replay, uint64_t ts)
+{
+	const struct recorder_file_hdr *hdr = replay->reader.hdr;
+	uint64_t real_ns;
+	char buf[32];
+	struct tm tm;
+	time_t secs;
+
+	real_ns = hdr->start_real_ns + (ts - hdr->start_mono_ns);
+	secs = real_ns / 1000000000ULL;
+
+	localtime_r(&secs, &tm);
+	strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+
+	output_printf(&replay->opts.out, "%s.%03u (+%.3fs)", buf,
+		      (unsigned int)(real_ns % 1000000000ULL / 1000000),
+		      (ts - hdr->start_mono_ns) / 1000000000.0);
+}
+
+static void replay_print_event(struct replay *replay, const uint8_t *payload,
+			       size_t len)
+{
+	struct nlattr *attrs[NUM_BATADV_ATTR];
+	const struct nlmsghdr *nlh;
+	struct genlmsghdr *ghdr;
+	uint64_t ts;
+
+	if (len < sizeof(ts) + NLMSG_HDRLEN + GENL_HDRLEN)
+		return;
+
+	memcpy(&ts, payload, sizeof(ts));
+	nlh = (const struct nlmsghdr *)(payload + sizeof(ts));
+	if (nlh->nlmsg_len > len - sizeof(ts))
+		return;
+
+	ghdr = nlmsg_data(nlh);
+	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
+		      genlmsg_len(ghdr), batadv_netlink_policy))
+		return;
+
+	replay_print_time(replay, ts);
+
+	if (ghdr->cmd == BATADV_CMD_TP_METER &&
+	    attrs[BATADV_ATTR_TPMETER_COOKIE] &&
+	    attrs[BATADV_ATTR_TPMETER_RESULT])
+		output_printf(&replay->opts.out, " event tp_meter 0x%08x: result %u\n",
+			      nla_get_u32(attrs[BATADV_ATTR_TPMETER_COOKIE]),
+			      nla_get_u8(attrs[BATADV_ATTR_TPMETER_RESULT]));
+	else
+		output_printf(&replay->opts.out, " event %u\n", ghdr->cmd);
+}
+
+/* overview of the recording when no table was selected */
+static int replay_list(struct replay *replay)
+{
+	const struct recorder_rec *rec;
+	const struct command *cmd;
+	const uint8_t *payload;
+	struct recorder_ref ref;
+	uint64_t ts = 0;
+	int32_t err;
+	int ret;
+
+	output_printf(&replay->opts.out, "Recording of %.*s started ",
+		      (int)sizeof(replay->reader.hdr->mesh_iface),
+		      replay->reader.hdr->mesh_iface);
+	replay_print_time(replay, replay->reader.hdr->start_mono_ns);
+	output_char(&replay->opts.out, '\n');
+
+	while ((ret = recorder_read(&replay->reader, &rec, &payload)) > 0) {
+		switch (rec->type) {
+		case RECORDER_SAMPLE:
+			if (rec->len < sizeof(ts))
+				return -EINVAL;
+
+			memcpy(&ts, payload, sizeof(ts));
+			replay->num_rows[rec->nl_cmd] = 0;
+			break;
+		case RECORDER_ROW:
+			replay->num_rows[rec->nl_cmd]++;
+			break;
+		case RECORDER_ROW_REF:
+			if (rec->len < sizeof(ref))
+				return -EINVAL;
+
+			memcpy(&ref, payload, sizeof(ref));
+			replay->num_rows[rec->nl_cmd] += ref.count;
+			break;
+		case RECORDER_SAMPLE_END:
+			if (rec->len < sizeof(err))
+				return -EINVAL;
+
+			memcpy(&err, payload, sizeof(err));
+			cmd = replay_table_cmd(rec->nl_cmd);
+
+			replay_print_time(replay, ts);
+			output_printf(&replay->opts.out, " table %s: ",
+				      cmd ? cmd->name : "unknown");
+
+			if (err < 0)
+				output_printf(&replay->opts.out, "%s\n",
+					      strerror(-err));
+			else
+				output_printf(&replay->opts.out, "%zu rows\n",
+					      replay->num_rows[rec->nl_cmd]);
+			break;
+		case RECORDER_EVENT:
+			replay_print_event(replay, payload, rec->len);
+			break;
+		}
+
+		output_flush(&replay->opts.out);
+	}
+
+	return ret;
+}
+
+static void replay_print(struct replay *replay)
+{
+	const struct recorder_rows *rows = &replay->rows[replay->complete_idx];
+	struct print_opts *opts = &replay->opts;
+	size_t i;
+
+	if (replay->complete_err < 0) {
+		fprintf(stderr, "Error - table %s could not be dumped: %s\n",
+			replay->cmd->name, strerror(-replay->complete_err));
+		return;
+	}
+
+	opts->remaining_header = NULL;
+
+	if (!(opts->read_opt & SKIP_HEADER)) {
+		replay_print_time(replay, replay->complete_ts);
+		output_char(&opts->out, '\n');
+
+		output_reset(&replay->header_buf);
+		output_mem(&replay->header_buf, replay->complete_header,
+			   replay->complete_header_len);
+		output_char(&replay->header_buf, '\0');
+		opts->remaining_header = replay->header_buf.buf;
+	}
+
+	for (i = 0; i < rows->num; i++)
+		netlink_print_common_cb(recorder_rows_get(rows, i), opts);
+
+	netlink_print_remaining_header(opts);
+	output_flush(&opts->out);
+}
+
+static int replay_table(struct replay *replay)
+{
+	uint8_t nl_cmd = replay->data->nl_cmd;
+	const struct recorder_rec *rec;
+	const uint8_t *payload;
+	int32_t err;
+	uint64_t ts;
+	int ret;
+
+	while ((ret = recorder_read(&replay->reader, &rec, &payload)) > 0) {
+		if (rec->nl_cmd != nl_cmd || rec->type == RECORDER_EVENT)
+			continue;
+
+		switch (rec->type) {
+		case RECORDER_SAMPLE:
+			if (rec->len < sizeof(ts))
+				return -EINVAL;
+
+			memcpy(&ts, payload, sizeof(ts));
+
+			/* the last complete sample is the one before - with -a
+			 * it was already printed
+			 */
+			if (replay->limit && ts > replay->limit &&
+			    replay->complete) {
+				if (replay->all)
+					return 0;
+
+				goto print;
+			}
+
+			replay->cur = !replay->cur;
+			recorder_rows_reset(&replay->rows[replay->cur]);
+			replay->ts = ts;
+			replay->in_sample = true;
+			break;
+		case RECORDER_HEADER:
+			replay->header = (const char *)payload;
+			replay->header_len = rec->len;
+			break;
+		case RECORDER_ROW:
+		case RECORDER_ROW_REF:
+			if (!replay->in_sample)
+				return -EINVAL;
+
+			ret = recorder_rows_apply(&replay->rows[replay->cur],
+						  &replay->rows[!replay->cur],
+						  rec, payload);
+			if (ret < 0)
+				return ret;
+			break;
+		case RECORDER_SAMPLE_END:
+			if (!replay->in_sample || rec->len < sizeof(err))
+				return -EINVAL;
+
+			memcpy(&err, payload, sizeof(err));
+
+			/* a failed dump is not a base for the next sample */
+			if (err < 0)
+				recorder_rows_reset(&replay->rows[replay->cur]);
+
+			replay->in_sample = false;
+			replay->complete = true;
+			replay->complete_idx = replay->cur;
+			replay->complete_ts = replay->ts;
+			replay->complete_header = replay->header;
+			replay->complete_header_len = replay->header_len;
+			replay->complete_err = err;
+
+			if (replay->all)
+				replay_print(replay);
+			break;
+		}
+	}
+
+	if (ret < 0)
+		fprintf(stderr, "Warning - recording is truncated or corrupted\n");
+
+	if (replay->all)
+		return 0;
+
+print:
+	if (!replay->complete) {
+		fprintf(stderr, "Error - no sample of table %s was recorded\n",
+			replay->cmd->name);
+		return -ENOENT;
+	}
+
+	replay_print(replay);
+
+	return 0;
+}
+
+static int replay(struct state *state, int argc, char **argv)
+{
+	struct replay replay = {
+		.read_opt = USE_BAT_HOSTS,
+	};
+	float offset = 0.0f;
+	int optchar;
+	int ret;
+
+	while ((optchar = getopt(argc, argv, "hat:nH")) != -1) {
+		switch (optchar) {
+		case 'h':
+			replay_usage();
+			return EXIT_SUCCESS;
+		case 'a':
+			replay.all = true;
+			break;
+		case 't':
+			if (!sscanf(optarg, "%f", &offset) || offset < 0.0f) {
+				fprintf(stderr, "Error - provided argument of '-%c' is not a positive number\n",
+					optchar);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'n':
+			replay.read_opt &= ~USE_BAT_HOSTS;
+			break;
+		case 'H':
+			replay.read_opt |= SKIP_HEADER;
+			break;
+		default:
+			replay_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind >= argc || argc - optind > 2) {
+		replay_usage();
+		return EXIT_FAILURE;
+	}
+
+	if (argc - optind == 2) {
+		replay.cmd = debug_table_find(argv[optind + 1]);
+		if (replay.cmd)
+			replay.data = replay.cmd->arg;
+
+		if (!replay.data || !replay.data->netlink_cb) {
+			fprintf(stderr, "Error - unknown debug table: %s\n",
+				argv[optind + 1]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!replay.data && state->output_format != OUTPUT_FORMAT_TEXT) {
+		fprintf(stderr, "Error - the list of a recording only supports the text output format\n");
+		return EXIT_FAILURE;
+	}
+
+	ret = recorder_reader_open(&replay.reader, argv[optind]);
+	if (ret < 0) {
+		fprintf(stderr, "Error - can't read recording '%s': %s\n",
+			argv[optind], strerror(-ret));
+		return EXIT_FAILURE;
+	}
+
+	if (offset > 0.0f)
+		replay.limit = replay.reader.hdr->start_mono_ns +
+			       offset * 1000000000.0;
+
+	if (output_init(&replay.opts.out, STDOUT_FILENO, OUTPUT_BUF_SIZE) < 0 ||
+	    output_init(&replay.header_buf, -1, 512) < 0) {
+		fprintf(stderr, "Error - could not allocate output buffers\n");
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	if (!replay.data) {
+		ret = replay_list(&replay);
+		if (ret < 0)
+			fprintf(stderr, "Warning - recording is truncated or corrupted\n");
+
+		ret = 0;
+		goto out;
+	}
+
+	/* records are streamed - no text header */
+	output_set_format(&replay.opts.out, state->output_format,
+			  !(replay.read_opt & SKIP_HEADER));
+	if (replay.opts.out.format != OUTPUT_FORMAT_TEXT)
+		replay.read_opt |= SKIP_HEADER;
+
+	replay.opts.read_opt = replay.read_opt;
+	replay.opts.callback = replay.data->netlink_cb;
+	replay.opts.nl_cmd = replay.data->nl_cmd;
+
+	bat_hosts_init(replay.read_opt);
+	ret = replay_table(&replay);
+	bat_hosts_free();
+
+out:
+	output_free(&replay.opts.out);
+	output_free(&replay.header_buf);
+	recorder_rows_free(&replay.rows[0]);
+	recorder_rows_free(&replay.rows[1]);
+	recorder_reader_close(&replay.reader);
+
+	return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+COMMAND(SUBCOMMAND, replay, "rp", COMMAND_FLAG_OUTPUT_FORMAT, NULL,
+	"<file> [table]    \treplay a recording of batctl record");
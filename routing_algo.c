@@ -30,6 +30,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "batadv_packet.h"
 #include "batman_adv.h"
@@ -50,16 +51,21 @@ static void ra_mode_usage(void)
 	fprintf(stderr, " \t -h print this help\n");
 }
 
-static const int routing_algos_mandatory[] = {
-	BATADV_ATTR_ALGO_NAME,
+struct routing_algos_row {
+	const char *algo_name;
+};
+
+static const struct netlink_attr_desc routing_algos_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_ALGO_NAME, STRING,
+			 struct routing_algos_row, algo_name),
 };
 
-static int routing_algos_callback(struct nl_msg *msg, void *arg __maybe_unused)
+static int routing_algos_callback(struct nlmsghdr *nlh, void *arg)
 {
-	struct nlattr *attrs[BATADV_ATTR_MAX+1];
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct print_opts *opts = arg;
+	struct routing_algos_row row;
 	struct genlmsghdr *ghdr;
-	const char *algo_name;
+	int ret;
 
 	if (!genlmsg_valid_hdr(nlh, 0)) {
 		fputs("Received invalid data from kernel.\n", stderr);
@@ -71,31 +77,33 @@ static int routing_algos_callback(struct nl_msg *msg, void *arg __maybe_unused)
 	if (ghdr->cmd != BATADV_CMD_GET_ROUTING_ALGOS)
 		return NL_OK;
 
-	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
-		      genlmsg_len(ghdr), batadv_netlink_policy)) {
-		fputs("Received invalid data from kernel.\n", stderr);
-		exit(1);
-	}
-
-	if (missing_mandatory_attrs(attrs, routing_algos_mandatory,
-				    ARRAY_SIZE(routing_algos_mandatory))) {
+	ret = netlink_decode_attrs(ghdr, routing_algos_attrs,
+				   ARRAY_SIZE(routing_algos_attrs),
+				   &row, sizeof(row), NULL);
+	if (ret == -ENOENT) {
 		fputs("Missing attributes from kernel\n", stderr);
 		exit(1);
+	} else if (ret < 0) {
+		fputs("Received invalid data from kernel.\n", stderr);
+		exit(1);
 	}
 
-	algo_name = nla_get_string(attrs[BATADV_ATTR_ALGO_NAME]);
-
-	printf(" * %s\n", algo_name);
+	output_str(&opts->out, " * ");
+	output_str(&opts->out, row.algo_name);
+	output_char(&opts->out, '\n');
 
 	return NL_OK;
 }
 
 static int netlink_print_routing_algos(void)
 {
+	struct netlink_dump_buf *buf;
 	struct nl_sock *sock;
 	struct nl_msg *msg;
-	struct nl_cb *cb;
+	uint32_t seq;
 	int family;
+	int nl_err;
+	int ret;
 	struct print_opts opts = {
 		.callback = routing_algos_callback,
 	};
@@ -112,40 +120,56 @@ static int netlink_print_routing_algos(void)
 		goto err_free_sock;
 	}
 
+	if (output_init(&opts.out, STDOUT_FILENO, OUTPUT_BUF_SIZE) < 0) {
+		last_err = -ENOMEM;
+		goto err_free_sock;
+	}
+
+	buf = netlink_dump_buf_alloc();
+	if (!buf) {
+		last_err = -ENOMEM;
+		goto err_free_out;
+	}
+
 	msg = nlmsg_alloc();
 	if (!msg) {
 		last_err = -ENOMEM;
-		goto err_free_sock;
+		goto err_free_buf;
 	}
 
 	genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, family, 0, NLM_F_DUMP,
 		    BATADV_CMD_GET_ROUTING_ALGOS, 1);
 
 	nl_send_auto_complete(sock, msg);
+	seq = nlmsg_hdr(msg)->nlmsg_seq;
 
 	nlmsg_free(msg);
 
-	opts.remaining_header = strdup("Available routing algorithms:\n");
+	opts.remaining_header = "Available routing algorithms:\n";
 
-	cb = nl_cb_alloc(NL_CB_DEFAULT);
-	if (!cb) {
-		last_err = -ENOMEM;
-		goto err_free_sock;
-	}
+	last_err = 0;
+	ret = netlink_dump_recv(sock, buf, seq, netlink_print_common_cb, &opts,
+				&nl_err);
+	if (ret < 0) {
+		last_err = ret;
+	} else if (nl_err < 0) {
+		if (nl_err != -EOPNOTSUPP)
+			fprintf(stderr, "Error received: %s\n",
+				strerror(-nl_err));
 
-	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, netlink_print_common_cb,
-		  &opts);
-	nl_cb_set(cb, NL_CB_FINISH, NL_CB_CUSTOM, netlink_stop_callback, NULL);
-	nl_cb_err(cb, NL_CB_CUSTOM, netlink_print_error, NULL);
+		last_err = nl_err;
+	}
 
-	nl_recvmsgs(sock, cb);
+err_free_buf:
+	netlink_dump_buf_free(buf);
+err_free_out:
+	if (!last_err)
+		netlink_print_remaining_header(&opts);
 
+	output_free(&opts.out);
 err_free_sock:
 	nl_socket_free(sock);
 
-	if (!last_err)
-		netlink_print_remaining_header(&opts);
-
 	return last_err;
 }
 
@@ -0,0 +1,622 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <net/if.h>
+#include <netinet/if_ether.h>
+#include <netlink/netlink.h>
+#include <netlink/genl/genl.h>
+#include <netlink/genl/ctrl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "batadv_packet.h"
+#include "batman_adv.h"
+#include "bat-hosts.h"
+#include "functions.h"
+#include "hash.h"
+#include "main.h"
+#include "netlink.h"
+
+/* per originator information collected from one of the tables */
+struct snapshot_entry {
+	uint8_t addr[ETH_ALEN];
+	uint8_t nexthop[ETH_ALEN];
+	uint32_t hard_ifindex;
+	uint32_t last_seen_msecs;
+	uint32_t throughput;
+	bool has_throughput;
+	uint8_t tq;
+	uint32_t bandwidth_down;
+	uint32_t bandwidth_up;
+	bool best;
+	unsigned int count;
+};
+
+struct snapshot_table {
+	const char *name;
+	uint8_t nl_cmd;
+	netlink_dump_cb_t callback;
+	const struct netlink_attr_desc *attrs;
+	size_t num_attrs;
+
+	int family;
+	int ifindex;
+	struct hashtable_t *hash;
+	pthread_t thread;
+	bool started;
+	int err;
+};
+
+enum snapshot_tables {
+	SNAPSHOT_ORIGINATORS,
+	SNAPSHOT_NEIGHBORS,
+	SNAPSHOT_TRANSGLOBAL,
+	SNAPSHOT_GATEWAYS,
+	SNAPSHOT_CLAIMS,
+	NUM_SNAPSHOT_TABLES,
+};
+
+struct snapshot_row {
+	const uint8_t *orig;
+	const uint8_t *neigh;
+	const uint8_t *backbone;
+	uint32_t hard_ifindex;
+	uint32_t last_seen_msecs;
+	uint32_t throughput;
+	uint32_t bandwidth_down;
+	uint32_t bandwidth_up;
+	uint8_t tq;
+	bool best;
+};
+
+static const struct netlink_attr_desc snapshot_originators_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_ORIG_ADDRESS, MAC,
+			 struct snapshot_row, orig),
+	NETLINK_ATTR_REQ(BATADV_ATTR_NEIGH_ADDRESS, MAC,
+			 struct snapshot_row, neigh),
+	NETLINK_ATTR_REQ(BATADV_ATTR_HARD_IFINDEX, U32,
+			 struct snapshot_row, hard_ifindex),
+	NETLINK_ATTR_REQ(BATADV_ATTR_LAST_SEEN_MSECS, U32,
+			 struct snapshot_row, last_seen_msecs),
+	NETLINK_ATTR_OPT(BATADV_ATTR_TQ, U8,
+			 struct snapshot_row, tq),
+	NETLINK_ATTR_OPT(BATADV_ATTR_THROUGHPUT, U32,
+			 struct snapshot_row, throughput),
+	NETLINK_ATTR_OPT(BATADV_ATTR_FLAG_BEST, FLAG,
+			 struct snapshot_row, best),
+};
+
+static const struct netlink_attr_desc snapshot_neighbors_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_NEIGH_ADDRESS, MAC,
+			 struct snapshot_row, neigh),
+	NETLINK_ATTR_REQ(BATADV_ATTR_HARD_IFINDEX, U32,
+			 struct snapshot_row, hard_ifindex),
+};
+
+static const struct netlink_attr_desc snapshot_transglobal_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_ORIG_ADDRESS, MAC,
+			 struct snapshot_row, orig),
+};
+
+static const struct netlink_attr_desc snapshot_gateways_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_ORIG_ADDRESS, MAC,
+			 struct snapshot_row, orig),
+	NETLINK_ATTR_REQ(BATADV_ATTR_BANDWIDTH_DOWN, U32,
+			 struct snapshot_row, bandwidth_down),
+	NETLINK_ATTR_REQ(BATADV_ATTR_BANDWIDTH_UP, U32,
+			 struct snapshot_row, bandwidth_up),
+	NETLINK_ATTR_OPT(BATADV_ATTR_FLAG_BEST, FLAG,
+			 struct snapshot_row, best),
+};
+
+static const struct netlink_attr_desc snapshot_claims_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_BLA_BACKBONE, MAC,
+			 struct snapshot_row, backbone),
+};
+
+static struct snapshot_entry *snapshot_entry_get(struct snapshot_table *table,
+						 const uint8_t *addr)
+{
+	struct snapshot_entry *entry;
+	struct hashtable_t *swaphash;
+
+	entry = hash_find(table->hash, (void *)addr);
+	if (entry)
+		return entry;
+
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		return NULL;
+
+	memcpy(entry->addr, addr, ETH_ALEN);
+
+	if (hash_add(table->hash, entry) < 0) {
+		free(entry);
+		return NULL;
+	}
+
+	if (table->hash->elements * 4 > table->hash->size) {
+		swaphash = hash_resize(table->hash, table->hash->size * 2);
+		if (swaphash)
+			table->hash = swaphash;
+	}
+
+	return entry;
+}
+
+static int snapshot_decode(struct snapshot_table *table, struct nlmsghdr *nlh,
+			   struct snapshot_row *row, netlink_attr_mask_t *present)
+{
+	struct genlmsghdr *ghdr;
+
+	if (!genlmsg_valid_hdr(nlh, 0))
+		return -EINVAL;
+
+	ghdr = nlmsg_data(nlh);
+	if (ghdr->cmd != table->nl_cmd)
+		return -EINVAL;
+
+	return netlink_decode_attrs(ghdr, table->attrs, table->num_attrs,
+				    row, sizeof(*row), present);
+}
+
+static int snapshot_originators_cb(struct nlmsghdr *nlh, void *arg)
+{
+	struct snapshot_table *table = arg;
+	struct snapshot_entry *entry;
+	netlink_attr_mask_t present;
+	struct snapshot_row row;
+
+	if (snapshot_decode(table, nlh, &row, &present) < 0)
+		return NL_OK;
+
+	if (!row.best)
+		return NL_OK;
+
+	entry = snapshot_entry_get(table, row.orig);
+	if (!entry) {
+		table->err = -ENOMEM;
+		return NL_STOP;
+	}
+
+	memcpy(entry->nexthop, row.neigh, ETH_ALEN);
+	entry->hard_ifindex = row.hard_ifindex;
+	entry->last_seen_msecs = row.last_seen_msecs;
+	entry->tq = row.tq;
+	entry->throughput = row.throughput;
+	entry->has_throughput = !!(present & NETLINK_ATTR_BIT(BATADV_ATTR_THROUGHPUT));
+
+	return NL_OK;
+}
+
+static int snapshot_neighbors_cb(struct nlmsghdr *nlh, void *arg)
+{
+	struct snapshot_table *table = arg;
+	struct snapshot_entry *entry;
+	struct snapshot_row row;
+
+	if (snapshot_decode(table, nlh, &row, NULL) < 0)
+		return NL_OK;
+
+	entry = snapshot_entry_get(table, row.neigh);
+	if (!entry) {
+		table->err = -ENOMEM;
+		return NL_STOP;
+	}
+
+	/* number of links to this neighbor */
+	entry->count++;
+
+	return NL_OK;
+}
+
+static int snapshot_transglobal_cb(struct nlmsghdr *nlh, void *arg)
+{
+	struct snapshot_table *table = arg;
+	struct snapshot_entry *entry;
+	struct snapshot_row row;
+
+	if (snapshot_decode(table, nlh, &row, NULL) < 0)
+		return NL_OK;
+
+	entry = snapshot_entry_get(table, row.orig);
+	if (!entry) {
+		table->err = -ENOMEM;
+		return NL_STOP;
+	}
+
+	/* number of clients announced by this originator */
+	entry->count++;
+
+	return NL_OK;
+}
+
+static int snapshot_gateways_cb(struct nlmsghdr *nlh, void *arg)
+{
+	struct snapshot_table *table = arg;
+	struct snapshot_entry *entry;
+	struct snapshot_row row;
+
+	if (snapshot_decode(table, nlh, &row, NULL) < 0)
+		return NL_OK;
+
+	entry = snapshot_entry_get(table, row.orig);
+	if (!entry) {
+		table->err = -ENOMEM;
+		return NL_STOP;
+	}
+
+	entry->bandwidth_down = row.bandwidth_down;
+	entry->bandwidth_up = row.bandwidth_up;
+	entry->best = row.best;
+
+	return NL_OK;
+}
+
+static int snapshot_claims_cb(struct nlmsghdr *nlh, void *arg)
+{
+	struct snapshot_table *table = arg;
+	struct snapshot_entry *entry;
+	struct snapshot_row row;
+
+	if (snapshot_decode(table, nlh, &row, NULL) < 0)
+		return NL_OK;
+
+	entry = snapshot_entry_get(table, row.backbone);
+	if (!entry) {
+		table->err = -ENOMEM;
+		return NL_STOP;
+	}
+
+	/* number of clients claimed by this backbone gateway */
+	entry->count++;
+
+	return NL_OK;
+}
+
+static struct snapshot_table snapshot_tables[NUM_SNAPSHOT_TABLES] = {
+	[SNAPSHOT_ORIGINATORS] = {
+		.name = "originators",
+		.nl_cmd = BATADV_CMD_GET_ORIGINATORS,
+		.callback = snapshot_originators_cb,
+		.attrs = snapshot_originators_attrs,
+		.num_attrs = ARRAY_SIZE(snapshot_originators_attrs),
+	},
+	[SNAPSHOT_NEIGHBORS] = {
+		.name = "neighbors",
+		.nl_cmd = BATADV_CMD_GET_NEIGHBORS,
+		.callback = snapshot_neighbors_cb,
+		.attrs = snapshot_neighbors_attrs,
+		.num_attrs = ARRAY_SIZE(snapshot_neighbors_attrs),
+	},
+	[SNAPSHOT_TRANSGLOBAL] = {
+		.name = "transglobal",
+		.nl_cmd = BATADV_CMD_GET_TRANSTABLE_GLOBAL,
+		.callback = snapshot_transglobal_cb,
+		.attrs = snapshot_transglobal_attrs,
+		.num_attrs = ARRAY_SIZE(snapshot_transglobal_attrs),
+	},
+	[SNAPSHOT_GATEWAYS] = {
+		.name = "gateways",
+		.nl_cmd = BATADV_CMD_GET_GATEWAYS,
+		.callback = snapshot_gateways_cb,
+		.attrs = snapshot_gateways_attrs,
+		.num_attrs = ARRAY_SIZE(snapshot_gateways_attrs),
+	},
+	[SNAPSHOT_CLAIMS] = {
+		.name = "claimtable",
+		.nl_cmd = BATADV_CMD_GET_BLA_CLAIM,
+		.callback = snapshot_claims_cb,
+		.attrs = snapshot_claims_attrs,
+		.num_attrs = ARRAY_SIZE(snapshot_claims_attrs),
+	},
+};
+
+/* every table is dumped on its own socket so the kernel can fill all of
+ * them at the same time
+ */
+static void *snapshot_table_dump(void *arg)
+{
+	struct snapshot_table *table = arg;
+	struct netlink_dump_buf *buf;
+	struct nl_sock *sock;
+	int ret;
+
+	sock = nl_socket_alloc();
+	if (!sock) {
+		table->err = -ENOMEM;
+		return NULL;
+	}
+
+	ret = genl_connect(sock);
+	if (ret < 0) {
+		table->err = -EOPNOTSUPP;
+		goto err_free_sock;
+	}
+
+	nl_socket_disable_auto_ack(sock);
+	netlink_dump_sock_setup(sock);
+
+	buf = netlink_dump_buf_alloc();
+	if (!buf) {
+		table->err = -ENOMEM;
+		goto err_free_sock;
+	}
+
+	ret = netlink_dump(sock, buf, table->family, table->ifindex,
+			   table->nl_cmd, table->callback, table);
+	if (ret < 0 && !table->err)
+		table->err = ret;
+
+	netlink_dump_buf_free(buf);
+err_free_sock:
+	nl_socket_free(sock);
+
+	return NULL;
+}
+
+static int snapshot_fetch(struct state *state, int ifindex)
+{
+	struct snapshot_table *table;
+	int ret;
+	int i;
+
+	for (i = 0; i < NUM_SNAPSHOT_TABLES; i++) {
+		table = &snapshot_tables[i];
+
+		table->family = state->batadv_family;
+		table->ifindex = ifindex;
+		table->err = 0;
+		table->hash = hash_new(64, compare_mac, choose_mac);
+		if (!table->hash)
+			return -ENOMEM;
+	}
+
+	for (i = 0; i < NUM_SNAPSHOT_TABLES; i++) {
+		table = &snapshot_tables[i];
+
+		ret = pthread_create(&table->thread, NULL, snapshot_table_dump,
+				     table);
+		table->started = (ret == 0);
+
+		/* no thread available - dump it sequentially instead */
+		if (!table->started)
+			snapshot_table_dump(table);
+	}
+
+	for (i = 0; i < NUM_SNAPSHOT_TABLES; i++) {
+		table = &snapshot_tables[i];
+
+		if (table->started)
+			pthread_join(table->thread, NULL);
+	}
+
+	return 0;
+}
+
+static void snapshot_free(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_SNAPSHOT_TABLES; i++) {
+		if (!snapshot_tables[i].hash)
+			continue;
+
+		hash_delete(snapshot_tables[i].hash, free);
+		snapshot_tables[i].hash = NULL;
+	}
+}
+
+static int snapshot_entry_cmp(const void *a, const void *b)
+{
+	const struct snapshot_entry *entry_a = *(const struct snapshot_entry **)a;
+	const struct snapshot_entry *entry_b = *(const struct snapshot_entry **)b;
+
+	return memcmp(entry_a->addr, entry_b->addr, ETH_ALEN);
+}
+
+static void snapshot_print_mac(const uint8_t *addr, int read_opt)
+{
+	struct bat_host *bat_host = NULL;
+
+	if (read_opt & USE_BAT_HOSTS)
+		bat_host = bat_hosts_find_by_mac((char *)addr);
+
+	if (bat_host)
+		printf("%17s ", bat_host->name);
+	else
+		printf("%02x:%02x:%02x:%02x:%02x:%02x ",
+		       addr[0], addr[1], addr[2], addr[3], addr[4], addr[5]);
+}
+
+static struct snapshot_entry *snapshot_find(enum snapshot_tables table,
+					    uint8_t *addr)
+{
+	return hash_find(snapshot_tables[table].hash, addr);
+}
+
+static int snapshot_print(struct state *state, int read_opt,
+			  const struct timespec *taken, double duration)
+{
+	struct hashtable_t *origs = snapshot_tables[SNAPSHOT_ORIGINATORS].hash;
+	struct snapshot_entry *orig, *neigh, *tt, *gw, *claims;
+	struct snapshot_entry **entries;
+	struct hash_it_t *hashit = NULL;
+	char ifname[IF_NAMESIZE];
+	char timestr[64];
+	struct tm tm;
+	size_t num = 0;
+	size_t i;
+
+	entries = calloc(origs->elements ? origs->elements : 1,
+			 sizeof(*entries));
+	if (!entries)
+		return -ENOMEM;
+
+	while (NULL != (hashit = hash_iterate(origs, hashit)))
+		entries[num++] = hashit->bucket->data;
+
+	qsort(entries, num, sizeof(*entries), snapshot_entry_cmp);
+
+	if (!(read_opt & SKIP_HEADER)) {
+		localtime_r(&taken->tv_sec, &tm);
+		strftime(timestr, sizeof(timestr), "%Y-%m-%d %H:%M:%S", &tm);
+
+		printf("[%s snapshot at %s.%03ld, %zu originators, fetched in %.1f ms]\n",
+		       state->mesh_iface, timestr, taken->tv_nsec / 1000000,
+		       num, duration * 1000.0);
+
+		for (i = 0; i < NUM_SNAPSHOT_TABLES; i++) {
+			if (!snapshot_tables[i].err)
+				continue;
+
+			printf("[%s unavailable: %s]\n", snapshot_tables[i].name,
+			       strerror(-snapshot_tables[i].err));
+		}
+
+		printf("   Originator        Nexthop           [outgoingIF] (   link    ) TT-clients Gateway (down/up)     Claims\n");
+	}
+
+	for (i = 0; i < num; i++) {
+		orig = entries[i];
+		neigh = snapshot_find(SNAPSHOT_NEIGHBORS, orig->addr);
+		tt = snapshot_find(SNAPSHOT_TRANSGLOBAL, orig->addr);
+		gw = snapshot_find(SNAPSHOT_GATEWAYS, orig->addr);
+		claims = snapshot_find(SNAPSHOT_CLAIMS, orig->addr);
+
+		if (!if_indextoname(orig->hard_ifindex, ifname))
+			ifname[0] = '\0';
+
+		printf(" %c ", neigh ? 'N' : ' ');
+		snapshot_print_mac(orig->addr, read_opt);
+		snapshot_print_mac(orig->nexthop, read_opt);
+		printf("[%10s] ", ifname);
+
+		if (orig->has_throughput)
+			printf("(%6u.%1u MBit) ", orig->throughput / 1000,
+			       orig->throughput % 1000 / 100);
+		else
+			printf("(    %3u/255) ", orig->tq);
+
+		printf("%10u ", tt ? tt->count : 0);
+
+		if (gw)
+			printf("%c %7u.%u/%u.%u MBit ", gw->best ? '*' : ' ',
+			       gw->bandwidth_down / 10, gw->bandwidth_down % 10,
+			       gw->bandwidth_up / 10, gw->bandwidth_up % 10);
+		else
+			printf("%-22s", "  -");
+
+		printf("%6u\n", claims ? claims->count : 0);
+	}
+
+	free(entries);
+
+	return 0;
+}
+
+static void snapshot_usage(void)
+{
+	fprintf(stderr, "Usage: batctl [options] snapshot|ss [parameters]\n");
+	fprintf(stderr, "parameters:\n");
+	fprintf(stderr, " \t -h print this help\n");
+	fprintf(stderr, " \t -n don't replace mac addresses with bat-host names\n");
+	fprintf(stderr, " \t -H don't show the header\n");
+}
+
+static int snapshot(struct state *state, int argc, char **argv)
+{
+	int read_opt = USE_BAT_HOSTS;
+	struct timespec start, end;
+	struct timespec taken;
+	double duration;
+	int optchar;
+	int ifindex;
+	int ret;
+
+	while ((optchar = getopt(argc, argv, "hnH")) != -1) {
+		switch (optchar) {
+		case 'h':
+			snapshot_usage();
+			return EXIT_SUCCESS;
+		case 'n':
+			read_opt &= ~USE_BAT_HOSTS;
+			break;
+		case 'H':
+			read_opt |= SKIP_HEADER;
+			break;
+		default:
+			snapshot_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	check_root_or_die("batctl snapshot");
+
+	if (!state->sock) {
+		fprintf(stderr, "Error - batman-adv netlink interface is not available\n");
+		return EXIT_FAILURE;
+	}
+
+	ifindex = if_nametoindex(state->mesh_iface);
+	if (!ifindex) {
+		fprintf(stderr, "Interface %s is unknown\n", state->mesh_iface);
+		return EXIT_FAILURE;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &taken);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	ret = snapshot_fetch(state, ifindex);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	duration = end.tv_sec - start.tv_sec;
+	duration += (end.tv_nsec - start.tv_nsec) / 1000000000.0;
+
+	if (ret == 0 && snapshot_tables[SNAPSHOT_ORIGINATORS].err)
+		ret = snapshot_tables[SNAPSHOT_ORIGINATORS].err;
+
+	if (ret < 0) {
+		fprintf(stderr, "Error - failed to fetch the mesh tables: %s\n",
+			strerror(-ret));
+		snapshot_free();
+		return EXIT_FAILURE;
+	}
+
+	bat_hosts_init(read_opt);
+	ret = snapshot_print(state, read_opt, &taken, duration);
+	bat_hosts_free();
+	snapshot_free();
+
+	if (ret < 0)
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
+
+COMMAND(SUBCOMMAND, snapshot, "ss", COMMAND_FLAG_MESH_IFACE | COMMAND_FLAG_NETLINK,
+	NULL, "                  \tprint a joined view of the mesh tables");
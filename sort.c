@@ -0,0 +1,506 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#include <errno.h>
+#include <netlink/msg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter.h"
+#include "main.h"
+#include "sort.h"
+
+#define SORT_MAX_FIELDS 4
+
+/* without a limit, the messages of the kept rows are copied into blocks
+ * which are reused for every dump. Watch mode stops allocating once the
+ * blocks can hold a complete dump. With a limit, each heap slot owns the
+ * storage of its message instead
+ */
+#define SORT_BLOCK_SIZE (64 * 1024)
+
+struct sort_block {
+	struct sort_block *next;
+	size_t len;
+	size_t size;
+	uint8_t data[];
+};
+
+struct sort_field {
+	const char *name;
+	netlink_attr_mask_t attrs;
+	bool descending;
+
+	/* entry in the descriptors of the table which is sorted */
+	size_t desc_idx;
+};
+
+struct sort_key {
+	bool present;
+	long long num;
+
+	/* strings: offset of the value in the message */
+	size_t str_off;
+};
+
+struct sort_row {
+	struct nlmsghdr *nlh;
+	size_t seq;
+	struct sort_key keys[SORT_MAX_FIELDS];
+
+	/* with a limit: storage of the message, moves with the row */
+	uint8_t *buf;
+	size_t buf_size;
+};
+
+struct sort {
+	char *expr;
+	size_t num_fields;
+	struct sort_field fields[SORT_MAX_FIELDS];
+
+	/* descriptors the fields were resolved for */
+	const struct netlink_attr_desc *desc;
+
+	/* the fields don't fit the table of the last row */
+	int err;
+
+	/* maximum number of rows - 0 keeps all */
+	size_t limit;
+
+	/* all rows or, with a limit, a heap with the last row at the top */
+	struct sort_row *rows;
+	size_t num_rows;
+	size_t size;
+	size_t seq;
+	bool flushing;
+
+	struct sort_block *blocks;
+	struct sort_block *block;
+};
+
+/* qsort() has no context argument */
+static const struct sort *sort_ctx;
+
+/* comma separated list of fields, a leading '-' sorts in descending order */
+struct sort *sort_compile(const char *expr, size_t limit)
+{
+	struct sort_field *field;
+	struct sort *sort;
+	char *saveptr;
+	char *str;
+
+	sort = calloc(1, sizeof(*sort));
+	if (!sort)
+		return NULL;
+
+	sort->limit = limit;
+
+	if (!expr)
+		return sort;
+
+	sort->expr = strdup(expr);
+	if (!sort->expr)
+		goto err;
+
+	for (str = strtok_r(sort->expr, ",", &saveptr); str;
+	     str = strtok_r(NULL, ",", &saveptr)) {
+		if (sort->num_fields == SORT_MAX_FIELDS) {
+			fprintf(stderr, "Error - at most %d sort fields are supported\n",
+				SORT_MAX_FIELDS);
+			goto err;
+		}
+
+		field = &sort->fields[sort->num_fields];
+
+		if (*str == '-') {
+			field->descending = true;
+			str++;
+		}
+
+		field->name = str;
+		field->attrs = filter_field_attrs(str);
+		if (!field->attrs) {
+			fprintf(stderr, "Error - unknown sort field: %s\n", str);
+			goto err;
+		}
+
+		sort->num_fields++;
+	}
+
+	return sort;
+
+err:
+	sort_free(sort);
+	return NULL;
+}
+
+void sort_free(struct sort *sort)
+{
+	struct sort_block *block;
+	size_t i;
+
+	if (!sort)
+		return;
+
+	for (i = 0; i < sort->size; i++)
+		free(sort->rows[i].buf);
+
+	while (sort->blocks) {
+		block = sort->blocks;
+		sort->blocks = block->next;
+		free(block);
+	}
+
+	free(sort->rows);
+	free(sort->expr);
+	free(sort);
+}
+
+/* find the descriptor of each field once for the table */
+static int sort_resolve(struct sort *sort,
+			const struct netlink_attr_desc *desc, size_t num)
+{
+	struct sort_field *field;
+	bool found;
+	size_t i;
+	size_t j;
+
+	for (i = 0; i < sort->num_fields; i++) {
+		field = &sort->fields[i];
+		found = false;
+
+		for (j = 0; j < num; j++) {
+			if (field->attrs & NETLINK_ATTR_BIT(desc[j].type)) {
+				field->desc_idx = j;
+				found = true;
+				break;
+			}
+		}
+
+		if (!found) {
+			fprintf(stderr, "Error - the table has no field '%s' to sort by\n",
+				field->name);
+			return -EINVAL;
+		}
+	}
+
+	sort->desc = desc;
+
+	return 0;
+}
+
+static int sort_row_cmp(const struct sort *sort, const struct sort_row *a,
+			const struct sort_row *b)
+{
+	const struct sort_key *ka;
+	const struct sort_key *kb;
+	const char *stra;
+	const char *strb;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < sort->num_fields; i++) {
+		ka = &a->keys[i];
+		kb = &b->keys[i];
+
+		/* rows without the field always come last */
+		if (!ka->present || !kb->present) {
+			if (ka->present == kb->present)
+				continue;
+
+			return ka->present ? -1 : 1;
+		}
+
+		if (sort->desc[sort->fields[i].desc_idx].kind ==
+		    NETLINK_ATTR_STRING) {
+			stra = (const char *)a->nlh + ka->str_off;
+			strb = (const char *)b->nlh + kb->str_off;
+			ret = strcmp(stra, strb);
+		} else {
+			ret = (ka->num > kb->num) - (ka->num < kb->num);
+		}
+
+		if (sort->fields[i].descending)
+			ret = -ret;
+
+		if (ret)
+			return ret;
+	}
+
+	/* keep the order of the dump for equal rows */
+	return (a->seq > b->seq) - (a->seq < b->seq);
+}
+
+static int sort_row_qsort_cmp(const void *a, const void *b)
+{
+	return sort_row_cmp(sort_ctx, a, b);
+}
+
+static void sort_row_swap(struct sort_row *a, struct sort_row *b)
+{
+	struct sort_row tmp = *a;
+
+	*a = *b;
+	*b = tmp;
+}
+
+static void sort_heap_up(struct sort *sort, size_t i)
+{
+	size_t parent;
+
+	while (i > 0) {
+		parent = (i - 1) / 2;
+
+		if (sort_row_cmp(sort, &sort->rows[parent], &sort->rows[i]) >= 0)
+			break;
+
+		sort_row_swap(&sort->rows[parent], &sort->rows[i]);
+		i = parent;
+	}
+}
+
+static void sort_heap_down(struct sort *sort, size_t i)
+{
+	size_t largest;
+	size_t child;
+
+	while (1) {
+		largest = i;
+
+		for (child = 2 * i + 1; child <= 2 * i + 2; child++) {
+			if (child >= sort->num_rows)
+				break;
+
+			if (sort_row_cmp(sort, &sort->rows[child],
+					 &sort->rows[largest]) > 0)
+				largest = child;
+		}
+
+		if (largest == i)
+			break;
+
+		sort_row_swap(&sort->rows[largest], &sort->rows[i]);
+		i = largest;
+	}
+}
+
+static struct nlmsghdr *sort_copy_msg(struct sort *sort,
+				      const struct nlmsghdr *src)
+{
+	size_t len = NLMSG_ALIGN(src->nlmsg_len);
+	struct sort_block **next;
+	struct nlmsghdr *nlh;
+	size_t size;
+
+	while (!sort->block || sort->block->len + len > sort->block->size) {
+		if (sort->block)
+			next = &sort->block->next;
+		else
+			next = &sort->blocks;
+
+		if (!*next) {
+			size = len > SORT_BLOCK_SIZE ? len : SORT_BLOCK_SIZE;
+
+			*next = malloc(sizeof(**next) + size);
+			if (!*next)
+				return NULL;
+
+			(*next)->next = NULL;
+			(*next)->size = size;
+		}
+
+		sort->block = *next;
+		sort->block->len = 0;
+	}
+
+	nlh = (struct nlmsghdr *)(sort->block->data + sort->block->len);
+	memcpy(nlh, src, src->nlmsg_len);
+	sort->block->len += len;
+
+	return nlh;
+}
+
+/* copy the message of @src into the storage of the slot @dst
+ *
+ * A row which is replaced in the heap is overwritten. The memory of a
+ * limited sort therefore stays bounded by the limit instead of the dump
+ */
+static int sort_row_keep(struct sort *sort, struct sort_row *dst,
+			 const struct sort_row *src)
+{
+	size_t len = src->nlh->nlmsg_len;
+	struct nlmsghdr *nlh;
+	uint8_t *buf;
+
+	if (sort->limit) {
+		if (dst->buf_size < len) {
+			buf = realloc(dst->buf, len);
+			if (!buf)
+				return -ENOMEM;
+
+			dst->buf = buf;
+			dst->buf_size = len;
+		}
+
+		nlh = (struct nlmsghdr *)dst->buf;
+		memcpy(nlh, src->nlh, len);
+	} else {
+		nlh = sort_copy_msg(sort, src->nlh);
+		if (!nlh)
+			return -ENOMEM;
+	}
+
+	dst->nlh = nlh;
+	dst->seq = src->seq;
+	memcpy(dst->keys, src->keys, sizeof(dst->keys));
+
+	return 0;
+}
+
+/**
+ * sort_add() - keep a row for sorting instead of printing it
+ * @sort: sort state or NULL
+ * @nlh: message of the row
+ * @desc: descriptors which were used to decode the row
+ * @num: number of entries in @desc
+ * @row: the decoded row (pointing into @nlh)
+ * @present: attributes found by netlink_decode_attrs()
+ *
+ * With a limit, the rows are kept in a heap of the limit size. A new row
+ * only replaces the row which would be printed last when it sorts before
+ * it.
+ *
+ * Return: true when the row must not be printed now - also when the sort
+ *  fields don't fit the table, see sort_error()
+ */
+bool sort_add(struct sort *sort, struct nlmsghdr *nlh,
+	      const struct netlink_attr_desc *desc, size_t num,
+	      const void *row, netlink_attr_mask_t present)
+{
+	const struct netlink_attr_desc *d;
+	struct sort_row tmp;
+	struct sort_row *rows;
+	const char *str;
+	size_t size;
+	size_t i;
+
+	if (!sort || sort->flushing)
+		return false;
+
+	if (sort->desc != desc) {
+		sort->err = sort_resolve(sort, desc, num);
+		if (sort->err < 0)
+			return true;
+	}
+
+	tmp.nlh = nlh;
+	tmp.seq = sort->seq++;
+
+	for (i = 0; i < sort->num_fields; i++) {
+		d = &desc[sort->fields[i].desc_idx];
+
+		if (d->kind == NETLINK_ATTR_STRING) {
+			tmp.keys[i].present = !!(present & NETLINK_ATTR_BIT(d->type));
+			if (!tmp.keys[i].present)
+				continue;
+
+			str = *(const char * const *)((const uint8_t *)row +
+						      d->offset);
+			tmp.keys[i].str_off = str - (const char *)nlh;
+		} else {
+			tmp.keys[i].present = netlink_attr_value(d, row, present,
+								 &tmp.keys[i].num) == 0;
+		}
+	}
+
+	if (sort->limit && sort->num_rows == sort->limit) {
+		if (sort_row_cmp(sort, &tmp, &sort->rows[0]) >= 0)
+			return true;
+
+		/* the replaced row is still valid when the new row can't be
+		 * kept
+		 */
+		if (sort_row_keep(sort, &sort->rows[0], &tmp) < 0)
+			return true;
+
+		sort_heap_down(sort, 0);
+		return true;
+	}
+
+	if (sort->num_rows == sort->size) {
+		size = sort->size ? sort->size * 2 : 64;
+		if (sort->limit && size > sort->limit)
+			size = sort->limit;
+
+		rows = realloc(sort->rows, size * sizeof(*rows));
+		if (!rows)
+			return false;
+
+		memset(&rows[sort->size], 0,
+		       (size - sort->size) * sizeof(*rows));
+
+		sort->rows = rows;
+		sort->size = size;
+	}
+
+	if (sort_row_keep(sort, &sort->rows[sort->num_rows], &tmp) < 0)
+		return false;
+
+	sort->num_rows++;
+
+	if (sort->limit)
+		sort_heap_up(sort, sort->num_rows - 1);
+
+	return true;
+}
+
+/* error of the last sort_add() - the table can't be sorted */
+int sort_error(const struct sort *sort)
+{
+	if (!sort)
+		return 0;
+
+	return sort->err;
+}
+
+/* print the kept rows in order by handing them to the table callback again */
+void sort_flush(struct sort *sort, netlink_dump_cb_t callback, void *arg)
+{
+	size_t i;
+
+	if (!sort)
+		return;
+
+	sort_ctx = sort;
+	qsort(sort->rows, sort->num_rows, sizeof(*sort->rows),
+	      sort_row_qsort_cmp);
+
+	sort->flushing = true;
+
+	for (i = 0; i < sort->num_rows; i++)
+		callback(sort->rows[i].nlh, arg);
+
+	sort->flushing = false;
+	sort->num_rows = 0;
+	sort->seq = 0;
+	sort->block = NULL;
+}
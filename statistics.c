@@ -39,8 +39,11 @@
 void check_root_or_die(const char *cmd);
 
 /* code borrowed from ethtool */
-static int statistics_custom_get(int fd, struct ifreq *ifr)
+static int statistics_custom_get(int fd, struct ifreq *ifr,
+				 enum output_format format)
 {
+	char name[ETH_GSTRING_LEN + 1];
+	struct output out;
 	struct ethtool_drvinfo drvinfo;
 	struct ethtool_gstrings *strings = NULL;
 	struct ethtool_stats *stats = NULL;
@@ -88,11 +91,34 @@ static int statistics_custom_get(int fd, struct ifreq *ifr)
 		goto out;
 	}
 
+	if (format == OUTPUT_FORMAT_TEXT) {
+		for (i = 0; i < n_stats; i++) {
+			printf("\t%.*s: %llu\n", ETH_GSTRING_LEN,
+			       &strings->data[i * ETH_GSTRING_LEN],
+			       stats->data[i]);
+		}
+
+		goto success;
+	}
+
+	/* all counters form a single record */
+	if (output_init(&out, STDOUT_FILENO, OUTPUT_BUF_SIZE) < 0) {
+		fprintf(stderr, "Error - out of memory\n");
+		goto out;
+	}
+
+	output_set_format(&out, format, true);
+	output_record_begin(&out);
+
 	for (i = 0; i < n_stats; i++) {
-		printf("\t%.*s: %llu\n", ETH_GSTRING_LEN,
-		       &strings->data[i * ETH_GSTRING_LEN], stats->data[i]);
+		snprintf(name, sizeof(name), "%.*s", ETH_GSTRING_LEN,
+			 &strings->data[i * ETH_GSTRING_LEN]);
+		output_field_uint(&out, name, stats->data[i]);
 	}
 
+	output_record_end(&out);
+	output_free(&out);
+
 success:
 	ret = EXIT_SUCCESS;
 
@@ -118,7 +144,7 @@ static int statistics(struct state *state, int argc __maybe_unused,
 		goto out;
 	}
 
-	ret = statistics_custom_get(fd, &ifr);
+	ret = statistics_custom_get(fd, &ifr, state->output_format);
 
 out:
 	if (fd >= 0)
@@ -126,5 +152,6 @@ static int statistics(struct state *state, int argc __maybe_unused,
 	return ret;
 }
 
-COMMAND(SUBCOMMAND, statistics, "s", COMMAND_FLAG_MESH_IFACE, NULL,
+COMMAND(SUBCOMMAND, statistics, "s",
+	COMMAND_FLAG_MESH_IFACE | COMMAND_FLAG_OUTPUT_FORMAT, NULL,
 	"                  \tprint mesh statistics");
@@ -43,12 +43,16 @@
 #include <signal.h>
 #include <stddef.h>
 #include <stdint.h>
-#include <sys/select.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 
 #include "batadv_packet.h"
 #include "tcpdump.h"
 #include "bat-hosts.h"
+#include "bpf_filter.h"
 #include "functions.h"
 
 #define BATADV_THROUGHPUT_MAX_VALUE	0xFFFFFFFF
@@ -59,10 +63,14 @@
 
 #define IPV6_MIN_MTU	1280
 
+/* the summaries count the dropped frames instead of warning about each */
 #define LEN_CHECK(buff_len, check_len, desc) \
 if ((size_t)(buff_len) < (check_len)) { \
-	fprintf(stderr, "Warning - dropping received %s packet as it is smaller than expected (%zu): %zu\n", \
-		desc, (check_len), (size_t)(buff_len)); \
+	if (dump_counters) \
+		dump_stats_short(); \
+	else \
+		fprintf(stderr, "Warning - dropping received %s packet as it is smaller than expected (%zu): %zu\n", \
+			desc, (check_len), (size_t)(buff_len)); \
 	return; \
 }
 
@@ -73,16 +81,81 @@ static unsigned short dump_level_all = DUMP_TYPE_BATOGM | DUMP_TYPE_BATOGM2 |
 				       DUMP_TYPE_NONBAT;
 static unsigned short dump_level;
 
+/* packet types whose dissectors collect flows, OGMs or TVLVs while the
+ * packets are only counted
+ */
+static const unsigned short dump_level_counted = DUMP_TYPE_BATOGM |
+						 DUMP_TYPE_BATOGM2 |
+						 DUMP_TYPE_BATUCAST |
+						 DUMP_TYPE_BATBCAST |
+						 DUMP_TYPE_BATUTVLV;
+
+/* output and receive time of the packet which is dissected by this thread */
+static __thread FILE *dump_out;
+static __thread struct timespec dump_time;
+/* counters, flow and OGM of the packet when nothing is printed (-S, -T, -O) */
+static __thread struct dump_stats *dump_counters;
+static __thread struct dump_flow *dump_flow;
+static __thread struct dump_ogm *dump_ogm;
+/* captured length of the frame until it was accounted to its type */
+static __thread size_t dump_frame_len;
+/* captured length of the frame until it was counted as too short */
+static __thread size_t dump_short_len;
+
+static const char *dump_stats_names[DUMP_STATS_NUM] = {
+	[DUMP_STATS_OGM] = "OGM IV",
+	[DUMP_STATS_OGM2] = "OGM2",
+	[DUMP_STATS_ELP] = "ELP",
+	[DUMP_STATS_ICMP] = "ICMP",
+	[DUMP_STATS_UCAST] = "UCAST",
+	[DUMP_STATS_4ADDR] = "4ADDR",
+	[DUMP_STATS_4ADDR_DAT] = "4ADDR DAT",
+	[DUMP_STATS_UCAST_TVLV] = "UCAST TVLV",
+	[DUMP_STATS_BCAST] = "BCAST",
+	[DUMP_STATS_FRAG] = "FRAG",
+	[DUMP_STATS_CODED] = "CODED",
+	[DUMP_STATS_BAT_OTHER] = "BAT other",
+	[DUMP_STATS_NONBAT] = "non batman",
+	[DUMP_STATS_TVLV_GW] = "TVLV GW",
+	[DUMP_STATS_TVLV_DAT] = "TVLV DAT",
+	[DUMP_STATS_TVLV_NC] = "TVLV NC",
+	[DUMP_STATS_TVLV_TT] = "TVLV TT",
+	[DUMP_STATS_TVLV_ROAM] = "TVLV ROAM",
+	[DUMP_STATS_TVLV_MCAST] = "TVLV MCAST",
+	[DUMP_STATS_TVLV_OTHER] = "TVLV other",
+	[DUMP_STATS_SHORT] = "short",
+};
+
+static const char *dump_top_names[DUMP_TOP_NUM] = {
+	[DUMP_TOP_MESH_BYTES] = "mesh flows (originator > destination) by bytes",
+	[DUMP_TOP_MESH_PACKETS] = "mesh flows (originator > destination) by packets",
+	[DUMP_TOP_CLIENT_BYTES] = "client flows (source > destination) by bytes",
+	[DUMP_TOP_CLIENT_PACKETS] = "client flows (source > destination) by packets",
+};
+
 static void parse_eth_hdr(unsigned char *packet_buff, ssize_t buff_len, int read_opt, int time_printed);
+static void dump_stats_short(void);
 
 static void tcpdump_usage(void)
 {
 	fprintf(stderr, "Usage: batctl tcpdump [parameters] interface [interface]\n");
+	fprintf(stderr, "       batctl tcpdump [parameters] -r file\n");
 	fprintf(stderr, "parameters:\n");
+	fprintf(stderr, " \t -B size - size of the capture ring of each interface in KiB (default: %d)\n", DUMP_RING_SIZE_DEFAULT / 1024);
+	fprintf(stderr, " \t -F expr - only capture packets matching the filter expression\n");
 	fprintf(stderr, " \t -c compat filter - only display packets matching own compat version (%i)\n", BATADV_COMPAT_VERSION);
 	fprintf(stderr, " \t -h print this help\n");
 	fprintf(stderr, " \t -n don't convert addresses to bat-host names\n");
 	fprintf(stderr, " \t -p dump specific packet type\n");
+	fprintf(stderr, " \t -r file - dissect the packets of a pcap or pcapng file\n");
+	fprintf(stderr, " \t -S interval - only count the protocol overhead and print it every interval seconds\n");
+	fprintf(stderr, " \t -T interval - only print the heaviest unicast and broadcast flows every interval seconds\n");
+	fprintf(stderr, " \t -O interval - only track the OGMs of each originator and neighbor and print them every interval seconds\n");
+	fprintf(stderr, " \t -I msecs - originator interval for the OGM jitter (default: %d)\n", DUMP_OGM_ORIG_INTERVAL);
+	fprintf(stderr, " \t -w file - write the captured packets to a pcapng file\n");
+	fprintf(stderr, " \t -C size - start a new capture file after size MB\n");
+	fprintf(stderr, " \t -G secs - start a new capture file after secs seconds\n");
+	fprintf(stderr, " \t -P print the packets while writing them\n");
 	fprintf(stderr, " \t -x dump all packet types except specified\n");
 	fprintf(stderr, "packet types:\n");
 	fprintf(stderr, " \t\t%3d - batman ogm packets\n", DUMP_TYPE_BATOGM);
@@ -99,16 +172,24 @@ static void tcpdump_usage(void)
 
 static int print_time(void)
 {
-	struct timeval tv;
+	/* the packets of one second share the conversion to the local time */
+	static __thread char time_str[16];
+	static __thread time_t time_sec;
+	struct tm tm_buf;
 	struct tm *tm;
 
-	gettimeofday(&tv, NULL);
-	tm = localtime(&tv.tv_sec);
+	if (!time_str[0] || time_sec != dump_time.tv_sec) {
+		tm = localtime_r(&dump_time.tv_sec, &tm_buf);
+		if (tm)
+			snprintf(time_str, sizeof(time_str), "%02d:%02d:%02d",
+				 tm->tm_hour, tm->tm_min, tm->tm_sec);
+		else
+			snprintf(time_str, sizeof(time_str), "00:00:00");
 
-	if (tm)
-		printf("%02d:%02d:%02d.%06ld ", tm->tm_hour, tm->tm_min, tm->tm_sec, tv.tv_usec);
-	else
-		printf("00:00:00.000000 ");
+		time_sec = dump_time.tv_sec;
+	}
+
+	fprintf(dump_out, "%s.%06ld ", time_str, dump_time.tv_nsec / 1000);
 
 	return 1;
 }
@@ -127,8 +208,8 @@ static void batctl_tvlv_parse_gw_v1(void *buff, ssize_t buff_len)
 	down = ntohl(tvlv->bandwidth_down);
 	up = ntohl(tvlv->bandwidth_up);
 
-	printf("\tTVLV GWv1: down %d.%.1dMbps, up %d.%1dMbps\n",
-	       down / 10, down % 10, up / 10, up % 10);
+	fprintf(dump_out, "\tTVLV GWv1: down %d.%.1dMbps, up %d.%1dMbps\n",
+			  down / 10, down % 10, up / 10, up % 10);
 }
 
 static void batctl_tvlv_parse_dat_v1(void (*buff)__attribute__((unused)),
@@ -140,7 +221,7 @@ static void batctl_tvlv_parse_dat_v1(void (*buff)__attribute__((unused)),
 		return;
 	}
 
-	printf("\tTVLV DATv1: enabled\n");
+	fprintf(dump_out, "\tTVLV DATv1: enabled\n");
 }
 
 static void batctl_tvlv_parse_nc_v1(void (*buff)__attribute__((unused)),
@@ -152,7 +233,7 @@ static void batctl_tvlv_parse_nc_v1(void (*buff)__attribute__((unused)),
 		return;
 	}
 
-	printf("\tTVLV NCv1: enabled\n");
+	fprintf(dump_out, "\tTVLV NCv1: enabled\n");
 }
 
 static void batctl_tvlv_parse_tt_v1(void *buff, ssize_t buff_len)
@@ -182,15 +263,15 @@ static void batctl_tvlv_parse_tt_v1(void *buff, ssize_t buff_len)
 	buff_len -= vlan_len;
 	num_entry = buff_len / sizeof(struct batadv_tvlv_tt_change);
 
-	printf("\tTVLV TTv1: %s [%c] ttvn=%hhu vlan_num=%hu entry_num=%hu\n",
-	       type, tvlv->flags & BATADV_TT_FULL_TABLE ? 'F' : '.',
-	       tvlv->ttvn, num_vlan, num_entry);
+	fprintf(dump_out, "\tTVLV TTv1: %s [%c] ttvn=%hhu vlan_num=%hu entry_num=%hu\n",
+			  type, tvlv->flags & BATADV_TT_FULL_TABLE ? 'F' : '.',
+			  tvlv->ttvn, num_vlan, num_entry);
 
 	vlan = (struct batadv_tvlv_tt_vlan_data *)(tvlv + 1);
 	for (i = 0; i < num_vlan; i++) {
-		printf("\t\tVLAN ID %hd, crc %#.8x\n",
-		       BATADV_PRINT_VID(ntohs(vlan->vid)),
-		       ntohl(vlan->crc));
+		fprintf(dump_out, "\t\tVLAN ID %hd, crc %#.8x\n",
+				  BATADV_PRINT_VID(ntohs(vlan->vid)),
+				  ntohl(vlan->crc));
 		vlan++;
 	}
 }
@@ -205,9 +286,9 @@ static void batctl_tvlv_parse_roam_v1(void *buff, ssize_t buff_len)
 		return;
 	}
 
-	printf("\tTVLV ROAMv1: client %s, VLAN ID %d\n",
-	       get_name_by_macaddr((struct ether_addr *)tvlv->client, NO_FLAGS),
-	       BATADV_PRINT_VID(ntohs(tvlv->vid)));
+	fprintf(dump_out, "\tTVLV ROAMv1: client %s, VLAN ID %d\n",
+			  get_name_by_macaddr((struct ether_addr *)tvlv->client, NO_FLAGS),
+			  BATADV_PRINT_VID(ntohs(tvlv->vid)));
 }
 
 typedef void (*batctl_tvlv_parser_t)(void *buff, ssize_t buff_len);
@@ -260,6 +341,91 @@ static batctl_tvlv_parser_t tvlv_parser_get(uint8_t type, uint8_t version)
 	}
 }
 
+static void dump_stats_add(enum dump_stats_type type, size_t len)
+{
+	unsigned long *packets = &dump_counters->packets[type];
+	unsigned long *bytes = &dump_counters->bytes[type];
+
+	/* only this thread writes - the output thread reads them concurrently */
+	__atomic_store_n(packets, *packets + 1, __ATOMIC_RELAXED);
+	__atomic_store_n(bytes, *bytes + len, __ATOMIC_RELAXED);
+}
+
+static enum dump_stats_type dump_stats_tvlv_type(uint8_t type)
+{
+	switch (type) {
+	case BATADV_TVLV_GW:
+		return DUMP_STATS_TVLV_GW;
+	case BATADV_TVLV_DAT:
+		return DUMP_STATS_TVLV_DAT;
+	case BATADV_TVLV_NC:
+		return DUMP_STATS_TVLV_NC;
+	case BATADV_TVLV_TT:
+		return DUMP_STATS_TVLV_TT;
+	case BATADV_TVLV_ROAM:
+		return DUMP_STATS_TVLV_ROAM;
+	case BATADV_TVLV_MCAST:
+		return DUMP_STATS_TVLV_MCAST;
+	default:
+		return DUMP_STATS_TVLV_OTHER;
+	}
+}
+
+/* account the whole captured frame (including a VLAN tag) once to its type */
+static void dump_stats_frame(enum dump_stats_type type)
+{
+	if (!dump_frame_len)
+		return;
+
+	dump_stats_add(type, dump_frame_len);
+	dump_frame_len = 0;
+}
+
+/* account a frame once when (a part of) it was too short to be dissected */
+static void dump_stats_short(void)
+{
+	if (!dump_short_len)
+		return;
+
+	dump_stats_add(DUMP_STATS_SHORT, dump_short_len);
+	dump_short_len = 0;
+}
+
+/* remember the mesh and client addresses of a unicast or broadcast packet */
+static void dump_stats_flow(const uint8_t *orig, const uint8_t *dst,
+			    unsigned char *inner_buff, ssize_t inner_len)
+{
+	struct ether_header *eth_hdr = (struct ether_header *)inner_buff;
+
+	if (inner_len < (ssize_t)sizeof(*eth_hdr))
+		return;
+
+	memcpy(dump_flow->mesh, orig, ETH_ALEN);
+	memcpy(dump_flow->mesh + ETH_ALEN, dst, ETH_ALEN);
+	memcpy(dump_flow->client, eth_hdr->ether_shost, ETH_ALEN);
+	memcpy(dump_flow->client + ETH_ALEN, eth_hdr->ether_dhost, ETH_ALEN);
+	dump_flow->valid = true;
+}
+
+/* remember an originator message of the packet for the OGM tracker */
+static void dump_stats_ogm(const uint8_t *orig, const uint8_t *neigh,
+			   uint32_t seqno, uint8_t ttl, uint32_t metric,
+			   bool ogm2)
+{
+	struct dump_ogm_entry *entry;
+
+	if (dump_ogm->num == DUMP_OGM_MAX_AGGR)
+		return;
+
+	entry = &dump_ogm->entries[dump_ogm->num++];
+	memcpy(entry->orig, orig, ETH_ALEN);
+	memcpy(entry->neigh, neigh, ETH_ALEN);
+	entry->seqno = seqno;
+	entry->ttl = ttl;
+	entry->metric = metric;
+	entry->ogm2 = ogm2;
+}
+
 static void dump_tvlv(unsigned char *ptr, ssize_t tvlv_len)
 {
 	struct batadv_tvlv_hdr *tvlv_hdr;
@@ -276,9 +442,15 @@ static void dump_tvlv(unsigned char *ptr, ssize_t tvlv_len)
 		len = ntohs(tvlv_hdr->len);
 		LEN_CHECK(tvlv_len, (size_t)len, "BAT TVLV");
 
-		parser = tvlv_parser_get(tvlv_hdr->type, tvlv_hdr->version);
-		if (parser)
-			parser(ptr, len);
+		if (dump_counters) {
+			dump_stats_add(dump_stats_tvlv_type(tvlv_hdr->type),
+				       sizeof(*tvlv_hdr) + len);
+		} else {
+			parser = tvlv_parser_get(tvlv_hdr->type,
+						 tvlv_hdr->version);
+			if (parser)
+				parser(ptr, len);
+		}
 
 		/* go to the next container */
 		ptr += len;
@@ -305,18 +477,24 @@ static void dump_batman_ucast_tvlv(unsigned char *packet_buff, ssize_t buff_len,
 	LEN_CHECK(check_len, (size_t)ntohs(tvlv_packet->tvlv_len),
 		  "BAT TVLV (containers)");
 
+	if (dump_counters) {
+		dump_tvlv((uint8_t *)(tvlv_packet + 1),
+			  ntohs(tvlv_packet->tvlv_len));
+		return;
+	}
+
 	if (!time_printed)
 		time_printed = print_time();
 
 	src = (struct ether_addr *)tvlv_packet->src;
-	printf("BAT %s > ", get_name_by_macaddr(src, read_opt));
+	fprintf(dump_out, "BAT %s > ", get_name_by_macaddr(src, read_opt));
 
 	dst = (struct ether_addr *)tvlv_packet->dst;
 	tvlv_len = ntohs(tvlv_packet->tvlv_len);
-	printf("%s: TVLV, len %zu, tvlv_len %zu, ttl %hhu\n",
-	       get_name_by_macaddr(dst, read_opt),
-	       buff_len - sizeof(struct ether_header), tvlv_len,
-	       tvlv_packet->ttl);
+	fprintf(dump_out, "%s: TVLV, len %zu, tvlv_len %zu, ttl %hhu\n",
+			  get_name_by_macaddr(dst, read_opt),
+			  buff_len - sizeof(struct ether_header), tvlv_len,
+			  tvlv_packet->ttl);
 
 	dump_tvlv((uint8_t *)(tvlv_packet + 1), tvlv_len);
 }
@@ -350,38 +528,38 @@ static int dump_bla2_claim(struct ether_header *eth_hdr,
 
 	switch (bla_dst->type) {
 	case BATADV_CLAIM_TYPE_CLAIM:
-		printf("BLA CLAIM, backbone %s, ",
-		       get_name_by_macaddr((struct ether_addr *)hw_src, read_opt));
-		printf("client %s, bla group %04x\n",
-		       get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_shost, read_opt),
-		       ntohs(bla_dst->group));
+		fprintf(dump_out, "BLA CLAIM, backbone %s, ",
+				  get_name_by_macaddr((struct ether_addr *)hw_src, read_opt));
+		fprintf(dump_out, "client %s, bla group %04x\n",
+				  get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_shost, read_opt),
+				  ntohs(bla_dst->group));
 		break;
 	case BATADV_CLAIM_TYPE_UNCLAIM:
-		printf("BLA UNCLAIM, backbone %s, ",
-		       get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_shost, read_opt));
-		printf("client %s, bla group %04x\n",
-		       get_name_by_macaddr((struct ether_addr *)hw_src, read_opt),
-		       ntohs(bla_dst->group));
+		fprintf(dump_out, "BLA UNCLAIM, backbone %s, ",
+				  get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_shost, read_opt));
+		fprintf(dump_out, "client %s, bla group %04x\n",
+				  get_name_by_macaddr((struct ether_addr *)hw_src, read_opt),
+				  ntohs(bla_dst->group));
 		break;
 	case BATADV_CLAIM_TYPE_ANNOUNCE:
-		printf("BLA ANNOUNCE, backbone %s, bla group %04x, crc %04x\n",
-		       get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_shost, read_opt),
-		       ntohs(bla_dst->group), ntohs(*((uint16_t *)(&hw_src[4]))));
+		fprintf(dump_out, "BLA ANNOUNCE, backbone %s, bla group %04x, crc %04x\n",
+				  get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_shost, read_opt),
+				  ntohs(bla_dst->group), ntohs(*((uint16_t *)(&hw_src[4]))));
 		break;
 	case BATADV_CLAIM_TYPE_REQUEST:
-		printf("BLA REQUEST, src backbone %s, ",
-		       get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_shost, read_opt));
-		printf("dst backbone %s\n",
-		       get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_dhost, read_opt));
+		fprintf(dump_out, "BLA REQUEST, src backbone %s, ",
+				  get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_shost, read_opt));
+		fprintf(dump_out, "dst backbone %s\n",
+				  get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_dhost, read_opt));
 		break;
 	case BATADV_CLAIM_TYPE_LOOPDETECT:
-		printf("BLA LOOPDETECT, src backbone %s, ",
-		       get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_shost, read_opt));
-		printf("dst backbone %s\n",
-		       get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_dhost, read_opt));
+		fprintf(dump_out, "BLA LOOPDETECT, src backbone %s, ",
+				  get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_shost, read_opt));
+		fprintf(dump_out, "dst backbone %s\n",
+				  get_name_by_macaddr((struct ether_addr *)eth_hdr->ether_dhost, read_opt));
 		break;
 	default:
-		printf("BLA UNKNOWN, type %hhu\n", bla_dst->type);
+		fprintf(dump_out, "BLA UNKNOWN, type %hhu\n", bla_dst->type);
 		break;
 	}
 
@@ -406,8 +584,8 @@ static void dump_arp(unsigned char *packet_buff, ssize_t buff_len,
 
 	switch (ntohs(arphdr->arp_op)) {
 	case ARPOP_REQUEST:
-		printf("ARP, Request who-has %s", inet_ntoa(*(struct in_addr *)&arphdr->arp_tpa));
-		printf(" tell %s (%s), length %zd\n", inet_ntoa(*(struct in_addr *)&arphdr->arp_spa),
+		fprintf(dump_out, "ARP, Request who-has %s", inet_ntoa(*(struct in_addr *)&arphdr->arp_tpa));
+		fprintf(dump_out, " tell %s (%s), length %zd\n", inet_ntoa(*(struct in_addr *)&arphdr->arp_spa),
 			ether_ntoa_long((struct ether_addr *)&arphdr->arp_sha), buff_len);
 		break;
 	case ARPOP_REPLY:
@@ -415,11 +593,11 @@ static void dump_arp(unsigned char *packet_buff, ssize_t buff_len,
 		if (arp_is_bla2_claim)
 			break;
 
-		printf("ARP, Reply %s is-at %s, length %zd\n", inet_ntoa(*(struct in_addr *)&arphdr->arp_spa),
+		fprintf(dump_out, "ARP, Reply %s is-at %s, length %zd\n", inet_ntoa(*(struct in_addr *)&arphdr->arp_spa),
 			ether_ntoa_long((struct ether_addr *)&arphdr->arp_sha), buff_len);
 		break;
 	default:
-		printf("ARP, unknown op code: %i\n", ntohs(arphdr->arp_op));
+		fprintf(dump_out, "ARP, unknown op code: %i\n", ntohs(arphdr->arp_op));
 		break;
 	}
 }
@@ -435,8 +613,8 @@ static void dump_tcp(const char ip_string[], unsigned char *packet_buff,
 		  sizeof(struct tcphdr), "TCP");
 	tcphdr = (struct tcphdr *)(packet_buff + ip6_header_len);
 	tcp_header_len = tcphdr->doff * 4;
-	printf("%s %s.%i > ", ip_string, src_addr, ntohs(tcphdr->source));
-	printf("%s.%i: TCP, Flags [%c%c%c%c%c%c], length %zu\n",
+	fprintf(dump_out, "%s %s.%i > ", ip_string, src_addr, ntohs(tcphdr->source));
+	fprintf(dump_out, "%s.%i: TCP, Flags [%c%c%c%c%c%c], length %zu\n",
 		dst_addr, ntohs(tcphdr->dest),
 		(tcphdr->fin ? 'F' : '.'), (tcphdr->syn ? 'S' : '.'),
 		(tcphdr->rst ? 'R' : '.'), (tcphdr->psh ? 'P' : '.'),
@@ -453,29 +631,29 @@ static void dump_udp(const char ip_string[], unsigned char *packet_buff,
 	LEN_CHECK((size_t)buff_len - ip6_header_len, sizeof(struct udphdr),
 		  "UDP");
 	udphdr = (struct udphdr *)(packet_buff + ip6_header_len);
-	printf("%s %s.%i > ", ip_string, src_addr, ntohs(udphdr->source));
+	fprintf(dump_out, "%s %s.%i > ", ip_string, src_addr, ntohs(udphdr->source));
 
 	switch (ntohs(udphdr->dest)) {
 	case 67:
 		LEN_CHECK((size_t)buff_len - ip6_header_len -
 			  sizeof(struct udphdr), (size_t) 44, "DHCP");
-		printf("%s.67: BOOTP/DHCP, Request from %s, length %zu\n",
-		       dst_addr,
-		       ether_ntoa_long((struct ether_addr *)(((char *)udphdr) +
+		fprintf(dump_out, "%s.67: BOOTP/DHCP, Request from %s, length %zu\n",
+				  dst_addr,
+				  ether_ntoa_long((struct ether_addr *)(((char *)udphdr) +
 				       sizeof(struct udphdr) + 28)),
-		       (size_t)buff_len - ip6_header_len -
-		       sizeof(struct udphdr));
+				  (size_t)buff_len - ip6_header_len -
+				  sizeof(struct udphdr));
 		break;
 	case 68:
-		printf("%s.68: BOOTP/DHCP, Reply, length %zu\n", dst_addr,
-		       (size_t)buff_len - ip6_header_len -
-		       sizeof(struct udphdr));
+		fprintf(dump_out, "%s.68: BOOTP/DHCP, Reply, length %zu\n", dst_addr,
+				  (size_t)buff_len - ip6_header_len -
+				  sizeof(struct udphdr));
 		break;
 	default:
-		printf("%s.%i: UDP, length %zu\n", dst_addr,
-		       ntohs(udphdr->dest),
-		       (size_t)buff_len - ip6_header_len -
-		       sizeof(struct udphdr));
+		fprintf(dump_out, "%s.%i: UDP, length %zu\n", dst_addr,
+				  ntohs(udphdr->dest),
+				  (size_t)buff_len - ip6_header_len -
+				  sizeof(struct udphdr));
 		break;
 	}
 }
@@ -515,7 +693,7 @@ static void dump_ipv6(unsigned char *packet_buff, ssize_t buff_len,
 		icmphdr = (struct icmp6_hdr *)(packet_buff +
 					       sizeof(struct ip6_hdr));
 
-		printf("%s %s > %s ", ip_string, ipsrc, ipdst);
+		fprintf(dump_out, "%s %s > %s ", ip_string, ipsrc, ipdst);
 		if (icmphdr->icmp6_type < ICMP6_INFOMSG_MASK &&
 		    (size_t)(buff_len) > IPV6_MIN_MTU) {
 			fprintf(stderr,
@@ -524,61 +702,61 @@ static void dump_ipv6(unsigned char *packet_buff, ssize_t buff_len,
 			return;
 		}
 
-		printf("ICMP6");
+		fprintf(dump_out, "ICMP6");
 		switch (icmphdr->icmp6_type) {
 		case ICMP6_DST_UNREACH:
 			switch (icmphdr->icmp6_code) {
 			case ICMP6_DST_UNREACH_NOROUTE:
-				printf(", unreachable route\n");
+				fprintf(dump_out, ", unreachable route\n");
 				break;
 			case ICMP6_DST_UNREACH_ADMIN:
-				printf(", unreachable prohibited\n");
+				fprintf(dump_out, ", unreachable prohibited\n");
 				break;
 			case ICMP6_DST_UNREACH_ADDR:
-				printf(", unreachable address\n");
+				fprintf(dump_out, ", unreachable address\n");
 				break;
 			case ICMP6_DST_UNREACH_BEYONDSCOPE:
-				printf(", beyond scope\n");
+				fprintf(dump_out, ", beyond scope\n");
 				break;
 			case ICMP6_DST_UNREACH_NOPORT:
-				printf(", unreachable port\n");
+				fprintf(dump_out, ", unreachable port\n");
 				break;
 			default:
-				printf(", unknown unreach code (%u)\n",
-				       icmphdr->icmp6_code);
+				fprintf(dump_out, ", unknown unreach code (%u)\n",
+						  icmphdr->icmp6_code);
 			}
 			break;
 		case ICMP6_ECHO_REQUEST:
-			printf(" echo request, id: %d, seq: %d, length: %hu\n",
-			       icmphdr->icmp6_id, icmphdr->icmp6_seq,
-			       iphdr->ip6_plen);
+			fprintf(dump_out, " echo request, id: %d, seq: %d, length: %hu\n",
+					  icmphdr->icmp6_id, icmphdr->icmp6_seq,
+					  iphdr->ip6_plen);
 			break;
 		case ICMP6_ECHO_REPLY:
-			printf(" echo reply, id: %d, seq: %d, length: %hu\n",
-			       icmphdr->icmp6_id, icmphdr->icmp6_seq,
-			       iphdr->ip6_plen);
+			fprintf(dump_out, " echo reply, id: %d, seq: %d, length: %hu\n",
+					  icmphdr->icmp6_id, icmphdr->icmp6_seq,
+					  iphdr->ip6_plen);
 			break;
 		case ICMP6_TIME_EXCEEDED:
-			printf(" time exceeded in-transit, length %zu\n",
-			       (size_t)buff_len - sizeof(struct icmp6_hdr));
+			fprintf(dump_out, " time exceeded in-transit, length %zu\n",
+					  (size_t)buff_len - sizeof(struct icmp6_hdr));
 			break;
 		case ND_NEIGHBOR_SOLICIT:
 			nd_neigh_sol = (struct nd_neighbor_solicit *)icmphdr;
 			inet_ntop(AF_INET6, &(nd_neigh_sol->nd_ns_target),
 				  nd_nas_target, 40);
-			printf(" neighbor solicitation, who has %s, length %zd\n",
-			       nd_nas_target, buff_len);
+			fprintf(dump_out, " neighbor solicitation, who has %s, length %zd\n",
+					  nd_nas_target, buff_len);
 			break;
 		case ND_NEIGHBOR_ADVERT:
 			nd_advert = (struct nd_neighbor_advert *)icmphdr;
 			inet_ntop(AF_INET6, &(nd_advert->nd_na_target),
 				  nd_nas_target, 40);
-			printf(" neighbor advertisement, tgt is %s, length %zd\n",
-			       nd_nas_target, buff_len);
+			fprintf(dump_out, " neighbor advertisement, tgt is %s, length %zd\n",
+					  nd_nas_target, buff_len);
 			break;
 		default:
-			printf(", destination unreachable, unknown icmp6 type (%u)\n",
-			       icmphdr->icmp6_type);
+			fprintf(dump_out, ", destination unreachable, unknown icmp6 type (%u)\n",
+					  icmphdr->icmp6_type);
 			break;
 		}
 		break;
@@ -591,7 +769,7 @@ static void dump_ipv6(unsigned char *packet_buff, ssize_t buff_len,
 			 sizeof(struct ip6_hdr), ipsrc, ipdst);
 		break;
 	default:
-		printf(" IPv6 unknown protocol: %i\n", iphdr->ip6_nxt);
+		fprintf(dump_out, " IPv6 unknown protocol: %i\n", iphdr->ip6_nxt);
 	}
 }
 
@@ -625,11 +803,11 @@ static void dump_ip(unsigned char *packet_buff, ssize_t buff_len,
 		LEN_CHECK((size_t)buff_len - (iphdr->ihl * 4), sizeof(struct icmphdr), "ICMP");
 
 		icmphdr = (struct icmphdr *)(packet_buff + (iphdr->ihl * 4));
-		printf("%s %s > ", ip_string, ipsrc);
+		fprintf(dump_out, "%s %s > ", ip_string, ipsrc);
 
 		switch (icmphdr->type) {
 		case ICMP_ECHOREPLY:
-			printf("%s: ICMP echo reply, id %hu, seq %hu, length %zu\n",
+			fprintf(dump_out, "%s: ICMP echo reply, id %hu, seq %hu, length %zu\n",
 				ipdst, ntohs(icmphdr->un.echo.id),
 				ntohs(icmphdr->un.echo.sequence),
 				(size_t)buff_len - (iphdr->ihl * 4));
@@ -643,13 +821,13 @@ static void dump_ip(unsigned char *packet_buff, ssize_t buff_len,
 				tmp_iphdr = (struct iphdr *)(((char *)icmphdr) + sizeof(struct icmphdr));
 				tmp_udphdr = (struct udphdr *)(((char *)tmp_iphdr) + (tmp_iphdr->ihl * 4));
 
-				printf("%s: ICMP ", ipdst);
-				printf("%s udp port %hu unreachable, length %zu\n",
+				fprintf(dump_out, "%s: ICMP ", ipdst);
+				fprintf(dump_out, "%s udp port %hu unreachable, length %zu\n",
 					ipdst, ntohs(tmp_udphdr->dest),
 					(size_t)buff_len - (iphdr->ihl * 4));
 				break;
 			default:
-				printf("%s: ICMP unreachable %hhu, length %zu\n",
+				fprintf(dump_out, "%s: ICMP unreachable %hhu, length %zu\n",
 					ipdst, icmphdr->code,
 					(size_t)buff_len - (iphdr->ihl * 4));
 				break;
@@ -657,17 +835,17 @@ static void dump_ip(unsigned char *packet_buff, ssize_t buff_len,
 
 			break;
 		case ICMP_ECHO:
-			printf("%s: ICMP echo request, id %hu, seq %hu, length %zu\n",
+			fprintf(dump_out, "%s: ICMP echo request, id %hu, seq %hu, length %zu\n",
 				ipdst, ntohs(icmphdr->un.echo.id),
 				ntohs(icmphdr->un.echo.sequence),
 				(size_t)buff_len - (iphdr->ihl * 4));
 			break;
 		case ICMP_TIME_EXCEEDED:
-			printf("%s: ICMP time exceeded in-transit, length %zu\n",
+			fprintf(dump_out, "%s: ICMP time exceeded in-transit, length %zu\n",
 				ipdst, (size_t)buff_len - (iphdr->ihl * 4));
 			break;
 		default:
-			printf("%s: ICMP type %hhu, length %zu\n",
+			fprintf(dump_out, "%s: ICMP type %hhu, length %zu\n",
 				ipdst, icmphdr->type,
 				(size_t)buff_len - (iphdr->ihl * 4));
 			break;
@@ -682,7 +860,7 @@ static void dump_ip(unsigned char *packet_buff, ssize_t buff_len,
 			 ipsrc, ipdst);
 		break;
 	default:
-		printf("IP unknown protocol: %i\n", iphdr->protocol);
+		fprintf(dump_out, "IP unknown protocol: %i\n", iphdr->protocol);
 		break;
 	}
 }
@@ -694,11 +872,14 @@ static void dump_vlan(unsigned char *packet_buff, ssize_t buff_len, int read_opt
 	vlanhdr = (struct vlanhdr *)(packet_buff + sizeof(struct ether_header));
 	LEN_CHECK((size_t)buff_len, sizeof(struct ether_header) + sizeof(struct vlanhdr), "VLAN");
 
-	if (!time_printed)
-		time_printed = print_time();
+	if (!dump_counters) {
+		if (!time_printed)
+			time_printed = print_time();
 
-	vlanhdr->vid = ntohs(vlanhdr->vid);
-	printf("vlan %u, p %u, ", vlanhdr->vid, vlanhdr->vid >> 12);
+		vlanhdr->vid = ntohs(vlanhdr->vid);
+		fprintf(dump_out, "vlan %u, p %u, ", vlanhdr->vid,
+			vlanhdr->vid >> 12);
+	}
 
 	/* overwrite vlan tags */
 	memmove(packet_buff + 4, packet_buff, 2 * ETH_ALEN);
@@ -718,26 +899,42 @@ static void dump_batman_iv_ogm(unsigned char *packet_buff, ssize_t buff_len, int
 	ether_header = (struct ether_header *)packet_buff;
 	batman_ogm_packet = (struct batadv_ogm_packet *)(packet_buff + sizeof(struct ether_header));
 
-	if (!time_printed)
-		print_time();
-
-	printf("BAT %s: ",
-	       get_name_by_macaddr((struct ether_addr *)batman_ogm_packet->orig, read_opt));
+	/* aggregated OGMs follow the TVLV containers of the previous one */
+	while (check_len >= (ssize_t)sizeof(struct batadv_ogm_packet) &&
+	       batman_ogm_packet->packet_type == BATADV_IV_OGM) {
+		tvlv_len = ntohs(batman_ogm_packet->tvlv_len);
+
+		if (dump_counters) {
+			dump_stats_ogm(batman_ogm_packet->orig,
+				       ether_header->ether_shost,
+				       ntohl(batman_ogm_packet->seqno),
+				       batman_ogm_packet->ttl,
+				       batman_ogm_packet->tq, false);
+		} else {
+			if (!time_printed)
+				print_time();
+
+			fprintf(dump_out, "BAT %s: ",
+					  get_name_by_macaddr((struct ether_addr *)batman_ogm_packet->orig, read_opt));
+
+			fprintf(dump_out, "OGM IV via neigh %s, seq %u, tq %3d, ttl %2d, v %d, flags [%c%c%c], length %zu, tvlv_len %zu\n",
+					  get_name_by_macaddr((struct ether_addr *)ether_header->ether_shost, read_opt),
+					  ntohl(batman_ogm_packet->seqno), batman_ogm_packet->tq,
+					  batman_ogm_packet->ttl, batman_ogm_packet->version,
+					  (batman_ogm_packet->flags & BATADV_NOT_BEST_NEXT_HOP ? 'N' : '.'),
+					  (batman_ogm_packet->flags & BATADV_DIRECTLINK ? 'D' : '.'),
+					  (batman_ogm_packet->flags & BATADV_PRIMARIES_FIRST_HOP ? 'F' : '.'),
+					  check_len, tvlv_len);
+		}
 
-	tvlv_len = ntohs(batman_ogm_packet->tvlv_len);
-	printf("OGM IV via neigh %s, seq %u, tq %3d, ttl %2d, v %d, flags [%c%c%c], length %zu, tvlv_len %zu\n",
-	       get_name_by_macaddr((struct ether_addr *)ether_header->ether_shost, read_opt),
-	       ntohl(batman_ogm_packet->seqno), batman_ogm_packet->tq,
-	       batman_ogm_packet->ttl, batman_ogm_packet->version,
-	       (batman_ogm_packet->flags & BATADV_NOT_BEST_NEXT_HOP ? 'N' : '.'),
-	       (batman_ogm_packet->flags & BATADV_DIRECTLINK ? 'D' : '.'),
-	       (batman_ogm_packet->flags & BATADV_PRIMARIES_FIRST_HOP ? 'F' : '.'),
-	       check_len, tvlv_len);
+		check_len -= sizeof(struct batadv_ogm_packet);
+		LEN_CHECK(check_len, (size_t)tvlv_len, "BAT OGM TVLV (containers)");
 
-	check_len -= sizeof(struct batadv_ogm_packet);
-	LEN_CHECK(check_len, (size_t)tvlv_len, "BAT OGM TVLV (containers)");
+		dump_tvlv((uint8_t *)(batman_ogm_packet + 1), tvlv_len);
 
-	dump_tvlv((uint8_t *)(batman_ogm_packet + 1), tvlv_len);
+		check_len -= tvlv_len;
+		batman_ogm_packet = (struct batadv_ogm_packet *)((uint8_t *)(batman_ogm_packet + 1) + tvlv_len);
+	}
 }
 
 static void dump_batman_ogm2(unsigned char *packet_buff, ssize_t buff_len,
@@ -757,31 +954,48 @@ static void dump_batman_ogm2(unsigned char *packet_buff, ssize_t buff_len,
 	batman_ogm2 = (struct batadv_ogm2_packet *)(packet_buff +
 						    sizeof(struct ether_header));
 
-	if (!time_printed)
-		print_time();
-
-	ether_addr = (struct ether_addr *)batman_ogm2->orig;
-	printf("BAT %s: ", get_name_by_macaddr(ether_addr, read_opt));
-
-	tvlv_len = ntohs(batman_ogm2->tvlv_len);
-
-	throughput = ntohl(batman_ogm2->throughput);
-	if (throughput == BATADV_THROUGHPUT_MAX_VALUE)
-		snprintf(thr_str, sizeof(thr_str), "MAX");
-	else
-		snprintf(thr_str, sizeof(thr_str), "%.1fMbps",
-			 (float)ntohl(batman_ogm2->throughput) / 10);
+	/* aggregated OGMs follow the TVLV containers of the previous one */
+	while (check_len >= (ssize_t)BATADV_OGM2_HLEN &&
+	       batman_ogm2->packet_type == BATADV_OGM2) {
+		tvlv_len = ntohs(batman_ogm2->tvlv_len);
+		throughput = ntohl(batman_ogm2->throughput);
+
+		if (dump_counters) {
+			dump_stats_ogm(batman_ogm2->orig,
+				       ether_header->ether_shost,
+				       ntohl(batman_ogm2->seqno),
+				       batman_ogm2->ttl, throughput, true);
+		} else {
+			if (!time_printed)
+				print_time();
+
+			ether_addr = (struct ether_addr *)batman_ogm2->orig;
+			fprintf(dump_out, "BAT %s: ",
+				get_name_by_macaddr(ether_addr, read_opt));
+
+			if (throughput == BATADV_THROUGHPUT_MAX_VALUE)
+				snprintf(thr_str, sizeof(thr_str), "MAX");
+			else
+				snprintf(thr_str, sizeof(thr_str), "%.1fMbps",
+					 (float)throughput / 10);
+
+			ether_addr = (struct ether_addr *)ether_header->ether_shost;
+			fprintf(dump_out, "OGM2 via neigh %s, seq %u, throughput %s, ttl %2d, v %d, length %zu, tvlv_len %zu\n",
+					  get_name_by_macaddr(ether_addr, read_opt),
+					  ntohl(batman_ogm2->seqno), thr_str,
+					  batman_ogm2->ttl, batman_ogm2->version,
+					  check_len, tvlv_len);
+		}
 
-	ether_addr = (struct ether_addr *)ether_header->ether_shost;
-	printf("OGM2 via neigh %s, seq %u, throughput %s, ttl %2d, v %d, length %zu, tvlv_len %zu\n",
-	       get_name_by_macaddr(ether_addr, read_opt),
-	       ntohl(batman_ogm2->seqno), thr_str, batman_ogm2->ttl,
-	       batman_ogm2->version, check_len, tvlv_len);
+		check_len -= BATADV_OGM2_HLEN;
+		LEN_CHECK(check_len, (size_t)tvlv_len, "BAT OGM2 TVLV (containers)");
 
-	check_len -= BATADV_OGM2_HLEN;
-	LEN_CHECK(check_len, (size_t)tvlv_len, "BAT OGM2 TVLV (containers)");
+		dump_tvlv((uint8_t *)(batman_ogm2 + 1), tvlv_len);
 
-	dump_tvlv((uint8_t *)(batman_ogm2 + 1), tvlv_len);
+		check_len -= tvlv_len;
+		batman_ogm2 = (struct batadv_ogm2_packet *)((uint8_t *)(batman_ogm2 + 1) +
+							    tvlv_len);
+	}
 }
 
 static void dump_batman_elp(unsigned char *packet_buff, ssize_t buff_len,
@@ -803,13 +1017,13 @@ static void dump_batman_elp(unsigned char *packet_buff, ssize_t buff_len,
 		print_time();
 
 	ether_addr = (struct ether_addr *)batman_elp->orig;
-	printf("BAT %s: ", get_name_by_macaddr(ether_addr, read_opt));
+	fprintf(dump_out, "BAT %s: ", get_name_by_macaddr(ether_addr, read_opt));
 
 	ether_addr = (struct ether_addr *)ether_header->ether_shost;
-	printf("ELP via iface %s, seq %u, v %d, interval %ums, length %zu\n",
-	       get_name_by_macaddr(ether_addr, read_opt),
-	       ntohl(batman_elp->seqno), batman_elp->version,
-	       ntohl(batman_elp->elp_interval), check_len);
+	fprintf(dump_out, "ELP via iface %s, seq %u, v %d, interval %ums, length %zu\n",
+			  get_name_by_macaddr(ether_addr, read_opt),
+			  ntohl(batman_elp->seqno), batman_elp->version,
+			  ntohl(batman_elp->elp_interval), check_len);
 }
 
 static void dump_batman_icmp(unsigned char *packet_buff, ssize_t buff_len, int read_opt, int time_printed)
@@ -827,41 +1041,41 @@ static void dump_batman_icmp(unsigned char *packet_buff, ssize_t buff_len, int r
 	if (!time_printed)
 		print_time();
 
-	printf("BAT %s > ",
-	       get_name_by_macaddr((struct ether_addr *)icmp_packet->orig, read_opt));
+	fprintf(dump_out, "BAT %s > ",
+			  get_name_by_macaddr((struct ether_addr *)icmp_packet->orig, read_opt));
 
 	name = get_name_by_macaddr((struct ether_addr *)icmp_packet->dst,
 				    read_opt);
 
 	switch (icmp_packet->msg_type) {
 	case BATADV_ECHO_REPLY:
-		printf("%s: ICMP echo reply, id %hhu, seq %hu, ttl %2d, v %d, length %zu\n",
+		fprintf(dump_out, "%s: ICMP echo reply, id %hhu, seq %hu, ttl %2d, v %d, length %zu\n",
 			name, icmp_packet->uid, ntohs(icmp_packet->seqno),
 			icmp_packet->ttl, icmp_packet->version,
 			(size_t)buff_len - sizeof(struct ether_header));
 		break;
 	case BATADV_ECHO_REQUEST:
-		printf("%s: ICMP echo request, id %hhu, seq %hu, ttl %2d, v %d, length %zu\n",
+		fprintf(dump_out, "%s: ICMP echo request, id %hhu, seq %hu, ttl %2d, v %d, length %zu\n",
 			name, icmp_packet->uid, ntohs(icmp_packet->seqno),
 			icmp_packet->ttl, icmp_packet->version,
 			(size_t)buff_len - sizeof(struct ether_header));
 		break;
 	case BATADV_TTL_EXCEEDED:
-		printf("%s: ICMP time exceeded in-transit, id %hhu, seq %hu, ttl %2d, v %d, length %zu\n",
+		fprintf(dump_out, "%s: ICMP time exceeded in-transit, id %hhu, seq %hu, ttl %2d, v %d, length %zu\n",
 			name, icmp_packet->uid, ntohs(icmp_packet->seqno),
 			icmp_packet->ttl, icmp_packet->version,
 			(size_t)buff_len - sizeof(struct ether_header));
 		break;
 	case BATADV_TP:
-		printf("%s: ICMP TP type %s (%hhu), id %hhu, seq %u, ttl %2d, v %d, length %zu\n",
-		       name, tp->subtype == BATADV_TP_MSG ? "MSG" :
+		fprintf(dump_out, "%s: ICMP TP type %s (%hhu), id %hhu, seq %u, ttl %2d, v %d, length %zu\n",
+				  name, tp->subtype == BATADV_TP_MSG ? "MSG" :
 			     tp->subtype == BATADV_TP_ACK ? "ACK" : "N/A",
-		       tp->subtype, tp->uid, ntohl(tp->seqno), tp->ttl,
-		       tp->version,
-		       (size_t)buff_len - sizeof(struct ether_header));
+				  tp->subtype, tp->uid, ntohl(tp->seqno), tp->ttl,
+				  tp->version,
+				  (size_t)buff_len - sizeof(struct ether_header));
 		break;
 	default:
-		printf("%s: ICMP type %hhu, length %zu\n",
+		fprintf(dump_out, "%s: ICMP type %hhu, length %zu\n",
 			name, icmp_packet->msg_type,
 			(size_t)buff_len - sizeof(struct ether_header));
 		break;
@@ -880,15 +1094,22 @@ static void dump_batman_ucast(unsigned char *packet_buff, ssize_t buff_len, int
 	ether_header = (struct ether_header *)packet_buff;
 	unicast_packet = (struct batadv_unicast_packet *)(packet_buff + sizeof(struct ether_header));
 
+	if (dump_counters) {
+		dump_stats_flow(ether_header->ether_shost, unicast_packet->dest,
+				(uint8_t *)(unicast_packet + 1),
+				buff_len - ETH_HLEN - sizeof(*unicast_packet));
+		return;
+	}
+
 	if (!time_printed)
 		time_printed = print_time();
 
-	printf("BAT %s > ",
-	       get_name_by_macaddr((struct ether_addr *)ether_header->ether_shost, read_opt));
+	fprintf(dump_out, "BAT %s > ",
+			  get_name_by_macaddr((struct ether_addr *)ether_header->ether_shost, read_opt));
 
-	printf("%s: UCAST, ttvn %d, ttl %hhu, ",
-	       get_name_by_macaddr((struct ether_addr *)unicast_packet->dest, read_opt),
-	       unicast_packet->ttvn, unicast_packet->ttl);
+	fprintf(dump_out, "%s: UCAST, ttvn %d, ttl %hhu, ",
+			  get_name_by_macaddr((struct ether_addr *)unicast_packet->dest, read_opt),
+			  unicast_packet->ttvn, unicast_packet->ttl);
 
 	parse_eth_hdr(packet_buff + ETH_HLEN + sizeof(struct batadv_unicast_packet),
 		      buff_len - ETH_HLEN - sizeof(struct batadv_unicast_packet),
@@ -907,15 +1128,22 @@ static void dump_batman_bcast(unsigned char *packet_buff, ssize_t buff_len, int
 	ether_header = (struct ether_header *)packet_buff;
 	bcast_packet = (struct batadv_bcast_packet *)(packet_buff + sizeof(struct ether_header));
 
+	if (dump_counters) {
+		dump_stats_flow(bcast_packet->orig, ether_header->ether_dhost,
+				(uint8_t *)(bcast_packet + 1),
+				buff_len - ETH_HLEN - sizeof(*bcast_packet));
+		return;
+	}
+
 	if (!time_printed)
 		time_printed = print_time();
 
-	printf("BAT %s: ",
-	       get_name_by_macaddr((struct ether_addr *)ether_header->ether_shost, read_opt));
+	fprintf(dump_out, "BAT %s: ",
+			  get_name_by_macaddr((struct ether_addr *)ether_header->ether_shost, read_opt));
 
-	printf("BCAST, orig %s, seq %u, ",
-	       get_name_by_macaddr((struct ether_addr *)bcast_packet->orig, read_opt),
-	       ntohl(bcast_packet->seqno));
+	fprintf(dump_out, "BCAST, orig %s, seq %u, ",
+			  get_name_by_macaddr((struct ether_addr *)bcast_packet->orig, read_opt),
+			  ntohl(bcast_packet->seqno));
 
 	parse_eth_hdr(packet_buff + ETH_HLEN + sizeof(struct batadv_bcast_packet),
 		      buff_len - ETH_HLEN - sizeof(struct batadv_bcast_packet),
@@ -927,23 +1155,38 @@ static void dump_batman_4addr(unsigned char *packet_buff, ssize_t buff_len, int
 	struct ether_header *ether_header;
 	struct batadv_unicast_4addr_packet *unicast_4addr_packet;
 
+	unicast_4addr_packet = (struct batadv_unicast_4addr_packet *)(packet_buff + sizeof(struct ether_header));
+
+	if ((size_t)buff_len - ETH_HLEN >= sizeof(*unicast_4addr_packet) &&
+	    unicast_4addr_packet->subtype != BATADV_P_DATA)
+		dump_stats_frame(DUMP_STATS_4ADDR_DAT);
+	else
+		dump_stats_frame(DUMP_STATS_4ADDR);
+
 	LEN_CHECK((size_t)buff_len - sizeof(struct ether_header), sizeof(struct batadv_unicast_4addr_packet), "BAT 4ADDR");
 	LEN_CHECK((size_t)buff_len - sizeof(struct ether_header) - sizeof(struct batadv_unicast_4addr_packet),
 		sizeof(struct ether_header), "BAT 4ADDR (unpacked)");
 
 	ether_header = (struct ether_header *)packet_buff;
-	unicast_4addr_packet = (struct batadv_unicast_4addr_packet *)(packet_buff + sizeof(struct ether_header));
+
+	if (dump_counters) {
+		dump_stats_flow(unicast_4addr_packet->src,
+				unicast_4addr_packet->u.dest,
+				(uint8_t *)(unicast_4addr_packet + 1),
+				buff_len - ETH_HLEN - sizeof(*unicast_4addr_packet));
+		return;
+	}
 
 	if (!time_printed)
 		time_printed = print_time();
 
-	printf("BAT %s > ",
-	       get_name_by_macaddr((struct ether_addr *)ether_header->ether_shost, read_opt));
+	fprintf(dump_out, "BAT %s > ",
+			  get_name_by_macaddr((struct ether_addr *)ether_header->ether_shost, read_opt));
 
-	printf("%s: 4ADDR, subtybe %hhu, ttvn %d, ttl %hhu, ",
-	       get_name_by_macaddr((struct ether_addr *)unicast_4addr_packet->u.dest, read_opt),
-	       unicast_4addr_packet->subtype, unicast_4addr_packet->u.ttvn,
-	       unicast_4addr_packet->u.ttl);
+	fprintf(dump_out, "%s: 4ADDR, subtybe %hhu, ttvn %d, ttl %hhu, ",
+			  get_name_by_macaddr((struct ether_addr *)unicast_4addr_packet->u.dest, read_opt),
+			  unicast_4addr_packet->subtype, unicast_4addr_packet->u.ttvn,
+			  unicast_4addr_packet->u.ttl);
 
 	parse_eth_hdr(packet_buff + ETH_HLEN + sizeof(struct batadv_unicast_4addr_packet),
 		      buff_len - ETH_HLEN - sizeof(struct batadv_unicast_4addr_packet),
@@ -953,82 +1196,113 @@ static void dump_batman_4addr(unsigned char *packet_buff, ssize_t buff_len, int
 static void parse_eth_hdr(unsigned char *packet_buff, ssize_t buff_len, int read_opt, int time_printed)
 {
 	struct batadv_ogm_packet *batman_ogm_packet;
+	unsigned short level = dump_level;
 	struct ether_header *eth_hdr;
 
 	eth_hdr = (struct ether_header *)packet_buff;
 
+	/* no packet is printed while the overhead is counted - the frame is
+	 * accounted to its type and the dissectors only collect the flows,
+	 * OGMs and TVLVs of the batman-adv packets
+	 */
+	if (dump_counters)
+		level = dump_level_counted;
+
 	switch (ntohs(eth_hdr->ether_type)) {
 	case ETH_P_ARP:
-		if ((dump_level & DUMP_TYPE_NONBAT) || (time_printed))
+		dump_stats_frame(DUMP_STATS_NONBAT);
+		if ((level & DUMP_TYPE_NONBAT) || (time_printed))
 			dump_arp(packet_buff + ETH_HLEN, buff_len - ETH_HLEN,
 				 eth_hdr, read_opt, time_printed);
 		break;
 	case ETH_P_IP:
-		if ((dump_level & DUMP_TYPE_NONBAT) || (time_printed))
+		dump_stats_frame(DUMP_STATS_NONBAT);
+		if ((level & DUMP_TYPE_NONBAT) || (time_printed))
 			dump_ip(packet_buff + ETH_HLEN, buff_len - ETH_HLEN, time_printed);
 		break;
 	case ETH_P_IPV6:
-		if ((dump_level & DUMP_TYPE_NONBAT) || (time_printed))
+		dump_stats_frame(DUMP_STATS_NONBAT);
+		if ((level & DUMP_TYPE_NONBAT) || (time_printed))
 			dump_ipv6(packet_buff + ETH_HLEN, buff_len - ETH_HLEN,
 				  time_printed);
 		break;
 	case ETH_P_8021Q:
-		if ((dump_level & DUMP_TYPE_NONBAT) || (time_printed))
+		/* the frame is accounted to the type behind the tag */
+		if (dump_counters || (level & DUMP_TYPE_NONBAT) || (time_printed))
 			dump_vlan(packet_buff, buff_len, read_opt, time_printed);
 		break;
 	case ETH_P_BATMAN:
 		batman_ogm_packet = (struct batadv_ogm_packet *)(packet_buff + ETH_HLEN);
 
-		if ((read_opt & COMPAT_FILTER) &&
+		if (!dump_counters && (read_opt & COMPAT_FILTER) &&
 		    (batman_ogm_packet->version != BATADV_COMPAT_VERSION))
 			return;
 
 		switch (batman_ogm_packet->packet_type) {
 		case BATADV_IV_OGM:
-			if (dump_level & DUMP_TYPE_BATOGM)
+			dump_stats_frame(DUMP_STATS_OGM);
+			if (level & DUMP_TYPE_BATOGM)
 				dump_batman_iv_ogm(packet_buff, buff_len, read_opt, time_printed);
 			break;
 		case BATADV_OGM2:
-			if (dump_level & DUMP_TYPE_BATOGM2)
+			dump_stats_frame(DUMP_STATS_OGM2);
+			if (level & DUMP_TYPE_BATOGM2)
 				dump_batman_ogm2(packet_buff, buff_len,
 						 read_opt, time_printed);
 			break;
 		case BATADV_ELP:
-			if (dump_level & DUMP_TYPE_BATELP)
+			dump_stats_frame(DUMP_STATS_ELP);
+			if (level & DUMP_TYPE_BATELP)
 				dump_batman_elp(packet_buff, buff_len,
 						 read_opt, time_printed);
 			break;
 		case BATADV_ICMP:
-			if (dump_level & DUMP_TYPE_BATICMP)
+			dump_stats_frame(DUMP_STATS_ICMP);
+			if (level & DUMP_TYPE_BATICMP)
 				dump_batman_icmp(packet_buff, buff_len, read_opt, time_printed);
 			break;
 		case BATADV_UNICAST:
-			if (dump_level & DUMP_TYPE_BATUCAST)
+			dump_stats_frame(DUMP_STATS_UCAST);
+			if (level & DUMP_TYPE_BATUCAST)
 				dump_batman_ucast(packet_buff, buff_len, read_opt, time_printed);
 			break;
 		case BATADV_BCAST:
-			if (dump_level & DUMP_TYPE_BATBCAST)
+			dump_stats_frame(DUMP_STATS_BCAST);
+			if (level & DUMP_TYPE_BATBCAST)
 				dump_batman_bcast(packet_buff, buff_len, read_opt, time_printed);
 			break;
 		case BATADV_UNICAST_4ADDR:
-			if (dump_level & DUMP_TYPE_BATUCAST)
+			/* accounted by the dissector - DAT messages on their own */
+			if (level & DUMP_TYPE_BATUCAST)
 				dump_batman_4addr(packet_buff, buff_len, read_opt, time_printed);
 			break;
 		case BATADV_UNICAST_TVLV:
-			if ((dump_level & DUMP_TYPE_BATUCAST) ||
-			    (dump_level & DUMP_TYPE_BATUTVLV))
+			dump_stats_frame(DUMP_STATS_UCAST_TVLV);
+			if ((level & DUMP_TYPE_BATUCAST) ||
+			    (level & DUMP_TYPE_BATUTVLV))
 				dump_batman_ucast_tvlv(packet_buff, buff_len,
 						       read_opt, time_printed);
 			break;
+		case BATADV_UNICAST_FRAG:
+			dump_stats_frame(DUMP_STATS_FRAG);
+			/* fall through */
+		case BATADV_CODED:
+			dump_stats_frame(DUMP_STATS_CODED);
+			/* fall through */
 		default:
-			fprintf(stderr, "Warning - packet contains unknown batman packet type: 0x%02x\n", batman_ogm_packet->packet_type);
+			/* a frame is only accounted once - to its first type */
+			dump_stats_frame(DUMP_STATS_BAT_OTHER);
+			if (!dump_counters)
+				fprintf(stderr, "Warning - packet contains unknown batman packet type: 0x%02x\n", batman_ogm_packet->packet_type);
 			break;
 		}
 
 		break;
 
 	default:
-		fprintf(stderr, "Warning - packet contains unknown ether type: 0x%04x\n", ntohs(eth_hdr->ether_type));
+		dump_stats_frame(DUMP_STATS_NONBAT);
+		if (!dump_counters)
+			fprintf(stderr, "Warning - packet contains unknown ether type: 0x%04x\n", ntohs(eth_hdr->ether_type));
 		break;
 	}
 }
@@ -1120,7 +1394,52 @@ static void parse_wifi_hdr(unsigned char *packet_buff, ssize_t buff_len, int rea
 	parse_eth_hdr(packet_buff, buff_len, read_opt, time_printed);
 }
 
-static struct dump_if *create_dump_interface(char *iface)
+static int create_dump_ring(struct dump_if *dump_if, size_t ring_size)
+{
+	int version = TPACKET_V3;
+	struct tpacket_req3 req;
+	void *ring;
+	int res;
+
+	res = setsockopt(dump_if->raw_sock, SOL_PACKET, PACKET_VERSION,
+			 &version, sizeof(version));
+	if (res < 0) {
+		perror("Error - can't create raw socket (PACKET_VERSION)");
+		return -1;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = DUMP_RING_BLOCK_SIZE;
+	req.tp_block_nr = ring_size / DUMP_RING_BLOCK_SIZE;
+	req.tp_frame_size = DUMP_RING_FRAME_SIZE;
+	req.tp_frame_nr = req.tp_block_size / req.tp_frame_size * req.tp_block_nr;
+	req.tp_retire_blk_tov = DUMP_RING_BLOCK_TIMEOUT;
+
+	res = setsockopt(dump_if->raw_sock, SOL_PACKET, PACKET_RX_RING, &req,
+			 sizeof(req));
+	if (res < 0) {
+		perror("Error - can't create raw socket (PACKET_RX_RING)");
+		return -1;
+	}
+
+	dump_if->ring_size = (size_t)req.tp_block_size * req.tp_block_nr;
+	dump_if->block_nr = req.tp_block_nr;
+	dump_if->block = 0;
+
+	ring = mmap(NULL, dump_if->ring_size, PROT_READ | PROT_WRITE,
+		    MAP_SHARED, dump_if->raw_sock, 0);
+	if (ring == MAP_FAILED) {
+		perror("Error - can't map the capture ring");
+		return -1;
+	}
+
+	dump_if->ring = ring;
+
+	return 0;
+}
+
+static struct dump_if *create_dump_interface(char *iface, size_t ring_size,
+					     const struct bpf_filter *filter)
 {
 	struct dump_if *dump_if;
 	struct ifreq req;
@@ -1138,6 +1457,7 @@ static struct dump_if *create_dump_interface(char *iface)
 		goto free_dumpif;
 	}
 
+	dump_if->space_fd = -1;
 	dump_if->raw_sock = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
 	if (dump_if->raw_sock < 0) {
 		perror("Error - can't create raw socket");
@@ -1176,6 +1496,26 @@ static struct dump_if *create_dump_interface(char *iface)
 		goto close_socket;
 	}
 
+	if (filter) {
+		/* the filter expects the offsets of an ethernet header */
+		if (dump_if->hw_type != ARPHRD_ETHER) {
+			fprintf(stderr, "Error - filter expressions are only supported on ethernet interfaces: %s\n",
+				dump_if->dev);
+			goto close_socket;
+		}
+
+		res = bpf_filter_attach(filter, dump_if->raw_sock);
+		if (res < 0) {
+			fprintf(stderr, "Error - can't attach filter to raw socket: %s\n",
+				strerror(-res));
+			goto close_socket;
+		}
+	}
+
+	res = create_dump_ring(dump_if, ring_size);
+	if (res < 0)
+		goto close_socket;
+
 	dump_if->addr.sll_family   = AF_PACKET;
 	dump_if->addr.sll_protocol = htons(ETH_P_ALL);
 	dump_if->addr.sll_ifindex  = req.ifr_ifindex;
@@ -1189,6 +1529,9 @@ static struct dump_if *create_dump_interface(char *iface)
 	return dump_if;
 
 close_socket:
+	if (dump_if->ring)
+		munmap(dump_if->ring, dump_if->ring_size);
+
 	close(dump_if->raw_sock);
 free_dumpif:
 	free(dump_if);
@@ -1210,144 +1553,1707 @@ static void sig_handler(int sig)
 	}
 }
 
-static int tcpdump(struct state *state __maybe_unused, int argc, char **argv)
+static void dump_frame(int32_t hw_type, unsigned char *packet_buff,
+		       ssize_t buff_len, int read_opt)
 {
-	struct timeval tv;
-	struct dump_if *dump_if, *dump_if_tmp;
-	struct list_head dump_if_list;
-	fd_set wait_sockets, tmp_wait_sockets;
-	ssize_t read_len;
-	int ret = EXIT_FAILURE, res, optchar, found_args = 1, max_sock = 0, tmp;
-	int read_opt = USE_BAT_HOSTS;
-	unsigned char packet_buff[2000];
-	int monitor_header_len = -1;
+	int monitor_header_len;
 
-	dump_level = dump_level_all;
+	if ((size_t)buff_len < sizeof(struct ether_header)) {
+		if (dump_counters)
+			dump_stats_short();
+		else
+			fprintf(stderr, "Warning - dropping received packet as it is smaller than expected (%zu): %zd\n",
+				sizeof(struct ether_header), buff_len);
+		return;
+	}
 
-	while ((optchar = getopt(argc, argv, "chnp:x:")) != -1) {
-		switch (optchar) {
-		case 'c':
-			read_opt |= COMPAT_FILTER;
-			found_args += 1;
-			break;
-		case 'h':
-			tcpdump_usage();
-			return EXIT_SUCCESS;
-		case 'n':
-			read_opt &= ~USE_BAT_HOSTS;
-			found_args += 1;
-			break;
-		case 'p':
-			tmp = strtol(optarg, NULL , 10);
-			if ((tmp > 0) && (tmp <= dump_level_all))
-				dump_level = tmp;
-			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
-			break;
-		case 'x':
-			tmp = strtol(optarg, NULL , 10);
-			if ((tmp > 0) && (tmp <= dump_level_all))
-				dump_level &= ~tmp;
-			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
-			break;
-		default:
-			tcpdump_usage();
-			return EXIT_FAILURE;
-		}
+	switch (hw_type) {
+	case ARPHRD_ETHER:
+		parse_eth_hdr(packet_buff, buff_len, read_opt, 0);
+		break;
+	case ARPHRD_IEEE80211_PRISM:
+	case ARPHRD_IEEE80211_RADIOTAP:
+		monitor_header_len = monitor_header_length(packet_buff, buff_len, hw_type);
+		if (monitor_header_len >= 0)
+			parse_wifi_hdr(packet_buff + monitor_header_len, buff_len - monitor_header_len, read_opt, 0);
+		break;
+	default:
+		/* should not happen */
+		break;
 	}
+}
 
-	if (argc <= found_args) {
-		fprintf(stderr, "Error - target interface not specified\n");
-		tcpdump_usage();
-		return EXIT_FAILURE;
+/* parse the frames of all blocks which were handed over by the kernel */
+static uint16_t dump_linktype(struct dump_if *dump_if)
+{
+	switch (dump_if->hw_type) {
+	case ARPHRD_IEEE80211_PRISM:
+		return PCAPNG_LINKTYPE_IEEE802_11_PRISM;
+	case ARPHRD_IEEE80211_RADIOTAP:
+		return PCAPNG_LINKTYPE_IEEE802_11_RADIOTAP;
+	case ARPHRD_ETHER:
+	default:
+		return PCAPNG_LINKTYPE_ETHERNET;
 	}
+}
 
-	check_root_or_die("batctl tcpdump");
+static void dump_kick(int event_fd)
+{
+	uint64_t event = 1;
 
-	bat_hosts_init(read_opt);
+	if (write(event_fd, &event, sizeof(event)) < 0 && errno != EAGAIN)
+		return;
+}
 
-	signal(SIGINT, sig_handler);
-	signal(SIGTERM, sig_handler);
+/* sleep until the eventfd is kicked, a signal arrives or the timeout expired */
+static void dump_wait(int event_fd, int timeout)
+{
+	struct pollfd pfd = {
+		.fd = event_fd,
+		.events = POLLIN,
+	};
+	uint64_t events;
+
+	if (poll(&pfd, 1, timeout) > 0 &&
+	    read(event_fd, &events, sizeof(events)) < 0)
+		return;
+}
 
-	/* init interfaces list */
-	INIT_LIST_HEAD(&dump_if_list);
-	FD_ZERO(&wait_sockets);
+/* hand a frame to the next dissector - returns its id or -1 when dropped */
+static int dump_queue_frame(struct dump_if *dump_if,
+			    const struct tpacket3_hdr *frame)
+{
+	struct dump_pipeline *pipeline = dump_if->pipeline;
+	unsigned int id = dump_if->seq % pipeline->num_dissectors;
+	struct dump_pipe *pipe = &dump_if->pipes[id];
+	struct dump_slot *slot;
+	uint8_t *buf;
+	size_t tail;
+
+	tail = __atomic_load_n(&pipe->tail, __ATOMIC_ACQUIRE);
+
+	/* without a capture file the kernel ring buffers until the output
+	 * caught up - otherwise the capture file must not miss packets
+	 */
+	while (pipe->head - tail == DUMP_PIPE_SLOTS) {
+		if (pipeline->writer ||
+		    __atomic_load_n(&pipeline->stop_capture, __ATOMIC_ACQUIRE))
+			goto drop;
+
+		dump_kick(pipeline->dissectors[id].event_fd);
+		dump_wait(dump_if->space_fd, 100);
+		tail = __atomic_load_n(&pipe->tail, __ATOMIC_ACQUIRE);
+	}
 
-	while (argc > found_args) {
-		dump_if = create_dump_interface(argv[found_args]);
-		if (!dump_if)
-			goto out;
+	slot = &pipe->slots[pipe->head % DUMP_PIPE_SLOTS];
 
-		if (dump_if->raw_sock > max_sock)
-			max_sock = dump_if->raw_sock;
+	/* the buffers of the slots only grow until the largest frame fits */
+	if (slot->frame_size < frame->tp_snaplen) {
+		buf = realloc(slot->frame, frame->tp_snaplen);
+		if (!buf)
+			goto drop;
 
-		FD_SET(dump_if->raw_sock, &wait_sockets);
-		list_add_tail(&dump_if->list, &dump_if_list);
-		found_args++;
+		slot->frame = buf;
+		slot->frame_size = frame->tp_snaplen;
 	}
 
-	while (!is_aborted) {
+	memcpy(slot->frame, (uint8_t *)frame + frame->tp_mac,
+	       frame->tp_snaplen);
+	slot->len = frame->tp_snaplen;
+	slot->time.tv_sec = frame->tp_sec;
+	slot->time.tv_nsec = frame->tp_nsec;
+
+	__atomic_store_n(&pipe->head, pipe->head + 1, __ATOMIC_RELEASE);
+	dump_if->seq++;
+
+	return id;
+
+drop:
+	dump_if->not_printed++;
+	return -1;
+}
+
+/* pass the frames of all blocks which were handed over by the kernel on */
+static void dump_ring(struct dump_if *dump_if)
+{
+	struct dump_pipeline *pipeline = dump_if->pipeline;
+	struct tpacket_block_desc *block;
+	struct tpacket3_hdr *frame;
+	unsigned long kick = 0;
+	bool queued = false;
+	uint32_t i;
+	int id;
+
+	while (1) {
+		block = (struct tpacket_block_desc *)(dump_if->ring +
+			(size_t)dump_if->block * DUMP_RING_BLOCK_SIZE);
+
+		if (!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+			break;
+
+		frame = (struct tpacket3_hdr *)((uint8_t *)block +
+						block->hdr.bh1.offset_to_first_pkt);
+
+		for (i = 0; i < block->hdr.bh1.num_pkts; i++) {
+			if (pipeline->writer)
+				pcapng_writer_packet(pipeline->writer,
+						     dump_if->pcap_id,
+						     frame->tp_sec * 1000000000ULL + frame->tp_nsec,
+						     (uint8_t *)frame + frame->tp_mac,
+						     frame->tp_snaplen,
+						     frame->tp_len);
+
+			if (pipeline->print) {
+				id = dump_queue_frame(dump_if, frame);
+				if (id >= 0)
+					kick |= 1UL << id;
+			}
+
+			queued = true;
+			frame = (struct tpacket3_hdr *)((uint8_t *)frame +
+							frame->tp_next_offset);
+		}
+
+		/* return the block to the kernel */
+		__atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+		dump_if->block = (dump_if->block + 1) % dump_if->block_nr;
+	}
 
-		memcpy(&tmp_wait_sockets, &wait_sockets, sizeof(fd_set));
+	if (queued && pipeline->writer)
+		pcapng_writer_kick(pipeline->writer);
 
-		tv.tv_sec = 1;
-		tv.tv_usec = 0;
+	for (i = 0; i < pipeline->num_dissectors; i++) {
+		if (kick & (1UL << i))
+			dump_kick(pipeline->dissectors[i].event_fd);
+	}
+}
 
-		res = select(max_sock + 1, &tmp_wait_sockets, NULL, NULL, &tv);
+static void *dump_capture_thread(void *arg)
+{
+	struct dump_if *dump_if = arg;
+	struct pollfd pfd = {
+		.fd = dump_if->raw_sock,
+		.events = POLLIN | POLLERR,
+	};
+	int res;
 
+	while (!__atomic_load_n(&dump_if->pipeline->stop_capture, __ATOMIC_ACQUIRE)) {
+		/* the timeout is only used to notice the end of the capture */
+		res = poll(&pfd, 1, 100);
 		if (res == 0)
 			continue;
 
 		if (res < 0) {
-			perror("Error - can't select on raw socket");
+			if (errno != EINTR)
+				perror("Error - can't poll on raw socket");
 			continue;
 		}
 
-		list_for_each_entry(dump_if, &dump_if_list, list) {
-			if (!FD_ISSET(dump_if->raw_sock, &tmp_wait_sockets))
-				continue;
+		dump_ring(dump_if);
+	}
 
-			read_len = read(dump_if->raw_sock, packet_buff, sizeof(packet_buff));
+	return NULL;
+}
 
-			if (read_len < 0) {
-				fprintf(stderr, "Error - can't read from interface '%s': %s\n", dump_if->dev, strerror(errno));
-				continue;
-			}
+static void dump_dissect_slot(struct dump_if *dump_if, struct dump_slot *slot,
+			      int read_opt)
+{
+	/* only counted - the text of the slot stays empty */
+	if (dump_counters) {
+		dump_flow = &slot->flow;
+		dump_flow->valid = false;
+		dump_ogm = &slot->ogm;
+		dump_ogm->num = 0;
+		dump_frame_len = slot->len;
+		dump_short_len = slot->len;
+
+		dump_frame(dump_if->hw_type, slot->frame, slot->len, read_opt);
+		return;
+	}
 
-			if ((size_t)read_len < sizeof(struct ether_header)) {
-				fprintf(stderr, "Warning - dropping received packet as it is smaller than expected (%zu): %zd\n",
-					sizeof(struct ether_header), read_len);
-				continue;
-			}
+	dump_out = slot->out;
+	fseeko(dump_out, 0, SEEK_SET);
 
-			switch (dump_if->hw_type) {
-			case ARPHRD_ETHER:
-				parse_eth_hdr(packet_buff, read_len, read_opt, 0);
-				break;
-			case ARPHRD_IEEE80211_PRISM:
-			case ARPHRD_IEEE80211_RADIOTAP:
-				monitor_header_len = monitor_header_length(packet_buff, read_len, dump_if->hw_type);
-				if (monitor_header_len >= 0)
-					parse_wifi_hdr(packet_buff + monitor_header_len, read_len - monitor_header_len, read_opt, 0);
-				break;
-			default:
-				/* should not happen */
-				break;
-			}
+	dump_time = slot->time;
+	dump_frame(dump_if->hw_type, slot->frame, slot->len, read_opt);
 
-			fflush(stdout);
-		}
+	/* updates text and text_len of the slot */
+	fflush(dump_out);
+}
 
+/* dissect the frames of all interfaces - returns false when there were none */
+static bool dump_dissect_pipes(struct dump_dissector *dissector)
+{
+	struct dump_pipeline *pipeline = dissector->pipeline;
+	struct dump_if *dump_if;
+	struct dump_pipe *pipe;
+	bool dissected = false;
+	size_t head;
+
+	list_for_each_entry(dump_if, pipeline->dump_if_list, list) {
+		pipe = &dump_if->pipes[dissector->id];
+		head = __atomic_load_n(&pipe->head, __ATOMIC_ACQUIRE);
+
+		while (pipe->mid != head) {
+			dump_dissect_slot(dump_if,
+					  &pipe->slots[pipe->mid % DUMP_PIPE_SLOTS],
+					  pipeline->read_opt);
+			__atomic_store_n(&pipe->mid, pipe->mid + 1,
+					 __ATOMIC_RELEASE);
+			dissected = true;
+		}
 	}
 
-out:
-	list_for_each_entry_safe(dump_if, dump_if_tmp, &dump_if_list, list) {
-		if (dump_if->raw_sock >= 0)
-			close(dump_if->raw_sock);
+	return dissected;
+}
 
-		list_del(&dump_if->list);
-		free(dump_if);
+/* packets are only counted for the summaries (-S, -T, -O) */
+static bool dump_summary_only(const struct dump_pipeline *pipeline)
+{
+	return pipeline->stats_interval || pipeline->top_interval ||
+	       pipeline->ogm_interval;
+}
+
+static void *dump_dissector_thread(void *arg)
+{
+	struct dump_dissector *dissector = arg;
+	struct dump_pipeline *pipeline = dissector->pipeline;
+	bool stop;
+
+	if (dump_summary_only(pipeline))
+		dump_counters = &dissector->stats;
+
+	while (1) {
+		/* everything was captured when the stop is seen */
+		stop = __atomic_load_n(&pipeline->stop_dissect, __ATOMIC_ACQUIRE);
+
+		if (dump_dissect_pipes(dissector)) {
+			dump_kick(pipeline->output_fd);
+			continue;
+		}
+
+		if (stop)
+			break;
+
+		dump_wait(dissector->event_fd, 1000);
 	}
 
+	return NULL;
+}
+
+/* first dissected packet of an interface which was not printed yet */
+static struct dump_slot *dump_next_slot(struct dump_pipeline *pipeline,
+					struct dump_if *dump_if)
+{
+	struct dump_pipe *pipe;
+	size_t mid;
+
+	pipe = &dump_if->pipes[dump_if->out_seq % pipeline->num_dissectors];
+	mid = __atomic_load_n(&pipe->mid, __ATOMIC_ACQUIRE);
+	if (pipe->tail == mid)
+		return NULL;
+
+	return &pipe->slots[pipe->tail % DUMP_PIPE_SLOTS];
+}
+
+static int compare_ogm_link(void *data1, void *data2)
+{
+	const struct dump_ogm_link *link1 = data1;
+	const struct dump_ogm_link *link2 = data2;
+
+	return (memcmp(link1->orig, link2->orig, ETH_ALEN) == 0 &&
+		memcmp(link1->neigh, link2->neigh, ETH_ALEN) == 0 ? 1 : 0);
+}
+
+static int choose_ogm_link(void *data, int32_t size)
+{
+	const struct dump_ogm_link *link = data;
+	uint8_t key[2 * ETH_ALEN];
+
+	memcpy(key, link->orig, ETH_ALEN);
+	memcpy(key + ETH_ALEN, link->neigh, ETH_ALEN);
+
+	return (hash_bytes(key, sizeof(key)) % size);
+}
+
+static struct dump_ogm_link *dump_ogm_link_get(struct dump_pipeline *pipeline,
+					       const struct dump_ogm_entry *ogm)
+{
+	struct dump_ogm_link *link, lookup;
+	struct hashtable_t *swaphash;
+
+	memcpy(lookup.orig, ogm->orig, ETH_ALEN);
+	memcpy(lookup.neigh, ogm->neigh, ETH_ALEN);
+
+	link = hash_find(pipeline->ogm_links, &lookup);
+	if (link)
+		return link;
+
+	link = calloc(1, sizeof(*link));
+	if (!link)
+		return NULL;
+
+	memcpy(link->orig, ogm->orig, ETH_ALEN);
+	memcpy(link->neigh, ogm->neigh, ETH_ALEN);
+	link->ogm2 = ogm->ogm2;
+
+	/* the first OGM is handled like a restart of the originator */
+	link->seqno = ogm->seqno - DUMP_OGM_MAX_GAP;
+
+	if (hash_add(pipeline->ogm_links, link) < 0) {
+		free(link);
+		return NULL;
+	}
+
+	if (pipeline->ogm_links->elements * 4 > pipeline->ogm_links->size) {
+		swaphash = hash_resize(pipeline->ogm_links,
+				       pipeline->ogm_links->size * 2);
+		if (swaphash)
+			pipeline->ogm_links = swaphash;
+	}
+
+	return link;
+}
+
+/**
+ * dump_ogm_track - account an OGM to the link it was received on
+ * @pipeline: pipeline of the capture
+ * @ogm: originator message
+ * @time: receive time of the OGM
+ *
+ * A higher sequence number counts the skipped ones as expected and compares
+ * the time since the previous one with the originator interval. Lower
+ * sequence numbers inside the window are duplicates or reordered OGMs, older
+ * ones up to DUMP_OGM_MAX_GAP are stale and leave the link unchanged. Other
+ * jumps restart the tracking of the originator.
+ */
+static void dump_ogm_track(struct dump_pipeline *pipeline,
+			   const struct dump_ogm_entry *ogm,
+			   const struct timespec *time)
+{
+	struct dump_ogm_link *link;
+	double elapsed, jitter;
+	uint64_t bit;
+	int32_t diff;
+	bool first;
+
+	link = dump_ogm_link_get(pipeline, ogm);
+	if (!link)
+		return;
+
+	first = !link->received;
+	diff = (int32_t)(ogm->seqno - link->seqno);
+
+	if (diff > 0 && diff < DUMP_OGM_MAX_GAP) {
+		elapsed = (time->tv_sec - link->last_seen.tv_sec) * 1000.0 +
+			  (time->tv_nsec - link->last_seen.tv_nsec) / 1e6;
+		jitter = elapsed - (double)diff * pipeline->orig_interval;
+		if (jitter < 0)
+			jitter = -jitter;
+
+		link->jitter_sum += jitter;
+		link->jitter_num++;
+		if (jitter > link->jitter_max)
+			link->jitter_max = jitter;
+
+		if (diff < DUMP_OGM_WINDOW)
+			link->window = (link->window << diff) | 1;
+		else
+			link->window = 1;
+
+		link->seqno = ogm->seqno;
+		link->last_seen = *time;
+		link->expected += diff;
+	} else if (diff <= 0 && diff > -DUMP_OGM_WINDOW) {
+		bit = 1ULL << -diff;
+		if (link->window & bit) {
+			link->duplicates++;
+			return;
+		}
+
+		link->window |= bit;
+		link->reordered++;
+	} else if (diff <= -DUMP_OGM_WINDOW && diff > -DUMP_OGM_MAX_GAP) {
+		link->stale++;
+		return;
+	} else {
+		link->seqno = ogm->seqno;
+		link->window = 1;
+		link->last_seen = *time;
+		link->expected++;
+	}
+
+	link->received++;
+
+	if (first) {
+		link->ttl_min = ogm->ttl;
+		link->ttl_max = ogm->ttl;
+		link->metric_first = ogm->metric;
+	}
+
+	if (ogm->ttl < link->ttl_min)
+		link->ttl_min = ogm->ttl;
+	if (ogm->ttl > link->ttl_max)
+		link->ttl_max = ogm->ttl;
+
+	link->ttl_sum += ogm->ttl;
+	link->metric_last = ogm->metric;
+}
+
+static void dump_print_slot(struct dump_pipeline *pipeline,
+			    struct dump_if *dump_if, struct dump_slot *slot)
+{
+	struct dump_pipe *pipe;
+	unsigned int i;
+
+	pipe = &dump_if->pipes[dump_if->out_seq % pipeline->num_dissectors];
+
+	if (slot->text_len)
+		fwrite(slot->text, slot->text_len, 1, stdout);
+
+	if (pipeline->top_interval && slot->flow.valid) {
+		topk_add(pipeline->top[DUMP_TOP_MESH_BYTES], slot->flow.mesh,
+			 slot->len);
+		topk_add(pipeline->top[DUMP_TOP_MESH_PACKETS], slot->flow.mesh, 1);
+		topk_add(pipeline->top[DUMP_TOP_CLIENT_BYTES], slot->flow.client,
+			 slot->len);
+		topk_add(pipeline->top[DUMP_TOP_CLIENT_PACKETS],
+			 slot->flow.client, 1);
+	}
+
+	if (pipeline->ogm_interval) {
+		for (i = 0; i < slot->ogm.num; i++)
+			dump_ogm_track(pipeline, &slot->ogm.entries[i],
+				       &slot->time);
+	}
+
+	__atomic_store_n(&pipe->tail, pipe->tail + 1, __ATOMIC_RELEASE);
+	dump_if->out_seq++;
+	dump_if->printed = true;
+}
+
+static bool dump_time_before(const struct timespec *a,
+			     const struct timespec *b)
+{
+	if (a->tv_sec != b->tv_sec)
+		return a->tv_sec < b->tv_sec;
+
+	return a->tv_nsec < b->tv_nsec;
+}
+
+static long dump_time_diff_ms(const struct timespec *a,
+			      const struct timespec *b)
+{
+	return (a->tv_sec - b->tv_sec) * 1000 +
+	       (a->tv_nsec - b->tv_nsec) / 1000000;
+}
+
+/**
+ * dump_print_pipes - print the dissected packets ordered by their time stamps
+ * @pipeline: pipeline of the capture
+ * @flush: print everything without waiting for the other interfaces
+ * @printed: set when a packet was printed
+ *
+ * The packets of each interface are already ordered, so the interfaces are
+ * merged by repeatedly printing the oldest of their first packets. A packet
+ * is held back while an interface has nothing to compare against - until it
+ * is older than the reorder window.
+ *
+ * Return: time in ms until the oldest held back packet is printed or -1
+ */
+static int dump_print_pipes(struct dump_pipeline *pipeline, bool flush,
+			    bool *printed)
+{
+	struct dump_slot *oldest_slot;
+	struct dump_if *oldest;
+	struct dump_if *dump_if;
+	struct dump_slot *slot;
+	struct timespec now;
+	int timeout = -1;
+	bool missing;
+	long age;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	while (1) {
+		oldest = NULL;
+		oldest_slot = NULL;
+		missing = false;
+
+		list_for_each_entry(dump_if, pipeline->dump_if_list, list) {
+			slot = dump_next_slot(pipeline, dump_if);
+			if (!slot) {
+				missing = true;
+				continue;
+			}
+
+			if (oldest_slot &&
+			    !dump_time_before(&slot->time, &oldest_slot->time))
+				continue;
+
+			oldest = dump_if;
+			oldest_slot = slot;
+		}
+
+		if (!oldest)
+			break;
+
+		if (missing && !flush) {
+			age = dump_time_diff_ms(&now, &oldest_slot->time);
+			if (age < DUMP_REORDER_WINDOW) {
+				timeout = DUMP_REORDER_WINDOW - age;
+				if (timeout > DUMP_REORDER_WINDOW)
+					timeout = DUMP_REORDER_WINDOW;
+				break;
+			}
+		}
+
+		dump_print_slot(pipeline, oldest, oldest_slot);
+		*printed = true;
+	}
+
+	/* the capture threads might wait for free slots */
+	list_for_each_entry(dump_if, pipeline->dump_if_list, list) {
+		if (!dump_if->printed)
+			continue;
+
+		dump_kick(dump_if->space_fd);
+		dump_if->printed = false;
+	}
+
+	return timeout;
+}
+
+static int dump_pipes_init(struct dump_if *dump_if, unsigned int num_pipes)
+{
+	struct dump_slot *slot;
+	unsigned int i;
+	unsigned int j;
+
+	for (i = 0; i < num_pipes; i++) {
+		dump_if->pipes[i].slots = calloc(DUMP_PIPE_SLOTS,
+						 sizeof(*dump_if->pipes[i].slots));
+		if (!dump_if->pipes[i].slots)
+			return -ENOMEM;
+
+		for (j = 0; j < DUMP_PIPE_SLOTS; j++) {
+			slot = &dump_if->pipes[i].slots[j];
+			slot->out = open_memstream(&slot->text, &slot->text_len);
+			if (!slot->out)
+				return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static void dump_pipes_free(struct dump_if *dump_if)
+{
+	struct dump_slot *slot;
+	unsigned int i;
+	unsigned int j;
+
+	for (i = 0; i < DUMP_MAX_DISSECTORS; i++) {
+		if (!dump_if->pipes[i].slots)
+			continue;
+
+		for (j = 0; j < DUMP_PIPE_SLOTS; j++) {
+			slot = &dump_if->pipes[i].slots[j];
+			if (slot->out)
+				fclose(slot->out);
+
+			free(slot->text);
+			free(slot->frame);
+		}
+
+		free(dump_if->pipes[i].slots);
+		dump_if->pipes[i].slots = NULL;
+	}
+}
+
+/* start the dissector threads and one capture thread per interface */
+static int dump_pipeline_start(struct dump_pipeline *pipeline)
+{
+	struct dump_dissector *dissector;
+	struct dump_if *dump_if;
+	sigset_t oldset;
+	sigset_t sigset;
+	unsigned int i;
+	int ret = 0;
+
+	/* signals are handled by the output thread */
+	sigfillset(&sigset);
+	pthread_sigmask(SIG_BLOCK, &sigset, &oldset);
+
+	for (i = 0; i < pipeline->num_dissectors; i++) {
+		dissector = &pipeline->dissectors[i];
+
+		ret = pthread_create(&dissector->thread, NULL,
+				     dump_dissector_thread, dissector);
+		if (ret != 0)
+			goto out;
+
+		dissector->started = true;
+	}
+
+	list_for_each_entry(dump_if, pipeline->dump_if_list, list) {
+		ret = pthread_create(&dump_if->thread, NULL,
+				     dump_capture_thread, dump_if);
+		if (ret != 0)
+			goto out;
+
+		dump_if->started = true;
+	}
+
+out:
+	pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+
+	if (ret != 0)
+		fprintf(stderr, "Error - can't start capture threads: %s\n",
+			strerror(ret));
+
+	return -ret;
+}
+
+/* print the title of a summary - returns the seconds since the previous one */
+static double dump_summary_start(struct timespec *since,
+				 const struct timespec *now, const char *title)
+{
+	struct tm tm_buf;
+	double interval;
+	struct tm *tm;
+	time_t t;
+
+	interval = (now->tv_sec - since->tv_sec) +
+		   (now->tv_nsec - since->tv_nsec) / 1e9;
+	if (interval <= 0)
+		interval = 1;
+
+	*since = *now;
+
+	t = time(NULL);
+	tm = localtime_r(&t, &tm_buf);
+	if (tm)
+		printf("%02d:%02d:%02d ", tm->tm_hour, tm->tm_min, tm->tm_sec);
+
+	printf("%s over the last %.1f s:\n", title, interval);
+
+	return interval;
+}
+
+/**
+ * dump_stats_print - print the protocol overhead summary
+ * @pipeline: pipeline of the capture
+ * @now: time of the summary (CLOCK_MONOTONIC)
+ *
+ * The packets and bytes are counted since the start of the capture, the rates
+ * are calculated over the time since the previous summary.
+ */
+static void dump_stats_print(struct dump_pipeline *pipeline,
+			     const struct timespec *now)
+{
+	uint64_t packets[DUMP_STATS_NUM] = { 0 };
+	uint64_t bytes[DUMP_STATS_NUM] = { 0 };
+	uint64_t all_packets = 0, all_bytes = 0;
+	double all_packet_rate = 0, all_byte_rate = 0;
+	struct dump_dissector *dissector;
+	double packet_rate, byte_rate;
+	unsigned long cur;
+	double interval;
+	unsigned int i;
+	int type;
+
+	for (i = 0; i < pipeline->num_dissectors; i++) {
+		dissector = &pipeline->dissectors[i];
+
+		for (type = 0; type < DUMP_STATS_NUM; type++) {
+			cur = __atomic_load_n(&dissector->stats.packets[type],
+					      __ATOMIC_RELAXED);
+			packets[type] += cur - dissector->stats_seen.packets[type];
+			dissector->stats_seen.packets[type] = cur;
+
+			cur = __atomic_load_n(&dissector->stats.bytes[type],
+					      __ATOMIC_RELAXED);
+			bytes[type] += cur - dissector->stats_seen.bytes[type];
+			dissector->stats_seen.bytes[type] = cur;
+		}
+	}
+
+	interval = dump_summary_start(&pipeline->stats_time, now,
+				      "protocol overhead, rates");
+	printf("%-12s %12s %16s %12s %14s\n", "type", "packets", "bytes",
+	       "packets/s", "bytes/s");
+
+	for (type = 0; type < DUMP_STATS_NUM; type++) {
+		pipeline->stats_packets[type] += packets[type];
+		pipeline->stats_bytes[type] += bytes[type];
+
+		if (!pipeline->stats_packets[type])
+			continue;
+
+		packet_rate = packets[type] / interval;
+		byte_rate = bytes[type] / interval;
+
+		printf("%-12s %12" PRIu64 " %16" PRIu64 " %12.1f %14.1f\n",
+		       dump_stats_names[type], pipeline->stats_packets[type],
+		       pipeline->stats_bytes[type], packet_rate, byte_rate);
+
+		if (type >= DUMP_STATS_FIRST_TVLV)
+			continue;
+
+		all_packets += pipeline->stats_packets[type];
+		all_bytes += pipeline->stats_bytes[type];
+		all_packet_rate += packet_rate;
+		all_byte_rate += byte_rate;
+	}
+
+	printf("%-12s %12" PRIu64 " %16" PRIu64 " %12.1f %14.1f\n\n", "all",
+	       all_packets, all_bytes, all_packet_rate, all_byte_rate);
+	fflush(stdout);
+}
+
+/**
+ * dump_top_print - print the heaviest flows since the previous report
+ * @pipeline: pipeline of the capture
+ * @now: time of the report (CLOCK_MONOTONIC)
+ *
+ * The counts are upper bounds, a flow may have been counted up to the given
+ * error before it was seen. The counters are cleared for the next interval.
+ */
+static void dump_top_print(struct dump_pipeline *pipeline,
+			   const struct timespec *now)
+{
+	char flow[2 * HOST_NAME_MAX_LEN + sizeof(" > ")];
+	struct topk_item items[DUMP_TOP_FLOWS];
+	char src[HOST_NAME_MAX_LEN];
+	struct ether_addr *addr;
+	double interval;
+	size_t num, i;
+	int type;
+
+	interval = dump_summary_start(&pipeline->top_time, now,
+				      "heaviest flows");
+
+	for (type = 0; type < DUMP_TOP_NUM; type++) {
+		printf("%s:\n", dump_top_names[type]);
+
+		num = topk_list(pipeline->top[type], items, DUMP_TOP_FLOWS);
+		for (i = 0; i < num; i++) {
+			addr = (struct ether_addr *)items[i].key;
+			snprintf(src, sizeof(src), "%s",
+				 get_name_by_macaddr(addr, pipeline->read_opt));
+
+			addr = (struct ether_addr *)(items[i].key + ETH_ALEN);
+			snprintf(flow, sizeof(flow), "%s > %s", src,
+				 get_name_by_macaddr(addr, pipeline->read_opt));
+
+			printf("  %-40s %14" PRIu64 " %14.1f/s", flow,
+			       items[i].count, items[i].count / interval);
+			if (items[i].error)
+				printf(" (error %" PRIu64 ")", items[i].error);
+			printf("\n");
+		}
+
+		topk_reset(pipeline->top[type]);
+	}
+
+	printf("\n");
+	fflush(stdout);
+}
+
+static int dump_ogm_link_cmp(const void *a, const void *b)
+{
+	const struct dump_ogm_link *link_a = *(const struct dump_ogm_link **)a;
+	const struct dump_ogm_link *link_b = *(const struct dump_ogm_link **)b;
+	int ret;
+
+	ret = memcmp(link_a->orig, link_b->orig, ETH_ALEN);
+	if (ret != 0)
+		return ret;
+
+	return memcmp(link_a->neigh, link_b->neigh, ETH_ALEN);
+}
+
+static void dump_ogm_print_link(struct dump_pipeline *pipeline,
+				struct dump_ogm_link *link)
+{
+	char orig[HOST_NAME_MAX_LEN];
+	char jitter[32] = "-";
+	char ratio[16] = "-";
+	char metric[48];
+	char ttl[32] = "-";
+	double trend;
+
+	snprintf(orig, sizeof(orig), "%s",
+		 get_name_by_macaddr((struct ether_addr *)link->orig,
+				     pipeline->read_opt));
+
+	if (link->expected)
+		snprintf(ratio, sizeof(ratio), "%.1f%%",
+			 100.0 * link->received / link->expected);
+
+	if (link->jitter_num)
+		snprintf(jitter, sizeof(jitter), "%.1f/%.1f",
+			 link->jitter_sum / link->jitter_num, link->jitter_max);
+
+	if (link->received)
+		snprintf(ttl, sizeof(ttl), "%u/%.1f/%u", link->ttl_min,
+			 (double)link->ttl_sum / link->received, link->ttl_max);
+
+	trend = (double)link->metric_last - link->metric_first;
+
+	if (!link->ogm2)
+		snprintf(metric, sizeof(metric), "tq %u (%+.0f)",
+			 link->metric_last, trend);
+	else if (link->metric_last == BATADV_THROUGHPUT_MAX_VALUE)
+		snprintf(metric, sizeof(metric), "MAX");
+	else if (link->metric_first == BATADV_THROUGHPUT_MAX_VALUE)
+		snprintf(metric, sizeof(metric), "%.1fMbps",
+			 link->metric_last / 10.0);
+	else
+		snprintf(metric, sizeof(metric), "%.1fMbps (%+.1f)",
+			 link->metric_last / 10.0, trend / 10.0);
+
+	printf("%-17s %-17s %6lu %6lu %7s %5lu %5lu %5lu %15s %16s  %s\n",
+	       orig,
+	       get_name_by_macaddr((struct ether_addr *)link->neigh,
+				   pipeline->read_opt),
+	       link->received, link->expected, ratio, link->duplicates,
+	       link->reordered, link->stale, jitter, ttl, metric);
+}
+
+/**
+ * dump_ogm_print - print the OGM links which were seen since the last report
+ * @pipeline: pipeline of the capture
+ * @now: time of the report (CLOCK_MONOTONIC)
+ *
+ * The counters of the links are cleared for the next interval, links without
+ * OGMs for DUMP_OGM_TIMEOUT seconds are forgotten.
+ */
+static void dump_ogm_print(struct dump_pipeline *pipeline,
+			   const struct timespec *now)
+{
+	struct hash_it_t *hashit = NULL;
+	struct dump_ogm_link **entries;
+	struct dump_ogm_link *link;
+	struct timespec real;
+	size_t num = 0, size, i;
+
+	dump_summary_start(&pipeline->ogm_time, now, "OGM links");
+
+	if (pipeline->ogm_entries_size < (size_t)pipeline->ogm_links->elements) {
+		size = pipeline->ogm_links->elements * 2;
+		entries = realloc(pipeline->ogm_entries,
+				  size * sizeof(*entries));
+		if (!entries)
+			return;
+
+		pipeline->ogm_entries = entries;
+		pipeline->ogm_entries_size = size;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &real);
+
+	while (NULL != (hashit = hash_iterate(pipeline->ogm_links, hashit))) {
+		link = hashit->bucket->data;
+
+		if (link->received || link->duplicates || link->stale) {
+			pipeline->ogm_entries[num++] = link;
+			continue;
+		}
+
+		if (real.tv_sec - link->last_seen.tv_sec > DUMP_OGM_TIMEOUT) {
+			hash_remove_bucket(pipeline->ogm_links, hashit);
+			free(link);
+		}
+	}
+
+	qsort(pipeline->ogm_entries, num, sizeof(*pipeline->ogm_entries),
+	      dump_ogm_link_cmp);
+
+	printf("%-17s %-17s %6s %6s %7s %5s %5s %5s %15s %16s  %s\n",
+	       "originator", "neighbor", "recv", "exp", "ratio", "dup", "reord",
+	       "stale", "jitter avg/max", "ttl min/avg/max", "tq/throughput");
+
+	for (i = 0; i < num; i++) {
+		link = pipeline->ogm_entries[i];
+		dump_ogm_print_link(pipeline, link);
+
+		link->received = 0;
+		link->expected = 0;
+		link->duplicates = 0;
+		link->reordered = 0;
+		link->stale = 0;
+		link->jitter_num = 0;
+		link->jitter_sum = 0;
+		link->jitter_max = 0;
+		link->ttl_sum = 0;
+	}
+
+	printf("\n");
+	fflush(stdout);
+}
+
+/* stop the capture and wait until everything captured was dissected */
+static void dump_pipeline_stop(struct dump_pipeline *pipeline)
+{
+	struct dump_dissector *dissector;
+	struct dump_if *dump_if;
+	bool printed = false;
+	struct timespec now;
+	unsigned int i;
+
+	__atomic_store_n(&pipeline->stop_capture, true, __ATOMIC_RELEASE);
+
+	list_for_each_entry(dump_if, pipeline->dump_if_list, list) {
+		if (dump_if->started)
+			pthread_join(dump_if->thread, NULL);
+
+		dump_if->started = false;
+	}
+
+	__atomic_store_n(&pipeline->stop_dissect, true, __ATOMIC_RELEASE);
+
+	for (i = 0; i < pipeline->num_dissectors; i++) {
+		dissector = &pipeline->dissectors[i];
+		if (!dissector->started)
+			continue;
+
+		dump_kick(dissector->event_fd);
+		pthread_join(dissector->thread, NULL);
+		dissector->started = false;
+	}
+
+	if (pipeline->print) {
+		dump_print_pipes(pipeline, true, &printed);
+		fflush(stdout);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	if (pipeline->stats_interval)
+		dump_stats_print(pipeline, &now);
+
+	if (pipeline->top_interval)
+		dump_top_print(pipeline, &now);
+
+	if (pipeline->ogm_interval)
+		dump_ogm_print(pipeline, &now);
+}
+
+static int dump_pipeline_init(struct dump_pipeline *pipeline, bool print)
+{
+	struct dump_dissector *dissector;
+	struct dump_if *dump_if;
+	unsigned int i;
+	long nproc;
+
+	pipeline->print = print;
+	pipeline->output_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (pipeline->output_fd < 0) {
+		perror("Error - can't create eventfd for the output");
+		return -errno;
+	}
+
+	if (print) {
+		nproc = sysconf(_SC_NPROCESSORS_ONLN);
+		pipeline->num_dissectors = nproc > 0 ? nproc : 1;
+		if (pipeline->num_dissectors > DUMP_MAX_DISSECTORS)
+			pipeline->num_dissectors = DUMP_MAX_DISSECTORS;
+	}
+
+	for (i = 0; pipeline->top_interval && i < DUMP_TOP_NUM; i++) {
+		pipeline->top[i] = topk_new(DUMP_TOP_CAPACITY);
+		if (!pipeline->top[i]) {
+			fprintf(stderr, "Error - could not allocate flow counters: out of memory ?\n");
+			return -ENOMEM;
+		}
+	}
+
+	if (pipeline->ogm_interval) {
+		pipeline->ogm_links = hash_new(64, compare_ogm_link,
+					       choose_ogm_link);
+		if (!pipeline->ogm_links) {
+			fprintf(stderr, "Error - could not allocate OGM links: out of memory ?\n");
+			return -ENOMEM;
+		}
+	}
+
+	for (i = 0; i < pipeline->num_dissectors; i++) {
+		dissector = &pipeline->dissectors[i];
+		dissector->pipeline = pipeline;
+		dissector->id = i;
+		dissector->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (dissector->event_fd < 0) {
+			perror("Error - can't create eventfd for the dissectors");
+			return -errno;
+		}
+	}
+
+	list_for_each_entry(dump_if, pipeline->dump_if_list, list) {
+		dump_if->pipeline = pipeline;
+		dump_if->space_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (dump_if->space_fd < 0) {
+			perror("Error - can't create eventfd for the capture");
+			return -errno;
+		}
+
+		if (dump_pipes_init(dump_if, pipeline->num_dissectors) < 0) {
+			fprintf(stderr, "Error - could not allocate packet buffers: out of memory ?\n");
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static void dump_pipeline_free(struct dump_pipeline *pipeline)
+{
+	unsigned int i;
+
+	for (i = 0; i < pipeline->num_dissectors; i++) {
+		if (pipeline->dissectors[i].event_fd >= 0)
+			close(pipeline->dissectors[i].event_fd);
+	}
+
+	if (pipeline->output_fd >= 0)
+		close(pipeline->output_fd);
+
+	for (i = 0; i < DUMP_TOP_NUM; i++)
+		topk_free(pipeline->top[i]);
+
+	if (pipeline->ogm_links)
+		hash_delete(pipeline->ogm_links, free);
+
+	free(pipeline->ogm_entries);
+}
+
+/* output thread - prints in large blocks which are flushed after a deadline */
+static void dump_pipeline_run(struct dump_pipeline *pipeline)
+{
+	struct timespec pending_since;
+	struct timespec now;
+	bool pending = false;
+	bool printed = false;
+	int merge_timeout = -1;
+	long elapsed;
+	int timeout;
+
+	clock_gettime(CLOCK_MONOTONIC, &pipeline->stats_time);
+	pipeline->top_time = pipeline->stats_time;
+	pipeline->ogm_time = pipeline->stats_time;
+
+	while (!is_aborted) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		if (pipeline->print) {
+			merge_timeout = dump_print_pipes(pipeline, false,
+							 &printed);
+			if (printed && !pending) {
+				pending = true;
+				pending_since = now;
+			}
+
+			printed = false;
+		}
+
+		timeout = 1000;
+		if (merge_timeout >= 0)
+			timeout = merge_timeout;
+
+		if (pending) {
+			elapsed = (now.tv_sec - pending_since.tv_sec) * 1000 +
+				  (now.tv_nsec - pending_since.tv_nsec) / 1000000;
+
+			if (elapsed >= DUMP_FLUSH_INTERVAL) {
+				fflush(stdout);
+				pending = false;
+			} else if (DUMP_FLUSH_INTERVAL - elapsed < timeout) {
+				timeout = DUMP_FLUSH_INTERVAL - elapsed;
+			}
+		}
+
+		if (pipeline->stats_interval) {
+			elapsed = dump_time_diff_ms(&now, &pipeline->stats_time);
+
+			if (elapsed >= pipeline->stats_interval * 1000L) {
+				dump_stats_print(pipeline, &now);
+				elapsed = 0;
+			}
+
+			if (pipeline->stats_interval * 1000L - elapsed < timeout)
+				timeout = pipeline->stats_interval * 1000L - elapsed;
+		}
+
+		if (pipeline->top_interval) {
+			elapsed = dump_time_diff_ms(&now, &pipeline->top_time);
+
+			if (elapsed >= pipeline->top_interval * 1000L) {
+				dump_top_print(pipeline, &now);
+				elapsed = 0;
+			}
+
+			if (pipeline->top_interval * 1000L - elapsed < timeout)
+				timeout = pipeline->top_interval * 1000L - elapsed;
+		}
+
+		if (pipeline->ogm_interval) {
+			elapsed = dump_time_diff_ms(&now, &pipeline->ogm_time);
+
+			if (elapsed >= pipeline->ogm_interval * 1000L) {
+				dump_ogm_print(pipeline, &now);
+				elapsed = 0;
+			}
+
+			if (pipeline->ogm_interval * 1000L - elapsed < timeout)
+				timeout = pipeline->ogm_interval * 1000L - elapsed;
+		}
+
+		/* the error is reported when the writer is closed */
+		if (pipeline->writer && pcapng_writer_error(pipeline->writer) < 0)
+			break;
+
+		dump_wait(pipeline->output_fd, timeout);
+	}
+}
+
+static void print_dump_stats(struct dump_if *dump_if)
+{
+	struct tpacket_stats_v3 stats;
+	socklen_t len = sizeof(stats);
+	int res;
+
+	res = getsockopt(dump_if->raw_sock, SOL_PACKET, PACKET_STATISTICS,
+			 &stats, &len);
+	if (res < 0)
+		return;
+
+	fprintf(stderr, "%s: %u packets received, %u packets dropped by kernel, %u ring freezes\n",
+		dump_if->dev, stats.tp_packets, stats.tp_drops,
+		stats.tp_freeze_q_cnt);
+
+	if (dump_if->not_printed)
+		fprintf(stderr, "%s: %lu packets not %s because the output was too slow\n",
+			dump_if->dev, dump_if->not_printed,
+			dump_summary_only(dump_if->pipeline) ? "counted" : "printed");
+}
+
+static int32_t dump_file_hw_type(uint16_t linktype)
+{
+	switch (linktype) {
+	case PCAPNG_LINKTYPE_ETHERNET:
+		return ARPHRD_ETHER;
+	case PCAPNG_LINKTYPE_IEEE802_11_PRISM:
+		return ARPHRD_IEEE80211_PRISM;
+	case PCAPNG_LINKTYPE_IEEE802_11_RADIOTAP:
+		return ARPHRD_IEEE80211_RADIOTAP;
+	default:
+		return -1;
+	}
+}
+
+/* split the file in chunks of packets which can be dissected independently */
+static int dump_file_scan(struct dump_file *file)
+{
+	struct pcapng_cursor cursor;
+	struct pcapng_cursor start;
+	struct pcapng_packet packet;
+	struct dump_chunk *chunks;
+	size_t unsupported = 0;
+	size_t max_chunks = 0;
+	struct dump_chunk *chunk = NULL;
+	int ret;
+
+	pcapng_reader_start(file->reader, &cursor);
+
+	while (1) {
+		start = cursor;
+
+		ret = pcapng_reader_next(file->reader, &cursor, &packet);
+		if (ret == -ENOMEM) {
+			fprintf(stderr, "Error - could not read capture file: out of memory ?\n");
+			return ret;
+		}
+
+		/* dissect everything in front of a truncated packet */
+		if (ret < 0) {
+			fprintf(stderr, "Warning - capture file is truncated or malformed at offset %zu\n",
+				start.offset);
+			break;
+		}
+
+		if (ret == 0)
+			break;
+
+		if (dump_file_hw_type(packet.linktype) < 0)
+			unsupported++;
+
+		if (chunk && chunk->num_packets < DUMP_READ_CHUNK_PACKETS) {
+			chunk->num_packets++;
+			continue;
+		}
+
+		if (file->num_chunks == max_chunks) {
+			max_chunks = max_chunks ? max_chunks * 2 : 64;
+			chunks = realloc(file->chunks,
+					 max_chunks * sizeof(*chunks));
+			if (!chunks) {
+				fprintf(stderr, "Error - could not read capture file: out of memory ?\n");
+				return -ENOMEM;
+			}
+
+			file->chunks = chunks;
+		}
+
+		chunk = &file->chunks[file->num_chunks++];
+		memset(chunk, 0, sizeof(*chunk));
+		chunk->start = start;
+		chunk->num_packets = 1;
+	}
+
+	if (unsupported)
+		fprintf(stderr, "Warning - skipping %zu packets of unsupported link types\n",
+			unsupported);
+
+	return 0;
+}
+
+static void dump_file_chunk(struct dump_file *file, struct dump_chunk *chunk)
+{
+	struct pcapng_cursor cursor = chunk->start;
+	struct pcapng_packet packet;
+	int32_t hw_type;
+	size_t i;
+
+	for (i = 0; i < chunk->num_packets; i++) {
+		if (pcapng_reader_next(file->reader, &cursor, &packet) <= 0)
+			break;
+
+		hw_type = dump_file_hw_type(packet.linktype);
+		if (hw_type < 0)
+			continue;
+
+		dump_time.tv_sec = packet.ts_nsec / 1000000000ULL;
+		dump_time.tv_nsec = packet.ts_nsec % 1000000000ULL;
+		dump_frame(hw_type, packet.data, packet.caplen, file->read_opt);
+	}
+}
+
+static void *dump_file_worker(void *arg)
+{
+	struct dump_file *file = arg;
+	struct dump_chunk *chunk;
+
+	while (1) {
+		pthread_mutex_lock(&file->lock);
+		while (file->next < file->num_chunks &&
+		       file->next >= file->written + file->window)
+			pthread_cond_wait(&file->cond, &file->lock);
+
+		if (file->next >= file->num_chunks) {
+			pthread_mutex_unlock(&file->lock);
+			break;
+		}
+
+		chunk = &file->chunks[file->next++];
+		pthread_mutex_unlock(&file->lock);
+
+		/* the output is merged in packet order by the main thread */
+		dump_out = open_memstream(&chunk->output, &chunk->output_len);
+		if (dump_out) {
+			dump_file_chunk(file, chunk);
+			fclose(dump_out);
+		} else {
+			fprintf(stderr, "Error - could not allocate output buffer: out of memory ?\n");
+		}
+
+		pthread_mutex_lock(&file->lock);
+		chunk->done = true;
+		pthread_cond_broadcast(&file->cond);
+		pthread_mutex_unlock(&file->lock);
+	}
+
+	return NULL;
+}
+
+/* print the chunks in order while the workers dissect the following ones */
+static void dump_file_merge(struct dump_file *file)
+{
+	struct dump_chunk *chunk;
+	size_t i;
+
+	for (i = 0; i < file->num_chunks; i++) {
+		chunk = &file->chunks[i];
+
+		pthread_mutex_lock(&file->lock);
+		while (!chunk->done)
+			pthread_cond_wait(&file->cond, &file->lock);
+		pthread_mutex_unlock(&file->lock);
+
+		if (chunk->output_len)
+			fwrite(chunk->output, chunk->output_len, 1, stdout);
+
+		free(chunk->output);
+		chunk->output = NULL;
+
+		pthread_mutex_lock(&file->lock);
+		file->written++;
+
+		/* stop handing out chunks */
+		if (is_aborted)
+			file->next = file->num_chunks;
+
+		pthread_cond_broadcast(&file->cond);
+		pthread_mutex_unlock(&file->lock);
+
+		if (is_aborted)
+			break;
+	}
+
+	fflush(stdout);
+}
+
+static int dump_file_read(const char *path, int read_opt)
+{
+	pthread_t threads[DUMP_READ_MAX_THREADS];
+	unsigned int num_threads = 0;
+	struct dump_file file;
+	unsigned int max_threads;
+	long nproc;
+	size_t i;
+	int ret = EXIT_FAILURE;
+
+	memset(&file, 0, sizeof(file));
+	file.read_opt = read_opt;
+	pthread_mutex_init(&file.lock, NULL);
+	pthread_cond_init(&file.cond, NULL);
+
+	file.reader = pcapng_reader_open(path);
+	if (!file.reader)
+		goto out;
+
+	if (dump_file_scan(&file) < 0)
+		goto out;
+
+	nproc = sysconf(_SC_NPROCESSORS_ONLN);
+	max_threads = nproc > 0 ? nproc : 1;
+	if (max_threads > DUMP_READ_MAX_THREADS)
+		max_threads = DUMP_READ_MAX_THREADS;
+	if (max_threads > file.num_chunks)
+		max_threads = file.num_chunks;
+
+	file.window = max_threads * DUMP_READ_WINDOW;
+
+	/* a single chunk (or core) is dissected without workers */
+	for (i = 0; max_threads > 1 && i < max_threads; i++) {
+		if (pthread_create(&threads[num_threads], NULL,
+				   dump_file_worker, &file) != 0)
+			break;
+
+		num_threads++;
+	}
+
+	if (num_threads) {
+		dump_file_merge(&file);
+	} else {
+		for (i = 0; i < file.num_chunks && !is_aborted; i++)
+			dump_file_chunk(&file, &file.chunks[i]);
+
+		fflush(stdout);
+	}
+
+	for (i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+
+	ret = EXIT_SUCCESS;
+
+out:
+	for (i = 0; i < file.num_chunks; i++)
+		free(file.chunks[i].output);
+
+	free(file.chunks);
+	pcapng_reader_close(file.reader);
+	pthread_cond_destroy(&file.cond);
+	pthread_mutex_destroy(&file.lock);
+
+	return ret;
+}
+
+static int tcpdump(struct state *state __maybe_unused, int argc, char **argv)
+{
+	struct dump_if *dump_if, *dump_if_tmp;
+	struct list_head dump_if_list;
+	struct pcapng_writer *writer = NULL;
+	struct dump_pipeline pipeline;
+	struct bpf_filter *filter = NULL;
+	char *filter_expr = NULL;
+	char *write_path = NULL;
+	char *read_path = NULL;
+	unsigned int stats_interval = 0;
+	unsigned int top_interval = 0;
+	unsigned int ogm_interval = 0;
+	unsigned int orig_interval = DUMP_OGM_ORIG_INTERVAL;
+	unsigned int rotate_secs = 0;
+	size_t rotate_size = 0;
+	bool print = false;
+	size_t ring_size = DUMP_RING_SIZE_DEFAULT;
+	int ret = EXIT_FAILURE, res, optchar, found_args = 1, tmp;
+	int read_opt = USE_BAT_HOSTS;
+	unsigned int i;
+
+	dump_level = dump_level_all;
+
+	while ((optchar = getopt(argc, argv, "B:C:F:G:I:O:PS:T:chnp:r:w:x:")) != -1) {
+		switch (optchar) {
+		case 'B':
+			tmp = strtol(optarg, NULL, 10);
+			if (tmp < 2 * DUMP_RING_BLOCK_SIZE / 1024) {
+				fprintf(stderr, "Error - capture ring must be at least %d KiB\n",
+					2 * DUMP_RING_BLOCK_SIZE / 1024);
+				return EXIT_FAILURE;
+			}
+			ring_size = (size_t)tmp * 1024;
+			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
+			break;
+		case 'C':
+			tmp = strtol(optarg, NULL, 10);
+			if (tmp <= 0) {
+				fprintf(stderr, "Error - invalid capture file size: %s\n",
+					optarg);
+				return EXIT_FAILURE;
+			}
+			rotate_size = (size_t)tmp * 1000000;
+			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
+			break;
+		case 'F':
+			filter_expr = optarg;
+			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
+			break;
+		case 'G':
+			tmp = strtol(optarg, NULL, 10);
+			if (tmp <= 0) {
+				fprintf(stderr, "Error - invalid capture file duration: %s\n",
+					optarg);
+				return EXIT_FAILURE;
+			}
+			rotate_secs = tmp;
+			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
+			break;
+		case 'I':
+			tmp = strtol(optarg, NULL, 10);
+			if (tmp <= 0) {
+				fprintf(stderr, "Error - invalid originator interval: %s\n",
+					optarg);
+				return EXIT_FAILURE;
+			}
+			orig_interval = tmp;
+			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
+			break;
+		case 'O':
+			tmp = strtol(optarg, NULL, 10);
+			if (tmp <= 0) {
+				fprintf(stderr, "Error - invalid report interval: %s\n",
+					optarg);
+				return EXIT_FAILURE;
+			}
+			ogm_interval = tmp;
+			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
+			break;
+		case 'P':
+			print = true;
+			found_args += 1;
+			break;
+		case 'S':
+			tmp = strtol(optarg, NULL, 10);
+			if (tmp <= 0) {
+				fprintf(stderr, "Error - invalid summary interval: %s\n",
+					optarg);
+				return EXIT_FAILURE;
+			}
+			stats_interval = tmp;
+			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
+			break;
+		case 'T':
+			tmp = strtol(optarg, NULL, 10);
+			if (tmp <= 0) {
+				fprintf(stderr, "Error - invalid report interval: %s\n",
+					optarg);
+				return EXIT_FAILURE;
+			}
+			top_interval = tmp;
+			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
+			break;
+		case 'c':
+			read_opt |= COMPAT_FILTER;
+			found_args += 1;
+			break;
+		case 'h':
+			tcpdump_usage();
+			return EXIT_SUCCESS;
+		case 'n':
+			read_opt &= ~USE_BAT_HOSTS;
+			found_args += 1;
+			break;
+		case 'p':
+			tmp = strtol(optarg, NULL , 10);
+			if ((tmp > 0) && (tmp <= dump_level_all))
+				dump_level = tmp;
+			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
+			break;
+		case 'r':
+			read_path = optarg;
+			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
+			break;
+		case 'w':
+			write_path = optarg;
+			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
+			break;
+		case 'x':
+			tmp = strtol(optarg, NULL , 10);
+			if ((tmp > 0) && (tmp <= dump_level_all))
+				dump_level &= ~tmp;
+			found_args += ((*((char*)(optarg - 1)) == optchar ) ? 1 : 2);
+			break;
+		default:
+			tcpdump_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	dump_out = stdout;
+
+	if (read_path) {
+		if (argc > found_args || filter_expr || write_path ||
+		    stats_interval || top_interval || ogm_interval) {
+			fprintf(stderr, "Error - interfaces, -F, -O, -S, -T and -w can't be used when reading a capture file\n");
+			tcpdump_usage();
+			return EXIT_FAILURE;
+		}
+
+		bat_hosts_init(read_opt);
+		signal(SIGINT, sig_handler);
+		signal(SIGTERM, sig_handler);
+
+		ret = dump_file_read(read_path, read_opt);
+
+		bat_hosts_free();
+		return ret;
+	}
+
+	if (argc <= found_args) {
+		fprintf(stderr, "Error - target interface not specified\n");
+		tcpdump_usage();
+		return EXIT_FAILURE;
+	}
+
+	/* the packets are only printed by default when they are not saved */
+	if (!write_path)
+		print = true;
+
+	/* the dissectors count instead of printing */
+	if (stats_interval || top_interval || ogm_interval)
+		print = true;
+
+	check_root_or_die("batctl tcpdump");
+
+	bat_hosts_init(read_opt);
+
+	signal(SIGINT, sig_handler);
+	signal(SIGTERM, sig_handler);
+
+	/* init interfaces list */
+	INIT_LIST_HEAD(&dump_if_list);
+
+	memset(&pipeline, 0, sizeof(pipeline));
+	pipeline.dump_if_list = &dump_if_list;
+	pipeline.read_opt = read_opt;
+	pipeline.stats_interval = stats_interval;
+	pipeline.top_interval = top_interval;
+	pipeline.ogm_interval = ogm_interval;
+	pipeline.orig_interval = orig_interval;
+	pipeline.output_fd = -1;
+	for (i = 0; i < DUMP_MAX_DISSECTORS; i++)
+		pipeline.dissectors[i].event_fd = -1;
+
+	if (filter_expr) {
+		filter = bpf_filter_compile(filter_expr);
+		if (!filter)
+			goto out;
+	}
+
+	if (write_path) {
+		writer = pcapng_writer_open(write_path, rotate_size,
+					    rotate_secs);
+		if (!writer)
+			goto out;
+
+		pipeline.writer = writer;
+	}
+
+	while (argc > found_args) {
+		dump_if = create_dump_interface(argv[found_args], ring_size,
+						filter);
+		if (!dump_if)
+			goto out;
+
+		list_add_tail(&dump_if->list, &dump_if_list);
+
+		if (writer) {
+			res = pcapng_writer_add_interface(writer, dump_if->dev,
+							  dump_linktype(dump_if));
+			if (res < 0) {
+				fprintf(stderr, "Error - can't add interface to capture file: %s\n",
+					strerror(-res));
+				goto out;
+			}
+
+			dump_if->pcap_id = res;
+		}
+
+		found_args++;
+	}
+
+	if (dump_pipeline_init(&pipeline, print) < 0)
+		goto out;
+
+	if (writer && pcapng_writer_start(writer) < 0)
+		goto out;
+
+	setvbuf(stdout, NULL, _IOFBF, DUMP_OUTPUT_BUFFER);
+
+	if (dump_pipeline_start(&pipeline) == 0)
+		dump_pipeline_run(&pipeline);
+
+	dump_pipeline_stop(&pipeline);
+
+	list_for_each_entry(dump_if, &dump_if_list, list)
+		print_dump_stats(dump_if);
+
+out:
+	dump_pipeline_free(&pipeline);
+
+	list_for_each_entry_safe(dump_if, dump_if_tmp, &dump_if_list, list) {
+		dump_pipes_free(dump_if);
+
+		if (dump_if->space_fd >= 0)
+			close(dump_if->space_fd);
+
+		if (dump_if->ring)
+			munmap(dump_if->ring, dump_if->ring_size);
+
+		if (dump_if->raw_sock >= 0)
+			close(dump_if->raw_sock);
+
+		list_del(&dump_if->list);
+		free(dump_if);
+	}
+
+	res = pcapng_writer_close(writer);
+	if (res < 0)
+		fprintf(stderr, "Error - can't write capture file: %s\n",
+			strerror(-res));
+
+	bpf_filter_free(filter);
 	bat_hosts_free();
 	return ret;
 }
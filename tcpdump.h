@@ -23,12 +23,19 @@
 #ifndef _BATCTL_TCPDUMP_H
 #define _BATCTL_TCPDUMP_H
 
-#include <netpacket/packet.h>
+#include <linux/if_packet.h>
 #include <netinet/if_ether.h>
 #include <net/if_arp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include <sys/types.h>
+#include <time.h>
 #include "main.h"
+#include "hash.h"
 #include "list.h"
+#include "pcapng.h"
+#include "topk.h"
 
 #ifndef ARPHRD_IEEE80211_PRISM
 #define ARPHRD_IEEE80211_PRISM 802
@@ -48,6 +55,88 @@
 #define DUMP_TYPE_BATFRAG 128
 #define DUMP_TYPE_NONBAT 256
 
+/* size of the TPACKET_V3 blocks - a block has to fit the largest (GRO) frame */
+#define DUMP_RING_BLOCK_SIZE (256 * 1024)
+#define DUMP_RING_FRAME_SIZE 2048
+#define DUMP_RING_SIZE_DEFAULT (4 * 1024 * 1024)
+/* time after which a partially filled block is handed to batctl */
+#define DUMP_RING_BLOCK_TIMEOUT 50
+
+/* packets of an interface which wait for one dissector thread */
+#define DUMP_PIPE_SLOTS 256
+#define DUMP_MAX_DISSECTORS 8
+/* time after which the printed packets are flushed to stdout (in ms) */
+#define DUMP_FLUSH_INTERVAL 100
+#define DUMP_OUTPUT_BUFFER (256 * 1024)
+/* time (in ms) a packet waits for older packets of other interfaces - the
+ * kernel may hold a packet back in a ring block for DUMP_RING_BLOCK_TIMEOUT
+ */
+#define DUMP_REORDER_WINDOW (3 * DUMP_RING_BLOCK_TIMEOUT)
+
+/* packets of a capture file which are dissected by one thread at a time */
+#define DUMP_READ_CHUNK_PACKETS 4096
+#define DUMP_READ_MAX_THREADS 16
+/* chunks per thread which may be dissected ahead of the output */
+#define DUMP_READ_WINDOW 4
+
+/* protocol overhead classes which are counted by -S */
+enum dump_stats_type {
+	DUMP_STATS_OGM,
+	DUMP_STATS_OGM2,
+	DUMP_STATS_ELP,
+	DUMP_STATS_ICMP,
+	DUMP_STATS_UCAST,
+	DUMP_STATS_4ADDR,
+	DUMP_STATS_4ADDR_DAT,
+	DUMP_STATS_UCAST_TVLV,
+	DUMP_STATS_BCAST,
+	DUMP_STATS_FRAG,
+	DUMP_STATS_CODED,
+	DUMP_STATS_BAT_OTHER,
+	DUMP_STATS_NONBAT,
+	DUMP_STATS_TVLV_GW,
+	DUMP_STATS_TVLV_DAT,
+	DUMP_STATS_TVLV_NC,
+	DUMP_STATS_TVLV_TT,
+	DUMP_STATS_TVLV_ROAM,
+	DUMP_STATS_TVLV_MCAST,
+	DUMP_STATS_TVLV_OTHER,
+	DUMP_STATS_SHORT,
+	DUMP_STATS_NUM,
+};
+
+/* the TVLV containers and the frames which were too short to be dissected
+ * are part of the packets which carry them
+ */
+#define DUMP_STATS_FIRST_TVLV DUMP_STATS_TVLV_GW
+
+/* heaviest flows which are reported by -T and the counters to find them */
+#define DUMP_TOP_FLOWS 10
+#define DUMP_TOP_CAPACITY 256
+
+enum dump_top_type {
+	DUMP_TOP_MESH_BYTES,
+	DUMP_TOP_MESH_PACKETS,
+	DUMP_TOP_CLIENT_BYTES,
+	DUMP_TOP_CLIENT_PACKETS,
+	DUMP_TOP_NUM,
+};
+
+/* OGM tracker (-O): sequence numbers below the highest one which are
+ * remembered to detect duplicates
+ */
+#define DUMP_OGM_WINDOW 64
+/* a larger jump of the sequence numbers is a restart of the originator */
+#define DUMP_OGM_MAX_GAP 1024
+/* links without OGMs are forgotten after this time (in s) */
+#define DUMP_OGM_TIMEOUT 60
+/* default originator interval of batman-adv (in ms) */
+#define DUMP_OGM_ORIG_INTERVAL 1000
+/* OGMs of an aggregated frame which are tracked - batman-adv sends at most
+ * 32 in its 512 byte aggregates
+ */
+#define DUMP_OGM_MAX_AGGR 32
+
 #define IEEE80211_FCTL_FTYPE 0x0c00
 #define IEEE80211_FCTL_TODS 0x0001
 #define IEEE80211_FCTL_FROMDS 0x0002
@@ -57,12 +146,181 @@
 
 #define IEEE80211_STYPE_QOS_DATA 0x8000
 
+/* addresses of a unicast or broadcast packet */
+struct dump_flow {
+	bool valid;
+	uint8_t mesh[TOPK_KEY_LEN];	/* originator and destination */
+	uint8_t client[TOPK_KEY_LEN];	/* inner source and destination */
+};
+
+/* originator message in a packet */
+struct dump_ogm_entry {
+	bool ogm2;
+	uint8_t orig[ETH_ALEN];
+	uint8_t neigh[ETH_ALEN];
+	uint32_t seqno;
+	uint32_t metric;	/* tq or throughput (in 100 kbit/s) */
+	uint8_t ttl;
+};
+
+/* originator messages of a packet - one per OGM of an aggregate */
+struct dump_ogm {
+	unsigned int num;
+	struct dump_ogm_entry entries[DUMP_OGM_MAX_AGGR];
+};
+
+/* OGMs of an originator which were received from a neighbor */
+struct dump_ogm_link {
+	uint8_t orig[ETH_ALEN];
+	uint8_t neigh[ETH_ALEN];
+	bool ogm2;
+
+	uint32_t seqno;		/* highest sequence number */
+	uint64_t window;	/* received sequence numbers up to the highest */
+	struct timespec last_seen;
+
+	/* since the previous report */
+	unsigned long received;
+	unsigned long expected;
+	unsigned long duplicates;
+	unsigned long reordered;
+	unsigned long stale;
+	unsigned long jitter_num;
+	double jitter_sum;
+	double jitter_max;
+	uint8_t ttl_min;
+	uint8_t ttl_max;
+	unsigned long ttl_sum;
+	uint32_t metric_first;
+	uint32_t metric_last;
+};
+
+/* captured packet and its dissection */
+struct dump_slot {
+	uint8_t *frame;
+	size_t frame_size;
+	uint32_t len;
+	struct timespec time;
+
+	FILE *out;
+	char *text;
+	size_t text_len;
+	struct dump_flow flow;
+	struct dump_ogm ogm;
+};
+
+/* ring from a capture thread over a dissector to the output thread - every
+ * index is only written by one of the three threads
+ */
+struct dump_pipe {
+	struct dump_slot *slots;
+	size_t head;	/* captured */
+	size_t mid;	/* dissected */
+	size_t tail;	/* printed */
+};
+
+/* counters of one dissector - they are only written by the dissector and may
+ * wrap, the output thread adds up the differences since its last visit
+ */
+struct dump_stats {
+	unsigned long packets[DUMP_STATS_NUM];
+	unsigned long bytes[DUMP_STATS_NUM];
+};
+
+struct dump_pipeline;
+
+struct dump_dissector {
+	struct dump_pipeline *pipeline;
+	unsigned int id;
+	int event_fd;
+	pthread_t thread;
+	bool started;
+
+	struct dump_stats stats;
+	struct dump_stats stats_seen;	/* output thread */
+};
+
+struct dump_pipeline {
+	struct list_head *dump_if_list;
+	struct pcapng_writer *writer;
+	bool print;
+	int read_opt;
+
+	struct dump_dissector dissectors[DUMP_MAX_DISSECTORS];
+	unsigned int num_dissectors;
+	int output_fd;
+
+	bool stop_capture;
+	bool stop_dissect;
+
+	/* protocol overhead summary every stats_interval seconds (-S) */
+	unsigned int stats_interval;
+	struct timespec stats_time;
+	uint64_t stats_packets[DUMP_STATS_NUM];
+	uint64_t stats_bytes[DUMP_STATS_NUM];
+
+	/* heaviest flows every top_interval seconds (-T) - output thread */
+	unsigned int top_interval;
+	struct timespec top_time;
+	struct topk *top[DUMP_TOP_NUM];
+
+	/* OGM links every ogm_interval seconds (-O) - output thread */
+	unsigned int ogm_interval;
+	unsigned int orig_interval;
+	struct timespec ogm_time;
+	struct hashtable_t *ogm_links;
+	struct dump_ogm_link **ogm_entries;
+	size_t ogm_entries_size;
+};
+
 struct dump_if {
 	struct list_head list;
 	char *dev;
 	int32_t raw_sock;
 	struct sockaddr_ll addr;
 	int32_t hw_type;
+
+	/* PACKET_RX_RING (TPACKET_V3) */
+	uint8_t *ring;
+	size_t ring_size;
+	unsigned int block_nr;
+	unsigned int block;
+
+	/* interface id in the capture file */
+	unsigned int pcap_id;
+
+	/* capture thread and its pipes to the dissectors */
+	struct dump_pipeline *pipeline;
+	pthread_t thread;
+	bool started;
+	struct dump_pipe pipes[DUMP_MAX_DISSECTORS];
+	uint64_t seq;		/* next packet - capture thread */
+	uint64_t out_seq;	/* next printed packet - output thread */
+	int space_fd;		/* kicked when slots were printed */
+	bool printed;		/* slots were printed - output thread */
+	unsigned long not_printed;
+};
+
+/* packets of a capture file which are dissected together */
+struct dump_chunk {
+	struct pcapng_cursor start;
+	size_t num_packets;
+	char *output;
+	size_t output_len;
+	bool done;
+};
+
+struct dump_file {
+	struct pcapng_reader *reader;
+	struct dump_chunk *chunks;
+	size_t num_chunks;
+	int read_opt;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	size_t next;	/* next chunk for a worker */
+	size_t written;	/* chunks which were printed */
+	size_t window;
 };
 
 struct vlanhdr {
@@ -44,12 +44,11 @@
 #include "batadv_packet.h"
 #include "batman_adv.h"
 #include "functions.h"
-#include "genl.h"
 #include "netlink.h"
 #include "debugfs.h"
 
 static struct ether_addr *dst_mac;
-static char *tp_mesh_iface;
+static struct state *tp_state;
 
 struct tp_result {
 	int error;
@@ -166,41 +165,27 @@ static int tp_meter_cookie_callback(struct nl_msg *msg, void *arg)
 	return NL_OK;
 }
 
-static int tp_meter_start(char *mesh_iface, struct ether_addr *dst_mac,
+static int tp_meter_start(struct state *state, struct ether_addr *dst_mac,
 			  uint32_t time, struct tp_cookie *cookie)
 {
-	struct nl_sock *sock;
 	struct nl_msg *msg;
 	struct nl_cb *cb;
 	int ifindex;
-	int family;
-	int ret;
 	int err = 0;
 
-	sock = nl_socket_alloc();
-	if (!sock)
-		return -ENOMEM;
+	if (!state->sock)
+		return -EOPNOTSUPP;
 
-	ret = genl_connect(sock);
-	if (ret < 0) {
-		err = -EOPNOTSUPP;
-		goto out;
-	}
-
-	family = genl_ctrl_resolve(sock, BATADV_NL_NAME);
-	if (family < 0) {
-		err = -EOPNOTSUPP;
-		goto out;
-	}
-
-	ifindex = if_nametoindex(mesh_iface);
+	ifindex = if_nametoindex(state->mesh_iface);
 	if (!ifindex) {
-		fprintf(stderr, "Interface %s is unknown\n", mesh_iface);
-		err = -ENODEV;
-		goto out;
+		fprintf(stderr, "Interface %s is unknown\n", state->mesh_iface);
+		return -ENODEV;
 	}
 
 	cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!cb)
+		return -ENOMEM;
+
 	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, tp_meter_cookie_callback,
 		  cookie);
 	nl_cb_err(cb, NL_CB_CUSTOM, tpmeter_nl_print_error, cookie);
@@ -211,19 +196,17 @@ static int tp_meter_start(char *mesh_iface, struct ether_addr *dst_mac,
 		goto out;
 	}
 
-	genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, family, 0,
+	genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, state->batadv_family, 0,
 		    0, BATADV_CMD_TP_METER, 1);
 
 	nla_put_u32(msg, BATADV_ATTR_MESH_IFINDEX, ifindex);
 	nla_put(msg, BATADV_ATTR_ORIG_ADDRESS, ETH_ALEN, dst_mac);
 	nla_put_u32(msg, BATADV_ATTR_TPMETER_TEST_TIME, time);
 
-	nl_send_auto_complete(sock, msg);
+	nl_send_auto_complete(state->sock, msg);
 	nlmsg_free(msg);
 
-	nl_recvmsgs(sock, cb);
-
-	nl_cb_put(cb);
+	nl_recvmsgs(state->sock, cb);
 
 	if (cookie->error < 0)
 		err = cookie->error;
@@ -231,7 +214,7 @@ static int tp_meter_start(char *mesh_iface, struct ether_addr *dst_mac,
 		err= -EINVAL;
 
 out:
-	nl_socket_free(sock);
+	nl_cb_put(cb);
 
 	return err;
 }
@@ -266,65 +249,50 @@ static int tp_recv_result(struct nl_sock *sock, struct tp_result *result)
 	return err;
 }
 
-static int tp_meter_stop(char *mesh_iface, struct ether_addr *dst_mac)
+static int tp_meter_stop(struct state *state, struct ether_addr *dst_mac)
 {
-	struct nl_sock *sock;
 	struct nl_msg *msg;
 	int ifindex;
-	int family;
-	int ret;
-	int err = 0;
 
-	sock = nl_socket_alloc();
-	if (!sock)
-		return -ENOMEM;
-
-	ret = genl_connect(sock);
-	if (ret < 0) {
-		err = -EOPNOTSUPP;
-		goto out;
-	}
-
-	family = genl_ctrl_resolve(sock, BATADV_NL_NAME);
-	if (family < 0) {
-		err = -EOPNOTSUPP;
-		goto out;
-	}
+	if (!state->sock)
+		return -EOPNOTSUPP;
 
-	ifindex = if_nametoindex(mesh_iface);
+	ifindex = if_nametoindex(state->mesh_iface);
 	if (!ifindex) {
-		fprintf(stderr, "Interface %s is unknown\n", mesh_iface);
-		err = -ENODEV;
-		goto out;
+		fprintf(stderr, "Interface %s is unknown\n", state->mesh_iface);
+		return -ENODEV;
 	}
 
 	msg = nlmsg_alloc();
-	if (!msg) {
-		err = -ENOMEM;
-		goto out;
-	}
+	if (!msg)
+		return -ENOMEM;
 
-	genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, family, 0,
+	genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, state->batadv_family, 0,
 		    0, BATADV_CMD_TP_METER_CANCEL, 1);
 
 	nla_put_u32(msg, BATADV_ATTR_MESH_IFINDEX, ifindex);
 	nla_put(msg, BATADV_ATTR_ORIG_ADDRESS, ETH_ALEN, dst_mac);
 
-	nl_send_auto_complete(sock, msg);
+	nl_send_auto_complete(state->sock, msg);
 	nlmsg_free(msg);
 
-out:
-	nl_socket_free(sock);
-
-	return err;
+	return 0;
 }
 
-static struct nl_sock *tp_prepare_listening_sock(void)
+/* the results are sent via multicast and can arrive before the reply to the
+ * start request. A second socket is therefore joined to the tpmeter group
+ * before the test is started
+ */
+static struct nl_sock *tp_prepare_listening_sock(struct state *state)
 {
 	struct nl_sock *sock;
-	int family;
 	int ret;
-	int mcid;
+
+	if (state->tpmeter_mcid < 0) {
+		fprintf(stderr, "Failed to resolve batman-adv tpmeter multicast group: %d\n",
+			state->tpmeter_mcid);
+		return NULL;
+	}
 
 	sock = nl_socket_alloc();
 	if (!sock)
@@ -337,22 +305,7 @@ static struct nl_sock *tp_prepare_listening_sock(void)
 		goto err;
 	}
 
-	family = genl_ctrl_resolve(sock, BATADV_NL_NAME);
-	if (family < 0) {
-		fprintf(stderr, "Failed to resolve batman-adv netlink: %d\n",
-			family);
-		goto err;
-	}
-
-	mcid = nl_get_multicast_id(sock, BATADV_NL_NAME,
-				   BATADV_NL_MCAST_GROUP_TPMETER);
-	if (mcid < 0) {
-		fprintf(stderr, "Failed to resolve batman-adv tpmeter multicast group: %d\n",
-			mcid);
-		goto err;
-	}
-
-	ret = nl_socket_add_membership(sock, mcid);
+	ret = nl_socket_add_membership(sock, state->tpmeter_mcid);
 	if (ret) {
 		fprintf(stderr, "Failed to join batman-adv tpmeter multicast group: %d\n",
 			ret);
@@ -373,13 +326,43 @@ void tp_sig_handler(int sig)
 	case SIGINT:
 	case SIGTERM:
 		fflush(stdout);
-		tp_meter_stop(tp_mesh_iface, dst_mac);
+		tp_meter_stop(tp_state, dst_mac);
 		break;
 	default:
 		break;
 	}
 }
 
+static void tp_print_record(enum output_format format, const char *dst,
+			    const struct ether_addr *mac,
+			    const struct tp_result *result,
+			    uint64_t throughput)
+{
+	struct output out;
+
+	if (output_init(&out, STDOUT_FILENO, 512) < 0)
+		return;
+
+	output_set_format(&out, format, true);
+	output_record_begin(&out);
+	output_field_str(&out, "destination", dst);
+	output_field_mac(&out, "destination_address", mac->ether_addr_octet);
+	output_field_str(&out, "result",
+			 result->return_value == BATADV_TP_REASON_CANCEL ?
+			 "cancel" : "complete");
+	output_field_uint(&out, "test_time", result->test_time);
+	output_field_uint(&out, "total_bytes", result->total_bytes);
+
+	/* bytes per second */
+	if (throughput == UINT64_MAX)
+		output_field_none(&out, "throughput");
+	else
+		output_field_uint(&out, "throughput", throughput);
+
+	output_record_end(&out);
+	output_free(&out);
+}
+
 static void tp_meter_usage(void)
 {
 	fprintf(stderr, "Usage: batctl tp [parameters] <MAC>\n");
@@ -458,15 +441,21 @@ static int throughputmeter(struct state *state, int argc, char **argv)
 		dst_string = ether_ntoa_long(dst_mac);
 
 	/* for sighandler */
-	tp_mesh_iface = state->mesh_iface;
+	tp_state = state;
 	signal(SIGINT, tp_sig_handler);
 	signal(SIGTERM, tp_sig_handler);
 
-	listen_sock = tp_prepare_listening_sock();
+	if (!state->sock) {
+		fprintf(stderr, "Error - batman-adv netlink support is not available\n");
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
+
+	listen_sock = tp_prepare_listening_sock(state);
 	if (!listen_sock)
 		goto out;
 
-	ret = tp_meter_start(state->mesh_iface, dst_mac, time, &cookie);
+	ret = tp_meter_start(state, dst_mac, time, &cookie);
 	if (ret < 0) {
 		printf("Failed to send tp_meter request to kernel: %d\n", ret);
 		goto out;
@@ -499,7 +488,8 @@ static int throughputmeter(struct state *state, int argc, char **argv)
 		fprintf(stderr, "Too many ongoing sessions\n");
 		break;
 	case BATADV_TP_REASON_CANCEL:
-		printf("CANCEL received: test aborted\n");
+		if (state->output_format == OUTPUT_FORMAT_TEXT)
+			printf("CANCEL received: test aborted\n");
 		/* fall through */
 	case BATADV_TP_REASON_COMPLETE:
 		/* print the partial result */
@@ -510,6 +500,13 @@ static int throughputmeter(struct state *state, int argc, char **argv)
 			throughput = UINT64_MAX;
 		}
 
+		if (state->output_format != OUTPUT_FORMAT_TEXT) {
+			tp_print_record(state->output_format, dst_string,
+					dst_mac, &result, throughput);
+			ret = 0;
+			break;
+		}
+
 		printf("Test duration %ums.\n", result.test_time);
 		printf("Sent %" PRIu64 " Bytes.\n", result.total_bytes);
 		printf("Throughput: ");
@@ -543,5 +540,7 @@ static int throughputmeter(struct state *state, int argc, char **argv)
 	return ret;
 }
 
-COMMAND(SUBCOMMAND, throughputmeter, "tp", COMMAND_FLAG_MESH_IFACE, NULL,
+COMMAND(SUBCOMMAND, throughputmeter, "tp",
+	COMMAND_FLAG_MESH_IFACE | COMMAND_FLAG_NETLINK |
+	COMMAND_FLAG_OUTPUT_FORMAT, NULL,
 	"<destination>     \tstart a throughput measurement");
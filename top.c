@@ -0,0 +1,908 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <net/if.h>
+#include <netlink/netlink.h>
+#include <netlink/genl/genl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "batman_adv.h"
+#include "bat-hosts.h"
+#include "debug.h"
+#include "functions.h"
+#include "main.h"
+#include "netlink.h"
+#include "output.h"
+#include "sort.h"
+
+extern const struct command *__start___command[];
+extern const struct command *__stop___command[];
+
+#define TOP_MAX_TABLES 16
+#define TOP_MAX_KEYS 6
+
+/* fields which can be selected as sort key of a table */
+static const struct top_keys {
+	uint8_t nl_cmd;
+	const char *keys[TOP_MAX_KEYS];
+} top_keys[] = {
+	{ BATADV_CMD_GET_ORIGINATORS,
+	  { "orig", "age", "tq", "throughput", "neigh", "iface" } },
+	{ BATADV_CMD_GET_NEIGHBORS,
+	  { "neigh", "iface", "age", "throughput" } },
+	{ BATADV_CMD_GET_TRANSTABLE_GLOBAL,
+	  { "client", "orig", "vid", "tt_ttvn" } },
+	{ BATADV_CMD_GET_TRANSTABLE_LOCAL,
+	  { "client", "vid", "age" } },
+	{ BATADV_CMD_GET_GATEWAYS,
+	  { "orig", "tq", "throughput", "bandwidth_down", "bandwidth_up" } },
+	{ BATADV_CMD_GET_BLA_CLAIM,
+	  { "client", "vid", "bla_backbone" } },
+	{ BATADV_CMD_GET_BLA_BACKBONE,
+	  { "bla_backbone", "vid", "age" } },
+	{ BATADV_CMD_GET_DAT_CACHE,
+	  { "dat_cache_ip4address", "client", "vid", "age" } },
+	{ BATADV_CMD_GET_MCAST_FLAGS,
+	  { "orig", "mcast_flags" } },
+};
+
+struct top_table {
+	const struct command *cmd;
+	const struct top_keys *keys;
+};
+
+struct top_line {
+	size_t off;
+	size_t len;
+};
+
+struct top {
+	struct state *state;
+	int ifindex;
+	int read_opt;
+	float interval;
+
+	struct top_table tables[TOP_MAX_TABLES];
+	size_t num_tables;
+	size_t table;
+	struct netlink_table_probe probe;
+	struct nl_msg *msg;
+	char error[64];
+
+	/* messages of the last dump - kept to sort them again */
+	uint8_t *msgs;
+	size_t msgs_len;
+	size_t msgs_size;
+	size_t *msg_offs;
+	size_t num_msgs;
+	size_t msg_offs_size;
+
+	/* 0 keeps the order of the dump, otherwise index + 1 of the key */
+	size_t key;
+	bool descending;
+	struct sort *sort;
+
+	/* text of the table rendered by the table callback */
+	struct print_opts opts;
+	struct output header;
+	struct top_line *lines;
+	size_t num_lines;
+	size_t lines_size;
+	size_t scroll;
+
+	/* cells on the terminal and the cells of the next frame */
+	unsigned int rows;
+	unsigned int cols;
+	char *screen;
+	char *frame;
+	bool redraw;
+	struct output term;
+};
+
+static volatile sig_atomic_t top_stop;
+static volatile sig_atomic_t top_resized;
+static struct termios top_termios;
+static bool top_term_raw;
+
+static void top_usage(void)
+{
+	fprintf(stderr, "Usage: batctl [options] top [parameters] [table]\n");
+	fprintf(stderr, "parameters:\n");
+	fprintf(stderr, " \t -h print this help\n");
+	fprintf(stderr, " \t -n don't replace mac addresses with bat-host names\n");
+	fprintf(stderr, " \t -w interval - refresh the table every x.y seconds (default: 1)\n");
+	fprintf(stderr, "keys:\n");
+	fprintf(stderr, " \t q quit, j/k or arrows scroll, space/b page down/up, g/G first/last row\n");
+	fprintf(stderr, " \t s next sort key, r reverse the order, tab/p next/previous table, 1-9 select table\n");
+}
+
+static void top_sig_handler(int sig)
+{
+	switch (sig) {
+	case SIGWINCH:
+		top_resized = 1;
+		break;
+	default:
+		top_stop = 1;
+		break;
+	}
+}
+
+/* also called at exit() when a table callback gives up */
+static void top_term_restore(void)
+{
+	if (!top_term_raw)
+		return;
+
+	fputs("\033[?25h\033[?1049l", stdout);
+	fflush(stdout);
+
+	tcsetattr(STDIN_FILENO, TCSAFLUSH, &top_termios);
+	top_term_raw = false;
+}
+
+static int top_term_setup(void)
+{
+	struct termios raw;
+
+	if (tcgetattr(STDIN_FILENO, &top_termios) < 0)
+		return -errno;
+
+	raw = top_termios;
+	raw.c_lflag &= ~(ICANON | ECHO);
+	raw.c_cc[VMIN] = 0;
+	raw.c_cc[VTIME] = 0;
+
+	if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) < 0)
+		return -errno;
+
+	top_term_raw = true;
+	atexit(top_term_restore);
+
+	/* alternate screen without cursor */
+	fputs("\033[?1049h\033[?25l", stdout);
+	fflush(stdout);
+
+	return 0;
+}
+
+static int top_resize(struct top *top)
+{
+	struct winsize ws;
+	unsigned int rows = 24;
+	unsigned int cols = 80;
+	char *screen;
+	char *frame;
+
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row &&
+	    ws.ws_col) {
+		rows = ws.ws_row;
+		cols = ws.ws_col;
+	}
+
+	screen = realloc(top->screen, rows * cols);
+	if (!screen)
+		return -ENOMEM;
+
+	top->screen = screen;
+
+	frame = realloc(top->frame, rows * cols);
+	if (!frame)
+		return -ENOMEM;
+
+	top->frame = frame;
+	top->rows = rows;
+	top->cols = cols;
+	top->redraw = true;
+
+	return 0;
+}
+
+static void top_tables_init(struct top *top)
+{
+	const struct debug_table_data *debug_table;
+	const struct command **p;
+	struct top_table *table;
+
+	for (p = __start___command; p < __stop___command; p++) {
+		if ((*p)->type != DEBUGTABLE)
+			continue;
+
+		debug_table = (*p)->arg;
+		if (!debug_table || !debug_table->netlink_fn)
+			continue;
+
+		if (top->num_tables == TOP_MAX_TABLES)
+			break;
+
+		table = &top->tables[top->num_tables++];
+		table->cmd = *p;
+		table->keys = NULL;
+	}
+}
+
+static const char *top_key_name(struct top *top)
+{
+	const struct top_keys *keys = top->tables[top->table].keys;
+
+	if (!top->key || !keys)
+		return "none";
+
+	return keys->keys[top->key - 1];
+}
+
+static int top_sort_setup(struct top *top)
+{
+	char expr[64];
+
+	sort_free(top->sort);
+	top->sort = NULL;
+
+	if (!top->key)
+		return 0;
+
+	snprintf(expr, sizeof(expr), "%s%s", top->descending ? "-" : "",
+		 top_key_name(top));
+
+	top->sort = sort_compile(expr, 0);
+	if (!top->sort)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int top_store_msg(struct nlmsghdr *nlh, void *arg)
+{
+	size_t len = NLMSG_ALIGN(nlh->nlmsg_len);
+	struct top *top = arg;
+	size_t *msg_offs;
+	uint8_t *msgs;
+	size_t size;
+
+	if (top->msgs_len + len > top->msgs_size) {
+		size = top->msgs_size ? top->msgs_size : 64 * 1024;
+		while (size < top->msgs_len + len)
+			size *= 2;
+
+		msgs = realloc(top->msgs, size);
+		if (!msgs)
+			return NL_STOP;
+
+		top->msgs = msgs;
+		top->msgs_size = size;
+	}
+
+	if (top->num_msgs == top->msg_offs_size) {
+		size = top->msg_offs_size ? top->msg_offs_size * 2 : 256;
+
+		msg_offs = realloc(top->msg_offs, size * sizeof(*msg_offs));
+		if (!msg_offs)
+			return NL_STOP;
+
+		top->msg_offs = msg_offs;
+		top->msg_offs_size = size;
+	}
+
+	memcpy(top->msgs + top->msgs_len, nlh, nlh->nlmsg_len);
+	top->msg_offs[top->num_msgs++] = top->msgs_len;
+	top->msgs_len += len;
+
+	return NL_OK;
+}
+
+/* format the kept messages with the table callback and split the rows */
+static void top_render(struct top *top)
+{
+	struct top_line *lines;
+	struct nlmsghdr *nlh;
+	const char *buf;
+	size_t start;
+	size_t size;
+	size_t i;
+
+	output_reset(&top->opts.out);
+
+	top->opts.sort = top->sort;
+	top->opts.callback = top->probe.callback;
+
+	if (top->probe.callback) {
+		for (i = 0; i < top->num_msgs; i++) {
+			nlh = (struct nlmsghdr *)(top->msgs + top->msg_offs[i]);
+			top->probe.callback(nlh, &top->opts);
+		}
+
+		sort_flush(top->sort, top->probe.callback, &top->opts);
+	}
+
+	top->num_lines = 0;
+	buf = top->opts.out.buf;
+	start = 0;
+
+	for (i = 0; i < top->opts.out.len; i++) {
+		if (buf[i] != '\n')
+			continue;
+
+		if (top->num_lines == top->lines_size) {
+			size = top->lines_size ? top->lines_size * 2 : 256;
+
+			lines = realloc(top->lines, size * sizeof(*lines));
+			if (!lines)
+				break;
+
+			top->lines = lines;
+			top->lines_size = size;
+		}
+
+		top->lines[top->num_lines].off = start;
+		top->lines[top->num_lines].len = i - start;
+		top->num_lines++;
+
+		start = i + 1;
+	}
+}
+
+static void top_update(struct top *top)
+{
+	uint32_t seq;
+	int nl_err;
+	int ret;
+
+	if (!top->msg)
+		return;
+
+	output_reset(&top->header);
+	ret = netlink_get_info(top->state, top->ifindex, top->probe.nl_cmd,
+			       top->probe.header, &top->header);
+	if (ret < 0)
+		output_str(&top->header, top->probe.header);
+
+	top->msgs_len = 0;
+	top->num_msgs = 0;
+	top->error[0] = '\0';
+
+	nlmsg_hdr(top->msg)->nlmsg_seq = NL_AUTO_SEQ;
+	nl_send_auto_complete(top->state->sock, top->msg);
+	seq = nlmsg_hdr(top->msg)->nlmsg_seq;
+
+	ret = netlink_dump_recv(top->state->sock, top->state->dump_buf, seq,
+				top_store_msg, top, &nl_err);
+	if (ret == 0)
+		ret = nl_err;
+
+	if (ret < 0)
+		snprintf(top->error, sizeof(top->error), "%s", strerror(-ret));
+
+	top_render(top);
+}
+
+static void top_select(struct top *top, size_t table)
+{
+	const struct debug_table_data *debug_table;
+	size_t i;
+	int ret;
+
+	top->table = table;
+	top->key = 0;
+	top->descending = false;
+	top->scroll = 0;
+	top->num_msgs = 0;
+	top->error[0] = '\0';
+	output_reset(&top->header);
+
+	sort_free(top->sort);
+	top->sort = NULL;
+
+	if (top->msg) {
+		nlmsg_free(top->msg);
+		top->msg = NULL;
+	}
+
+	/* let the table tell how it is dumped */
+	top->probe.callback = NULL;
+	top->state->table_probe = &top->probe;
+
+	debug_table = top->tables[table].cmd->arg;
+	ret = debug_table->netlink_fn(top->state, NULL, top->read_opt, 0.0f,
+				      top->interval);
+
+	top->state->table_probe = NULL;
+
+	if (ret < 0 || !top->probe.callback) {
+		snprintf(top->error, sizeof(top->error), "table not available");
+		top->probe.callback = NULL;
+		top_render(top);
+		return;
+	}
+
+	top->tables[table].keys = NULL;
+	for (i = 0; i < ARRAY_SIZE(top_keys); i++) {
+		if (top_keys[i].nl_cmd == top->probe.nl_cmd)
+			top->tables[table].keys = &top_keys[i];
+	}
+
+	top->msg = nlmsg_alloc();
+	if (!top->msg) {
+		snprintf(top->error, sizeof(top->error), "%s",
+			 strerror(ENOMEM));
+		top_render(top);
+		return;
+	}
+
+	genlmsg_put(top->msg, NL_AUTO_PID, NL_AUTO_SEQ,
+		    top->state->batadv_family, 0, NLM_F_DUMP,
+		    top->probe.nl_cmd, 1);
+	nla_put_u32(top->msg, BATADV_ATTR_MESH_IFINDEX, top->ifindex);
+
+	top_update(top);
+}
+
+static unsigned int top_viewport(struct top *top)
+{
+	unsigned int header_lines = 0;
+	size_t i;
+
+	for (i = 0; i < top->header.len; i++) {
+		if (top->header.buf[i] == '\n')
+			header_lines++;
+	}
+
+	if (top->rows <= header_lines + 2)
+		return 1;
+
+	return top->rows - header_lines - 2;
+}
+
+/* copy a line into the frame - tabs are expanded, the rest is cleared */
+static void top_frame_line(struct top *top, unsigned int y, const char *str,
+			   size_t len)
+{
+	char *cells = top->frame + y * top->cols;
+	unsigned int x = 0;
+	size_t i;
+
+	for (i = 0; i < len && x < top->cols; i++) {
+		if (str[i] == '\t') {
+			do {
+				cells[x++] = ' ';
+			} while (x < top->cols && x % 8);
+			continue;
+		}
+
+		if ((unsigned char)str[i] < ' ')
+			continue;
+
+		cells[x++] = str[i];
+	}
+
+	memset(cells + x, ' ', top->cols - x);
+}
+
+static void top_compose(struct top *top)
+{
+	unsigned int viewport = top_viewport(top);
+	const char *header = top->header.buf;
+	size_t header_len = top->header.len;
+	const struct top_line *line;
+	unsigned int y = 0;
+	const char *eol;
+	char buf[256];
+	size_t last;
+	size_t i;
+
+	/* status line, table header, rows and the key help at the bottom */
+	if (top->num_lines <= viewport)
+		top->scroll = 0;
+	else if (top->scroll > top->num_lines - viewport)
+		top->scroll = top->num_lines - viewport;
+
+	last = top->scroll + viewport;
+	if (last > top->num_lines)
+		last = top->num_lines;
+
+	snprintf(buf, sizeof(buf),
+		 " %s (%zu/%zu)  sort: %s%s  rows %zu-%zu/%zu  every %.1fs  %s",
+		 top->tables[top->table].cmd->name, top->table + 1,
+		 top->num_tables, top_key_name(top),
+		 top->key && top->descending ? " (desc)" : "",
+		 top->num_lines ? top->scroll + 1 : 0, last, top->num_lines,
+		 top->interval, top->error);
+	top_frame_line(top, y++, buf, strlen(buf));
+
+	while (header_len && y < top->rows) {
+		eol = memchr(header, '\n', header_len);
+		if (!eol)
+			break;
+
+		top_frame_line(top, y++, header, eol - header);
+		header_len -= eol - header + 1;
+		header = eol + 1;
+	}
+
+	for (i = top->scroll; i < last && y < top->rows - 1; i++) {
+		line = &top->lines[i];
+		top_frame_line(top, y++, top->opts.out.buf + line->off,
+			       line->len);
+	}
+
+	while (y < top->rows - 1)
+		top_frame_line(top, y++, "", 0);
+
+	snprintf(buf, sizeof(buf),
+		 " q:quit  j/k:scroll  space/b:page  s:sort  r:reverse  tab/p:table  1-9:select");
+	if (y < top->rows)
+		top_frame_line(top, y, buf, strlen(buf));
+}
+
+/* only the changed part of each line is written to the terminal */
+static void top_draw(struct top *top)
+{
+	const char *old;
+	const char *new;
+	unsigned int first;
+	unsigned int last;
+	unsigned int y;
+
+	top_compose(top);
+
+	if (top->redraw) {
+		output_str(&top->term, "\033[2J");
+		memset(top->screen, ' ', top->rows * top->cols);
+		top->redraw = false;
+	}
+
+	for (y = 0; y < top->rows; y++) {
+		old = top->screen + y * top->cols;
+		new = top->frame + y * top->cols;
+
+		for (first = 0; first < top->cols; first++) {
+			if (old[first] != new[first])
+				break;
+		}
+
+		if (first == top->cols)
+			continue;
+
+		for (last = top->cols - 1; last > first; last--) {
+			if (old[last] != new[last])
+				break;
+		}
+
+		output_printf(&top->term, "\033[%u;%uH", y + 1, first + 1);
+		output_mem(&top->term, new + first, last - first + 1);
+	}
+
+	memcpy(top->screen, top->frame, top->rows * top->cols);
+	output_flush(&top->term);
+}
+
+static void top_scroll(struct top *top, long long lines)
+{
+	long long scroll = top->scroll + lines;
+
+	if (scroll < 0)
+		scroll = 0;
+
+	/* clamped to the last page by top_compose() */
+	top->scroll = scroll;
+}
+
+static void top_next_key(struct top *top)
+{
+	const struct top_keys *keys = top->tables[top->table].keys;
+
+	if (!keys)
+		return;
+
+	top->key++;
+	if (top->key > TOP_MAX_KEYS || !keys->keys[top->key - 1])
+		top->key = 0;
+
+	if (top_sort_setup(top) < 0)
+		top->key = 0;
+
+	/* sorted again from the kept messages - no new dump */
+	top_render(top);
+}
+
+static void top_handle_keys(struct top *top, const char *buf, size_t len)
+{
+	size_t viewport = top_viewport(top);
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		/* escape sequences of the cursor keys */
+		if (buf[i] == '\033' && i + 2 < len && buf[i + 1] == '[') {
+			i += 2;
+
+			switch (buf[i]) {
+			case 'A':
+				top_scroll(top, -1);
+				break;
+			case 'B':
+				top_scroll(top, 1);
+				break;
+			case 'H':
+				top->scroll = 0;
+				break;
+			case 'F':
+				top->scroll = top->num_lines;
+				break;
+			case '5':
+				top_scroll(top, -(long long)viewport);
+				break;
+			case '6':
+				top_scroll(top, viewport);
+				break;
+			}
+
+			/* skip the rest of the sequence */
+			while (i + 1 < len && buf[i] >= '0' && buf[i] <= '9')
+				i++;
+
+			continue;
+		}
+
+		switch (buf[i]) {
+		case 'q':
+		case 'Q':
+			top_stop = 1;
+			return;
+		case 'j':
+			top_scroll(top, 1);
+			break;
+		case 'k':
+			top_scroll(top, -1);
+			break;
+		case ' ':
+			top_scroll(top, viewport);
+			break;
+		case 'b':
+			top_scroll(top, -(long long)viewport);
+			break;
+		case 'g':
+			top->scroll = 0;
+			break;
+		case 'G':
+			top->scroll = top->num_lines;
+			break;
+		case 's':
+			top_next_key(top);
+			break;
+		case 'r':
+			top->descending = !top->descending;
+			if (top_sort_setup(top) < 0)
+				top->key = 0;
+
+			top_render(top);
+			break;
+		case '\t':
+			top_select(top, (top->table + 1) % top->num_tables);
+			break;
+		case 'p':
+			top_select(top, (top->table + top->num_tables - 1) %
+					top->num_tables);
+			break;
+		case '\f':
+			top->redraw = true;
+			break;
+		default:
+			if (buf[i] >= '1' && buf[i] <= '9' &&
+			    (size_t)(buf[i] - '1') < top->num_tables)
+				top_select(top, buf[i] - '1');
+			break;
+		}
+	}
+}
+
+static double top_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static void top_run(struct top *top)
+{
+	struct pollfd pfd = {
+		.fd = STDIN_FILENO,
+		.events = POLLIN,
+	};
+	double next;
+	double now;
+	char buf[32];
+	ssize_t len;
+	int timeout;
+	int ret;
+
+	next = top_now() + top->interval;
+
+	while (!top_stop) {
+		if (top_resized) {
+			top_resized = 0;
+			if (top_resize(top) < 0)
+				break;
+		}
+
+		top_draw(top);
+
+		now = top_now();
+		if (now >= next) {
+			top_update(top);
+			next = now + top->interval;
+			continue;
+		}
+
+		timeout = (next - now) * 1000 + 1;
+
+		ret = poll(&pfd, 1, timeout);
+		if (ret <= 0)
+			continue;
+
+		len = read(STDIN_FILENO, buf, sizeof(buf));
+		if (len > 0)
+			top_handle_keys(top, buf, len);
+	}
+}
+
+static void top_free(struct top *top)
+{
+	if (top->msg)
+		nlmsg_free(top->msg);
+
+	sort_free(top->sort);
+	free(top->probe.header);
+	free(top->msgs);
+	free(top->msg_offs);
+	free(top->lines);
+	free(top->screen);
+	free(top->frame);
+	output_free(&top->opts.out);
+	output_free(&top->header);
+	output_free(&top->term);
+}
+
+static int top(struct state *state, int argc, char **argv)
+{
+	struct top top = {
+		.state = state,
+		.read_opt = USE_BAT_HOSTS,
+		.interval = 1.0f,
+	};
+	const struct command *cmd;
+	size_t start = 0;
+	int optchar;
+	size_t i;
+	int ret;
+
+	while ((optchar = getopt(argc, argv, "hnw:")) != -1) {
+		switch (optchar) {
+		case 'h':
+			top_usage();
+			return EXIT_SUCCESS;
+		case 'n':
+			top.read_opt &= ~USE_BAT_HOSTS;
+			break;
+		case 'w':
+			if (!sscanf(optarg, "%f", &top.interval) ||
+			    top.interval <= 0.0f) {
+				fprintf(stderr, "Error - provided argument of '-%c' is not a positive number\n",
+					optchar);
+				return EXIT_FAILURE;
+			}
+			break;
+		default:
+			top_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	check_root_or_die("batctl top");
+
+	if (!state->sock) {
+		fprintf(stderr, "Error - batman-adv netlink interface is not available\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
+		fprintf(stderr, "Error - batctl top needs a terminal\n");
+		return EXIT_FAILURE;
+	}
+
+	top.ifindex = if_nametoindex(state->mesh_iface);
+	if (!top.ifindex) {
+		fprintf(stderr, "Interface %s is unknown\n", state->mesh_iface);
+		return EXIT_FAILURE;
+	}
+
+	top_tables_init(&top);
+	if (!top.num_tables) {
+		fprintf(stderr, "Error - no debug table is available\n");
+		return EXIT_FAILURE;
+	}
+
+	if (optind < argc) {
+		for (i = 0; i < top.num_tables; i++) {
+			cmd = top.tables[i].cmd;
+
+			if (strcmp(cmd->name, argv[optind]) == 0 ||
+			    strcmp(cmd->abbr, argv[optind]) == 0)
+				break;
+		}
+
+		if (i == top.num_tables) {
+			fprintf(stderr, "Error - unknown debug table: %s\n",
+				argv[optind]);
+			return EXIT_FAILURE;
+		}
+
+		start = i;
+	}
+
+	if (output_init(&top.opts.out, -1, 64 * 1024) < 0 ||
+	    output_init(&top.header, -1, 512) < 0 ||
+	    output_init(&top.term, STDOUT_FILENO, OUTPUT_BUF_SIZE) < 0) {
+		fprintf(stderr, "Error - could not allocate output buffers\n");
+		ret = EXIT_FAILURE;
+		goto out;
+	}
+
+	top.opts.read_opt = top.read_opt;
+	top.opts.watch_interval = top.interval;
+
+	if (top_resize(&top) < 0 || top_term_setup() < 0) {
+		fprintf(stderr, "Error - could not set up the terminal\n");
+		ret = EXIT_FAILURE;
+		goto out;
+	}
+
+	signal(SIGINT, top_sig_handler);
+	signal(SIGTERM, top_sig_handler);
+	signal(SIGWINCH, top_sig_handler);
+
+	bat_hosts_init(top.read_opt);
+
+	top_select(&top, start);
+	top_run(&top);
+
+	bat_hosts_free();
+	top_term_restore();
+	ret = EXIT_SUCCESS;
+
+out:
+	top_free(&top);
+	return ret;
+}
+
+COMMAND(SUBCOMMAND, top, "top", COMMAND_FLAG_MESH_IFACE | COMMAND_FLAG_NETLINK,
+	NULL, "                  \tinteractive view of the debug tables");
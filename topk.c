@@ -0,0 +1,271 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "topk.h"
+
+/* Space-Saving summary: a fixed number of counters which always holds the
+ * heaviest keys. A new key replaces the smallest counter and inherits its
+ * count as error, so a key which is heavier than total / capacity is never
+ * lost.
+ */
+
+struct topk_entry {
+	uint8_t key[TOPK_KEY_LEN];
+	uint64_t count;
+	uint64_t error;
+	int next;		/* next entry in the same bucket */
+	unsigned int pos;	/* position in the heap */
+};
+
+struct topk {
+	struct topk_entry *entries;
+	unsigned int *heap;	/* entries ordered by their smallest count */
+	int *buckets;
+	struct topk_item *sorted;	/* buffer of topk_list() */
+	unsigned int num_buckets;
+	unsigned int capacity;
+	unsigned int num;
+};
+
+static int *topk_bucket(struct topk *topk, const uint8_t *key)
+{
+	return &topk->buckets[hash_bytes(key, TOPK_KEY_LEN) &
+			      (topk->num_buckets - 1)];
+}
+
+static void topk_unlink(struct topk *topk, int idx)
+{
+	int *link = topk_bucket(topk, topk->entries[idx].key);
+
+	while (*link != idx)
+		link = &topk->entries[*link].next;
+
+	*link = topk->entries[idx].next;
+}
+
+static void topk_link(struct topk *topk, int idx)
+{
+	int *bucket = topk_bucket(topk, topk->entries[idx].key);
+
+	topk->entries[idx].next = *bucket;
+	*bucket = idx;
+}
+
+static void topk_heap_set(struct topk *topk, unsigned int pos, unsigned int idx)
+{
+	topk->heap[pos] = idx;
+	topk->entries[idx].pos = pos;
+}
+
+static uint64_t topk_heap_count(struct topk *topk, unsigned int pos)
+{
+	return topk->entries[topk->heap[pos]].count;
+}
+
+static void topk_sift_up(struct topk *topk, unsigned int pos)
+{
+	unsigned int idx = topk->heap[pos];
+	unsigned int parent;
+
+	while (pos > 0) {
+		parent = (pos - 1) / 2;
+		if (topk_heap_count(topk, parent) <= topk->entries[idx].count)
+			break;
+
+		topk_heap_set(topk, pos, topk->heap[parent]);
+		pos = parent;
+	}
+
+	topk_heap_set(topk, pos, idx);
+}
+
+static void topk_sift_down(struct topk *topk, unsigned int pos)
+{
+	unsigned int idx = topk->heap[pos];
+	unsigned int child;
+
+	while (1) {
+		child = 2 * pos + 1;
+		if (child >= topk->num)
+			break;
+
+		if (child + 1 < topk->num &&
+		    topk_heap_count(topk, child + 1) < topk_heap_count(topk, child))
+			child++;
+
+		if (topk->entries[idx].count <= topk_heap_count(topk, child))
+			break;
+
+		topk_heap_set(topk, pos, topk->heap[child]);
+		pos = child;
+	}
+
+	topk_heap_set(topk, pos, idx);
+}
+
+/**
+ * topk_new - allocate a summary of the heaviest keys
+ * @capacity: number of counters
+ *
+ * Return: summary or NULL when out of memory
+ */
+struct topk *topk_new(unsigned int capacity)
+{
+	struct topk *topk;
+
+	topk = calloc(1, sizeof(*topk));
+	if (!topk)
+		return NULL;
+
+	topk->capacity = capacity;
+	topk->num_buckets = 1;
+	while (topk->num_buckets < capacity)
+		topk->num_buckets <<= 1;
+
+	topk->entries = calloc(capacity, sizeof(*topk->entries));
+	topk->heap = calloc(capacity, sizeof(*topk->heap));
+	topk->buckets = calloc(topk->num_buckets, sizeof(*topk->buckets));
+	topk->sorted = calloc(capacity, sizeof(*topk->sorted));
+	if (!topk->entries || !topk->heap || !topk->buckets || !topk->sorted) {
+		topk_free(topk);
+		return NULL;
+	}
+
+	topk_reset(topk);
+
+	return topk;
+}
+
+void topk_free(struct topk *topk)
+{
+	if (!topk)
+		return;
+
+	free(topk->sorted);
+	free(topk->buckets);
+	free(topk->heap);
+	free(topk->entries);
+	free(topk);
+}
+
+/* forget all keys */
+void topk_reset(struct topk *topk)
+{
+	unsigned int i;
+
+	for (i = 0; i < topk->num_buckets; i++)
+		topk->buckets[i] = -1;
+
+	topk->num = 0;
+}
+
+/**
+ * topk_add - count a key
+ * @topk: summary
+ * @key: key of TOPK_KEY_LEN bytes
+ * @weight: amount which is added to the count of the key
+ */
+void topk_add(struct topk *topk, const uint8_t *key, uint64_t weight)
+{
+	struct topk_entry *entry;
+	int idx;
+
+	for (idx = *topk_bucket(topk, key); idx >= 0; idx = entry->next) {
+		entry = &topk->entries[idx];
+		if (memcmp(entry->key, key, TOPK_KEY_LEN) != 0)
+			continue;
+
+		entry->count += weight;
+		topk_sift_down(topk, entry->pos);
+		return;
+	}
+
+	if (topk->num < topk->capacity) {
+		idx = topk->num++;
+		entry = &topk->entries[idx];
+		memcpy(entry->key, key, TOPK_KEY_LEN);
+		entry->count = weight;
+		entry->error = 0;
+		topk_link(topk, idx);
+
+		topk_heap_set(topk, idx, idx);
+		topk_sift_up(topk, idx);
+		return;
+	}
+
+	/* take over the smallest counter */
+	idx = topk->heap[0];
+	entry = &topk->entries[idx];
+	topk_unlink(topk, idx);
+
+	memcpy(entry->key, key, TOPK_KEY_LEN);
+	entry->error = entry->count;
+	entry->count += weight;
+	topk_link(topk, idx);
+
+	topk_sift_down(topk, 0);
+}
+
+static int topk_item_cmp(const void *a, const void *b)
+{
+	const struct topk_item *item_a = a;
+	const struct topk_item *item_b = b;
+
+	if (item_a->count != item_b->count)
+		return item_a->count < item_b->count ? 1 : -1;
+
+	return memcmp(item_a->key, item_b->key, TOPK_KEY_LEN);
+}
+
+/**
+ * topk_list - get the heaviest keys
+ * @topk: summary
+ * @items: buffer for the keys
+ * @num: size of the buffer
+ *
+ * The keys point into the summary and are only valid until the next
+ * topk_add() or topk_reset().
+ *
+ * Return: number of keys which were stored in @items (heaviest first)
+ */
+size_t topk_list(struct topk *topk, struct topk_item *items, size_t num)
+{
+	struct topk_item *all = topk->sorted;
+	unsigned int i;
+
+	if (num > topk->num)
+		num = topk->num;
+
+	for (i = 0; i < topk->num; i++) {
+		all[i].key = topk->entries[i].key;
+		all[i].count = topk->entries[i].count;
+		all[i].error = topk->entries[i].error;
+	}
+
+	qsort(all, topk->num, sizeof(*all), topk_item_cmp);
+	memcpy(items, all, num * sizeof(*items));
+
+	return num;
+}
@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2019  B.A.T.M.A.N. contributors:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ *
+ * License-Filename: LICENSES/preferred/GPL-2.0
+ */
+
+#ifndef _BATCTL_TOPK_H
+#define _BATCTL_TOPK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* size of the keys - a pair of MAC addresses */
+#define TOPK_KEY_LEN 12
+
+struct topk;
+
+/* counted key - the real count is between count - error and count */
+struct topk_item {
+	const uint8_t *key;
+	uint64_t count;
+	uint64_t error;
+};
+
+struct topk *topk_new(unsigned int capacity);
+void topk_free(struct topk *topk);
+void topk_add(struct topk *topk, const uint8_t *key, uint64_t weight);
+size_t topk_list(struct topk *topk, struct topk_item *items, size_t num);
+void topk_reset(struct topk *topk);
+
+#endif
@@ -21,6 +21,7 @@
  * License-Filename: LICENSES/preferred/GPL-2.0
  */
 
+#include <errno.h>
 #include <netinet/if_ether.h>
 #include <netlink/netlink.h>
 #include <netlink/genl/genl.h>
@@ -33,35 +34,71 @@
 #include "batman_adv.h"
 #include "bat-hosts.h"
 #include "debug.h"
+#include "filter.h"
 #include "functions.h"
+#include "group.h"
 #include "main.h"
 #include "netlink.h"
+#include "sort.h"
 
-static const int transglobal_mandatory[] = {
-	BATADV_ATTR_TT_ADDRESS,
-	BATADV_ATTR_ORIG_ADDRESS,
-	BATADV_ATTR_TT_VID,
-	BATADV_ATTR_TT_TTVN,
-	BATADV_ATTR_TT_LAST_TTVN,
-	BATADV_ATTR_TT_CRC32,
-	BATADV_ATTR_TT_FLAGS,
+struct transglobal_row {
+	const uint8_t *addr;
+	const uint8_t *orig;
+	uint8_t ttvn;
+	uint8_t last_ttvn;
+	uint32_t crc32;
+	uint16_t vid;
+	uint32_t flags;
+	bool best;
 };
 
-static int transglobal_callback(struct nl_msg *msg, void *arg)
+static const struct netlink_attr_desc transglobal_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_TT_ADDRESS, MAC,
+			 struct transglobal_row, addr),
+	NETLINK_ATTR_REQ(BATADV_ATTR_ORIG_ADDRESS, MAC,
+			 struct transglobal_row, orig),
+	NETLINK_ATTR_REQ(BATADV_ATTR_TT_TTVN, U8,
+			 struct transglobal_row, ttvn),
+	NETLINK_ATTR_REQ(BATADV_ATTR_TT_LAST_TTVN, U8,
+			 struct transglobal_row, last_ttvn),
+	NETLINK_ATTR_REQ(BATADV_ATTR_TT_CRC32, U32,
+			 struct transglobal_row, crc32),
+	NETLINK_ATTR_REQ(BATADV_ATTR_TT_VID, U16,
+			 struct transglobal_row, vid),
+	NETLINK_ATTR_REQ(BATADV_ATTR_TT_FLAGS, U32,
+			 struct transglobal_row, flags),
+	NETLINK_ATTR_OPT(BATADV_ATTR_FLAG_BEST, FLAG,
+			 struct transglobal_row, best),
+};
+
+static int transglobal_callback(struct nlmsghdr *nlh, void *arg)
 {
-	struct nlattr *attrs[BATADV_ATTR_MAX+1];
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct transglobal_row row;
+	netlink_attr_mask_t present;
 	struct print_opts *opts = arg;
-	struct bat_host *bat_host;
 	struct genlmsghdr *ghdr;
 	char c, r, w, i, t;
+	const uint8_t *addr;
+	const uint8_t *orig;
 	uint8_t last_ttvn;
 	uint32_t crc32;
 	uint32_t flags;
-	uint8_t *addr;
-	uint8_t *orig;
 	uint8_t ttvn;
 	int16_t vid;
+	int ret;
+	struct {
+		uint8_t client[ETH_ALEN];
+		uint8_t orig[ETH_ALEN];
+		int16_t vid;
+	} key;
+	struct {
+		uint32_t flags;
+		uint32_t crc32;
+		uint8_t ttvn;
+		uint8_t last_ttvn;
+		uint8_t best;
+	} value;
+	struct output *out;
 
 	if (!genlmsg_valid_hdr(nlh, 0)) {
 		fputs("Received invalid data from kernel.\n", stderr);
@@ -73,25 +110,28 @@ static int transglobal_callback(struct nl_msg *msg, void *arg)
 	if (ghdr->cmd != BATADV_CMD_GET_TRANSTABLE_GLOBAL)
 		return NL_OK;
 
-	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
-		      genlmsg_len(ghdr), batadv_netlink_policy)) {
+	ret = netlink_decode_attrs(ghdr, transglobal_attrs,
+				   ARRAY_SIZE(transglobal_attrs),
+				   &row, sizeof(row), &present);
+	if (ret == -ENOENT) {
+		fputs("Missing attributes from kernel\n", stderr);
+		exit(1);
+	} else if (ret < 0) {
 		fputs("Received invalid data from kernel.\n", stderr);
 		exit(1);
 	}
 
-	if (missing_mandatory_attrs(attrs, transglobal_mandatory,
-				    ARRAY_SIZE(transglobal_mandatory))) {
-		fputs("Missing attributes from kernel\n", stderr);
-		exit(1);
-	}
+	if (!filter_match(opts->filter, transglobal_attrs,
+			  ARRAY_SIZE(transglobal_attrs), &row, present))
+		return NL_OK;
 
-	addr = nla_data(attrs[BATADV_ATTR_TT_ADDRESS]);
-	orig = nla_data(attrs[BATADV_ATTR_ORIG_ADDRESS]);
-	vid = nla_get_u16(attrs[BATADV_ATTR_TT_VID]);
-	ttvn = nla_get_u8(attrs[BATADV_ATTR_TT_TTVN]);
-	last_ttvn = nla_get_u8(attrs[BATADV_ATTR_TT_LAST_TTVN]);
-	crc32 = nla_get_u32(attrs[BATADV_ATTR_TT_CRC32]);
-	flags = nla_get_u32(attrs[BATADV_ATTR_TT_FLAGS]);
+	addr = row.addr;
+	orig = row.orig;
+	vid = row.vid;
+	ttvn = row.ttvn;
+	last_ttvn = row.last_ttvn;
+	crc32 = row.crc32;
+	flags = row.flags;
 
 	if (opts->read_opt & MULTICAST_ONLY && !(addr[0] & 0x01))
 		return NL_OK;
@@ -100,7 +140,7 @@ static int transglobal_callback(struct nl_msg *msg, void *arg)
 		return NL_OK;
 
 	c = ' ', r = '.', w = '.', i = '.', t = '.';
-	if (attrs[BATADV_ATTR_FLAG_BEST])
+	if (row.best)
 		c = '*';
 	if (flags & BATADV_TT_CLIENT_ROAM)
 		r = 'R';
@@ -111,29 +151,56 @@ static int transglobal_callback(struct nl_msg *msg, void *arg)
 	if (flags & BATADV_TT_CLIENT_TEMP)
 		t = 'T';
 
-	printf(" %c ", c);
-
-	bat_host = bat_hosts_find_by_mac((char *)addr);
-	if (!(opts->read_opt & USE_BAT_HOSTS) || !bat_host)
-		printf("%02x:%02x:%02x:%02x:%02x:%02x ",
-		       addr[0], addr[1], addr[2],
-		       addr[3], addr[4], addr[5]);
-	else
-		printf("%17s ", bat_host->name);
+	if (group_add(opts->group, transglobal_attrs,
+		      ARRAY_SIZE(transglobal_attrs), &row, present))
+		return NL_OK;
 
-	printf("%4i [%c%c%c%c] (%3u) ",
-	       BATADV_PRINT_VID(vid), r, w, i, t, ttvn);
+	if (sort_add(opts->sort, nlh, transglobal_attrs,
+		     ARRAY_SIZE(transglobal_attrs), &row, present))
+		return NL_OK;
 
-	bat_host = bat_hosts_find_by_mac((char *)orig);
-	if (!(opts->read_opt & USE_BAT_HOSTS) || !bat_host)
-		printf("%02x:%02x:%02x:%02x:%02x:%02x ",
-		       orig[0], orig[1], orig[2],
-		       orig[3], orig[4], orig[5]);
-	else
-		printf("%17s ", bat_host->name);
+	if (opts->out.format != OUTPUT_FORMAT_TEXT) {
+		netlink_print_record(opts, transglobal_attrs,
+				     ARRAY_SIZE(transglobal_attrs), &row, present);
+		return NL_OK;
+	}
 
-	printf("(%3u) (0x%.8x)\n",
-	       last_ttvn, crc32);
+	out = netlink_row_begin(opts);
+
+	output_char(out, ' ');
+	output_char(out, c);
+	output_char(out, ' ');
+	output_host(out, addr, opts->read_opt);
+	output_char(out, ' ');
+	output_int(out, BATADV_PRINT_VID(vid), 4);
+	output_str(out, " [");
+	output_char(out, r);
+	output_char(out, w);
+	output_char(out, i);
+	output_char(out, t);
+	output_str(out, "] (");
+	output_uint(out, ttvn, 3);
+	output_str(out, ") ");
+	output_host(out, orig, opts->read_opt);
+	output_str(out, " (");
+	output_uint(out, last_ttvn, 3);
+	output_str(out, ") (0x");
+	output_hex(out, crc32, 8);
+	output_str(out, ")\n");
+
+	memset(&key, 0, sizeof(key));
+	memcpy(key.client, addr, ETH_ALEN);
+	memcpy(key.orig, orig, ETH_ALEN);
+	key.vid = vid;
+
+	memset(&value, 0, sizeof(value));
+	value.flags = flags;
+	value.crc32 = crc32;
+	value.ttvn = ttvn;
+	value.last_ttvn = last_ttvn;
+	value.best = row.best;
+
+	netlink_row_end(opts, &key, sizeof(key), &value, sizeof(value));
 
 	return NL_OK;
 }
@@ -153,6 +220,8 @@ static struct debug_table_data batctl_debug_table_transglobal = {
 	.debugfs_name = "transtable_global",
 	.header_lines = 2,
 	.netlink_fn = netlink_print_transglobal,
+	.nl_cmd = BATADV_CMD_GET_TRANSTABLE_GLOBAL,
+	.netlink_cb = transglobal_callback,
 	.option_unicast_only = 1,
 	.option_multicast_only = 1,
 };
@@ -20,35 +20,52 @@
  * License-Filename: LICENSES/preferred/GPL-2.0
  */
 
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/ether.h>
+#include <netinet/in.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include "main.h"
 #include "functions.h"
 #include "bat-hosts.h"
+#include "list.h"
 
 
+enum translate_input_state {
+	TRANSLATE_INPUT_MAC,
+	TRANSLATE_INPUT_IPV4,
+	TRANSLATE_INPUT_UNRESOLVED,
+};
+
+struct translate_input {
+	struct list_head list;
+	char *name;
+	enum translate_input_state state;
+	struct ether_addr mac;
+	struct in_addr ipv4;
+};
+
 static void translate_usage(void)
 {
-	fprintf(stderr, "Usage: batctl [options] translate mac|bat-host|host_name|IPv4_address\n");
+	fprintf(stderr, "Usage: batctl [options] translate [parameters] mac|bat-host|host_name|IPv4_address|-\n");
+	fprintf(stderr, "parameters:\n");
+	fprintf(stderr, " \t -f read destinations from file ('-' for stdin)\n");
+	fprintf(stderr, " \t -h print this help\n");
 }
 
-static int translate(struct state *state, int argc, char **argv)
+static int translate_single(struct state *state, char *dst_string)
 {
 	struct ether_addr *dst_mac = NULL;
 	struct bat_host *bat_host;
 	int ret = EXIT_FAILURE;
-	char *dst_string, *mac_string;
+	char *mac_string;
 
-	if (argc <= 1) {
-		fprintf(stderr, "Error - destination not specified\n");
-		translate_usage();
-		return EXIT_FAILURE;
-	}
-
-	check_root_or_die("batctl translate");
-
-	dst_string = argv[1];
 	bat_hosts_init(0);
 	bat_host = bat_hosts_find_by_name(dst_string);
 
@@ -64,7 +81,7 @@ static int translate(struct state *state, int argc, char **argv)
 		}
 	}
 
-	dst_mac = translate_mac(state->mesh_iface, dst_mac);
+	dst_mac = translate_mac(state, dst_mac);
 	if (dst_mac) {
 		mac_string = ether_ntoa_long(dst_mac);
 		printf("%s\n", mac_string);
@@ -78,5 +95,205 @@ static int translate(struct state *state, int argc, char **argv)
 	return ret;
 }
 
-COMMAND(SUBCOMMAND, translate, "t", COMMAND_FLAG_MESH_IFACE, NULL,
+static int translate_input_add(struct list_head *inputs, const char *name,
+			       unsigned int *num_ipv4)
+{
+	struct translate_input *input;
+	struct ether_addr *mac = NULL;
+	struct bat_host *bat_host;
+
+	input = malloc(sizeof(*input));
+	if (!input)
+		return -ENOMEM;
+
+	input->name = strdup(name);
+	if (!input->name) {
+		free(input);
+		return -ENOMEM;
+	}
+
+	input->state = TRANSLATE_INPUT_MAC;
+
+	bat_host = bat_hosts_find_by_name(input->name);
+	if (bat_host)
+		mac = &bat_host->mac_addr;
+
+	if (!mac)
+		mac = ether_aton(input->name);
+
+	/* IPv4 addresses are resolved together with one neighbor dump */
+	if (!mac && inet_pton(AF_INET, input->name, &input->ipv4) == 1)
+		input->state = TRANSLATE_INPUT_IPV4;
+	else if (!mac)
+		mac = resolve_mac(input->name);
+
+	if (mac)
+		memcpy(&input->mac, mac, sizeof(input->mac));
+	else if (input->state == TRANSLATE_INPUT_IPV4)
+		(*num_ipv4)++;
+	else
+		input->state = TRANSLATE_INPUT_UNRESOLVED;
+
+	list_add_tail(&input->list, inputs);
+
+	return 0;
+}
+
+static int translate_read_inputs(struct list_head *inputs, FILE *f,
+				 unsigned int *num_ipv4)
+{
+	char *line = NULL;
+	size_t len = 0;
+	char *saveptr;
+	char *name;
+	int ret = 0;
+
+	while (getline(&line, &len, f) != -1) {
+		name = strtok_r(line, " \t\r\n", &saveptr);
+		if (!name || name[0] == '#')
+			continue;
+
+		ret = translate_input_add(inputs, name, num_ipv4);
+		if (ret < 0)
+			break;
+	}
+
+	free(line);
+
+	return ret;
+}
+
+static unsigned int translate_resolve_ipv4(struct list_head *inputs)
+{
+	struct hashtable_t *neigh_cache;
+	struct translate_input *input;
+	unsigned int missing = 0;
+	struct ether_addr *mac;
+
+	neigh_cache = neigh_cache_dump(AF_INET);
+
+	list_for_each_entry(input, inputs, list) {
+		if (input->state != TRANSLATE_INPUT_IPV4)
+			continue;
+
+		mac = neigh_cache_find(neigh_cache, &input->ipv4,
+				       sizeof(input->ipv4));
+		if (mac) {
+			memcpy(&input->mac, mac, sizeof(input->mac));
+			input->state = TRANSLATE_INPUT_MAC;
+			continue;
+		}
+
+		request_mac_resolve(AF_INET, &input->ipv4);
+		missing++;
+	}
+
+	neigh_cache_free(neigh_cache);
+
+	return missing;
+}
+
+static int translate_batch(struct state *state, const char *path)
+{
+	struct translate_input *input, *input_safe;
+	unsigned int num_ipv4 = 0;
+	struct ether_addr *orig;
+	int ret = EXIT_SUCCESS;
+	char *mac_string;
+	LIST_HEAD(inputs);
+	FILE *f;
+
+	if (strcmp(path, "-") == 0) {
+		f = stdin;
+	} else {
+		f = fopen(path, "r");
+		if (!f) {
+			fprintf(stderr, "Error - can't open file '%s': %s\n",
+				path, strerror(errno));
+			return EXIT_FAILURE;
+		}
+	}
+
+	bat_hosts_init(0);
+
+	if (translate_read_inputs(&inputs, f, &num_ipv4) < 0) {
+		fprintf(stderr, "Error - could not allocate memory\n");
+		ret = EXIT_FAILURE;
+		goto out;
+	}
+
+	/* give the kernel a single chance to resolve all missing neighbors */
+	if (num_ipv4 && translate_resolve_ipv4(&inputs) > 0) {
+		usleep(200000);
+		translate_resolve_ipv4(&inputs);
+	}
+
+	/* the first TT dump is used for all inputs */
+	state->snapshot_max_age = -1;
+
+	list_for_each_entry(input, &inputs, list) {
+		if (input->state != TRANSLATE_INPUT_MAC) {
+			fprintf(stderr, "Error - mac address of the destination could not be resolved and is not a bat-host name: %s\n",
+				input->name);
+			ret = EXIT_NOSUCCESS;
+			continue;
+		}
+
+		orig = translate_mac(state, &input->mac);
+		mac_string = ether_ntoa_long(orig);
+		printf("%s %s\n", input->name, mac_string);
+	}
+
+out:
+	list_for_each_entry_safe(input, input_safe, &inputs, list) {
+		list_del(&input->list);
+		free(input->name);
+		free(input);
+	}
+
+	bat_hosts_free();
+
+	if (f != stdin)
+		fclose(f);
+
+	return ret;
+}
+
+static int translate(struct state *state, int argc, char **argv)
+{
+	char *path = NULL;
+	int optchar;
+
+	while ((optchar = getopt(argc, argv, "f:h")) != -1) {
+		switch (optchar) {
+		case 'f':
+			path = optarg;
+			break;
+		case 'h':
+			translate_usage();
+			return EXIT_SUCCESS;
+		default:
+			translate_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!path && optind < argc && strcmp(argv[optind], "-") == 0)
+		path = argv[optind];
+
+	if (!path && optind >= argc) {
+		fprintf(stderr, "Error - destination not specified\n");
+		translate_usage();
+		return EXIT_FAILURE;
+	}
+
+	check_root_or_die("batctl translate");
+
+	if (path)
+		return translate_batch(state, path);
+
+	return translate_single(state, argv[optind]);
+}
+
+COMMAND(SUBCOMMAND, translate, "t", COMMAND_FLAG_MESH_IFACE | COMMAND_FLAG_NETLINK, NULL,
 	"<destination>     \ttranslate a destination to the originator responsible for it");
@@ -21,6 +21,7 @@
  * License-Filename: LICENSES/preferred/GPL-2.0
  */
 
+#include <errno.h>
 #include <netinet/if_ether.h>
 #include <netlink/netlink.h>
 #include <netlink/genl/genl.h>
@@ -33,30 +34,56 @@
 #include "batman_adv.h"
 #include "bat-hosts.h"
 #include "debug.h"
+#include "filter.h"
 #include "functions.h"
+#include "group.h"
 #include "main.h"
 #include "netlink.h"
+#include "sort.h"
 
-static const int translocal_mandatory[] = {
-	BATADV_ATTR_TT_ADDRESS,
-	BATADV_ATTR_TT_VID,
-	BATADV_ATTR_TT_CRC32,
-	BATADV_ATTR_TT_FLAGS,
+struct translocal_row {
+	const uint8_t *addr;
+	uint16_t vid;
+	uint32_t crc32;
+	uint32_t flags;
+	uint32_t last_seen_msecs;
+};
+
+static const struct netlink_attr_desc translocal_attrs[] = {
+	NETLINK_ATTR_REQ(BATADV_ATTR_TT_ADDRESS, MAC,
+			 struct translocal_row, addr),
+	NETLINK_ATTR_REQ(BATADV_ATTR_TT_VID, U16,
+			 struct translocal_row, vid),
+	NETLINK_ATTR_REQ(BATADV_ATTR_TT_CRC32, U32,
+			 struct translocal_row, crc32),
+	NETLINK_ATTR_REQ(BATADV_ATTR_TT_FLAGS, U32,
+			 struct translocal_row, flags),
+	NETLINK_ATTR_OPT(BATADV_ATTR_LAST_SEEN_MSECS, U32,
+			 struct translocal_row, last_seen_msecs),
 };
 
-static int translocal_callback(struct nl_msg *msg, void *arg)
+static int translocal_callback(struct nlmsghdr *nlh, void *arg)
 {
-	int last_seen_msecs = 0, last_seen_secs = 0;
-	struct nlattr *attrs[BATADV_ATTR_MAX+1];
-	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	uint32_t last_seen_msecs = 0;
+	struct translocal_row row;
+	netlink_attr_mask_t present;
 	struct print_opts *opts = arg;
-	struct bat_host *bat_host;
 	struct genlmsghdr *ghdr;
 	char r, p, n, x, w, i;
-	uint8_t *addr;
+	const uint8_t *addr;
 	int16_t vid;
 	uint32_t crc32;
 	uint32_t flags;
+	int ret;
+	struct {
+		uint8_t client[ETH_ALEN];
+		int16_t vid;
+	} key;
+	struct {
+		uint32_t flags;
+		uint32_t crc32;
+	} value;
+	struct output *out;
 
 	if (!genlmsg_valid_hdr(nlh, 0)) {
 		fputs("Received invalid data from kernel.\n", stderr);
@@ -68,23 +95,26 @@ static int translocal_callback(struct nl_msg *msg, void *arg)
 	if (ghdr->cmd != BATADV_CMD_GET_TRANSTABLE_LOCAL)
 		return NL_OK;
 
-	if (nla_parse(attrs, BATADV_ATTR_MAX, genlmsg_attrdata(ghdr, 0),
-		      genlmsg_len(ghdr), batadv_netlink_policy)) {
+	ret = netlink_decode_attrs(ghdr, translocal_attrs,
+				   ARRAY_SIZE(translocal_attrs),
+				   &row, sizeof(row), &present);
+	if (ret == -ENOENT) {
+		fputs("Missing attributes from kernel\n", stderr);
+		exit(1);
+	} else if (ret < 0) {
 		fputs("Received invalid data from kernel.\n", stderr);
 		exit(1);
 	}
 
-	if (missing_mandatory_attrs(attrs, translocal_mandatory,
-				    ARRAY_SIZE(translocal_mandatory))) {
-		fputs("Missing attributes from kernel\n", stderr);
-		exit(1);
-	}
+	if (!filter_match(opts->filter, translocal_attrs,
+			  ARRAY_SIZE(translocal_attrs), &row, present))
+		return NL_OK;
 
-	addr = nla_data(attrs[BATADV_ATTR_TT_ADDRESS]);
-	vid = nla_get_u16(attrs[BATADV_ATTR_TT_VID]);
-	crc32 = nla_get_u32(attrs[BATADV_ATTR_TT_CRC32]);
-	flags = nla_get_u32(attrs[BATADV_ATTR_TT_FLAGS]);
-	last_seen_msecs = 0, last_seen_secs = 0;
+	addr = row.addr;
+	vid = row.vid;
+	crc32 = row.crc32;
+	flags = row.flags;
+	last_seen_msecs = 0;
 
 	if (opts->read_opt & MULTICAST_ONLY && !(addr[0] & 0x01))
 		return NL_OK;
@@ -107,29 +137,55 @@ static int translocal_callback(struct nl_msg *msg, void *arg)
 	if (flags & BATADV_TT_CLIENT_NOPURGE)  {
 		p = 'P';
 	} else {
-		if (!attrs[BATADV_ATTR_LAST_SEEN_MSECS]) {
+		if (!(present & NETLINK_ATTR_BIT(BATADV_ATTR_LAST_SEEN_MSECS))) {
 			fputs("Received invalid data from kernel.\n", stderr);
 			exit(1);
 		}
 
-		last_seen_msecs = nla_get_u32(
-			attrs[BATADV_ATTR_LAST_SEEN_MSECS]);
-		last_seen_secs = last_seen_msecs / 1000;
-		last_seen_msecs = last_seen_msecs % 1000;
+		last_seen_msecs = row.last_seen_msecs;
 	}
 
-	bat_host = bat_hosts_find_by_mac((char *)addr);
-	if (!(opts->read_opt & USE_BAT_HOSTS) || !bat_host)
-		printf("%02x:%02x:%02x:%02x:%02x:%02x ",
-		       addr[0], addr[1], addr[2],
-		       addr[3], addr[4], addr[5]);
-	else
-		printf("%17s ", bat_host->name);
+	if (group_add(opts->group, translocal_attrs,
+		      ARRAY_SIZE(translocal_attrs), &row, present))
+		return NL_OK;
+
+	if (sort_add(opts->sort, nlh, translocal_attrs,
+		     ARRAY_SIZE(translocal_attrs), &row, present))
+		return NL_OK;
+
+	if (opts->out.format != OUTPUT_FORMAT_TEXT) {
+		netlink_print_record(opts, translocal_attrs,
+				     ARRAY_SIZE(translocal_attrs), &row, present);
+		return NL_OK;
+	}
 
-	printf("%4i [%c%c%c%c%c%c] %3u.%03u   (0x%.8x)\n",
-	       BATADV_PRINT_VID(vid), r, p, n, x, w, i,
-	       last_seen_secs, last_seen_msecs,
-	       crc32);
+	out = netlink_row_begin(opts);
+
+	output_host(out, addr, opts->read_opt);
+	output_char(out, ' ');
+	output_int(out, BATADV_PRINT_VID(vid), 4);
+	output_str(out, " [");
+	output_char(out, r);
+	output_char(out, p);
+	output_char(out, n);
+	output_char(out, x);
+	output_char(out, w);
+	output_char(out, i);
+	output_str(out, "] ");
+	output_seconds(out, last_seen_msecs, 3);
+	output_str(out, "   (0x");
+	output_hex(out, crc32, 8);
+	output_str(out, ")\n");
+
+	memset(&key, 0, sizeof(key));
+	memcpy(key.client, addr, ETH_ALEN);
+	key.vid = vid;
+
+	memset(&value, 0, sizeof(value));
+	value.flags = flags;
+	value.crc32 = crc32;
+
+	netlink_row_end(opts, &key, sizeof(key), &value, sizeof(value));
 
 	return NL_OK;
 }
@@ -149,6 +205,8 @@ static struct debug_table_data batctl_debug_table_translocal = {
 	.debugfs_name = "transtable_local",
 	.header_lines = 2,
 	.netlink_fn = netlink_print_translocal,
+	.nl_cmd = BATADV_CMD_GET_TRANSTABLE_LOCAL,
+	.netlink_cb = translocal_callback,
 	.option_unicast_only = 1,
 	.option_multicast_only = 1,
 };